@@ -17,6 +17,7 @@
 
 #import "SPRWebSocket.h"
 #import "TrustKit.h"
+#import "SPTracer.h"
 
 #if TARGET_OS_IPHONE
 #define HAS_ICU
@@ -1057,6 +1058,8 @@ static const uint8_t SRPayloadLenMask   = 0x7F;
 {
     [self assertOnWorkQueue];
     
+    SPTraceScope("websocket.write", nil, nil);
+    
     NSUInteger dataLength = _outputBuffer.length;
     if (dataLength - _outputBufferOffset > 0 && _outputStream.hasSpaceAvailable) {
         NSInteger bytesWritten = [_outputStream write:_outputBuffer.bytes + _outputBufferOffset maxLength:dataLength - _outputBufferOffset];
@@ -1310,6 +1313,8 @@ static const char CRLFCRLFBytes[] = {'\r', '\n', '\r', '\n'};
         return;
     }
     
+    SPTraceScope("websocket.read", nil, nil);
+    
     while ([self _innerPumpScanner]) {
         
     }
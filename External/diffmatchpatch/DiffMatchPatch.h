@@ -120,7 +120,8 @@ typedef enum {
   // Chunk size for context length.
   uint16_t Patch_Margin;
 
-  // The number of bits in an int.
+  // Longest pattern handled by the Bitap matcher, and the size patches get
+  // split into.  Bitmasks span as many 64-bit words as needed.
   NSUInteger Match_MaxBits;
 }
 
@@ -130,6 +131,7 @@ typedef enum {
 @property (nonatomic, assign) NSInteger Match_Distance;
 @property (nonatomic, assign) float Patch_DeleteThreshold;
 @property (nonatomic, assign) uint16_t Patch_Margin;
+@property (nonatomic, assign) NSUInteger Match_MaxBits;
 
 - (NSMutableArray *)diff_mainOfOldString:(NSString *)text1 andNewString:(NSString *)text2;
 - (NSMutableArray *)diff_mainOfOldString:(NSString *)text1 andNewString:(NSString *)text2 checkLines:(BOOL)checklines;
@@ -48,6 +48,112 @@ void splice(NSMutableArray *input, NSUInteger start, NSUInteger count, NSArray *
   }
 }
 
+
+// Bitap alphabet, stored as a flat table of multi-word bitmasks.
+// Row 0 matches nothing; row (i + 1) holds the mask for chars[i].
+typedef struct {
+  NSUInteger wordCount;
+  NSUInteger charCount;
+  UniChar *chars;
+  uint64_t *masks;
+} DiffMatchAlphabet;
+
+static int diff_compareUniChars(const void *a, const void *b) {
+  return (int)*(const UniChar *)a - (int)*(const UniChar *)b;
+}
+
+static DiffMatchAlphabet diff_matchAlphabetCreate(CFStringRef pattern) {
+  DiffMatchAlphabet alphabet;
+  CFIndex length = CFStringGetLength(pattern);
+
+  alphabet.wordCount = MAX((NSUInteger)1, ((NSUInteger)length + 63) / 64);
+
+  // Sorted, unique characters.
+  UniChar *chars = (UniChar *)malloc(MAX(length, (CFIndex)1) * sizeof(UniChar));
+  CFStringGetCharacters(pattern, CFRangeMake(0, length), chars);
+  qsort(chars, length, sizeof(UniChar), diff_compareUniChars);
+
+  NSUInteger charCount = 0;
+  for (CFIndex i = 0; i < length; i++) {
+    if (charCount == 0 || chars[charCount - 1] != chars[i]) {
+      chars[charCount++] = chars[i];
+    }
+  }
+  alphabet.chars = chars;
+  alphabet.charCount = charCount;
+  alphabet.masks = (uint64_t *)calloc((charCount + 1) * alphabet.wordCount, sizeof(uint64_t));
+
+  CFStringInlineBuffer inlineBuffer;
+  CFStringInitInlineBuffer(pattern, &inlineBuffer, CFRangeMake(0, length));
+  for (CFIndex i = 0; i < length; i++) {
+    UniChar ch = CFStringGetCharacterFromInlineBuffer(&inlineBuffer, i);
+    UniChar *found = (UniChar *)bsearch(&ch, chars, charCount, sizeof(UniChar), diff_compareUniChars);
+    NSUInteger bit = (NSUInteger)(length - i - 1);
+    uint64_t *mask = alphabet.masks + (found - chars + 1) * alphabet.wordCount;
+    mask[bit / 64] |= (1ULL << (bit % 64));
+  }
+
+  return alphabet;
+}
+
+static void diff_matchAlphabetRelease(DiffMatchAlphabet *alphabet) {
+  free(alphabet->chars);
+  free(alphabet->masks);
+}
+
+/**
+ * Map the text characters at (j - 1), for j in [start, finish], into
+ * alphabet rows.  Characters past the end of the text match nothing.
+ */
+static NSUInteger *diff_matchAlphabetCreateRows(const DiffMatchAlphabet *alphabet, CFStringRef text, NSUInteger start, NSUInteger finish) {
+  NSUInteger *rows = (NSUInteger *)calloc(finish - start + 1, sizeof(NSUInteger));
+  NSUInteger textLength = (NSUInteger)CFStringGetLength(text);
+  NSUInteger end = MIN(finish, textLength);
+  if (end < start) {
+    return rows;
+  }
+
+  CFStringInlineBuffer inlineBuffer;
+  CFStringInitInlineBuffer(text, &inlineBuffer, CFRangeMake(start - 1, end - start + 1));
+  for (NSUInteger i = 0; i <= end - start; i++) {
+    UniChar ch = CFStringGetCharacterFromInlineBuffer(&inlineBuffer, i);
+    UniChar *found = (UniChar *)bsearch(&ch, alphabet->chars, alphabet->charCount, sizeof(UniChar), diff_compareUniChars);
+    rows[i] = (found == NULL) ? 0 : (NSUInteger)(found - alphabet->chars + 1);
+  }
+  return rows;
+}
+
+// rd = ((next << 1) | 1) & charMatch
+NS_INLINE void diff_bitapExactStep(uint64_t *rd, const uint64_t *next, const uint64_t *charMatch, NSUInteger wordCount) {
+  uint64_t carry = 1;
+  for (NSUInteger w = 0; w < wordCount; w++) {
+    uint64_t word = next[w];
+    rd[w] = ((word << 1) | carry) & charMatch[w];
+    carry = word >> 63;
+  }
+}
+
+// rd = (((next << 1) | 1) & charMatch) | (((lastNext | last) << 1) | 1) | lastNext
+NS_INLINE void diff_bitapFuzzyStep(uint64_t *rd, const uint64_t *next, const uint64_t *last, const uint64_t *lastNext, const uint64_t *charMatch, NSUInteger wordCount) {
+  uint64_t carry = 1;
+  uint64_t lastCarry = 1;
+  for (NSUInteger w = 0; w < wordCount; w++) {
+    uint64_t word = next[w];
+    uint64_t lastWord = lastNext[w] | last[w];
+    rd[w] = (((word << 1) | carry) & charMatch[w]) | ((lastWord << 1) | lastCarry) | lastNext[w];
+    carry = word >> 63;
+    lastCarry = lastWord >> 63;
+  }
+}
+
+// rd = (1 << bits) - 1
+NS_INLINE void diff_bitapSetLowBits(uint64_t *rd, NSUInteger bits, NSUInteger wordCount) {
+  for (NSUInteger w = 0; w < wordCount && bits > w * 64; w++) {
+    NSUInteger wordBits = MIN(bits - w * 64, (NSUInteger)64);
+    rd[w] = (wordBits == 64) ? UINT64_MAX : ((1ULL << wordBits) - 1);
+  }
+}
+
 @implementation Diff
 
 @synthesize operation;
@@ -265,6 +371,7 @@ void splice(NSMutableArray *input, NSUInteger start, NSUInteger count, NSArray *
 @synthesize Match_Distance;
 @synthesize Patch_DeleteThreshold;
 @synthesize Patch_Margin;
+@synthesize Match_MaxBits;
 
 - (id)init
 {
@@ -1936,8 +2043,9 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
   NSAssert((Match_MaxBits == 0 || pattern.length <= Match_MaxBits),
            @"Pattern too long for this application.");
 
-  // Initialise the alphabet.
-  NSMutableDictionary *s = [self match_alphabet:pattern];
+  // Initialise the alphabet.  Patterns may span several 64-bit words.
+  DiffMatchAlphabet alphabet = diff_matchAlphabetCreate((CFStringRef)pattern);
+  NSUInteger wordCount = alphabet.wordCount;
 
   // Highest score beyond which we give up.
   double score_threshold = Match_Threshold;
@@ -1955,13 +2063,20 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
   }
 
   // Initialise the bit arrays.
-  NSUInteger matchmask = 1 << (pattern.length - 1);
+  NSUInteger matchword = (pattern.length - 1) / 64;
+  uint64_t matchmask = 1ULL << ((pattern.length - 1) % 64);
   best_loc = NSNotFound;
 
   NSUInteger bin_min, bin_mid;
   NSUInteger bin_max = pattern.length + text.length;
-  NSUInteger *rd = NULL;
-  NSUInteger *last_rd = NULL;
+  // Each pass only ever narrows the range, so the bit arrays just cover
+  // [start, finish + 1], and the text gets mapped into alphabet rows once.
+  uint64_t *rd = NULL;
+  uint64_t *last_rd = NULL;
+  NSUInteger rd_start = 0;
+  NSUInteger last_rd_start = 0;
+  NSUInteger *rows = NULL;
+  NSUInteger rows_start = 0;
   for (NSUInteger d = 0; d < pattern.length; d++) {
     // Scan for the best match; each iteration allows for one more error.
     // Run a binary search to determine how far from 'loc' we can stray at
@@ -1982,26 +2097,27 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
     NSUInteger start = MAX_OF_CONST_AND_DIFF(1, loc, bin_mid);
     NSUInteger finish = MIN(loc + bin_mid, text.length) + pattern.length;
 
-    rd = (NSUInteger *)calloc((finish + 2), sizeof(NSUInteger));
-    rd[finish + 1] = (1 << d) - 1;
+    if (rows == NULL) {
+      rows_start = start;
+      rows = diff_matchAlphabetCreateRows(&alphabet, (CFStringRef)text, start, finish);
+    }
+
+    rd_start = start;
+    rd = (uint64_t *)calloc((finish - start + 2) * wordCount, sizeof(uint64_t));
+    diff_bitapSetLowBits(rd + (finish + 1 - rd_start) * wordCount, d, wordCount);
 
     for (NSUInteger j = finish; j >= start; j--) {
-      NSUInteger charMatch;
-      if (text.length <= j - 1 || ![s diff_containsObjectForUnicharKey:[text characterAtIndex:(j - 1)]]) {
-        // Out of range.
-        charMatch = 0;
-      } else {
-        charMatch = [s diff_unsignedIntegerForUnicharKey:[text characterAtIndex:(j - 1)]];
-      }
+      uint64_t *current = rd + (j - rd_start) * wordCount;
+      const uint64_t *charMatch = alphabet.masks + rows[j - rows_start] * wordCount;
       if (d == 0) {
         // First pass: exact match.
-        rd[j] = (((rd[j + 1] << 1) | 1) & charMatch);
+        diff_bitapExactStep(current, current + wordCount, charMatch, wordCount);
       } else {
         // Subsequent passes: fuzzy match.
-        rd[j] = (((rd[j + 1] << 1) | 1) & charMatch)
-                | (((last_rd[j + 1] | last_rd[j]) << 1) | 1) | last_rd[j + 1];
+        const uint64_t *last = last_rd + (j - last_rd_start) * wordCount;
+        diff_bitapFuzzyStep(current, current + wordCount, last, last + wordCount, charMatch, wordCount);
       }
-      if ((rd[j] & matchmask) != 0) {
+      if ((current[matchword] & matchmask) != 0) {
         double score = [self match_bitapScoreForErrorCount:d location:(j - 1) near:loc pattern:pattern];
         // This match will almost certainly be better than any existing match.
         // But check anyway.
@@ -2011,7 +2127,7 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
           best_loc = j - 1;
           if (best_loc > loc) {
             // When passing loc, don't exceed our current distance from loc.
-            start = MAX_OF_CONST_AND_DIFF(1, 2 * loc, best_loc);
+            start = MAX(rd_start, MAX_OF_CONST_AND_DIFF(1, 2 * loc, best_loc));
           } else {
             // Already passed loc, downhill from here on in.
             break;
@@ -2024,6 +2140,7 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
       free(last_rd);
     }
     last_rd = rd;
+    last_rd_start = rd_start;
     
     if ([self match_bitapScoreForErrorCount:(d + 1) location:loc near:loc pattern:pattern] > score_threshold) {
       // No hope for a (better) match at greater error levels.
@@ -2038,6 +2155,10 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
   if (rd != NULL) {
     free(rd);
   }
+  if (rows != NULL) {
+    free(rows);
+  }
+  diff_matchAlphabetRelease(&alphabet);
 
   return best_loc;
 }
@@ -2409,7 +2530,7 @@ NS_INLINE NSString * diff_charsToTokenString(NSString *charsString, NSArray *tok
         text2 = [textMutable diff_javaSubstringFromStart:start_loc
             toEnd:MIN(end_loc + Match_MaxBits, textMutable.length)];
       }
-      if (text1 == text2) {
+      if ([text1 isEqualToString:text2]) {
         // Perfect match, just shove the Replacement text in.
         [textMutable replaceCharactersInRange:NSMakeRange(start_loc, text1.length) withString:[self diff_text2:aPatch.diffs]];
       } else {
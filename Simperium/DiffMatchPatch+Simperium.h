@@ -9,8 +9,27 @@
 #import "DiffMatchPatch.h"
 
 
+typedef NS_ENUM(NSInteger, DiffMatchPatchGranularity) {
+    DiffMatchPatchGranularityCharacters = 0,
+    DiffMatchPatchGranularityWords      = 1,
+    DiffMatchPatchGranularityLines      = 2
+};
+
+
 @interface DiffMatchPatch (Simperium)
 
+// DiffMatchPatch carries mutable settings (Diff_Timeout, Match_Threshold, etc), so instances can't be shared across
+// threads. Each thread gets its own instance, with Simperium's settings: please, don't change them!
++ (instancetype)sp_threadLocalInstance;
+
 - (NSArray *)patch_apply:(NSArray *)sourcePatches toString:(NSString *)text error:(NSError **)error;
 
+// Time-Budgeted Diffing: Starts at the given granularity, and escalates to coarser ones (words, then lines) whenever the
+// estimated cost exceeds the budget. The budget is also enforced as a deadline, past which the diff gets coarser.
+- (NSMutableArray *)sp_diffsFromText:(NSString *)oldText
+                              toText:(NSString *)newText
+                         granularity:(DiffMatchPatchGranularity)granularity
+                              budget:(NSTimeInterval)budget
+                     usedGranularity:(DiffMatchPatchGranularity *)usedGranularity;
+
 @end
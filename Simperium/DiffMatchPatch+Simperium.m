@@ -12,10 +12,40 @@
 
 
 static NSInteger DiffMatchPatchApplyError = -9999;
+static NSString * const DiffMatchPatchThreadLocalKey = @"com.simperium.DiffMatchPatch";
+
+// Bitap handles long patterns: large patches get applied in one go, rather than split into 32 char pieces
+static NSUInteger const DiffMatchPatchMatchMaxBits  = 1024;
+
+// Budgeted Diffs: Myers' worst case is proportional to the product of the lengths. Rough throughput, on a mid-range device
+static double const DiffMatchPatchEstimatedCellsPerSecond   = 50e6;
+
+// Tokens are encoded as single unichars: past this point, the encoding would wrap around
+static NSUInteger const DiffMatchPatchMaxTokenCount         = USHRT_MAX;
+
+
+static NSTimeInterval DiffMatchPatchEstimatedTime(NSUInteger oldLength, NSUInteger newLength)
+{
+    return ((double)oldLength * (double)newLength) / DiffMatchPatchEstimatedCellsPerSecond;
+}
 
 
 @implementation DiffMatchPatch (Simperium)
 
++ (instancetype)sp_threadLocalInstance {
+    
+    NSMutableDictionary *threadDictionary   = [[NSThread currentThread] threadDictionary];
+    DiffMatchPatch *dmp                     = threadDictionary[DiffMatchPatchThreadLocalKey];
+    
+    if (!dmp) {
+        dmp = [[DiffMatchPatch alloc] init];
+        dmp.Match_MaxBits = DiffMatchPatchMatchMaxBits;
+        threadDictionary[DiffMatchPatchThreadLocalKey] = dmp;
+    }
+    
+    return dmp;
+}
+
 - (NSArray *)patch_apply:(NSArray *)sourcePatches toString:(NSString *)text error:(NSError **)error {
     
     NSArray *patched    = [self patch_apply:sourcePatches toString:text];
@@ -41,4 +71,118 @@ static NSInteger DiffMatchPatchApplyError = -9999;
     return patched;
 }
 
+- (NSMutableArray *)sp_diffsFromText:(NSString *)oldText
+                              toText:(NSString *)newText
+                         granularity:(DiffMatchPatchGranularity)granularity
+                              budget:(NSTimeInterval)budget
+                     usedGranularity:(DiffMatchPatchGranularity *)usedGranularity
+{
+    NSParameterAssert(oldText);
+    NSParameterAssert(newText);
+    
+    NSTimeInterval deadline = [NSDate timeIntervalSinceReferenceDate] + budget;
+    
+    // Common affixes are cheap to find, and don't count towards the cost
+    NSUInteger minLength    = MIN(oldText.length, newText.length);
+    NSUInteger prefixLength = [self diff_commonPrefixOfFirstString:oldText andSecondString:newText];
+    NSUInteger suffixLength = MIN([self diff_commonSuffixOfFirstString:oldText andSecondString:newText], minLength - prefixLength);
+    
+    // Line Diffs: Make sure the affixes don't split any line
+    if (granularity == DiffMatchPatchGranularityLines) {
+        NSRange prefixBreak = [oldText rangeOfString:@"\n" options:NSBackwardsSearch range:NSMakeRange(0, prefixLength)];
+        prefixLength        = (prefixBreak.location == NSNotFound) ? 0 : NSMaxRange(prefixBreak);
+    
+        NSUInteger suffixLocation = oldText.length - suffixLength;
+        if (suffixLength > 0 && suffixLocation > 0) {
+            NSRange suffixBreak = [oldText rangeOfString:@"\n" options:0 range:NSMakeRange(suffixLocation - 1, suffixLength)];
+            suffixLength        = (suffixBreak.location == NSNotFound) ? 0 : oldText.length - NSMaxRange(suffixBreak);
+        }
+    }
+    
+    NSString *oldMiddle     = [oldText substringWithRange:NSMakeRange(prefixLength, oldText.length - prefixLength - suffixLength)];
+    NSString *newMiddle     = [newText substringWithRange:NSMakeRange(prefixLength, newText.length - prefixLength - suffixLength)];
+    
+    // Escalate until the estimated cost fits within the remaining budget
+    NSMutableArray *diffs   = [self sp_diffsFromText:oldMiddle toText:newMiddle granularity:granularity deadline:deadline];
+    while (!diffs && granularity < DiffMatchPatchGranularityLines) {
+        granularity += 1;
+        diffs = [self sp_diffsFromText:oldMiddle toText:newMiddle granularity:granularity deadline:deadline];
+    }
+    
+    // Too many unique lines to tokenize: Replace the whole block
+    if (!diffs) {
+        diffs = [NSMutableArray array];
+        [self sp_appendDeleteRange:NSMakeRange(0, oldMiddle.length) insertRange:NSMakeRange(0, newMiddle.length) toDiffs:diffs oldText:oldMiddle newText:newMiddle];
+    }
+    
+    // Restore the affixes. Note: diff_cleanupMerge would slide the edits, and split lines
+    Diff *firstDiff = diffs.firstObject;
+    Diff *lastDiff  = diffs.lastObject;
+    
+    if (prefixLength > 0 && firstDiff.operation == DIFF_EQUAL) {
+        firstDiff.text = [[oldText substringToIndex:prefixLength] stringByAppendingString:firstDiff.text];
+    } else if (prefixLength > 0) {
+        [diffs insertObject:[Diff diffWithOperation:DIFF_EQUAL andText:[oldText substringToIndex:prefixLength]] atIndex:0];
+    }
+    
+    if (suffixLength > 0 && lastDiff.operation == DIFF_EQUAL) {
+        lastDiff.text = [lastDiff.text stringByAppendingString:[oldText substringFromIndex:oldText.length - suffixLength]];
+    } else if (suffixLength > 0) {
+        [diffs addObject:[Diff diffWithOperation:DIFF_EQUAL andText:[oldText substringFromIndex:oldText.length - suffixLength]]];
+    }
+    
+    if (usedGranularity) {
+        *usedGranularity = granularity;
+    }
+    
+    return diffs;
+}
+
+- (NSMutableArray *)sp_diffsFromText:(NSString *)oldText toText:(NSString *)newText granularity:(DiffMatchPatchGranularity)granularity deadline:(NSTimeInterval)deadline {
+    
+    NSTimeInterval remaining = deadline - [NSDate timeIntervalSinceReferenceDate];
+    
+    if (granularity == DiffMatchPatchGranularityCharacters) {
+        if (DiffMatchPatchEstimatedTime(oldText.length, newText.length) > remaining) {
+            return nil;
+        }
+    
+        return [self diff_mainOfOldString:oldText andNewString:newText checkLines:YES deadline:deadline];
+    }
+    
+    // Each Word (or Line) gets encoded as a single unichar. Lines are the last resort: they're attempted regardless of
+    // the estimate, and the deadline takes care of the rest
+    BOOL isWordMode         = (granularity == DiffMatchPatchGranularityWords);
+    NSArray *encoded        = isWordMode ? [self diff_wordsToCharsForFirstString:oldText andSecondString:newText] :
+                                           [self diff_linesToCharsForFirstString:oldText andSecondString:newText];
+    
+    NSString *oldChars      = encoded[0];
+    NSString *newChars      = encoded[1];
+    NSArray *tokens         = encoded[2];
+    
+    BOOL isOverBudget       = isWordMode && DiffMatchPatchEstimatedTime(oldChars.length, newChars.length) > remaining;
+    if (isOverBudget || tokens.count > DiffMatchPatchMaxTokenCount) {
+        return nil;
+    }
+    
+    NSMutableArray *diffs   = [self diff_mainOfOldString:oldChars andNewString:newChars checkLines:NO deadline:deadline];
+    if (isWordMode) {
+        [self diff_chars:diffs toTokens:tokens];
+    } else {
+        [self diff_chars:diffs toLines:tokens];
+    }
+    
+    return diffs;
+}
+
+- (void)sp_appendDeleteRange:(NSRange)deleteRange insertRange:(NSRange)insertRange toDiffs:(NSMutableArray *)diffs oldText:(NSString *)oldText newText:(NSString *)newText {
+    if (deleteRange.length > 0) {
+        [diffs addObject:[Diff diffWithOperation:DIFF_DELETE andText:[oldText substringWithRange:deleteRange]]];
+    }
+    
+    if (insertRange.length > 0) {
+        [diffs addObject:[Diff diffWithOperation:DIFF_INSERT andText:[newText substringWithRange:insertRange]]];
+    }
+}
+
 @end
@@ -16,12 +16,14 @@
 
 // Create a diff from the receiver using diff match patch.
 - (NSString *)sp_diffDeltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp;
+- (NSString *)sp_diffDeltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp budget:(NSTimeInterval)budget;
 
 // Returns the result of applying a diff to the receiver using diff match patch.
 - (NSArray *)sp_arrayByApplyingDiffDelta:(NSString *)delta diffMatchPatch:(DiffMatchPatch *)dmp;
 
 // Returns a transformed diff on top of another diff using diff match patch.
 - (NSString *)sp_transformDelta:(NSString *)delta onto:(NSString *)otherDelta diffMatchPatch:(DiffMatchPatch *)dmp;
+- (NSString *)sp_transformDelta:(NSString *)delta onto:(NSString *)otherDelta diffMatchPatch:(DiffMatchPatch *)dmp budget:(NSTimeInterval)budget;
 
 // TODO: Implement OP_LIST methods
 // Create a diff from the receiver
@@ -9,7 +9,9 @@
 #import "NSArray+Simperium.h"
 #import "SPMember.h"
 #import "DiffMatchPatch.h"
+#import "DiffMatchPatch+Simperium.h"
 #import "JSONKit+Simperium.h"
+#import "SPDiffBudget.h"
 
 
 @implementation NSArray (Simperium)
@@ -17,9 +19,14 @@
 #pragma mark - List Diffs With Diff Match Patch
 
 - (NSString *)sp_diffDeltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp
+{
+    return [self sp_diffDeltaWithArray:obj diffMatchPatch:dmp budget:SPDiffBudgetDefaultMemberTimeInterval];
+}
+
+- (NSString *)sp_diffDeltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp budget:(NSTimeInterval)budget
 {
     NSParameterAssert(obj); NSParameterAssert(dmp);
-    return [self sp_deltaWithArray:obj diffMatchPatch:dmp];
+    return [self sp_deltaWithArray:obj diffMatchPatch:dmp budget:budget];
 }
 
 - (NSArray *)sp_arrayByApplyingDiffDelta:(NSString *)delta diffMatchPatch:(DiffMatchPatch *)dmp
@@ -42,6 +49,11 @@
 }
 
 - (NSString *)sp_transformDelta:(NSString *)delta onto:(NSString *)otherDelta diffMatchPatch:(DiffMatchPatch *)dmp
+{
+    return [self sp_transformDelta:delta onto:otherDelta diffMatchPatch:dmp budget:SPDiffBudgetDefaultMemberTimeInterval];
+}
+
+- (NSString *)sp_transformDelta:(NSString *)delta onto:(NSString *)otherDelta diffMatchPatch:(DiffMatchPatch *)dmp budget:(NSTimeInterval)budget
 {
     NSParameterAssert(delta); NSParameterAssert(otherDelta); NSParameterAssert(dmp);
     NSString *sourceText = [self sp_newLineSeparatedJSONString];
@@ -57,32 +69,25 @@
     
     if ([diff2And1Text isEqualToString:diff2Text]) return @""; // no-op diff
     
-    NSMutableArray *diffs = [dmp diff_lineModeFromOldString:diff2Text andNewString:diff2And1Text deadline:0];
+    NSMutableArray *diffs = [dmp sp_diffsFromText:diff2Text toText:diff2And1Text granularity:DiffMatchPatchGranularityLines budget:budget usedGranularity:nil];
     
     return [dmp diff_toDelta:diffs];
 }
 
 
-- (NSString *)sp_deltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp
+- (NSString *)sp_deltaWithArray:(NSArray *)obj diffMatchPatch:(DiffMatchPatch *)dmp budget:(NSTimeInterval)budget
 {
     NSParameterAssert(obj); NSParameterAssert(dmp);
     
     NSString *nljs1 = [self sp_newLineSeparatedJSONString];
     NSString *nljs2 = [obj sp_newLineSeparatedJSONString];
     
-
-    NSArray *b = [dmp diff_linesToCharsForFirstString:nljs1 andSecondString:nljs2];
-    NSString *text1 = (NSString *)[b objectAtIndex:0];
-    NSString *text2 = (NSString *)[b objectAtIndex:1];
-    NSMutableArray *linearray = (NSMutableArray *)[b objectAtIndex:2];
-    
+    // One element per line: diff the lines within budget
     NSMutableArray *diffs = nil;
     @autoreleasepool {
-        diffs = [dmp diff_mainOfOldString:text1 andNewString:text2 checkLines:NO deadline:0];
+        diffs = [dmp sp_diffsFromText:nljs1 toText:nljs2 granularity:DiffMatchPatchGranularityLines budget:budget usedGranularity:nil];
     }
     
-    // Convert the diff back to original text.
-    [dmp diff_chars:diffs toLines:linearray];
     // Eliminate freak matches (e.g. blank lines)
     [dmp diff_cleanupSemantic:diffs];
     
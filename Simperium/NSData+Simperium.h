@@ -12,5 +12,15 @@
 @interface NSData(NSData_Simperium)
 
 + (NSData *)sp_decodeBase64WithString:(NSString *)strBase64;
+- (NSData *)sp_sha256Digest;
+
+// Binary Deltas: Content Defined Chunking over the raw bytes, so that insertions only affect the chunks around them.
+// Signatures are an opaque blob, meant to be persisted alongside the data they were built for.
+// Deltas are tab separated "=<count>" (copy), "-<count>" (skip) and "+<base64>" (insert) operations, counted in bytes.
+- (NSData *)sp_chunkSignatures;
+- (NSString *)sp_binaryDeltaFromData:(NSData *)oldData signatures:(NSData *)oldSignatures;
+
+// Returns nil if the delta is malformed, or wasn't built against the receiver
+- (NSData *)sp_dataByApplyingBinaryDelta:(NSString *)delta;
 
 @end
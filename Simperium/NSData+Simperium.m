@@ -7,6 +7,23 @@
 //
 
 #import "NSData+Simperium.h"
+#import "NSString+Simperium.h"
+#import <CommonCrypto/CommonDigest.h>
+
+
+// Chunk boundaries are found with a Gear rolling hash: ~5K bytes per chunk on average
+static NSUInteger const NSDataSimperiumChunkMinLength   = 1024;
+static NSUInteger const NSDataSimperiumChunkMaxLength   = 32 * 1024;
+static uint64_t const NSDataSimperiumChunkBoundaryMask  = (1 << 12) - 1;
+
+// Persisted Signature: FNV-1a hash + length, little endian. Locations are implied by the lengths
+static NSUInteger const NSDataSimperiumSignatureSize    = sizeof(uint64_t) + sizeof(uint32_t);
+
+typedef struct {
+    uint64_t    hash;
+    NSUInteger  location;
+    NSUInteger  length;
+} NSDataSimperiumChunk;
 
 // From https://github.com/mikeho/QSUtilities
 static const short _base64DecodingTable[256] = {
@@ -28,6 +45,65 @@ static const short _base64DecodingTable[256] = {
     -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2
 };
 
+
+#pragma mark - Chunking Helpers
+
+static const uint64_t *NSDataSimperiumGearTable(void)
+{
+    static uint64_t table[256];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // SplitMix64 with a fixed seed: boundaries must be stable across runs and devices
+        uint64_t seed = 0x5350436875686B73ULL;
+        for (NSInteger i = 0; i < 256; ++i) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            table[i] = z ^ (z >> 31);
+        }
+    });
+    return table;
+}
+
+static uint64_t NSDataSimperiumChunkHash(const uint8_t *bytes, NSUInteger length)
+{
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (NSUInteger i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Expands persisted signatures into NSDataSimperiumChunk structs. Returns nil if they don't cover the expected length
+static NSData *NSDataSimperiumChunksWithSignatures(NSData *signatures, NSUInteger expectedLength)
+{
+    if (signatures == nil || signatures.length % NSDataSimperiumSignatureSize != 0) {
+        return nil;
+    }
+    
+    NSUInteger count        = signatures.length / NSDataSimperiumSignatureSize;
+    NSMutableData *chunks   = [NSMutableData dataWithLength:count * sizeof(NSDataSimperiumChunk)];
+    NSDataSimperiumChunk *list = chunks.mutableBytes;
+    const uint8_t *bytes    = signatures.bytes;
+    NSUInteger location     = 0;
+    
+    for (NSUInteger i = 0; i < count; ++i) {
+        uint64_t hash       = 0;
+        uint32_t length     = 0;
+        memcpy(&hash, bytes + i * NSDataSimperiumSignatureSize, sizeof(hash));
+        memcpy(&length, bytes + i * NSDataSimperiumSignatureSize + sizeof(hash), sizeof(length));
+        
+        list[i].hash        = CFSwapInt64LittleToHost(hash);
+        list[i].location    = location;
+        list[i].length      = CFSwapInt32LittleToHost(length);
+        location            += list[i].length;
+    }
+    
+    return (location == expectedLength) ? chunks : nil;
+}
+
+
 @implementation NSData(NSData_Simperium)
 
 + (NSData *)sp_decodeBase64WithString:(NSString *)strBase64 {
@@ -109,4 +185,180 @@ static const short _base64DecodingTable[256] = {
     return [NSData dataWithBytesNoCopy:objResult length:j freeWhenDone:YES];
 }
 
+- (NSData *)sp_sha256Digest
+{
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(self.bytes, (CC_LONG)self.length, digest);
+    
+    return [NSData dataWithBytes:digest length:CC_SHA256_DIGEST_LENGTH];
+}
+
+
+#pragma mark - Binary Deltas
+
+- (NSData *)sp_chunkSignatures
+{
+    const uint64_t *gear    = NSDataSimperiumGearTable();
+    const uint8_t *bytes    = self.bytes;
+    NSUInteger length       = self.length;
+    NSMutableData *chunks   = [NSMutableData dataWithCapacity:(length / NSDataSimperiumChunkMinLength + 1) * NSDataSimperiumSignatureSize];
+    NSUInteger start        = 0;
+    uint64_t rolling        = 0;
+    
+    for (NSUInteger i = 0; i < length; ++i) {
+        rolling = (rolling << 1) + gear[bytes[i]];
+        
+        NSUInteger chunkLength = i + 1 - start;
+        BOOL isBoundary = (chunkLength >= NSDataSimperiumChunkMinLength && (rolling & NSDataSimperiumChunkBoundaryMask) == 0) ||
+                          chunkLength >= NSDataSimperiumChunkMaxLength ||
+                          i + 1 == length;
+        if (!isBoundary) {
+            continue;
+        }
+        
+        uint64_t hash       = CFSwapInt64HostToLittle(NSDataSimperiumChunkHash(bytes + start, chunkLength));
+        uint32_t size       = CFSwapInt32HostToLittle((uint32_t)chunkLength);
+        [chunks appendBytes:&hash length:sizeof(hash)];
+        [chunks appendBytes:&size length:sizeof(size)];
+        
+        start   = i + 1;
+        rolling = 0;
+    }
+    
+    return chunks;
+}
+
+- (NSString *)sp_binaryDeltaFromData:(NSData *)oldData signatures:(NSData *)oldSignatures
+{
+    NSParameterAssert(oldData);
+    
+    // Signatures that don't add up to the old data were built for something else
+    NSData *oldChunks   = NSDataSimperiumChunksWithSignatures(oldSignatures, oldData.length) ?:
+                          NSDataSimperiumChunksWithSignatures([oldData sp_chunkSignatures], oldData.length);
+    NSData *newChunks   = NSDataSimperiumChunksWithSignatures([self sp_chunkSignatures], self.length);
+    
+    // Map: Hash >> Old Chunk Indexes (in ascending order)
+    const NSDataSimperiumChunk *oldList = oldChunks.bytes;
+    NSUInteger oldCount                 = oldChunks.length / sizeof(NSDataSimperiumChunk);
+    NSMutableDictionary *oldIndexes     = [NSMutableDictionary dictionaryWithCapacity:oldCount];
+    
+    for (NSUInteger i = 0; i < oldCount; ++i) {
+        NSNumber *hash          = @(oldList[i].hash);
+        NSMutableArray *indexes = oldIndexes[hash];
+        if (!indexes) {
+            indexes             = [NSMutableArray arrayWithCapacity:1];
+            oldIndexes[hash]    = indexes;
+        }
+        [indexes addObject:@(i)];
+    }
+    
+    // Walk the new chunks: Deltas can only move forward, so matches behind the old cursor can't be reused
+    const NSDataSimperiumChunk *newList = newChunks.bytes;
+    NSUInteger newCount                 = newChunks.length / sizeof(NSDataSimperiumChunk);
+    const uint8_t *oldBytes             = oldData.bytes;
+    const uint8_t *newBytes             = self.bytes;
+    NSMutableArray *operations          = [NSMutableArray array];
+    NSUInteger oldCursor                = 0;
+    NSRange equalRange                  = NSMakeRange(0, 0);
+    NSRange insertRange                 = NSMakeRange(0, 0);
+    
+    for (NSUInteger i = 0; i < newCount; ++i) {
+        NSDataSimperiumChunk newChunk       = newList[i];
+        const NSDataSimperiumChunk *match   = NULL;
+        
+        for (NSNumber *index in oldIndexes[@(newChunk.hash)]) {
+            const NSDataSimperiumChunk *candidate = &oldList[index.unsignedIntegerValue];
+            if (candidate->location < oldCursor || candidate->length != newChunk.length) {
+                continue;
+            }
+            
+            // Verify: Hashes may collide
+            if (memcmp(oldBytes + candidate->location, newBytes + newChunk.location, newChunk.length) == 0) {
+                match = candidate;
+                break;
+            }
+        }
+        
+        if (!match) {
+            insertRange.length += newChunk.length;
+            continue;
+        }
+        
+        // Contiguous matches are merged into a single Copy
+        BOOL isContiguous = (match->location == NSMaxRange(equalRange) && insertRange.length == 0 && equalRange.length > 0);
+        if (isContiguous) {
+            equalRange.length += match->length;
+        } else {
+            [self sp_appendEqualRange:equalRange deleteRange:NSMakeRange(oldCursor, match->location - oldCursor) insertRange:insertRange toOperations:operations];
+            equalRange = NSMakeRange(match->location, match->length);
+        }
+        
+        oldCursor   = NSMaxRange(equalRange);
+        insertRange = NSMakeRange(newChunk.location + newChunk.length, 0);
+    }
+    
+    [self sp_appendEqualRange:equalRange deleteRange:NSMakeRange(oldCursor, oldData.length - oldCursor) insertRange:insertRange toOperations:operations];
+    
+    return [operations componentsJoinedByString:@"\t"];
+}
+
+- (void)sp_appendEqualRange:(NSRange)equalRange deleteRange:(NSRange)deleteRange insertRange:(NSRange)insertRange toOperations:(NSMutableArray *)operations
+{
+    if (equalRange.length > 0) {
+        [operations addObject:[NSString stringWithFormat:@"=%lu", (unsigned long)equalRange.length]];
+    }
+    
+    if (deleteRange.length > 0) {
+        [operations addObject:[NSString stringWithFormat:@"-%lu", (unsigned long)deleteRange.length]];
+    }
+    
+    if (insertRange.length > 0) {
+        NSString *inserted = [NSString sp_encodeBase64WithData:[self subdataWithRange:insertRange]];
+        [operations addObject:[@"+" stringByAppendingString:inserted]];
+    }
+}
+
+- (NSData *)sp_dataByApplyingBinaryDelta:(NSString *)delta
+{
+    NSCharacterSet *nonDigits   = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789"] invertedSet];
+    NSMutableData *result       = [NSMutableData dataWithCapacity:self.length];
+    NSUInteger cursor           = 0;
+    
+    for (NSString *operation in [delta componentsSeparatedByString:@"\t"]) {
+        if (operation.length == 0) {
+            continue;
+        }
+        
+        unichar type        = [operation characterAtIndex:0];
+        NSString *param     = [operation substringFromIndex:1];
+        
+        if (type == '+') {
+            NSData *inserted = [[NSData alloc] initWithBase64EncodedString:param options:0];
+            if (!inserted) {
+                return nil;
+            }
+            [result appendData:inserted];
+            continue;
+        }
+        
+        if (param.length == 0 || [param rangeOfCharacterFromSet:nonDigits].location != NSNotFound) {
+            return nil;
+        }
+        
+        unsigned long long count = strtoull(param.UTF8String, NULL, 10);
+        if (count > self.length - cursor || (type != '=' && type != '-')) {
+            return nil;
+        }
+        
+        if (type == '=') {
+            [result appendBytes:(const uint8_t *)self.bytes + cursor length:(NSUInteger)count];
+        }
+        
+        cursor += (NSUInteger)count;
+    }
+    
+    // Every single byte must have been either copied or skipped
+    return (cursor == self.length) ? result : nil;
+}
+
 @end
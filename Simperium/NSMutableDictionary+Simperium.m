@@ -25,7 +25,7 @@ static char const * const SimperiumKey = "simperiumKey";
     SPObject *spObject = objc_getAssociatedObject(self, ObjectKey);
     NSString *simperiumKey = objc_getAssociatedObject(self, SimperiumKey);
 
-    [spObject.bucket.storage object:self forKey:simperiumKey didChangeValue:anObject forKey:aKey];
+    [spObject.bucket.storage object:spObject forKey:simperiumKey didChangeValue:anObject forKey:aKey];
 }
 
 - (void)simperiumSetValue:(id)anObject forKey:(id)aKey {
@@ -37,7 +37,7 @@ static char const * const SimperiumKey = "simperiumKey";
     SPObject *spObject = objc_getAssociatedObject(self, ObjectKey);
     NSString *simperiumKey = objc_getAssociatedObject(self, SimperiumKey);
     
-    [spObject.bucket.storage object:self forKey:simperiumKey didChangeValue:anObject forKey:aKey];
+    [spObject.bucket.storage object:spObject forKey:simperiumKey didChangeValue:anObject forKey:aKey];
 }
 
 - (NSString *)simperiumKey {
@@ -10,6 +10,8 @@
 
 
 
+@class SPMetrics;
+
 typedef void (^SPBucketForceSyncCompletion)(BOOL signatureUpdated);
 
 #pragma mark ====================================================================================
@@ -31,6 +33,7 @@ typedef void (^SPBucketForceSyncCompletion)(BOOL signatureUpdated);
 @property (nonatomic, strong) SPRelationshipResolver        *relationshipResolver;
 @property (nonatomic, strong) SPChangeProcessor             *changeProcessor;
 @property (nonatomic, strong) SPIndexProcessor              *indexProcessor;
+@property (nonatomic, strong) SPMetrics                     *metrics;
 @property (nonatomic, strong) dispatch_queue_t              processorQueue;
 @property (nonatomic,   copy) SPBucketForceSyncCompletion   forceSyncCompletion;
 @property (nonatomic,   copy) NSString                      *forceSyncSignature;
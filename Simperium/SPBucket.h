@@ -98,6 +98,10 @@ typedef NS_ENUM(NSUInteger, SPBucketChangeType) {
 - (NSInteger)numObjects;
 - (NSInteger)numObjectsForPredicate:(NSPredicate *)predicate;
 
+// Registers a secondary index over a member, used to answer simple predicates (==, IN and, when sorted, ranges)
+// without scanning the whole bucket. Only JSON Storage supports this: Core Data relies on your model's indexes
+- (void)addIndexForMemberNamed:(NSString *)memberName sorted:(BOOL)sorted;
+
 // Retrive Simperium's Sync'ing stats:
 //  - Local Pending Changes:    Number of captured changes, pending to be sent / acknowledged
 //  - Local Enqueued Changes:   Number of objects marked for further processing
@@ -105,4 +109,11 @@ typedef NS_ENUM(NSUInteger, SPBucketChangeType) {
 typedef void(^SPBucketStatsCallback)(SPBucket *bucket, NSUInteger localPendingChanges, NSUInteger localEnqueuedChanges, NSUInteger localEnqueuedDeletions);
 - (void)statsWithCallback:(SPBucketStatsCallback)callback;
 
+// Sync metrics, meant to be cheap enough to stay on in production. The snapshot holds:
+//  - counters:     Changes sent, acknowledged, errored and retried. Remote changes applied, versions fetched
+//  - gauges:       Queue depths, and pending version requests
+//  - histograms:   Ack latency, remote change apply, index, storage save, and per member type diff times (milliseconds)
+typedef void(^SPBucketMetricsCallback)(SPBucket *bucket, NSDictionary *metrics);
+- (void)metricsWithCallback:(SPBucketMetricsCallback)callback;
+
 @end
@@ -17,6 +17,8 @@
 #import "SPGhost.h"
 #import "JSONKit+Simperium.h"
 #import "SPRelationshipResolver.h"
+#import "SPMetrics.h"
+#import "SPTracer.h"
 
 
 
@@ -45,7 +47,10 @@
         _relationshipResolver               = resolver;
         _propertyMismatchFailsafeEnabled    = false;
         
+        _metrics                            = [SPMetrics new];
+
         SPDiffer *aDiffer                   = [[SPDiffer alloc] initWithSchema:aSchema];
+        aDiffer.metrics                     = _metrics;
         _differ                             = aDiffer;
 
         // Label is used to support multiple simperium instances (e.g. unit testing)
@@ -144,6 +149,12 @@
     return [self.storage numObjectsForBucketName:self.name predicate:predicate];
 }
 
+- (void)addIndexForMemberNamed:(NSString *)memberName sorted:(BOOL)sorted {
+    if ([self.storage respondsToSelector:@selector(addIndexForMemberNamed:sorted:bucketName:)]) {
+        [self.storage addIndexForMemberNamed:memberName sorted:sorted bucketName:self.name];
+    }
+}
+
 - (void)statsWithCallback:(SPBucketStatsCallback)callback {
     SPChangeProcessor *processor = self.changeProcessor;
     dispatch_async(self.processorQueue, ^{
@@ -157,6 +168,28 @@
     });
 }
 
+- (void)metricsWithCallback:(SPBucketMetricsCallback)callback {
+    SPChangeProcessor *processor    = self.changeProcessor;
+    SPDiffer *differ                = self.differ;
+    SPMetrics *metrics              = self.metrics;
+    
+    dispatch_async(self.processorQueue, ^{
+        // Queue depths are sampled right before the snapshot: the processor's collections are only safe to read here
+        [metrics gaugeNamed:SPMetricsPendingChanges].value          = processor.numChangesPending;
+        [metrics gaugeNamed:SPMetricsQueuedChanges].value           = processor.numKeysForObjectsWithMoreChanges;
+        [metrics gaugeNamed:SPMetricsQueuedDeletions].value         = processor.numKeysForObjectToDelete;
+        [metrics gaugeNamed:SPMetricsQueuedRetries].value           = processor.numKeysForObjectsWithPendingRetry;
+        [metrics gaugeNamed:SPMetricsDiffBudgetEscalations].value   = differ.budgetEscalationCount;
+        [metrics gaugeNamed:SPMetricsDiffBudgetOverruns].value      = differ.budgetOverrunCount;
+        
+        NSDictionary *snapshot = [metrics snapshot];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            callback(self, snapshot);
+        });
+    });
+}
+
 - (NSString *)lastChangeSignature {
     // Load it: Skip for Ephemeral Storage
     if (!_lastChangeSignature && !_storage.isEphemeral) {
@@ -178,14 +211,36 @@
     }
 
     NSString *sigKey = [NSString stringWithFormat:@"lastChangeSignature-%@", self.instanceLabel];
-    [[NSUserDefaults standardUserDefaults] setObject:_lastChangeSignature forKey: sigKey];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+    
+    // Nuking it is always safe: we'll just re-index
+    if (!signature) {
+        [[NSUserDefaults standardUserDefaults] removeObjectForKey:sigKey];
+        [[NSUserDefaults standardUserDefaults] synchronize];
+        return;
+    }
+    
+    // A signature that's ahead of the stored changes would skip them for good, after a crash. Persist it only once
+    // everything saved so far has hit the disk, and as long as it hasn't been superseded in the meantime
+    NSString *pendingSignature = _lastChangeSignature;
+    
+    [self.storage commitPendingOperations:^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (![_lastChangeSignature isEqualToString:pendingSignature]) {
+                return;
+            }
+            
+            [[NSUserDefaults standardUserDefaults] setObject:pendingSignature forKey:sigKey];
+            [[NSUserDefaults standardUserDefaults] synchronize];
+        });
+    }];
 }
 
 
 #pragma mark Notifications
 
 - (void)objectDidChange:(NSNotification *)notification {
+    SPTraceScope("notify.change", self.name, nil);
+    
     if ([self.delegate respondsToSelector:@selector(bucket:didChangeObjectForKey:forChangeType:memberNames:)]) {
         // Only one object changed; get it
         NSSet *set = (NSSet *)notification.userInfo[@"keys"];
@@ -196,6 +251,8 @@
 }
 
 - (void)objectsAdded:(NSNotification *)notification {
+    SPTraceScope("notify.insert", self.name, nil);
+    
     // When objects are added, resolve any references to them that hadn't yet been fulfilled
     // Note: this notification isn't currently triggered from SPIndexProcessor when adding objects from the index. Instead,
     // references are resolved from within SPIndexProcessor itself
@@ -211,6 +268,8 @@
 }
 
 - (void)objectKeysDeleted:(NSNotification *)notification  {
+    SPTraceScope("notify.delete", self.name, nil);
+    
     NSSet *set = (NSSet *)notification.userInfo[@"keys"];
     BOOL delegateRespondsToSelector = [self.delegate respondsToSelector:@selector(bucket:didChangeObjectForKey:forChangeType:memberNames:)];
 
@@ -223,6 +282,8 @@
 }
 
 - (void)objectsAcknowledged:(NSNotification *)notification  {
+    SPTraceScope("notify.acknowledge", self.name, nil);
+    
     if ([self.delegate respondsToSelector:@selector(bucket:didChangeObjectForKey:forChangeType:memberNames:)]) {
         NSSet *set = (NSSet *)notification.userInfo[@"keys"];
         for (NSString *key in set) {
@@ -232,6 +293,8 @@
 }
 
 - (void)objectsWillChange:(NSNotification *)notification  {
+    SPTraceScope("notify.willChange", self.name, nil);
+    
     if ([self.delegate respondsToSelector:@selector(bucket:willChangeObjectsForKeys:)]) {
         NSSet *set = (NSSet *)notification.userInfo[@"keys"];
         [self.delegate bucket:self willChangeObjectsForKeys:set];
@@ -239,6 +302,8 @@
 }
 
 - (void)acknowledgedObjectDeletion:(NSNotification *)notification {
+    SPTraceScope("notify.acknowledgeDelete", self.name, nil);
+    
     if ([self.delegate respondsToSelector:@selector(bucketDidAcknowledgeDelete:)]) {
         [self.delegate bucketDidAcknowledgeDelete:self];
     }    
@@ -253,9 +318,11 @@
 }
 
 - (void)resolvePendingRelationshipsToKeys:(NSSet *)keys {
-    for (NSString *key in keys) {
-        [self.relationshipResolver resolvePendingRelationshipsForKey:key bucketName:self.name storage:self.storage];
+    if (keys.count == 0) {
+        return;
     }
+    
+    [self.relationshipResolver resolvePendingRelationshipsForKeys:keys bucketName:self.name storage:self.storage];
 }
 
 - (void)forceSyncWithCompletion:(SPBucketForceSyncCompletion)completion {
@@ -0,0 +1,39 @@
+//
+//  SPBufferedFileWriter.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPBufferedFileWriter
+#pragma mark ====================================================================================
+
+// Appends to a file from a background queue, in large chunks. Callers stamp their entries with `timestamp` on their
+// own thread, and leave the (expensive) encoding to the block handed over to `appendWithBlock:`.
+@interface SPBufferedFileWriter : NSObject
+
+@property (nonatomic, strong, readonly) NSURL       *fileURL;
+@property (nonatomic, assign, readonly) uint64_t    startTime;
+
+// The file is overwritten. Returns nil if it can't be opened
++ (instancetype)writerWithURL:(NSURL *)fileURL;
+
+// Nanoseconds, on the same clock as `startTime`
++ (uint64_t)timestamp;
+
+// The block runs on the writer's queue, and may append anything to the buffer. Dropped once the writer is closed
+- (void)appendWithBlock:(void (^)(NSMutableData *buffer))block;
+
+// Blocks until every appended entry has been written
+- (void)flush;
+
+// Writes the trailer (if any), flushes and closes the file
+- (void)closeWithTrailer:(NSData *)trailer;
+
+@end
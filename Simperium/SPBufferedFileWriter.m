@@ -0,0 +1,144 @@
+//
+//  SPBufferedFileWriter.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBufferedFileWriter.h"
+#import "SPLogger.h"
+#import <time.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLogLevels logLevel                             = SPLogLevelsInfo;
+static NSUInteger const SPBufferedFileWriterBufferSize  = 64 * 1024;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPBufferedFileWriter ()
+@property (nonatomic, strong, readwrite) NSURL              *fileURL;
+@property (nonatomic, assign, readwrite) uint64_t           startTime;
+@property (nonatomic, strong, readwrite) dispatch_queue_t   queue;
+@property (nonatomic, strong, readwrite) NSFileHandle       *fileHandle;
+@property (nonatomic, strong, readwrite) NSMutableData      *buffer;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPBufferedFileWriter
+#pragma mark ====================================================================================
+
+@implementation SPBufferedFileWriter
+
++ (instancetype)writerWithURL:(NSURL *)fileURL {
+    NSParameterAssert(fileURL);
+    
+    NSFileManager *fileManager  = [NSFileManager defaultManager];
+    NSURL *folderURL            = [fileURL URLByDeletingLastPathComponent];
+    
+    [fileManager createDirectoryAtURL:folderURL withIntermediateDirectories:YES attributes:nil error:nil];
+    [fileManager createFileAtPath:fileURL.path contents:nil attributes:nil];
+    
+    NSFileHandle *fileHandle    = [NSFileHandle fileHandleForWritingAtPath:fileURL.path];
+    if (!fileHandle) {
+        SPLogError(@"Simperium couldn't open file for writing at %@", fileURL.path);
+        return nil;
+    }
+    
+    SPBufferedFileWriter *writer    = [[self class] new];
+    writer.fileURL                  = fileURL;
+    writer.fileHandle               = fileHandle;
+    writer.startTime                = [self timestamp];
+    
+    return writer;
+}
+
++ (uint64_t)timestamp {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _queue  = dispatch_queue_create("com.simperium.SPBufferedFileWriter", NULL);
+        _buffer = [NSMutableData dataWithCapacity:SPBufferedFileWriterBufferSize];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self finishWithTrailer:nil];
+}
+
+
+#pragma mark - Public Methods
+
+- (void)appendWithBlock:(void (^)(NSMutableData *buffer))block {
+    NSParameterAssert(block);
+    
+    dispatch_async(self.queue, ^{
+        if (!self.fileHandle) {
+            return;
+        }
+        
+        block(self.buffer);
+        
+        if (self.buffer.length >= SPBufferedFileWriterBufferSize) {
+            [self writeBuffer];
+        }
+    });
+}
+
+- (void)flush {
+    dispatch_sync(self.queue, ^{
+        [self writeBuffer];
+    });
+}
+
+- (void)closeWithTrailer:(NSData *)trailer {
+    dispatch_sync(self.queue, ^{
+        [self finishWithTrailer:trailer];
+    });
+}
+
+
+#pragma mark - Private Methods
+
+- (void)writeBuffer {
+    if (!self.fileHandle || self.buffer.length == 0) {
+        return;
+    }
+    
+    @try {
+        [self.fileHandle writeData:self.buffer];
+    } @catch (NSException *exception) {
+        SPLogError(@"Simperium couldn't write to %@: %@", self.fileURL.path, exception);
+    }
+    
+    self.buffer.length = 0;
+}
+
+- (void)finishWithTrailer:(NSData *)trailer {
+    if (!self.fileHandle) {
+        return;
+    }
+    
+    if (trailer) {
+        [self.buffer appendData:trailer];
+    }
+    
+    [self writeBuffer];
+    [self.fileHandle closeFile];
+    
+    self.fileHandle = nil;
+}
+
+@end
@@ -43,6 +43,7 @@ typedef NS_ENUM(NSInteger, SPProcessorErrors) {
 @property (nonatomic, assign, readonly) int         numChangesPending;
 @property (nonatomic, assign, readonly) int         numKeysForObjectsWithMoreChanges;
 @property (nonatomic, assign, readonly) int         numKeysForObjectToDelete;
+@property (nonatomic, assign, readonly) int         numKeysForObjectsWithPendingRetry;
 @property (nonatomic, assign, readonly) BOOL        reachedMaxPendings;
 
 - (instancetype)initWithLabel:(NSString *)label clientID:(NSString *)clientID;
@@ -56,6 +57,7 @@ typedef NS_ENUM(NSInteger, SPProcessorErrors) {
 - (void)enqueueObjectForDeletion:(NSString *)key bucket:(SPBucket *)bucket;
 - (void)enqueueObjectForRetry:(NSString *)key bucket:(SPBucket *)bucket overrideRemoteData:(BOOL)overrideRemoteData;
 - (void)discardPendingChanges:(NSString *)key bucket:(SPBucket *)bucket;
+- (void)didSendChange:(NSDictionary *)change bucket:(SPBucket *)bucket;
 
 - (NSArray *)processLocalObjectsWithKeys:(NSSet *)keys bucket:(SPBucket *)bucket;
 - (NSArray *)processLocalDeletionsWithKeys:(NSSet *)keys;
@@ -20,6 +20,8 @@
 #import "SPBucket+Internals.h"
 #import "SPDiffer.h"
 #import "NSError+Simperium.h"
+#import "SPMetrics.h"
+#import "SPTracer.h"
 
 
 
@@ -27,8 +29,9 @@
 #pragma mark Constants
 #pragma mark ====================================================================================
 
-static SPLogLevels logLevel                         = SPLogLevelsInfo;
-static int const SPChangeProcessorMaxPendingChanges = 200;
+static SPLogLevels logLevel                                 = SPLogLevelsInfo;
+static int const SPChangeProcessorMaxPendingChanges         = 200;
+static NSTimeInterval const SPChangeProcessorDiffBudget     = 5.0;
 
 
 #pragma mark ====================================================================================
@@ -42,6 +45,7 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
 @property (nonatomic, strong, readwrite) SPPersistentMutableSet         *keysForObjectsWithMoreChanges;
 @property (nonatomic, strong, readwrite) SPPersistentMutableSet         *keysForObjectsToDelete;
 @property (nonatomic, strong, readwrite) SPPersistentMutableSet         *keysForObjectsWithPendingRetry;
+@property (nonatomic, strong, readwrite) NSMutableDictionary            *sendTimesForKeys;
 @end
 
 
@@ -71,6 +75,8 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
         NSString *deleteKey                 = [NSString stringWithFormat:@"keysForObjectsToDelete-%@", label];
         self.keysForObjectsToDelete         = [SPPersistentMutableSet loadSetWithLabel:deleteKey];
         
+        self.sendTimesForKeys               = [NSMutableDictionary dictionary];
+        
         [self migratePendingChangesIfNeeded];
     }
     
@@ -82,6 +88,7 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     [self.keysForObjectsWithMoreChanges removeAllObjects];
     [self.keysForObjectsWithPendingRetry removeAllObjects];
     [self.keysForObjectsToDelete removeAllObjects];
+    [self.sendTimesForKeys removeAllObjects];
     
     [self.changesPending save];
     [self.keysForObjectsWithMoreChanges save];
@@ -167,7 +174,11 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
             id<SPDiffable> object = [threadSafeStorage objectForKey:simperiumKey bucketName:bucket.name];
             if (object) {
                 [threadSafeStorage deleteObject:object];
+                
+                SPTraceScope("storage.save", bucket.name, simperiumKey);
+                CFAbsoluteTime saveStartTime = CFAbsoluteTimeGetCurrent();
                 [threadSafeStorage save];
+                [[bucket.metrics histogramNamed:SPMetricsStorageSaveTime] recordTimeIntervalSinceTime:saveStartTime];
             }
         }];
         
@@ -314,9 +325,8 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
             return NO;
         }
 
-        // Slight hack to ensure Core Data realizes the object has changed and needs a save
-        NSString *ghostDataCopy = [[[object.ghost dictionary] sp_JSONString] copy];
-        object.ghostData        = ghostDataCopy;
+        // Persist the ghost: storages with a Ghost Store won't need to dirty the object itself
+        [SPStorage saveGhostForObject:object storage:threadSafeStorage];
         
         SPLogVerbose(@"Simperium MODIFIED ghost version %@ (%@-%@)", endVersion, bucket.name, self.label);
         
@@ -361,7 +371,10 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
             }
         }
         
+        SPTraceScope("storage.save", bucket.name, simperiumKey);
+        CFAbsoluteTime saveStartTime = CFAbsoluteTimeGetCurrent();
         [threadSafeStorage save];
+        [[bucket.metrics histogramNamed:SPMetricsStorageSaveTime] recordTimeIntervalSinceTime:saveStartTime];
         
         dispatch_async(dispatch_get_main_queue(), ^{
             NSMutableDictionary *userInfo = [@{
@@ -428,8 +441,10 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
         // Change was awaiting acknowledgement; safe now to remove from changesPending
         if (acknowledged) {
             SPLogVerbose(@"Simperium acknowledged change for %@, cv=%@", changeClientID, changeVersion);
+            [self recordAcknowledgementForKey:key bucket:bucket];
         }
         [self.changesPending removeObjectForKey:key];
+        [self.sendTimesForKeys removeObjectForKey:key];
     }
     
     // Process!
@@ -452,9 +467,23 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
         SPLogError(@"Simperium error (%@), received an invalid change for (%@): %@", bucket.name, key, change);
     }
     
+    if (success && !acknowledged) {
+        [[bucket.metrics counterNamed:SPMetricsRemoteChangesApplied] increment];
+    }
+    
     return success;
 }
 
+- (void)recordAcknowledgementForKey:(NSString *)key bucket:(SPBucket *)bucket {
+    [[bucket.metrics counterNamed:SPMetricsChangesAcknowledged] increment];
+    
+    // Changes loaded from a previous session were never stamped
+    NSNumber *sendTime = self.sendTimesForKeys[key];
+    if (sendTime) {
+        [[bucket.metrics histogramNamed:SPMetricsChangeAckLatency] recordTimeIntervalSinceTime:sendTime.doubleValue];
+    }
+}
+
 
 #pragma mark ====================================================================================
 #pragma mark Remote Changes
@@ -492,6 +521,8 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     NSAssert(successHandler,                           @"Please, provide a success handler!");
     NSAssert(errorHandler,                             @"Please, provide an error handler!");
     
+    SPMetricsHistogram *applyTimeHistogram = [bucket.metrics histogramNamed:SPMetricsRemoteChangeApplyTime];
+    
     @autoreleasepool {
         
         for (NSDictionary *change in changes) {
@@ -500,8 +531,11 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
             NSString *key       = [self keyWithoutNamespaces:change bucket:bucket];
             NSString *version   = change[CH_END_VERSION];
             NSError *error      = nil;
+            
+            SPTraceScope("change.remote", bucket.name, key);
 
             if ([self processRemoteError:change bucket:bucket error:&error]) {
+                [[bucket.metrics counterNamed:SPMetricsChangesErrored] increment];
                 if (error) {
                     errorHandler(key, version, error);
                 }
@@ -509,7 +543,11 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
             }
             
             // Process Changes: this is necessary even if it's an ack, so the ghost data gets set accordingly
-            if (![self processRemoteChange:change bucket:bucket error:&error]) {
+            CFAbsoluteTime applyStartTime   = CFAbsoluteTimeGetCurrent();
+            BOOL applied                    = [self processRemoteChange:change bucket:bucket error:&error];
+            [applyTimeHistogram recordTimeIntervalSinceTime:applyStartTime];
+            
+            if (!applied) {
                 if (error) {
                     errorHandler(key, version, error);
                 }
@@ -604,6 +642,7 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     if (success) {
         [self.keysForObjectsWithPendingRetry addObject:key];
         [self.keysForObjectsWithPendingRetry save];
+        [[bucket.metrics counterNamed:SPMetricsChangesRetried] increment];
     }
 }
 
@@ -613,6 +652,21 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     NSAssert([bucket isKindOfClass:[SPBucket class]],  @"Missing Bucket");
     
     [self.changesPending removeObjectForKey:key];
+    [self.sendTimesForKeys removeObjectForKey:key];
+}
+
+- (void)didSendChange:(NSDictionary *)change bucket:(SPBucket *)bucket {
+    
+    NSAssert([change isKindOfClass:[NSDictionary class]],  @"Missing change");
+    NSAssert([bucket isKindOfClass:[SPBucket class]],      @"Missing Bucket");
+    
+    // Re-sent changes measure their ack latency from the last attempt
+    NSString *key = [self keyWithoutNamespaces:change bucket:bucket];
+    if (key) {
+        self.sendTimesForKeys[key] = @(CFAbsoluteTimeGetCurrent());
+    }
+    
+    [[bucket.metrics counterNamed:SPMetricsChangesSent] increment];
 }
 
 
@@ -626,7 +680,9 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     __block NSArray *changes                = nil;
     
     [threadSafeStorage performSafeBlockAndWait:^{
-        changes = [self _processLocalObjectsWithKeys:keys bucket:bucket threadSafeStorage:threadSafeStorage];
+        [bucket.differ performDiffsWithBudget:SPChangeProcessorDiffBudget block:^{
+            changes = [self _processLocalObjectsWithKeys:keys bucket:bucket threadSafeStorage:threadSafeStorage];
+        }];
     }];
     
     return changes;
@@ -878,6 +934,10 @@ static int const SPChangeProcessorMaxPendingChanges = 200;
     return (int)self.keysForObjectsToDelete.count;
 }
 
+- (int)numKeysForObjectsWithPendingRetry {
+    return (int)self.keysForObjectsWithPendingRetry.count;
+}
+
 - (BOOL)reachedMaxPendings {
     return (self.changesPending.count >= SPChangeProcessorMaxPendingChanges);
 }
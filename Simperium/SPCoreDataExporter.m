@@ -89,6 +89,22 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
         if (attr.attributeType == NSTransformableAttributeType && attr.valueTransformerName != nil) {
             [member setObject:attr.valueTransformerName forKey:@"valueTransformerName"];
         }
+        
+        // Text and List members can override their diff budget (in seconds)
+        if ([[attr userInfo] objectForKey:@"spDiffBudget"]) {
+            [member setObject:@([[[attr userInfo] objectForKey:@"spDiffBudget"] doubleValue]) forKey:@"diffBudget"];
+        }
+        
+        // Binary members can opt into chunked deltas
+        if ([[attr userInfo] objectForKey:@"spBinaryDelta"]) {
+            [member setObject:@(YES) forKey:@"binaryDelta"];
+        }
+        
+        // Members can opt out of Lazy Loading
+        if ([[attr userInfo] objectForKey:@"spDisableLazyLoading"]) {
+            [member setObject:@(NO) forKey:@"lazy"];
+        }
+        
         [members addObject: member];
     }
     
@@ -11,6 +11,8 @@
 #import "SPStorageObserver.h"
 #import "SPStorageProvider.h"
 
+@class SPGhostStore;
+
 
 
 @interface SPCoreDataStorage : SPStorage<SPStorageProvider>
@@ -20,9 +22,11 @@
 @property (nonatomic, strong,  readonly) NSManagedObjectModel           *managedObjectModel;
 @property (nonatomic, strong,  readonly) NSPersistentStoreCoordinator   *persistentStoreCoordinator;
 @property (nonatomic, assign, readwrite) BOOL                           delaysNewObjectsInitialization;
+@property (nonatomic, strong, readwrite) SPGhostStore                   *ghostStore;
 @property (nonatomic, weak,   readwrite) id<SPStorageObserver>          delegate;
 
 extern char* const SPCoreDataBucketListKey;
+extern char* const SPCoreDataGhostStoreKey;
 extern NSString* const SPCoreDataWorkerContext;
 
 + (BOOL)newCoreDataStack:(NSString *)modelName mainContext:(NSManagedObjectContext **)mainContext model:(NSManagedObjectModel **)model coordinator:(NSPersistentStoreCoordinator **)coordinator;
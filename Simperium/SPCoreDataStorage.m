@@ -13,6 +13,9 @@
 #import "SPCoreDataExporter.h"
 #import "SPSchema.h"
 #import "SPThreadsafeMutableSet.h"
+#import "SPGhostStore.h"
+#import "SPGhost.h"
+#import "SPObjectKeySet.h"
 #import "SPLogger.h"
 #import <objc/runtime.h>
 
@@ -23,7 +26,9 @@
 #pragma mark ====================================================================================
 
 char* const SPCoreDataBucketListKey     = "SPCoreDataBucketListKey";
+char* const SPCoreDataGhostStoreKey     = "SPCoreDataGhostStoreKey";
 NSString* const SPCoreDataWorkerContext = @"SPCoreDataWorkerContext";
+static NSString* const SPCoreDataPendingObjectKeysKey = @"SPCoreDataPendingObjectKeys";
 static SPLogLevels logLevel             = SPLogLevelsInfo;
 static NSInteger const SPWorkersDone    = 0;
 
@@ -42,8 +47,10 @@ static NSInteger const SPWorkersDone    = 0;
 @property (nonatomic, weak,   readwrite) SPCoreDataStorage              *sibling;
 @property (nonatomic, strong, readwrite) NSConditionLock                *mutex;
 @property (nonatomic, strong, readwrite) NSMutableSet                   *privateStashedObjects;
+@property (nonatomic, strong, readwrite) SPObjectKeySet                 *objectKeySet;
 - (void)addObserversForMainContext:(NSManagedObjectContext *)context;
 - (void)addObserversForChildrenContext:(NSManagedObjectContext *)context;
+- (void)addObserversForWriterContext:(NSManagedObjectContext *)context;
 @end
 
 typedef void (^SPCoreDataStorageSaveCallback)(void);
@@ -67,6 +74,7 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
         self.privateStashedObjects      = [NSMutableSet setWithCapacity:3];
         self.classMappings              = [NSMutableDictionary dictionary];
         self.remotelyDeletedKeys        = [SPThreadsafeMutableSet set];
+        self.objectKeySet               = [SPObjectKeySet new];
         
         self.persistentStoreCoordinator = coordinator;
         self.managedObjectModel         = model;
@@ -82,6 +90,7 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
         self.mainManagedObjectContext.parentContext = self.writerManagedObjectContext;
 
         [self addObserversForMainContext:self.mainManagedObjectContext];
+        [self addObserversForWriterContext:self.writerManagedObjectContext];
     }
     
     return self;
@@ -108,8 +117,9 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
         // Keep a reference to the writerContext
         self.writerManagedObjectContext = aSibling.writerManagedObjectContext;
         
-        // Shared mutex
+        // Shared mutex and Key Set
         self.mutex = aSibling.mutex;
+        self.objectKeySet = aSibling.objectKeySet;
         
         // An observer is expected to handle merges for otherContext when the threaded context is saved
         [self addObserversForChildrenContext:self.mainManagedObjectContext];
@@ -128,6 +138,29 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
     objc_setAssociatedObject(self.persistentStoreCoordinator, SPCoreDataBucketListKey, dict, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 }
 
+- (void)setGhostStore:(SPGhostStore *)ghostStore {
+    // Same as the bucketList: SPManagedObject instances (and threadsafe siblings) will find the store through the PSC
+    NSPersistentStoreCoordinator *coordinator = self.mainManagedObjectContext.persistentStoreCoordinator ?: self.persistentStoreCoordinator;
+    objc_setAssociatedObject(coordinator, SPCoreDataGhostStoreKey, ghostStore, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (SPGhostStore *)ghostStore {
+    NSPersistentStoreCoordinator *coordinator = self.mainManagedObjectContext.persistentStoreCoordinator ?: self.persistentStoreCoordinator;
+    return objc_getAssociatedObject(coordinator, SPCoreDataGhostStoreKey);
+}
+
+- (void)saveGhostForObject:(id<SPDiffable>)object {
+    SPGhostStore *ghostStore = self.ghostStore;
+    if (!ghostStore) {
+        [super saveGhostForObject:object];
+        return;
+    }
+    
+    // The object itself remains untouched: no need to rewrite it
+    [ghostStore setGhost:object.ghost forKey:object.simperiumKey bucketName:object.bucket.name];
+    object.ghost.needsSave = NO;
+}
+
 - (NSArray *)exportSchemas {
     SPCoreDataExporter *exporter = [[SPCoreDataExporter alloc] init];
     NSDictionary *definitionDict = [exporter exportModel:self.managedObjectModel classMappings:self.classMappings];
@@ -214,15 +247,46 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
 }
 
 - (NSArray *)objectKeysForBucketName:(NSString *)bucketName {
-    NSArray *results = [self objectKeysAndIdsForBucketName:bucketName];
-    
-    NSMutableArray *objectKeys = [NSMutableArray arrayWithCapacity:[results count]];
-    for (NSDictionary *result in results) {
-        NSString *key = [result objectForKey:@"simperiumKey"];
-        [objectKeys addObject:key];
+    return [[self loadedObjectKeysForBucketName:bucketName] allObjects] ?: @[];
+}
+
+- (void)enumerateObjectKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *simperiumKey, BOOL *stop))block {
+    NSParameterAssert(block);
+    [[self loadedObjectKeysForBucketName:bucketName] enumerateObjectsUsingBlock:block];
+}
+
+- (NSSet *)loadedObjectKeysForBucketName:(NSString *)bucketName {
+    SPObjectKeySet *objectKeySet = self.objectKeySet;
+    if ([objectKeySet containsKeysForBucketName:bucketName]) {
+        return [objectKeySet keysForBucketName:bucketName];
     }
     
-    return objectKeys;
+    // Fetch the keys just once: saves performed meanwhile (by the writer, or any worker) will be replayed on top
+    [objectKeySet beginLoadingKeysForBucketName:bucketName];
+    
+    NSManagedObjectContext *writerContext = self.writerManagedObjectContext;
+    [writerContext performBlockAndWait:^{
+        NSEntityDescription *entity = [NSEntityDescription entityForName:bucketName inManagedObjectContext:writerContext];
+        if (entity == nil) {
+            return;
+        }
+        
+        NSFetchRequest *request     = [[NSFetchRequest alloc] init];
+        request.entity              = entity;
+        request.resultType          = NSDictionaryResultType;
+        request.propertiesToFetch   = @[ @"simperiumKey" ];
+        
+        NSError *error              = nil;
+        NSArray *results            = [writerContext executeFetchRequest:request error:&error];
+        if (results == nil) {
+            SPLogError(@"Simperium error: couldn't load the keys for entity %@: %@", bucketName, error);
+            return;
+        }
+        
+        [objectKeySet setKeys:[results valueForKey:@"simperiumKey"] forBucketName:bucketName];
+    }];
+    
+    return [objectKeySet keysForBucketName:bucketName];
 }
 
 - (NSInteger)numObjectsForBucketName:(NSString *)bucketName predicate:(NSPredicate *)predicate {
@@ -291,6 +355,7 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
 - (void)deleteObject:(id<SPDiffable>)object {
     SPManagedObject *managedObject = (SPManagedObject *)object;
     NSString *namespacedSimperiumKey = managedObject.namespacedSimperiumKey;
+    [self.ghostStore removeGhostForKey:managedObject.simperiumKey bucketName:managedObject.bucket.name];
     [managedObject.managedObjectContext deleteObject:managedObject];
 
     // NOTE:
@@ -319,6 +384,13 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
     if (![self.mainManagedObjectContext save:&error]) {
         NSLog(@"Simperium error deleting %@ - error:%@",bucketName,error);
     }
+    
+    // Ghosts for objects that were never loaded would otherwise survive, and get reused by the next sync
+    SPGhostStore *ghostStore = self.ghostStore;
+    if (ghostStore) {
+        [ghostStore removeGhostsForBucketName:bucketName];
+        [self saveGhostStore:ghostStore];
+    }
 }
 
 - (void)validateObjectsForBucketName:(NSString *)bucketName {
@@ -379,10 +451,36 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
         } @catch (NSException *exception) {
             NSLog(@"Simperium exception while saving context: %@", (id)[exception userInfo] ?: (id)[exception reason]);
         }
-    }  
+    }
+    
+    // Ghosts go right after the objects: a ghost must never be ahead of its object, or the next local diff
+    // would revert the remote change
+    SPGhostStore *ghostStore = self.ghostStore;
+    if (!ghostStore) {
+        return YES;
+    }
+    
+    // Workers save straight into the PSC. The main context relies on the writer, which saves asynchronously
+    if (self.mainManagedObjectContext.parentContext == nil) {
+        return [self saveGhostStore:ghostStore];
+    }
+    
+    [self saveWriterContextWithCallback:^{
+        [self saveGhostStore:ghostStore];
+    }];
+    
     return YES;
 }
 
+- (BOOL)saveGhostStore:(SPGhostStore *)ghostStore {
+    if ([ghostStore save]) {
+        return YES;
+    }
+    
+    SPLogError(@"Critical Simperium error while saving the Ghost Store");
+    return NO;
+}
+
 
 #pragma mark - Public Properties
 
@@ -482,6 +580,11 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
     NSDictionary *userInfo  = notification.userInfo;
     NSSet *deletedObjects   = [self filterRemotelyDeletedObjects:userInfo[NSDeletedObjectsKey]];
     
+    // Locally deleted objects won't need their ghosts anymore
+    for (SPManagedObject *deletedObject in deletedObjects) {
+        [self.ghostStore removeGhostForKey:deletedObject.simperiumKey bucketName:deletedObject.bucket.name];
+    }
+    
     [self.delegate storageWillSave:self deletedObjects:deletedObjects];
     
     // Save the writerMOC's changes
@@ -520,6 +623,7 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
     NSManagedObjectContext *childrenContext = (NSManagedObjectContext *)notification.object;
     [childrenContext performBlockAndWait:^{
         [self obtainPermanentIDsForInsertedObjectsInContext:childrenContext];
+        [self captureObjectKeyChangesInContext:childrenContext];
     }];
     
     // Get the deleted ManagedObject ID's
@@ -553,6 +657,11 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
     //  and yet, it doesn't get refreshed on the mainMOC, even after merging the changes.
     //  This doesn't happen in iOS, but as a safety measure, let's run this snippet anyways.
 
+    NSManagedObjectContext *childrenContext = (NSManagedObjectContext *)notification.object;
+    [childrenContext performBlockAndWait:^{
+        [self applyObjectKeyChangesInContext:childrenContext];
+    }];
+
     NSManagedObjectContext *writerMOC = self.writerManagedObjectContext;
     [writerMOC performBlockAndWait:^{
         [writerMOC mergeChangesFromContextDidSaveNotification:notification];
@@ -590,6 +699,85 @@ typedef void (^SPCoreDataStorageSaveCallback)(void);
 }
 
 
+#pragma mark - Writer MOC Notification Handlers
+
+- (void)writerContextWillSave:(NSNotification *)notification {
+    [self captureObjectKeyChangesInContext:notification.object];
+}
+
+- (void)writerContextDidSave:(NSNotification *)notification {
+    [self applyObjectKeyChangesInContext:notification.object];
+}
+
+- (void)addObserversForWriterContext:(NSManagedObjectContext *)context {
+    NSNotificationCenter* nc = [NSNotificationCenter defaultCenter];
+    [nc addObserver:self selector:@selector(writerContextWillSave:) name:NSManagedObjectContextWillSaveNotification   object:context];
+    [nc addObserver:self selector:@selector(writerContextDidSave:)  name:NSManagedObjectContextDidSaveNotification    object:context];
+}
+
+
+#pragma mark - Object Key Helpers
+
+// Note: Both the Writer and the Workers save straight into the PSC. Their changes are captured right before saving,
+// and applied to the Key Set only once the save succeeded
+- (void)captureObjectKeyChangesInContext:(NSManagedObjectContext *)context {
+    NSMutableArray *insertedKeys    = [NSMutableArray array];
+    NSMutableArray *deletedKeys     = [NSMutableArray array];
+    
+    for (NSManagedObject *object in context.insertedObjects) {
+        [self collectKey:[object valueForKey:@"simperiumKey"] object:object into:insertedKeys];
+    }
+    
+    for (NSManagedObject *object in context.updatedObjects) {
+        if (!object.changedValues[@"simperiumKey"]) {
+            continue;
+        }
+        [self collectKey:[object committedValuesForKeys:@[@"simperiumKey"]][@"simperiumKey"] object:object into:deletedKeys];
+        [self collectKey:[object valueForKey:@"simperiumKey"] object:object into:insertedKeys];
+    }
+    
+    for (NSManagedObject *object in context.deletedObjects) {
+        [self collectKey:[object committedValuesForKeys:@[@"simperiumKey"]][@"simperiumKey"] object:object into:deletedKeys];
+    }
+    
+    if (insertedKeys.count == 0 && deletedKeys.count == 0) {
+        [context.userInfo removeObjectForKey:SPCoreDataPendingObjectKeysKey];
+        return;
+    }
+    
+    context.userInfo[SPCoreDataPendingObjectKeysKey] = @[ deletedKeys, insertedKeys ];
+}
+
+- (void)collectKey:(NSString *)key object:(NSManagedObject *)object into:(NSMutableArray *)keys {
+    if (![object isKindOfClass:[SPManagedObject class]] || ![key isKindOfClass:[NSString class]]) {
+        return;
+    }
+    
+    // Fetches include subentities: so does the Key Set
+    for (NSEntityDescription *entity = object.entity; entity; entity = entity.superentity) {
+        [keys addObject:@[ entity.name, key ]];
+    }
+}
+
+- (void)applyObjectKeyChangesInContext:(NSManagedObjectContext *)context {
+    NSArray *changes = context.userInfo[SPCoreDataPendingObjectKeysKey];
+    if (!changes) {
+        return;
+    }
+    
+    [context.userInfo removeObjectForKey:SPCoreDataPendingObjectKeysKey];
+    
+    SPObjectKeySet *objectKeySet = self.objectKeySet;
+    for (NSArray *change in changes.firstObject) {
+        [objectKeySet removeKey:change.lastObject bucketName:change.firstObject];
+    }
+    
+    for (NSArray *change in changes.lastObject) {
+        [objectKeySet addKey:change.lastObject bucketName:change.firstObject];
+    }
+}
+
+
 #pragma mark - Delegate Helpers
 
 - (NSSet *)filterRemotelyDeletedObjects:(NSSet *)deletedObjects {
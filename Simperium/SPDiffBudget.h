@@ -0,0 +1,48 @@
+//
+//  SPDiffBudget.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+// Matches DiffMatchPatch's default Diff_Timeout
+extern NSTimeInterval const SPDiffBudgetDefaultMemberTimeInterval;
+
+// Member diffs always get at least this much time, even once their batch has run out
+extern NSTimeInterval const SPDiffBudgetMinimumMemberTimeInterval;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPDiffBudget
+#pragma mark ====================================================================================
+
+// Diffs performed within a budget's block (on the same thread) share its time. Members escalate to coarser diffs when
+// they'd otherwise run past it, and record every escalation and overrun.
+@interface SPDiffBudget : NSObject
+
+@property (nonatomic, assign, readonly) NSTimeInterval  timeInterval;
+@property (nonatomic, assign, readonly) NSTimeInterval  remainingTime;
+@property (atomic,    assign, readonly) NSUInteger      escalationCount;
+@property (atomic,    assign, readonly) NSUInteger      overrunCount;
+@property (atomic,    assign, readonly) NSTimeInterval  overrunTime;
+
++ (instancetype)budgetWithTimeInterval:(NSTimeInterval)timeInterval;
++ (SPDiffBudget *)currentBudget;
+
+- (void)performBlock:(void (^)(void))block;
+
+// Time available for a single member diff: the member's own budget, capped by the current batch (if any), but never
+// below SPDiffBudgetMinimumMemberTimeInterval
++ (NSTimeInterval)timeIntervalForMemberBudget:(NSTimeInterval)memberBudget;
++ (void)recordDiffForMember:(NSString *)keyName budget:(NSTimeInterval)budget elapsed:(NSTimeInterval)elapsed escalated:(BOOL)escalated;
+
+@end
@@ -0,0 +1,126 @@
+//
+//  SPDiffBudget.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPDiffBudget.h"
+#import "SPLogger.h"
+#import <stdatomic.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLogLevels logLevel                         = SPLogLevelsInfo;
+static NSString * const SPDiffBudgetThreadLocalKey  = @"com.simperium.SPDiffBudget";
+static double const SPDiffBudgetNanosPerSecond      = 1e9;
+
+NSTimeInterval const SPDiffBudgetDefaultMemberTimeInterval = 1.0;
+NSTimeInterval const SPDiffBudgetMinimumMemberTimeInterval = 0.01;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPDiffBudget ()
+@property (nonatomic, assign, readwrite) NSTimeInterval timeInterval;
+@property (nonatomic, assign, readwrite) NSTimeInterval deadline;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPDiffBudget
+#pragma mark ====================================================================================
+
+@implementation SPDiffBudget
+{
+    // Overrun time is kept in nanoseconds, so that it can be accumulated atomically
+    atomic_ulong        _escalationCount;
+    atomic_ulong        _overrunCount;
+    atomic_ullong       _overrunNanos;
+}
+
++ (instancetype)budgetWithTimeInterval:(NSTimeInterval)timeInterval {
+    SPDiffBudget *budget    = [self new];
+    budget.timeInterval     = timeInterval;
+    budget.deadline         = [NSDate timeIntervalSinceReferenceDate] + timeInterval;
+    return budget;
+}
+
++ (SPDiffBudget *)currentBudget {
+    return [[NSThread currentThread] threadDictionary][SPDiffBudgetThreadLocalKey];
+}
+
+- (NSTimeInterval)remainingTime {
+    return MAX(self.deadline - [NSDate timeIntervalSinceReferenceDate], 0);
+}
+
+- (NSUInteger)escalationCount {
+    return atomic_load(&_escalationCount);
+}
+
+- (NSUInteger)overrunCount {
+    return atomic_load(&_overrunCount);
+}
+
+- (NSTimeInterval)overrunTime {
+    return atomic_load(&_overrunNanos) / SPDiffBudgetNanosPerSecond;
+}
+
+- (void)performBlock:(void (^)(void))block {
+    NSParameterAssert(block);
+    
+    // The clock starts ticking when the batch does. Nested budgets get restored afterwards
+    NSMutableDictionary *threadDictionary   = [[NSThread currentThread] threadDictionary];
+    SPDiffBudget *previousBudget            = threadDictionary[SPDiffBudgetThreadLocalKey];
+    
+    self.deadline                                   = [NSDate timeIntervalSinceReferenceDate] + self.timeInterval;
+    threadDictionary[SPDiffBudgetThreadLocalKey]    = self;
+    
+    block();
+    
+    threadDictionary[SPDiffBudgetThreadLocalKey]    = previousBudget;
+}
+
++ (NSTimeInterval)timeIntervalForMemberBudget:(NSTimeInterval)memberBudget {
+    SPDiffBudget *budget = [self currentBudget];
+    if (!budget) {
+        return memberBudget;
+    }
+    
+    // Trivial diffs shouldn't escalate just because an earlier member used up the batch
+    NSTimeInterval floor = MIN(memberBudget, SPDiffBudgetMinimumMemberTimeInterval);
+    return MAX(MIN(memberBudget, budget.remainingTime), floor);
+}
+
++ (void)recordDiffForMember:(NSString *)keyName budget:(NSTimeInterval)budget elapsed:(NSTimeInterval)elapsed escalated:(BOOL)escalated {
+    SPDiffBudget *current = [self currentBudget];
+    
+    if (escalated) {
+        SPLogVerbose(@"Simperium escalated diff granularity for member %@ (budget %.3fs)", keyName, budget);
+        [current recordEscalation];
+    }
+    
+    // Overruns are reported once per batch, by SPDiffer
+    if (elapsed > budget) {
+        SPLogVerbose(@"Simperium diff for member %@ took %.3fs, over its %.3fs budget", keyName, elapsed, budget);
+        [current recordOverrun:elapsed - budget];
+    }
+}
+
+- (void)recordEscalation {
+    atomic_fetch_add(&_escalationCount, 1);
+}
+
+- (void)recordOverrun:(NSTimeInterval)overrunTime {
+    atomic_fetch_add(&_overrunCount, 1);
+    atomic_fetch_add(&_overrunNanos, (unsigned long long)(overrunTime * SPDiffBudgetNanosPerSecond));
+}
+
+@end
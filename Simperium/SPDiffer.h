@@ -14,6 +14,7 @@
 @class SPMember;
 @class SPGhost;
 @class SPSchema;
+@class SPMetrics;
 
 #pragma mark ====================================================================================
 #pragma mark SPDiffer
@@ -21,7 +22,13 @@
 
 @interface SPDiffer : NSObject
 
-@property (nonatomic, strong) SPSchema *schema;
+@property (nonatomic, strong) SPSchema  *schema;
+@property (nonatomic, strong) SPMetrics *metrics;
+
+// Metrics: Diff budget escalations and overruns, accumulated across every batch
+@property (atomic, assign, readonly) NSUInteger     budgetEscalationCount;
+@property (atomic, assign, readonly) NSUInteger     budgetOverrunCount;
+@property (atomic, assign, readonly) NSTimeInterval budgetOverrunTime;
 
 - (instancetype)initWithSchema:(SPSchema *)schema;
 - (NSMutableDictionary *)diffForAddition:(id<SPDiffable>)object;
@@ -30,4 +37,7 @@
 - (BOOL)applyGhostDiffFromDictionary:(NSDictionary *)diff toObject:(id<SPDiffable>)object error:(NSError **)error;
 - (NSDictionary *)transform:(id<SPDiffable>)object diff:(NSDictionary *)diff oldDiff:(NSDictionary *)oldDiff oldGhost:(SPGhost *)oldGhost error:(NSError **)error;
 
+// Every diff performed (on the current thread) within the block shares the given time budget
+- (void)performDiffsWithBudget:(NSTimeInterval)budget block:(void (^)(void))block;
+
 @end
@@ -13,6 +13,10 @@
 #import "SPLogger.h"
 #import "SPDiffable.h"
 #import "SPSchema.h"
+#import "SPDiffBudget.h"
+#import "SPMetrics.h"
+#import "SPTracer.h"
+#import <stdatomic.h>
 
 
 
@@ -20,7 +24,17 @@
 #pragma mark Constants
 #pragma mark ====================================================================================
 
-static SPLogLevels logLevel = SPLogLevelsInfo;
+static SPLogLevels logLevel                 = SPLogLevelsInfo;
+static double const SPDifferNanosPerSecond  = 1e9;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPDiffer ()
+@property (nonatomic, strong, readwrite) NSMapTable *diffTimeHistograms;
+@end
 
 
 #pragma mark ====================================================================================
@@ -28,11 +42,18 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 #pragma mark ====================================================================================
 
 @implementation SPDiffer
+{
+    // Batches may run on several threads at once. Overrun time is kept in nanoseconds
+    atomic_ulong        _budgetEscalationCount;
+    atomic_ulong        _budgetOverrunCount;
+    atomic_ullong       _budgetOverrunNanos;
+}
 
 - (instancetype)initWithSchema:(SPSchema *)aSchema {
     self = [super init];
     if (self) {
-        self.schema = aSchema;
+        self.schema             = aSchema;
+        self.diffTimeHistograms = [NSMapTable strongToStrongObjectsMapTable];
     }
     
     return self;
@@ -57,6 +78,8 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 
 //  Calculates the diff required to go from Dictionary-state into Object-state
 - (NSDictionary *)diffFromDictionary:(NSDictionary *)dict toObject:(id<SPDiffable>)object {
+    SPTraceScope("diff.compute", object.bucket.name, object.simperiumKey);
+    
     // changes contains the operations for every key that is different
     NSMutableDictionary *changes = [NSMutableDictionary dictionaryWithCapacity:3];
     
@@ -64,6 +87,9 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     // In the JS version, members can be added/removed this way too if a member is present in one entity
     // but not the other; ignore this functionality for now
     
+    // Members may keep data derived from the ghost's values in its metadata: only when diffing against the ghost itself
+    SPGhost *ghost = (dict == object.ghost.memberData) ? object.ghost : nil;
+    
     NSDictionary *currentDiff = nil;
     for (SPMember *member in [self.schema.members allValues])
     {
@@ -95,7 +121,14 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
             currentDiff = [thisMember diffForRemoval];
         } else {
             // Perform a full diff
-            currentDiff = [thisMember diff: dictValue otherValue:currentValue];
+            CFAbsoluteTime diffStartTime    = CFAbsoluteTimeGetCurrent();
+            currentDiff                     = [thisMember diff:dictValue otherValue:currentValue ghost:ghost];
+            [[self diffTimeHistogramForMember:thisMember] recordTimeIntervalSinceTime:diffStartTime];
+            
+            // Legacy encodings (ie. archived JSON) can't take incremental operations: send the whole value instead
+            if (currentDiff.count && ![currentDiff[OP_OP] isEqual:OP_REPLACE] && ![thisMember supportsIncrementalDiffFromEncodedValue:dict[key]]) {
+                currentDiff = [thisMember diffForReplacement:currentValue];
+            }
         }
         
         // If there was no difference, then don't add any changes for this member
@@ -110,8 +143,29 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     return changes;
 }
 
+// Diff times are tracked per member type (ie. time.diff.SPMemberText)
+- (SPMetricsHistogram *)diffTimeHistogramForMember:(SPMember *)member {
+    if (!self.metrics) {
+        return nil;
+    }
+    
+    Class memberClass = [member class];
+    
+    @synchronized(self.diffTimeHistograms) {
+        SPMetricsHistogram *histogram = [self.diffTimeHistograms objectForKey:memberClass];
+        if (!histogram) {
+            NSString *name  = [SPMetricsDiffTimePrefix stringByAppendingString:NSStringFromClass(memberClass)];
+            histogram       = [self.metrics histogramNamed:name];
+            [self.diffTimeHistograms setObject:histogram forKey:memberClass];
+        }
+        return histogram;
+    }
+}
+
 // Apply an incoming diff to this entity instance
 - (BOOL)applyDiffFromDictionary:(NSDictionary *)diff toObject:(id<SPDiffable>)object error:(NSError **)error {
+    SPTraceScope("diff.apply", object.bucket.name, object.simperiumKey);
+    
     // Process each change in the diff
     for (NSString *key in diff.allKeys) {
         NSDictionary *change    = diff[key];
@@ -174,6 +228,8 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 // Same strategy as applyDiff, but do it to the ghost's memberData
 // Note that no conversions are necessary here since all data is in JSON-compatible format already
 - (BOOL)applyGhostDiffFromDictionary:(NSDictionary *)diff toObject:(id<SPDiffable>)object error:(NSError **)error {
+    SPTraceScope("diff.applyGhost", object.bucket.name, object.simperiumKey);
+    
     // Create a copy of the ghost's data and update any members that have changed
     NSMutableDictionary *ghostMemberData = object.ghost.memberData;
     NSMutableDictionary *newMemberData = ghostMemberData ? [ghostMemberData mutableCopy] : [NSMutableDictionary dictionaryWithCapacity:diff.count];
@@ -219,7 +275,7 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
             }
             
             NSError *theError   = nil;
-            id newValue         = [member applyDiff:thisValue otherValue:otherValue error:&theError];
+            id newValue         = [member applyDiff:thisValue otherValue:otherValue encodedValue:ghostMemberData[key] error:&theError];
             
             // On error: halt and relay the error to the caller
             if (theError) {
@@ -239,6 +295,8 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 }
 
 - (NSDictionary *)transform:(id<SPDiffable>)object diff:(NSDictionary *)diff oldDiff:(NSDictionary *)oldDiff oldGhost:(SPGhost *)oldGhost error:(NSError **)error {
+    SPTraceScope("diff.transform", object.bucket.name, object.simperiumKey);
+    
     NSMutableDictionary *newDiff = [NSMutableDictionary dictionary];
     // Transform diff first, and then apply it
     for (NSString *key in diff.allKeys) {
@@ -270,11 +328,8 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
         }
             */
         
-        id thisValue            = [member getValueFromDictionary:change key:OP_VALUE object:object];
-        id otherValue           = [member getValueFromDictionary:oldChange key:OP_VALUE object:object];
-        
         NSError *theError       = nil;
-        NSDictionary *newChange = [member transform:thisValue otherValue:otherValue oldValue:ghostValue error:&theError];
+        NSDictionary *newChange = [member transformChange:change otherChange:oldChange oldValue:ghostValue object:object error:&theError];
         
         // On error: halt and relay the error to the caller
         if (theError) {
@@ -296,4 +351,32 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     return newDiff;
 }
 
+- (NSUInteger)budgetEscalationCount {
+    return atomic_load(&_budgetEscalationCount);
+}
+
+- (NSUInteger)budgetOverrunCount {
+    return atomic_load(&_budgetOverrunCount);
+}
+
+- (NSTimeInterval)budgetOverrunTime {
+    return atomic_load(&_budgetOverrunNanos) / SPDifferNanosPerSecond;
+}
+
+- (void)performDiffsWithBudget:(NSTimeInterval)budget block:(void (^)(void))block {
+    NSParameterAssert(block);
+    
+    SPDiffBudget *diffBudget = [SPDiffBudget budgetWithTimeInterval:budget];
+    [diffBudget performBlock:block];
+    
+    atomic_fetch_add(&_budgetEscalationCount, diffBudget.escalationCount);
+    atomic_fetch_add(&_budgetOverrunCount, diffBudget.overrunCount);
+    atomic_fetch_add(&_budgetOverrunNanos, (unsigned long long)(diffBudget.overrunTime * SPDifferNanosPerSecond));
+    
+    // Overruns get reported once per batch, rather than once per member
+    if (diffBudget.overrunCount > 0) {
+        SPLogWarn(@"Simperium diff batch overran its %.3fs budget %lu times", budget, (unsigned long)diffBudget.overrunCount);
+    }
+}
+
 @end
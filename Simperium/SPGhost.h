@@ -14,10 +14,12 @@
 @property (copy,   nonatomic) NSString              *key;
 @property (copy,   nonatomic) NSMutableDictionary   *memberData;
 @property (copy,   nonatomic) NSString              *version;
+// Local only: never synced. Members may keep data derived from their ghost values in here (ie. chunk signatures)
+@property (copy,   nonatomic) NSDictionary          *metadata;
 @property (assign, nonatomic) BOOL                  needsSave;
 
 - (instancetype)initFromDictionary:(NSDictionary *)dict;
-- (instancetype)initWithKey:(NSString *)k memberData:(NSMutableDictionary *)data;
+- (instancetype)initWithKey:(NSString *)k memberData:(NSDictionary *)data;
 - (NSDictionary *)dictionary;
 
 @end
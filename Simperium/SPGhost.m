@@ -7,6 +7,7 @@
 //
 
 #import "SPGhost.h"
+#import "SPGhostMemberData.h"
 
 
 @implementation SPGhost
@@ -15,8 +16,9 @@
     self = [super init];
     if (self) {
         _key        = dict[@"key"];
-        _memberData = dict[@"obj"];
+        _memberData = [self memberDataWithDictionary:dict[@"obj"]];
         _version    = dict[@"version"];
+        _metadata   = [dict[@"meta"] isKindOfClass:[NSDictionary class]] ? dict[@"meta"] : nil;
         
         // Make sure it's not marked dirty when initializing in this way, since ghosts are loaded
         // through this method on launch
@@ -26,11 +28,11 @@
     return self;
 }
 
-- (instancetype)initWithKey:(NSString *)k memberData:(NSMutableDictionary *)data {
+- (instancetype)initWithKey:(NSString *)k memberData:(NSDictionary *)data {
     self = [super init];
     if (self) {
         _key        = k;
-        _memberData = data;
+        _memberData = [self memberDataWithDictionary:data];
     }
     return self;
 }
@@ -40,21 +42,26 @@
     newGhost.key = [self key];
     newGhost.memberData = [self memberData];
     newGhost.version = [self version];
+    newGhost.metadata = [self metadata];
     return newGhost;
 }
 
 - (id)mutableCopyWithZone: (NSZone *) zone {
-    SPGhost *newGhost = [[[self class] allocWithZone:zone] init];
-    newGhost.key = [self key];
-    newGhost.version = [self version];
+    // Member Data is Copy-on-Write: both copies are equally cheap
+    return [self copyWithZone:zone];
+}
+
+- (NSMutableDictionary *)memberDataWithDictionary:(NSDictionary *)dict {
+    if (![dict isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
     
-    NSMutableDictionary *memberDataCopy = [[self memberData] mutableCopyWithZone:zone];
-    newGhost.memberData = memberDataCopy;
-    return newGhost;
+    // Copy-on-Write maps are shared in O(1). Anything else gets its members copied over, just once
+    return [dict isKindOfClass:[SPGhostMemberData class]] ? [dict mutableCopy] : [[SPGhostMemberData alloc] initWithDictionary:dict];
 }
 
 - (void)setMemberData:(NSMutableDictionary *)newMemberData {
-    _memberData = [newMemberData mutableCopy];
+    _memberData = [self memberDataWithDictionary:newMemberData];
     _needsSave = YES;
 }
 
@@ -68,14 +75,22 @@
     _needsSave = YES;
 }
 
+- (void)setMetadata:(NSDictionary *)newMetadata {
+    _metadata = [newMetadata copy];
+    _needsSave = YES;
+}
+
 - (NSDictionary *)dictionary {
-    if (_version == nil) {
-        return [NSDictionary dictionaryWithObjectsAndKeys:
-                self.key, @"key", self.memberData, @"obj", nil];
-    } else {
-        return [NSDictionary dictionaryWithObjectsAndKeys:
-                self.key, @"key", self.version, @"version", self.memberData, @"obj", nil];
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:4];
+    [dictionary setValue:self.key forKey:@"key"];
+    [dictionary setValue:self.version forKey:@"version"];
+    [dictionary setValue:self.memberData forKey:@"obj"];
+    
+    if (self.metadata.count) {
+        dictionary[@"meta"] = self.metadata;
     }
+    
+    return dictionary;
 }
 
 @end
@@ -0,0 +1,23 @@
+//
+//  SPGhostMemberData.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostMemberData
+#pragma mark ====================================================================================
+
+// Copy-on-Write member map, used as the Ghost's memberData.
+// Copies are O(1), and share their storage. Writes to shared storage only record the modified members, privately:
+// the map of members is never duplicated, and member values themselves are never copied.
+//
+@interface SPGhostMemberData : NSMutableDictionary
+
+@end
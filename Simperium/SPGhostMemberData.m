@@ -0,0 +1,232 @@
+//
+//  SPGhostMemberData.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPGhostMemberData.h"
+#import <pthread.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+// Marks members removed from a map that doesn't own its storage
+static id SPGhostMemberDataRemovedMarker = nil;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostMemberStorage
+#pragma mark ====================================================================================
+
+// Backing storage, shared by every map that was copied from the same source.
+// The lock guards the owner count, in-place writes, and every map's private changes.
+@interface SPGhostMemberStorage : NSObject
+{
+@public
+    NSMutableDictionary *_members;
+    NSUInteger          _owners;
+    pthread_mutex_t     _lock;
+}
+@end
+
+@implementation SPGhostMemberStorage
+
+- (instancetype)initWithMembers:(NSMutableDictionary *)members
+{
+    self = [super init];
+    if (self) {
+        _members    = members;
+        _owners     = 1;
+        pthread_mutex_init(&_lock, NULL);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostMemberData
+#pragma mark ====================================================================================
+
+@implementation SPGhostMemberData
+{
+    SPGhostMemberStorage    *_storage;
+    NSMutableDictionary     *_changes;
+    NSUInteger              _count;
+}
+
++ (void)initialize {
+    if (self == [SPGhostMemberData class]) {
+        SPGhostMemberDataRemovedMarker = [NSObject new];
+    }
+}
+
+- (instancetype)initWithStorage:(SPGhostMemberStorage *)storage changes:(NSMutableDictionary *)changes count:(NSUInteger)count {
+    self = [super init];
+    if (self) {
+        _storage    = storage;
+        _changes    = changes;
+        _count      = count;
+    }
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)numItems {
+    SPGhostMemberStorage *storage = [[SPGhostMemberStorage alloc] initWithMembers:[NSMutableDictionary dictionaryWithCapacity:numItems]];
+    return [self initWithStorage:storage changes:nil count:0];
+}
+
+- (instancetype)initWithObjects:(const id [])objects forKeys:(const id<NSCopying> [])keys count:(NSUInteger)count {
+    NSMutableDictionary *members    = [[NSMutableDictionary alloc] initWithObjects:objects forKeys:keys count:count];
+    SPGhostMemberStorage *storage   = [[SPGhostMemberStorage alloc] initWithMembers:members];
+    return [self initWithStorage:storage changes:nil count:members.count];
+}
+
+- (void)dealloc {
+    if (!_storage) {
+        return;
+    }
+    
+    pthread_mutex_lock(&_storage->_lock);
+    _storage->_owners -= 1;
+    pthread_mutex_unlock(&_storage->_lock);
+}
+
+
+#pragma mark - Copy on Write
+
+- (id)copyWithZone:(NSZone *)zone {
+    return [self mutableCopyWithZone:zone];
+}
+
+- (id)mutableCopyWithZone:(NSZone *)zone {
+    pthread_mutex_lock(&_storage->_lock);
+    
+    // Sole owners fold their changes in, so that the copy shares everything
+    if (_storage->_owners == 1) {
+        [self foldChanges];
+    }
+    
+    _storage->_owners += 1;
+    NSMutableDictionary *changes = [_changes mutableCopy];
+    
+    pthread_mutex_unlock(&_storage->_lock);
+    
+    return [[[self class] allocWithZone:zone] initWithStorage:_storage changes:changes count:_count];
+}
+
+// Must be called with the lock held, by the storage's sole owner
+- (void)foldChanges {
+    for (id key in _changes) {
+        id value = _changes[key];
+        if (value == SPGhostMemberDataRemovedMarker) {
+            [_storage->_members removeObjectForKey:key];
+        } else {
+            _storage->_members[key] = value;
+        }
+    }
+    
+    _changes = nil;
+}
+
+- (void)writeValue:(id)value forKey:(id)key {
+    pthread_mutex_lock(&_storage->_lock);
+    
+    // Shared storage is never written: only the modified members get recorded, privately
+    if (_storage->_owners > 1) {
+        _changes        = _changes ?: [NSMutableDictionary dictionary];
+        _changes[key]   = value;
+    } else if (value == SPGhostMemberDataRemovedMarker) {
+        [self foldChanges];
+        [_storage->_members removeObjectForKey:key];
+    } else {
+        [self foldChanges];
+        _storage->_members[key] = value;
+    }
+    
+    pthread_mutex_unlock(&_storage->_lock);
+}
+
+- (NSArray *)allMemberKeys {
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:_count];
+    
+    for (id key in _storage->_members) {
+        if (!_changes[key]) {
+            [keys addObject:key];
+        }
+    }
+    
+    for (id key in _changes) {
+        if (_changes[key] != SPGhostMemberDataRemovedMarker) {
+            [keys addObject:key];
+        }
+    }
+    
+    return keys;
+}
+
+
+#pragma mark - NSDictionary Primitives
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectForKey:(id)aKey {
+    id value = _changes[aKey];
+    if (value) {
+        return value == SPGhostMemberDataRemovedMarker ? nil : value;
+    }
+    return [_storage->_members objectForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return _changes.count ? [[self allMemberKeys] objectEnumerator] : [_storage->_members keyEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len {
+    if (_changes.count) {
+        return [super countByEnumeratingWithState:state objects:buffer count:len];
+    }
+    return [_storage->_members countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+
+#pragma mark - NSMutableDictionary Primitives
+
+- (void)setObject:(id)anObject forKey:(id<NSCopying>)aKey {
+    NSParameterAssert(anObject);
+    NSParameterAssert(aKey);
+    
+    if (![self objectForKey:aKey]) {
+        _count += 1;
+    }
+    
+    [self writeValue:anObject forKey:[(id)aKey copyWithZone:nil]];
+}
+
+- (void)removeObjectForKey:(id)aKey {
+    if (![self objectForKey:aKey]) {
+        return;
+    }
+    
+    _count -= 1;
+    [self writeValue:SPGhostMemberDataRemovedMarker forKey:aKey];
+}
+
+@end
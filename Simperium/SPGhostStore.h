@@ -0,0 +1,62 @@
+//
+//  SPGhostStore.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SPGhost;
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostStore
+#pragma mark ====================================================================================
+
+/// Persists Ghosts apart from the objects they belong to, keyed by (Bucket, SimperiumKey), in a compact binary format:
+/// the ghost's version, followed by each one of its members, encoded separately, and its (optional) metadata.
+///
+/// Acknowledgements and remote changes only need to update the store, rather than dirtying (and rewriting) the
+/// object itself. Members that didn't change since the last write are not encoded again.
+///
+@interface SPGhostStore : NSObject
+
+/// The Store's Label is used to define the Persistent Store identifier
+///
+@property (nonatomic, strong, readonly) NSString *label;
+
+/// Returns the Ghost stored for the specified object, or nil if there's none. Every call returns a new instance
+///
+- (SPGhost *)ghostForKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName;
+
+/// Stores the specified Ghost. Changes will be persisted after calling `save`
+///
+- (void)setGhost:(SPGhost *)ghost forKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName;
+
+/// Nukes the Ghost stored for the specified object, if any
+///
+- (void)removeGhostForKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName;
+
+/// Nukes every Ghost stored for the specified bucket
+///
+- (void)removeGhostsForBucketName:(NSString *)bucketName;
+
+/// Nukes every single stored Ghost
+///
+- (void)removeAllGhosts;
+
+/// Persists the internal stack
+///
+- (BOOL)save;
+
+/// Binary Encoding Helpers
+///
++ (NSData *)dataWithGhost:(SPGhost *)ghost;
++ (SPGhost *)ghostWithData:(NSData *)data key:(NSString *)simperiumKey;
+
++ (instancetype)loadStoreWithLabel:(NSString *)label;
+
+@end
@@ -0,0 +1,396 @@
+//
+//  SPGhostStore.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPGhostStore.h"
+#import "SPGhost.h"
+#import "SPGhostMemberData.h"
+#import "SPPersistentMutableDictionary.h"
+#import "SPLogger.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLogLevels logLevel                     = SPLogLevelsInfo;
+
+// Record Layout:
+//  [Magic: 4 bytes] [Version Length: uint32] [Version: UTF8] [Member Count: uint32] [Member]...
+//  [Metadata Length: uint32] [Metadata: JSON] (Optional)
+//
+// Member Layout:
+//  [Name Length: uint16] [Name: UTF8] [Type: uint8] [Value Length: uint32] [Value]
+//
+static char const SPGhostStoreMagic[4]          = { 'S', 'P', 'G', '1' };
+
+// Ghosts for brand new objects have no member data at all, which is not the same as having no members
+static uint32_t const SPGhostStoreNilMembers    = UINT32_MAX;
+
+typedef NS_ENUM(uint8_t, SPGhostStoreValueType) {
+    SPGhostStoreValueTypeUTF8                   = 's',
+    SPGhostStoreValueTypeUTF16                  = 'u',
+    SPGhostStoreValueTypeJSON                   = 'j'
+};
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostStoreMember
+#pragma mark ====================================================================================
+
+// Remembers the encoded form of a member's value, so that it can be reused for as long as the value doesn't change.
+// Ghost member values are never mutated in place, and SPGhostMemberData shares untouched values across copies:
+// a pointer comparison is enough
+@interface SPGhostStoreMember : NSObject
+@property (nonatomic, strong, readonly) id      value;
+@property (nonatomic, strong, readonly) NSData  *encoded;
+@end
+
+@implementation SPGhostStoreMember
+
+- (instancetype)initWithValue:(id)value encoded:(NSData *)encoded
+{
+    self = [super init];
+    if (self) {
+        _value      = value;
+        _encoded    = encoded;
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark Binary Helpers
+#pragma mark ====================================================================================
+
+static void SPGhostStoreAppendUInt16(NSMutableData *data, uint16_t value) {
+    uint16_t littleEndian = CFSwapInt16HostToLittle(value);
+    [data appendBytes:&littleEndian length:sizeof(littleEndian)];
+}
+
+static void SPGhostStoreAppendUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t littleEndian = CFSwapInt32HostToLittle(value);
+    [data appendBytes:&littleEndian length:sizeof(littleEndian)];
+}
+
+static BOOL SPGhostStoreReadBytes(NSData *data, NSUInteger *offset, void *buffer, NSUInteger length) {
+    if (*offset + length > data.length) {
+        return NO;
+    }
+    
+    [data getBytes:buffer range:NSMakeRange(*offset, length)];
+    *offset += length;
+    return YES;
+}
+
+static BOOL SPGhostStoreReadUInt16(NSData *data, NSUInteger *offset, uint16_t *value) {
+    uint16_t littleEndian = 0;
+    if (!SPGhostStoreReadBytes(data, offset, &littleEndian, sizeof(littleEndian))) {
+        return NO;
+    }
+    
+    *value = CFSwapInt16LittleToHost(littleEndian);
+    return YES;
+}
+
+static BOOL SPGhostStoreReadUInt32(NSData *data, NSUInteger *offset, uint32_t *value) {
+    uint32_t littleEndian = 0;
+    if (!SPGhostStoreReadBytes(data, offset, &littleEndian, sizeof(littleEndian))) {
+        return NO;
+    }
+    
+    *value = CFSwapInt32LittleToHost(littleEndian);
+    return YES;
+}
+
+static NSData *SPGhostStoreSubdata(NSData *data, NSUInteger *offset, NSUInteger length) {
+    if (*offset + length > data.length) {
+        return nil;
+    }
+    
+    NSData *subdata = [data subdataWithRange:NSMakeRange(*offset, length)];
+    *offset += length;
+    return subdata;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Member Encoding
+#pragma mark ====================================================================================
+
+static NSData *SPGhostStoreEncodeMember(NSString *name, id value) {
+    NSData *nameData                = [name dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *valueData               = nil;
+    SPGhostStoreValueType type      = SPGhostStoreValueTypeJSON;
+    
+    // Strings are the bulk of most ghosts: store them as they are, rather than escaping them
+    if ([value isKindOfClass:[NSString class]]) {
+        valueData                   = [value dataUsingEncoding:NSUTF8StringEncoding];
+        type                        = SPGhostStoreValueTypeUTF8;
+    
+        // Unpaired surrogates can't be represented in UTF8
+        if (!valueData) {
+            valueData               = [value dataUsingEncoding:NSUTF16LittleEndianStringEncoding];
+            type                    = SPGhostStoreValueTypeUTF16;
+        }
+    } else if ([NSJSONSerialization isValidJSONObject:@[ value ]]) {
+        // Wrap scalars up, so that they can be encoded as well
+        valueData                   = [NSJSONSerialization dataWithJSONObject:@[ value ] options:0 error:nil];
+    }
+    
+    if (nameData.length > UINT16_MAX || valueData == nil || valueData.length > UINT32_MAX) {
+        SPLogError(@"Simperium Ghost Store couldn't encode member %@", name);
+        return nil;
+    }
+    
+    NSMutableData *encoded = [NSMutableData dataWithCapacity:nameData.length + valueData.length + 7];
+    SPGhostStoreAppendUInt16(encoded, (uint16_t)nameData.length);
+    [encoded appendData:nameData];
+    [encoded appendBytes:&type length:sizeof(type)];
+    SPGhostStoreAppendUInt32(encoded, (uint32_t)valueData.length);
+    [encoded appendData:valueData];
+    
+    return encoded;
+}
+
+static id SPGhostStoreDecodeValue(NSData *valueData, SPGhostStoreValueType type) {
+    switch (type) {
+        case SPGhostStoreValueTypeUTF8:
+            return [[NSString alloc] initWithData:valueData encoding:NSUTF8StringEncoding];
+        case SPGhostStoreValueTypeUTF16:
+            return [[NSString alloc] initWithData:valueData encoding:NSUTF16LittleEndianStringEncoding];
+        case SPGhostStoreValueTypeJSON: {
+            NSArray *wrapper = [NSJSONSerialization JSONObjectWithData:valueData options:0 error:nil];
+            return [wrapper isKindOfClass:[NSArray class]] ? [wrapper firstObject] : nil;
+        }
+    }
+    
+    return nil;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPGhostStore ()
+@property (nonatomic, strong, readwrite) NSString                       *label;
+@property (nonatomic, strong, readwrite) SPPersistentMutableDictionary  *storage;
+@property (nonatomic, strong, readwrite) NSCache                        *encodedMembers;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostStore
+#pragma mark ====================================================================================
+
+@implementation SPGhostStore
+
+- (instancetype)initWithLabel:(NSString *)label {
+    self = [super init];
+    if (self) {
+        _label                          = label;
+        _encodedMembers                 = [NSCache new];
+        _storage                        = [SPPersistentMutableDictionary loadDictionaryWithLabel:label];
+        _storage.supportedObjectTypes   = [NSSet setWithObject:[NSData class]];
+    }
+    
+    return self;
+}
+
++ (instancetype)loadStoreWithLabel:(NSString *)label {
+    return [[SPGhostStore alloc] initWithLabel:label];
+}
+
+
+#pragma mark - Public Methods
+
+- (SPGhost *)ghostForKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    NSString *storageKey    = [self storageKeyForKey:simperiumKey bucketName:bucketName];
+    NSData *data            = [self.storage objectForKey:storageKey];
+    if (data == nil) {
+        return nil;
+    }
+    
+    SPGhost *ghost          = [[self class] ghostWithData:data key:simperiumKey];
+    if (ghost == nil) {
+        SPLogError(@"Simperium Ghost Store found a malformed record for %@", storageKey);
+    }
+    
+    return ghost;
+}
+
+- (void)setGhost:(SPGhost *)ghost forKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    NSString *storageKey = [self storageKeyForKey:simperiumKey bucketName:bucketName];
+    if (ghost == nil) {
+        [self removeGhostForKey:simperiumKey bucketName:bucketName];
+        return;
+    }
+    
+    NSDictionary *previousMembers   = [self.encodedMembers objectForKey:storageKey];
+    NSMutableDictionary *members    = [NSMutableDictionary dictionaryWithCapacity:ghost.memberData.count];
+    NSData *data                    = [[self class] dataWithGhost:ghost previousMembers:previousMembers encodedMembers:members];
+    
+    [self.storage setObject:data forKey:storageKey];
+    [self.encodedMembers setObject:members forKey:storageKey];
+}
+
+- (void)removeGhostForKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    NSString *storageKey = [self storageKeyForKey:simperiumKey bucketName:bucketName];
+    [self.storage removeObjectForKey:storageKey];
+    [self.encodedMembers removeObjectForKey:storageKey];
+}
+
+- (void)removeGhostsForBucketName:(NSString *)bucketName {
+    NSString *prefix = [self storageKeyPrefixForBucketName:bucketName];
+    
+    for (NSString *storageKey in [self.storage allKeys]) {
+        if ([storageKey hasPrefix:prefix]) {
+            [self.storage removeObjectForKey:storageKey];
+        }
+    }
+    
+    [self.encodedMembers removeAllObjects];
+}
+
+- (void)removeAllGhosts {
+    [self.storage removeAllObjects];
+    [self.encodedMembers removeAllObjects];
+}
+
+- (BOOL)save {
+    return [self.storage save];
+}
+
+
+#pragma mark - Private Helpers
+
+// Bucket names are length prefixed: they may contain dots (or anything else) themselves
+- (NSString *)storageKeyPrefixForBucketName:(NSString *)bucketName {
+    return [NSString stringWithFormat:@"%lu:%@.", (unsigned long)bucketName.length, bucketName];
+}
+
+- (NSString *)storageKeyForKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    return [[self storageKeyPrefixForBucketName:bucketName] stringByAppendingString:simperiumKey];
+}
+
+
+#pragma mark - Binary Encoding
+
++ (NSData *)dataWithGhost:(SPGhost *)ghost {
+    return [self dataWithGhost:ghost previousMembers:nil encodedMembers:nil];
+}
+
++ (NSData *)dataWithGhost:(SPGhost *)ghost previousMembers:(NSDictionary *)previousMembers encodedMembers:(NSMutableDictionary *)encodedMembers {
+    NSData *versionData     = [ghost.version dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+    NSDictionary *memberData = ghost.memberData;
+    NSMutableArray *chunks  = [NSMutableArray arrayWithCapacity:memberData.count];
+    NSUInteger length       = sizeof(SPGhostStoreMagic) + versionData.length + 2 * sizeof(uint32_t);
+    
+    for (NSString *name in memberData) {
+        id value                        = memberData[name];
+        SPGhostStoreMember *previous    = previousMembers[name];
+        NSData *encoded                 = (previous.value == value) ? previous.encoded : SPGhostStoreEncodeMember(name, value);
+        if (encoded == nil) {
+            continue;
+        }
+    
+        [chunks addObject:encoded];
+        encodedMembers[name]            = [[SPGhostStoreMember alloc] initWithValue:value encoded:encoded];
+        length                          += encoded.length;
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithCapacity:length];
+    [data appendBytes:SPGhostStoreMagic length:sizeof(SPGhostStoreMagic)];
+    SPGhostStoreAppendUInt32(data, (uint32_t)versionData.length);
+    [data appendData:versionData];
+    SPGhostStoreAppendUInt32(data, memberData ? (uint32_t)chunks.count : SPGhostStoreNilMembers);
+    
+    for (NSData *chunk in chunks) {
+        [data appendData:chunk];
+    }
+    
+    // Metadata is optional, and goes last: records written without it remain readable
+    NSData *metadata = ghost.metadata.count ? [NSJSONSerialization dataWithJSONObject:ghost.metadata options:0 error:nil] : nil;
+    if (metadata.length && metadata.length <= UINT32_MAX) {
+        SPGhostStoreAppendUInt32(data, (uint32_t)metadata.length);
+        [data appendData:metadata];
+    }
+    
+    return data;
+}
+
++ (SPGhost *)ghostWithData:(NSData *)data key:(NSString *)simperiumKey {
+    NSUInteger offset       = 0;
+    char magic[4]           = { 0 };
+    uint32_t versionLength  = 0;
+    uint32_t memberCount    = 0;
+    
+    if (!SPGhostStoreReadBytes(data, &offset, magic, sizeof(magic)) || memcmp(magic, SPGhostStoreMagic, sizeof(magic)) != 0) {
+        return nil;
+    }
+    
+    if (!SPGhostStoreReadUInt32(data, &offset, &versionLength)) {
+        return nil;
+    }
+    
+    NSData *versionData     = SPGhostStoreSubdata(data, &offset, versionLength);
+    if (!versionData || !SPGhostStoreReadUInt32(data, &offset, &memberCount)) {
+        return nil;
+    }
+    
+    BOOL hasMembers                 = (memberCount != SPGhostStoreNilMembers);
+    NSMutableDictionary *memberData = hasMembers ? [SPGhostMemberData dictionaryWithCapacity:memberCount] : nil;
+    
+    for (uint32_t i = 0; hasMembers && i < memberCount; ++i) {
+        uint16_t nameLength             = 0;
+        uint32_t valueLength            = 0;
+        SPGhostStoreValueType type      = 0;
+    
+        if (!SPGhostStoreReadUInt16(data, &offset, &nameLength)) {
+            return nil;
+        }
+    
+        NSData *nameData                = SPGhostStoreSubdata(data, &offset, nameLength);
+        if (!nameData || !SPGhostStoreReadBytes(data, &offset, &type, sizeof(type)) || !SPGhostStoreReadUInt32(data, &offset, &valueLength)) {
+            return nil;
+        }
+    
+        NSData *valueData               = SPGhostStoreSubdata(data, &offset, valueLength);
+        NSString *name                  = [[NSString alloc] initWithData:nameData encoding:NSUTF8StringEncoding];
+        id value                        = valueData ? SPGhostStoreDecodeValue(valueData, type) : nil;
+        if (!name || !value) {
+            return nil;
+        }
+    
+        memberData[name]                = value;
+    }
+    
+    uint32_t metadataLength             = 0;
+    NSDictionary *metadata              = nil;
+    
+    if (offset < data.length) {
+        NSData *metadataData            = SPGhostStoreReadUInt32(data, &offset, &metadataLength) ? SPGhostStoreSubdata(data, &offset, metadataLength) : nil;
+        metadata                        = metadataData ? [NSJSONSerialization JSONObjectWithData:metadataData options:0 error:nil] : nil;
+        if (![metadata isKindOfClass:[NSDictionary class]]) {
+            return nil;
+        }
+    }
+    
+    // Freshly loaded ghosts don't need to be saved again
+    SPGhost *ghost                      = [[SPGhost alloc] initWithKey:simperiumKey memberData:memberData];
+    ghost.version                       = versionLength ? [[NSString alloc] initWithData:versionData encoding:NSUTF8StringEncoding] : nil;
+    ghost.metadata                      = metadata;
+    ghost.needsSave                     = NO;
+    
+    return ghost;
+}
+
+@end
@@ -13,11 +13,15 @@
 #import "SPManagedObject.h"
 #import "SPGhost.h"
 #import "SPStorage.h"
-#import "JSONKit+Simperium.h"
 #import "SPLogger.h"
 #import "SPBucket+Internals.h"
 #import "SPDiffable.h"
 #import "SPDiffer.h"
+#import "SPSchema.h"
+#import "SPMember.h"
+#import "SPMemberEntity.h"
+#import "SPMetrics.h"
+#import "SPTracer.h"
 
 
 
@@ -27,6 +31,7 @@
 
 static SPLogLevels logLevel                         = SPLogLevelsInfo;
 static NSInteger const SPIndexProcessorBatchSize    = 50;
+static NSInteger const SPIndexProcessorRebaseStride = 8;
 
 typedef NS_ENUM(NSInteger, SPVersion) {
     SPVersionKey    = 0,
@@ -35,6 +40,92 @@ typedef NS_ENUM(NSInteger, SPVersion) {
 };
 
 
+#pragma mark ====================================================================================
+#pragma mark SPObjectSnapshot
+#pragma mark ====================================================================================
+
+// Read only copy of an object's member values. Diffs and transforms only need SPDiffable's accessors, so they can
+// run against a snapshot, away from the storage's thread.
+@interface SPObjectSnapshot : NSObject <SPDiffable>
+@property (nonatomic, strong) NSDictionary  *memberValues;
++ (instancetype)snapshotOfObject:(id<SPDiffable>)object schema:(SPSchema *)schema;
+@end
+
+@implementation SPObjectSnapshot
+
+@synthesize ghost           = _ghost;
+@synthesize ghostData       = _ghostData;
+@synthesize simperiumKey    = _simperiumKey;
+@synthesize bucket          = _bucket;
+
++ (instancetype)snapshotOfObject:(id<SPDiffable>)object schema:(SPSchema *)schema {
+    NSMutableDictionary *memberValues = [NSMutableDictionary dictionaryWithCapacity:schema.members.count];
+    
+    for (SPMember *member in [schema.members allValues]) {
+        id value = [object simperiumValueForKey:member.keyName];
+        memberValues[member.keyName] = [value conformsToProtocol:@protocol(NSCopying)] ? [value copy] : value;
+    }
+    
+    SPObjectSnapshot *snapshot  = [self new];
+    snapshot.simperiumKey       = object.simperiumKey;
+    snapshot.bucket             = object.bucket;
+    snapshot.memberValues       = memberValues;
+    
+    return snapshot;
+}
+
+- (id)simperiumValueForKey:(NSString *)key {
+    return self.memberValues[key];
+}
+
+- (void)simperiumSetValue:(id)value forKey:(NSString *)key {
+    NSAssert(false, @"Snapshots are read only");
+}
+
+- (void)loadMemberData:(NSDictionary *)data {
+    NSAssert(false, @"Snapshots are read only");
+}
+
+- (void)willBeRead {
+    
+}
+
+- (NSDictionary *)dictionary {
+    return self.memberValues;
+}
+
+- (NSString *)version {
+    return self.ghost.version;
+}
+
+- (id)object {
+    return self;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPPendingRebase
+#pragma mark ====================================================================================
+
+// Everything needed to rebase an object's local pending changes on top of its remote member data
+@interface SPPendingRebase : NSObject
+@property (nonatomic, strong) id<SPDiffable>    object;
+@property (nonatomic, copy)   NSString          *version;
+@property (nonatomic, strong) NSDictionary      *ghostData;
+@property (nonatomic, strong) SPGhost           *localGhost;
+@property (nonatomic, strong) id<SPDiffable>    localObject;
+@property (nonatomic, strong) id<SPDiffable>    remoteObject;
+@property (nonatomic, strong) NSDictionary      *localDiff;
+@property (nonatomic, strong) NSDictionary      *rebaseDiff;
+@property (nonatomic, strong) NSError           *error;
+@end
+
+@implementation SPPendingRebase
+@end
+
+
 #pragma mark ====================================================================================
 #pragma mark Private
 #pragma mark ====================================================================================
@@ -63,6 +154,8 @@ typedef NS_ENUM(NSInteger, SPVersion) {
 // Process an index of keys from the Simperium service for a particular bucket
 - (void)processIndex:(NSArray *)indexArray bucket:(SPBucket *)bucket versionHandler:(SPVersionHandlerBlockType)versionHandler  {
     
+    SPTraceScope("index.process", bucket.name, nil);
+    
     // indexArray could have thousands of items; break it up into batches to manage memory use
     NSMutableDictionary *indexDict  = [NSMutableDictionary dictionaryWithCapacity:[indexArray count]];
     NSInteger numBatches            = 1 + [indexArray count] / SPIndexProcessorBatchSize;
@@ -134,12 +227,24 @@ typedef NS_ENUM(NSInteger, SPVersion) {
 
 - (void)reconcileLocalAndRemoteIndex:(NSSet *)remoteKeySet bucket:(SPBucket *)bucket {
     
+    SPTraceScope("index.reconcile", bucket.name, nil);
+    
     id<SPStorageProvider> threadSafeStorage = [bucket.storage threadSafeStorage];
     
     [threadSafeStorage performCriticalBlockAndWait:^{
-        NSArray *localKeys                  = [threadSafeStorage objectKeysForBucketName:bucket.name];
-        NSMutableSet *localKeySet           = [NSMutableSet setWithArray:localKeys];
-        [localKeySet minusSet:remoteKeySet];
+        // Only the keys missing remotely are ever copied
+        NSMutableSet *localKeySet           = [NSMutableSet set];
+        
+        if ([threadSafeStorage respondsToSelector:@selector(enumerateObjectKeysForBucketName:usingBlock:)]) {
+            [threadSafeStorage enumerateObjectKeysForBucketName:bucket.name usingBlock:^(NSString *simperiumKey, BOOL *stop) {
+                if (![remoteKeySet containsObject:simperiumKey]) {
+                    [localKeySet addObject:simperiumKey];
+                }
+            }];
+        } else {
+            [localKeySet addObjectsFromArray:[threadSafeStorage objectKeysForBucketName:bucket.name]];
+            [localKeySet minusSet:remoteKeySet];
+        }
 
         // If any objects exist locally but not remotely, get rid of them
         if (localKeySet.count == 0) {
@@ -162,7 +267,11 @@ typedef NS_ENUM(NSInteger, SPVersion) {
         }
         
         SPLogVerbose(@"Simperium deleting %ld objects after re-indexing", (long)keysForDeletedObjects.count);
+        
+        SPTraceScope("storage.save", bucket.name, nil);
+        CFAbsoluteTime saveStartTime = CFAbsoluteTimeGetCurrent();
         [threadSafeStorage save];
+        [[bucket.metrics histogramNamed:SPMetricsStorageSaveTime] recordTimeIntervalSinceTime:saveStartTime];
         
         dispatch_async(dispatch_get_main_queue(), ^{
             NSDictionary *userInfo = @{
@@ -181,11 +290,23 @@ typedef NS_ENUM(NSInteger, SPVersion) {
     NSAssert([bucket isKindOfClass:[SPBucket class]],   @"Invalid Bucket Pointer");
     NSAssert(changeHandler,                             @"Please, provide a change handler");
     
+    [[bucket.metrics counterNamed:SPMetricsVersionsFetched] add:versions.count];
+    
+    SPTraceScope("index.versions", bucket.name, nil);
+    
     @autoreleasepool {
         NSMutableSet *addedKeys                 = [NSMutableSet setWithCapacity:5];
         NSMutableSet *changedKeys               = [NSMutableSet setWithCapacity:5];
         NSMutableSet *rebasedKeys               = [NSMutableSet setWithCapacity:5];
         id<SPStorageProvider> threadSafeStorage = [bucket.storage threadSafeStorage];
+        NSMutableArray *rebases                 = [NSMutableArray array];
+        
+        // Storages supporting Bulk Upserts will get every new object in a single call
+        BOOL supportsUpserts                    = [threadSafeStorage respondsToSelector:@selector(upsertObjectsForBucket:versions:)];
+        NSMutableArray *newVersions             = [NSMutableArray array];
+        
+        // Relationships can only be resolved on the storage's thread: their members can't be snapshotted
+        BOOL canSnapshot                        = [self canSnapshotObjectsWithSchema:bucket.differ.schema];
         
         [threadSafeStorage performSafeBlockAndWait:^{
             
@@ -205,98 +326,104 @@ typedef NS_ENUM(NSInteger, SPVersion) {
                 NSString *key                   = versionData[SPVersionKey];
                 NSString *version               = versionData[SPVersionNumber];
                 NSDictionary *data              = versionData[SPVersionData];
-                NSMutableDictionary *ghostData  = nil;
                 
                 // Process the Object's Member Data
                 id<SPDiffable> object           = objects[key];
                 
+                // The object doesn't exist locally yet, and will be upserted afterwards
+                if (!object && supportsUpserts) {
+                    [newVersions addObject:versionData];
+                    [addedKeys addObject:key];
+                    continue;
+                }
+                
                 // The object doesn't exist locally yet, so create it
                 if (!object) {
                     object          = [threadSafeStorage insertNewObjectForBucketName:bucket.name simperiumKey:key];
                     object.bucket   = bucket; // set it manually since it won't be set automatically yet
                     [object loadMemberData:data];
                     
-                    ghostData       = [[object dictionary] mutableCopy];
-                    
                     [addedKeys addObject:key];
                     SPLogVerbose(@"Simperium added object from index (%@): %@", bucket.name, object.simperiumKey);
                     
-                // The object exists. Let's attempt to rebase local pending changes
-                } else {
-
-                    // 1. Failsafe: Make sure that the object is in memory
-                    [object willBeRead];
-
-                    // 2. Calculate Delta: LocalGhost > LocalMembers
-                    SPGhost *localGhost             = [object.ghost copy];
-                    NSDictionary *localDiff         = [bucket.differ diffFromDictionary:localGhost.memberData toObject:object];
-                    
-                    // 3. Load the full Remote Member Data
+                    [self updateGhostForObject:object memberData:[object dictionary] version:version storage:threadSafeStorage];
+                    continue;
+                }
+                
+                // 1. Failsafe: Make sure that the object is in memory
+                [object willBeRead];
+                
+                // The object exists, but there's nothing to rebase: just load the remote data
+                BOOL rebaseDisabled = [self.keysForObjectsWithRebaseDisabled containsObject:key];
+                if (rebaseDisabled || ![self objectHasLocalChanges:object schema:bucket.differ.schema]) {
                     [object loadMemberData:data];
-                    SPLogWarn(@"Simperium successfully reloaded local entity (%@): %@.%@", bucket.name, key, version);
+                    [changedKeys addObject:key];
+                    [self.keysForObjectsWithRebaseDisabled removeObject:key];
                     
-                    // 4. Be sure to load all members into ghost (since the version results might only contain a subset of members that were changed)
-                    ghostData                       = [[object dictionary] mutableCopy];
-
-                    // 5. Rebase + apply localDiff
-                    BOOL isRebaseDisabled = [self.keysForObjectsWithRebaseDisabled containsObject:key];
+                    SPLogVerbose(@"Simperium reloaded local entity without changes (%@): %@.%@", bucket.name, key, version);
                     
-                    if (localDiff.count && !isRebaseDisabled) {
-                        
-                        // 5.1. Calculate Delta: LocalGhost > RemoteMembers
-                        NSDictionary *remoteDiff    = [bucket.differ diffFromDictionary:localGhost.memberData toObject:object];
-                        
-                        // 5.2. Transform localDiff: LocalGhost >> RemoteMembers >> LocalDiff (equivalent to git rebase)
-                        NSError *error              = nil;
-                        NSDictionary *rebaseDiff    = nil;
-                        
-                        if (remoteDiff.count) {
-                            // Note: if remoteDiff is empty, there is just no need to rebase!.
-                            SPLogWarn(@"Simperium rebasing local changes for object (%@): %@.%@", bucket.name, key, version);
-                            rebaseDiff = [bucket.differ transform:object diff:localDiff oldDiff:remoteDiff oldGhost:localGhost error:&error];
-                        } else {
-                            SPLogWarn(@"Simperium rebasing local changes for object (%@): %@.%@", bucket.name, key, version);
-                            rebaseDiff = localDiff;
-                        }
-                        
-                        // 5.3. Attempt to apply the Local Transformed Diff
-                        if (!error && rebaseDiff.count) {
-                            [bucket.differ applyDiffFromDictionary:rebaseDiff toObject:object error:&error];
-                        }
-                        
-                        // 5.4. Some debugging
-                        if (error) {
-                            SPLogWarn(@"Simperium error: could not apply local transformed diff for entity (%@): %@.%@", bucket.name, key, version);
-                        } else {
-                            SPLogWarn(@"Simperium successfully updated local entity (%@): %@.%@", bucket.name, key, version);
-                        }
-                        
-                        // 5.5. Signal the changeHandler that the object has untracked changes. Do this after saving the storage!
-                        [rebasedKeys addObject:key];
-                    }
+                    [self updateGhostForObject:object memberData:[object dictionary] version:version storage:threadSafeStorage];
+                    continue;
+                }
+                
+                // The object has local changes. Let's snapshot it, so that they can get rebased
+                SPPendingRebase *rebase = [self pendingRebaseForObject:object version:version data:data bucket:bucket snapshot:canSnapshot];
+                [rebases addObject:rebase];
+            }
+        }];
+        
+        // Snapshots can be rebased off the storage's thread, concurrently. Live objects can't
+        if (canSnapshot) {
+            [self computeRebaseDiffs:rebases bucket:bucket concurrently:YES];
+        }
+        
+        [threadSafeStorage performSafeBlockAndWait:^{
+            
+            if (!canSnapshot) {
+                [self computeRebaseDiffs:rebases bucket:bucket concurrently:NO];
+            }
+            
+            for (SPPendingRebase *rebase in rebases) {
+                NSString *key       = rebase.object.simperiumKey;
+                NSString *version   = rebase.version;
+                
+                // 8. Attempt to apply the Local Transformed Diff
+                if (rebase.localDiff.count) {
+                    NSError *error = rebase.error;
                     
-                    // 6. Keep track of changed Keys
-                    [changedKeys addObject:key];
+                    SPLogWarn(@"Simperium rebasing local changes for object (%@): %@.%@", bucket.name, key, version);
+                    if (!error && rebase.rebaseDiff.count) {
+                        [bucket.differ applyDiffFromDictionary:rebase.rebaseDiff toObject:rebase.object error:&error];
+                    }
                     
-                    // 7. Cleanup
-                    if (isRebaseDisabled) {
-                        [self.keysForObjectsWithRebaseDisabled removeObject:key];
+                    // 8.1. Some debugging
+                    if (error) {
+                        SPLogWarn(@"Simperium error: could not apply local transformed diff for entity (%@): %@.%@", bucket.name, key, version);
+                    } else {
+                        SPLogWarn(@"Simperium successfully updated local entity (%@): %@.%@", bucket.name, key, version);
                     }
+                    
+                    // 8.2. Signal the changeHandler that the object has untracked changes. Do this after saving the storage!
+                    [rebasedKeys addObject:key];
                 }
                 
-                // Update the ghost with the remote member data + version
-                SPGhost *ghost      = [[SPGhost alloc] initWithKey:object.simperiumKey memberData:ghostData];
-                ghost.version       = version;
-                object.ghost        = ghost;
-
-                // Slight hack to ensure Core Data realizes the object has changed and needs a save
-                object.ghostData    = [[object.ghost.dictionary sp_JSONString] copy];
+                // 9. Keep track of changed Keys
+                [changedKeys addObject:key];
                 
-                SPLogVerbose(@"Simperium updating ghost data for object %@.%@ (%@)", object.simperiumKey, version, bucket.name);
+                // 10. Cleanup
+                [self updateGhostForObject:rebase.object memberData:rebase.ghostData version:version storage:threadSafeStorage];
+            }
+            
+            if (newVersions.count) {
+                [threadSafeStorage upsertObjectsForBucket:bucket versions:newVersions];
+                SPLogVerbose(@"Simperium upserted %ld objects from index (%@)", (long)newVersions.count, bucket.name);
             }
             
             // Store after processing the batch for efficiency
+            SPTraceScope("storage.save", bucket.name, nil);
+            CFAbsoluteTime saveStartTime = CFAbsoluteTimeGetCurrent();
             [threadSafeStorage save];
+            [[bucket.metrics histogramNamed:SPMetricsStorageSaveTime] recordTimeIntervalSinceTime:saveStartTime];
         }];
         
         // Signal the changeHandler that the object has untracked changes
@@ -306,6 +433,8 @@ typedef NS_ENUM(NSInteger, SPVersion) {
         
         // Do all main thread work afterwards as well
         dispatch_async(dispatch_get_main_queue(), ^{
+            SPTraceScope("index.notify", bucket.name, nil);
+            
             // Manually resolve any pending references to added objects
             [bucket resolvePendingRelationshipsToKeys:addedKeys];
             [bucket.storage save];
@@ -333,6 +462,139 @@ typedef NS_ENUM(NSInteger, SPVersion) {
     }
 }
 
+
+#pragma mark - Rebase Helpers
+
+- (BOOL)canSnapshotObjectsWithSchema:(SPSchema *)schema {
+    for (SPMember *member in [schema.members allValues]) {
+        if ([member isKindOfClass:[SPMemberEntity class]]) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+// Cheap check for local changes, meant to spare the snapshots (and diffs) whenever there's nothing to rebase. The ghost
+// holds the members' wire values, as returned by `dictionary`: lazily loaded members get compared as they are, without
+// being decoded. False positives just take the regular path.
+// Note: Must be called on the storage's thread
+- (BOOL)objectHasLocalChanges:(id<SPDiffable>)object schema:(SPSchema *)schema {
+    
+    NSDictionary *ghostData = object.ghost.memberData;
+    if (!ghostData) {
+        return YES;
+    }
+    
+    NSDictionary *memberData = [object dictionary];
+    for (SPMember *member in [schema.members allValues]) {
+        id value        = memberData[member.keyName];
+        id ghostValue   = ghostData[member.keyName];
+        
+        if (value != ghostValue && ![value isEqual:ghostValue]) {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+// Note: Must be called on the storage's thread
+- (SPPendingRebase *)pendingRebaseForObject:(id<SPDiffable>)object version:(NSString *)version data:(NSDictionary *)data bucket:(SPBucket *)bucket snapshot:(BOOL)snapshot {
+    
+    SPPendingRebase *rebase = [SPPendingRebase new];
+    rebase.object           = object;
+    rebase.version          = version;
+    
+    // 2. Snapshot the Local Members. Whenever that's not possible, calculate Delta: LocalGhost > LocalMembers right here
+    rebase.localGhost       = [object.ghost copy];
+    
+    if (snapshot) {
+        rebase.localObject  = [SPObjectSnapshot snapshotOfObject:object schema:bucket.differ.schema];
+    } else {
+        rebase.localDiff    = [bucket.differ diffFromDictionary:rebase.localGhost.memberData toObject:object];
+    }
+    
+    // 3. Load the full Remote Member Data
+    [object loadMemberData:data];
+    SPLogWarn(@"Simperium successfully reloaded local entity (%@): %@.%@", bucket.name, object.simperiumKey, version);
+    
+    // 4. Be sure to load all members into ghost (since the version results might only contain a subset of members that were changed)
+    //    Note: The ghost takes its own (single) copy of the members
+    rebase.ghostData        = [object dictionary];
+    rebase.remoteObject     = snapshot ? [SPObjectSnapshot snapshotOfObject:object schema:bucket.differ.schema] : object;
+    
+    return rebase;
+}
+
+// Diffs and transforms are CPU bound, and independent from one key to another: large batches get spread across cores
+- (void)computeRebaseDiffs:(NSArray *)rebases bucket:(SPBucket *)bucket concurrently:(BOOL)concurrently {
+    
+    SPTraceScope("index.rebase", bucket.name, nil);
+    
+    SPDiffer *differ = bucket.differ;
+    
+    if (!concurrently || rebases.count < SPIndexProcessorRebaseStride) {
+        for (SPPendingRebase *rebase in rebases) {
+            [self computeRebaseDiff:rebase differ:differ];
+        }
+        return;
+    }
+    
+    size_t strides = (rebases.count + SPIndexProcessorRebaseStride - 1) / SPIndexProcessorRebaseStride;
+    
+    dispatch_apply(strides, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t stride) {
+        NSUInteger start    = stride * SPIndexProcessorRebaseStride;
+        NSUInteger end      = MIN(start + SPIndexProcessorRebaseStride, rebases.count);
+        
+        for (NSUInteger i = start; i < end; ++i) {
+            @autoreleasepool {
+                [self computeRebaseDiff:rebases[i] differ:differ];
+            }
+        }
+    });
+}
+
+- (void)computeRebaseDiff:(SPPendingRebase *)rebase differ:(SPDiffer *)differ {
+    // 5. Calculate Delta: LocalGhost > LocalMembers
+    if (rebase.localObject) {
+        rebase.localDiff = [differ diffFromDictionary:rebase.localGhost.memberData toObject:rebase.localObject];
+    }
+    
+    if (rebase.localDiff.count == 0) {
+        return;
+    }
+    
+    // 6. Calculate Delta: LocalGhost > RemoteMembers
+    NSDictionary *remoteDiff = [differ diffFromDictionary:rebase.localGhost.memberData toObject:rebase.remoteObject];
+    
+    // 7. Transform localDiff: LocalGhost >> RemoteMembers >> LocalDiff (equivalent to git rebase)
+    //    Note: if remoteDiff is empty, there is just no need to rebase!.
+    if (remoteDiff.count == 0) {
+        rebase.rebaseDiff = rebase.localDiff;
+        return;
+    }
+    
+    NSError *error      = nil;
+    rebase.rebaseDiff   = [differ transform:rebase.remoteObject diff:rebase.localDiff oldDiff:remoteDiff oldGhost:rebase.localGhost error:&error];
+    rebase.error        = error;
+}
+
+// Update the ghost with the remote member data + version
+- (void)updateGhostForObject:(id<SPDiffable>)object memberData:(NSDictionary *)memberData version:(NSString *)version storage:(id<SPStorageProvider>)storage {
+    SPGhost *ghost      = [[SPGhost alloc] initWithKey:object.simperiumKey memberData:memberData];
+    ghost.version       = version;
+    object.ghost        = ghost;
+    
+    // Persist the ghost: storages with a Ghost Store won't need to dirty the object itself
+    [SPStorage saveGhostForObject:object storage:storage];
+    
+    SPLogVerbose(@"Simperium updating ghost data for object %@.%@ (%@)", object.simperiumKey, version, object.bucket.name);
+}
+
+
+#pragma mark - Rebase Settings
+
 - (void)enableRebaseForAllObjects {
     [self.keysForObjectsWithRebaseDisabled removeAllObjects];
 }
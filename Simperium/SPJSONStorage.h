@@ -15,6 +15,21 @@
 @property (nonatomic, strong) NSMutableDictionary   *objects;
 @property (nonatomic, strong) NSMutableDictionary   *allObjects;
 
+// Memory Budget: Least Recently Used objects beyond this limit get spilled to a scratch file on disk, and are brought
+// back transparently when needed. Objects still in use elsewhere are never spilled. Zero means unbounded (default)
+@property (nonatomic, assign) NSUInteger            maximumObjectsInMemory;
+
 - (instancetype)initWithDelegate:(id<SPStorageObserver>)aDelegate;
 
+// Persistence: Loads every object journaled at the specified URL, and journals every change from now on. Objects
+// are journaled on `save`, and `commitPendingOperations:` waits until they've hit the disk. Should be called before
+// any bucket is created. Without a persistent store, this storage is ephemeral
+- (BOOL)loadPersistentStoreAtURL:(NSURL *)URL;
+
+// Hooks up the objects loaded from the persistent store with their bucket
+- (void)adoptObjectsForBucket:(SPBucket *)bucket;
+
+// Secondary Indexes: Hash indexes answer == and IN. Sorted indexes also answer <, <=, >, >= and BETWEEN
+- (void)addIndexForMemberNamed:(NSString *)memberName sorted:(BOOL)sorted bucketName:(NSString *)bucketName;
+
 @end
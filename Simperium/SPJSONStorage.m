@@ -13,6 +13,16 @@
 #import "SPBucket+Internals.h"
 #import "SPSchema.h"
 #import "SPDiffer.h"
+#import "SPJSONStorageIndex.h"
+#import "SPJSONStorageCache.h"
+#import "SPJSONStorageJournal.h"
+#import "SPObjectKeySet.h"
+#import "SPLogger.h"
+#import <stdatomic.h>
+
+
+static SPLogLevels logLevel                           = SPLogLevelsInfo;
+static NSUInteger const SPJSONStorageLoadTrimInterval = 1000;
 
 
 @interface NSMutableDictionary ()
@@ -25,21 +35,39 @@
 @interface SPJSONStorage ()
 @property (nonatomic,   weak) id<SPStorageObserver> delegate;
 @property (nonatomic, strong) dispatch_queue_t      storageQueue;
+@property (nonatomic, strong) NSMutableDictionary   *indexes;
+@property (atomic,       copy) NSDictionary          *indexedMemberNames;
+@property (nonatomic, strong) SPJSONStorageCache    *cache;
+@property (nonatomic, strong) SPJSONStorageJournal  *journal;
+@property (nonatomic, strong) SPObjectKeySet        *objectKeys;
+@property (nonatomic, strong) dispatch_queue_t      pendingChangesQueue;
+@property (nonatomic, strong) NSMutableDictionary   *updatedKeys;
+@property (nonatomic, strong) NSMutableDictionary   *deletedKeys;
+@property (nonatomic,   copy) NSDictionary          *storedMetadata;
 @end
 
 
-@implementation SPJSONStorage
+@implementation SPJSONStorage {
+    atomic_bool _trimScheduled;
+}
 
 - (instancetype)initWithDelegate:(id<SPStorageObserver>)aDelegate
 {
     self = [super init];
     if (self) {
-        _delegate   = aDelegate;
-        _objects    = [NSMutableDictionary dictionaryWithCapacity:10];
-        _allObjects = [NSMutableDictionary dictionaryWithCapacity:10];
-
+        _delegate       = aDelegate;
+        _objects        = [NSMutableDictionary dictionaryWithCapacity:10];
+        _allObjects     = [NSMutableDictionary dictionaryWithCapacity:10];
+        _indexes        = [NSMutableDictionary dictionary];
+        _updatedKeys    = [NSMutableDictionary dictionary];
+        _deletedKeys    = [NSMutableDictionary dictionary];
+        _objectKeys     = [SPObjectKeySet new];
+
+        // Reads run concurrently, while writes are enqueued as barriers: UI lookups won't contend with each other,
+        // only with the (much rarer) inserts and deletions performed by the processors
         NSString *queueLabel = @"com.simperium.JSONstorage";
-        _storageQueue = dispatch_queue_create([queueLabel cStringUsingEncoding:NSUTF8StringEncoding], NULL);
+        _storageQueue = dispatch_queue_create([queueLabel cStringUsingEncoding:NSUTF8StringEncoding], DISPATCH_QUEUE_CONCURRENT);
+        _pendingChangesQueue = dispatch_queue_create("com.simperium.JSONstorage.pending", NULL);
     }
     
     return self;
@@ -47,18 +75,51 @@
 
 
 - (void)object:(id)object forKey:(NSString *)simperiumKey didChangeValue:(id)value forKey:(NSString *)key {
-    // Update the schema if applicable
-    SPObject *spObject = [_allObjects objectForKey:simperiumKey];
-    [spObject.bucket.differ.schema ensureDynamicMemberExistsForObject:value key:key];
+    // Note: Objects update the schema themselves when batching. Single values may come from elsewhere
+    if ([object conformsToProtocol:@protocol(SPDiffable)]) {
+        [((id<SPDiffable>)object).bucket.differ.schema ensureDynamicMemberExistsForObject:value key:key];
+    }
+    
+    [self object:object forKey:simperiumKey didChangeValues:@{ key : value ?: [NSNull null] }];
+}
+
+- (void)object:(id)object forKey:(NSString *)simperiumKey didChangeValues:(NSDictionary *)values {
+    id<SPDiffable>diffable  = [object conformsToProtocol:@protocol(SPDiffable)] ? object : nil;
+    NSString *bucketName    = diffable.bucket.name;
+    [self markKeyAsUpdated:simperiumKey bucketName:bucketName];
+    
+    // Keep the Secondary Indexes in sync, if any. Buckets without indexes never hit the queue
+    NSSet *indexedMemberNames = self.indexedMemberNames[bucketName];
+    if (simperiumKey == nil || indexedMemberNames.count == 0 || ![indexedMemberNames intersectsSet:[NSSet setWithArray:values.allKeys]]) {
+        return;
+    }
+    
+    dispatch_barrier_sync(_storageQueue, ^{
+        // Deleted objects should not make it back into the indexes
+        if (_allObjects[simperiumKey] == nil) {
+            return;
+        }
+        
+        NSDictionary *bucketIndexes = _indexes[bucketName];
+        for (NSString *key in values) {
+            id value = values[key];
+            [bucketIndexes[key] setValue:(value == [NSNull null] ? nil : value) forObjectKey:simperiumKey];
+        }
+    });
 }
 
 - (SPStorage *)threadSafeStorage {
-    // Accessing objects through any instance of this class is thread-safe (on the main thread)
+    // Accessing objects through any instance of this class is thread-safe: reads are concurrent, writes are barriers
     return self;
 }
 
 - (NSMutableDictionary *)objectDictionaryForBucketName:(NSString *)bucketName {
-    return [_objects objectForKey:bucketName];
+    __block NSMutableDictionary *objectDict = nil;
+    dispatch_sync(_storageQueue, ^{
+        objectDict = [_objects objectForKey:bucketName];
+    });
+    
+    return objectDict;
 }
 
 - (id)objectForKey:(NSString *)key bucketName:(NSString *)bucketName {
@@ -67,10 +128,12 @@
     dispatch_sync(_storageQueue, ^{
         NSDictionary *objectDict = [_objects objectForKey:bucketName];
         if (objectDict) {
-            object = [objectDict objectForKey:key];
+            object = [self resolvedEntry:[objectDict objectForKey:key]];
         }
     });
     
+    [self scheduleTrimIfNeeded];
+    
     return object;
 }
 
@@ -80,10 +143,12 @@
     dispatch_sync(_storageQueue, ^{
         NSDictionary *objectDict = [_objects objectForKey:bucketName];
         if (objectDict) {
-            someObjects = [objectDict objectsForKeys:[keys allObjects] notFoundMarker:[NSNull null]];
+            someObjects = [self resolvedEntries:[objectDict objectsForKeys:[keys allObjects] notFoundMarker:[NSNull null]]];
         }
     });
     
+    [self scheduleTrimIfNeeded];
+    
     return someObjects ?: @[];
 }
 
@@ -95,30 +160,35 @@
 { 
     __block NSArray *bucketObjects = nil;
     dispatch_sync(_storageQueue, ^{
-        NSDictionary *objectDict = [_objects objectForKey:bucketName];
-        if (objectDict) {
-            bucketObjects = [objectDict allValues];
-            
-            if (predicate) {
-                bucketObjects = [bucketObjects filteredArrayUsingPredicate:predicate];
-            }
-        }
+        bucketObjects = [self filteredObjectsForBucketName:bucketName predicate:predicate];
     });
+    
+    [self scheduleTrimIfNeeded];
 
     return bucketObjects ?: @[];
 }
 
 - (NSArray *)objectKeysForBucketName:(NSString *)bucketName {
-    __block NSArray *bucketObjects = [self objectsForBucketName:bucketName predicate:nil];
-    
-    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:[bucketObjects count]];
-    for (id<SPDiffable>object in bucketObjects) {
-        if (object.simperiumKey) {
-            [keys addObject:object.simperiumKey];
-        }
+    return [[self loadedObjectKeysForBucketName:bucketName] allObjects] ?: @[];
+}
+
+- (void)enumerateObjectKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *simperiumKey, BOOL *stop))block {
+    NSParameterAssert(block);
+    [[self loadedObjectKeysForBucketName:bucketName] enumerateObjectsUsingBlock:block];
+}
+
+- (NSSet *)loadedObjectKeysForBucketName:(NSString *)bucketName {
+    // Objects are keyed by their simperiumKey: no need to bring spilled objects back. Writes are barriers, and keep
+    // the key set up to date from then on
+    if (![_objectKeys containsKeysForBucketName:bucketName]) {
+        dispatch_sync(_storageQueue, ^{
+            if (![_objectKeys containsKeysForBucketName:bucketName]) {
+                [_objectKeys setKeys:[[_objects objectForKey:bucketName] allKeys] forBucketName:bucketName];
+            }
+        });
     }
-         
-    return keys;
+    
+    return [_objectKeys keysForBucketName:bucketName];
 }
 
 
@@ -126,29 +196,183 @@
 {
     __block NSInteger count = 0;
     dispatch_sync(_storageQueue, ^{
+        count = [[self filteredObjectsForBucketName:bucketName predicate:predicate] count];
+    });
+    
+    [self scheduleTrimIfNeeded];
+    
+    return count;
+}
+
+// Note: Expected to be called from within the Storage Queue
+- (NSArray *)filteredObjectsForBucketName:(NSString *)bucketName predicate:(NSPredicate *)predicate
+{
+    NSDictionary *objectDict = [_objects objectForKey:bucketName];
+    if (!objectDict) {
+        return nil;
+    }
+    
+    if (!predicate) {
+        return [self resolvedEntries:[objectDict allValues]];
+    }
+    
+    // Narrow down the candidates with the Secondary Indexes, whenever possible. The predicate has the final say
+    NSSet *candidateKeys = [self candidateKeysForPredicate:predicate indexes:_indexes[bucketName]];
+    if (!candidateKeys) {
+        return [[self resolvedEntries:[objectDict allValues]] filteredArrayUsingPredicate:predicate];
+    }
+    
+    NSMutableArray *candidates = [NSMutableArray arrayWithCapacity:candidateKeys.count];
+    for (NSString *key in candidateKeys) {
+        id<SPDiffable>object = [self resolvedEntry:objectDict[key]];
+        if (object) {
+            [candidates addObject:object];
+        }
+    }
+    
+    return [candidates filteredArrayUsingPredicate:predicate];
+}
+
+
+#pragma mark - Secondary Indexes
+
+- (void)addIndexForMemberNamed:(NSString *)memberName sorted:(BOOL)sorted bucketName:(NSString *)bucketName
+{
+    NSParameterAssert(memberName);
+    NSParameterAssert(bucketName);
+    
+    dispatch_barrier_sync(_storageQueue, ^{
+        NSMutableDictionary *bucketIndexes = _indexes[bucketName];
+        if (!bucketIndexes) {
+            bucketIndexes = [NSMutableDictionary dictionary];
+            _indexes[bucketName] = bucketIndexes;
+        }
+        
+        SPJSONStorageIndex *index = [[SPJSONStorageIndex alloc] initWithMemberName:memberName sorted:sorted];
+        bucketIndexes[memberName] = index;
+        
+        // Snapshot of the indexed members, for lock free lookups
+        NSMutableDictionary *indexedMemberNames = [self.indexedMemberNames mutableCopy] ?: [NSMutableDictionary dictionary];
+        indexedMemberNames[bucketName]          = [NSSet setWithArray:bucketIndexes.allKeys];
+        self.indexedMemberNames                 = indexedMemberNames;
+        
+        // Index everything: spilled objects are brought back one at a time, and evicted again right afterwards
         NSDictionary *objectDict = [_objects objectForKey:bucketName];
-        if (objectDict) {
-            count = [[[objectDict allValues] filteredArrayUsingPredicate:predicate] count];
+        for (NSString *key in objectDict) {
+            @autoreleasepool {
+                id<SPDiffable>object = [self resolvedEntry:objectDict[key]];
+                [index setValue:[object simperiumValueForKey:memberName] forObjectKey:key];
+            }
         }
+        
+        [self trimObjectsInMemory];
     });
-    return count;
 }
 
-- (NSDictionary *)faultObjectsForKeys:(NSArray *)keys bucketName:(NSString *)bucketName {
-    // Batch fault a bunch of objects for efficiency
-    // All objects are already in memory, for now at least...
-    NSArray *objectsAsList = [self objectsForKeys:[NSSet setWithArray:keys] bucketName:bucketName];
-    NSMutableDictionary *objectDict = [NSMutableDictionary dictionary];
-    for (id<SPDiffable>object in objectsAsList) {
-        [objectDict setObject:object forKey:object.simperiumKey];
+// Tiny Query Planner: Returns a superset of the keys matching the predicate, or nil if a full scan is required
+- (NSSet *)candidateKeysForPredicate:(NSPredicate *)predicate indexes:(NSDictionary *)indexes
+{
+    if (indexes.count == 0) {
+        return nil;
     }
-    return objectDict;
+    
+    if ([predicate isKindOfClass:[NSComparisonPredicate class]]) {
+        // Functions, aggregates and subqueries don't expose a keyPath: those require a full scan
+        NSComparisonPredicate *comparison   = (NSComparisonPredicate *)predicate;
+        NSExpression *left                  = comparison.leftExpression;
+        NSExpression *right                 = comparison.rightExpression;
+        NSString *keyPath                   = nil;
+        
+        if (left.expressionType == NSKeyPathExpressionType) {
+            keyPath = left.keyPath;
+        } else if (right.expressionType == NSKeyPathExpressionType) {
+            keyPath = right.keyPath;
+        }
+        
+        if (!keyPath) {
+            return nil;
+        }
+        
+        SPJSONStorageIndex *index           = indexes[keyPath];
+        
+        return [index objectKeysForPredicate:comparison];
+    }
+    
+    if (![predicate isKindOfClass:[NSCompoundPredicate class]]) {
+        return nil;
+    }
+    
+    NSCompoundPredicate *compound = (NSCompoundPredicate *)predicate;
+    NSMutableSet *candidateKeys = nil;
+    
+    switch (compound.compoundPredicateType) {
+        case NSAndPredicateType:
+            // Intersect whatever can be answered: the rest will be handled by the predicate itself
+            for (NSPredicate *subpredicate in compound.subpredicates) {
+                NSSet *keys = [self candidateKeysForPredicate:subpredicate indexes:indexes];
+                if (!keys) {
+                    continue;
+                }
+                
+                if (candidateKeys) {
+                    [candidateKeys intersectSet:keys];
+                } else {
+                    candidateKeys = [keys mutableCopy];
+                }
+            }
+            break;
+            
+        case NSOrPredicateType:
+            // Every single branch must be answered by an index
+            candidateKeys = [NSMutableSet set];
+            for (NSPredicate *subpredicate in compound.subpredicates) {
+                NSSet *keys = [self candidateKeysForPredicate:subpredicate indexes:indexes];
+                if (!keys) {
+                    return nil;
+                }
+                
+                [candidateKeys unionSet:keys];
+            }
+            break;
+            
+        default:
+            break;
+    }
+    
+    return candidateKeys;
+}
+
+- (NSDictionary *)faultObjectsForKeys:(NSArray *)keys bucketName:(NSString *)bucketName {
+    // Batch fault a bunch of objects for efficiency: spilled objects are brought back in a single pass
+    NSMutableDictionary *faultedObjects = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+    dispatch_sync(_storageQueue, ^{
+        NSDictionary *objectDict = [_objects objectForKey:bucketName];
+        for (NSString *key in keys) {
+            id<SPDiffable>object = [self resolvedEntry:objectDict[key]];
+            if (object) {
+                [faultedObjects setObject:object forKey:key];
+            }
+        }
+    });
+    
+    [self scheduleTrimIfNeeded];
+    
+    return faultedObjects;
 }
 
 - (void)refaultObjects:(NSArray *)objects {
-//    for (SPManagedObject *object in objects) {
-//        [context refreshObject:object mergeChanges:NO];
-//    }
+    if (!_cache) {
+        return;
+    }
+    
+    // Objects still in use elsewhere won't be spilled, so evict them a bit later, once the caller is done
+    for (id<SPDiffable>object in objects) {
+        if (object.simperiumKey) {
+            [_cache demoteKey:object.simperiumKey];
+        }
+    }
+    
+    [self scheduleTrimIfNeeded];
 }
 
 - (id<SPDiffable>)insertNewObjectForBucketName:(NSString *)bucketName simperiumKey:(NSString *)key
@@ -159,7 +383,7 @@
         key = [NSString sp_makeUUID];
     }
         
-    dispatch_sync(_storageQueue, ^{
+    dispatch_barrier_sync(_storageQueue, ^{
         NSMutableDictionary *objectDict = [_objects objectForKey:bucketName];
         if (!objectDict) {
             objectDict = [NSMutableDictionary dictionaryWithCapacity:3];
@@ -168,56 +392,195 @@
         object.simperiumKey = key;
         [objectDict setObject:object forKey:key];
         [_allObjects setObject:object forKey:key];
+        [_objectKeys addKey:key bucketName:bucketName];
+        [self indexObject:object forKey:key bucketName:bucketName];
+        
+        [_cache removeKey:key];
+        [_cache touchKey:key bucketName:bucketName];
+        [self trimObjectsInMemory];
     });
     
+    [self markKeyAsUpdated:key bucketName:bucketName];
+    
     return object;
 }
 
 - (void)insertObject:(id)dict bucketName:(NSString *)bucketName {
     // object should be a dictionary
     id<SPDiffable>object = [[SPObject alloc] initWithDictionary:dict];
+    NSString *key = [NSString sp_makeUUID];
 
-    dispatch_sync(_storageQueue, ^{
+    dispatch_barrier_sync(_storageQueue, ^{
         NSMutableDictionary *objectDict = [_objects objectForKey:bucketName];
         if (!objectDict) {
             objectDict = [NSMutableDictionary dictionaryWithCapacity:3];
             [_objects setObject:objectDict forKey:bucketName];
         }
-        NSString *key = [NSString sp_makeUUID];
         object.simperiumKey = key;   
         [objectDict setObject:object forKey:key];
-        [_allObjects setObject:_objects forKey:key];
+        [_allObjects setObject:object forKey:key];
+        [_objectKeys addKey:key bucketName:bucketName];
+        [self indexObject:object forKey:key bucketName:bucketName];
+        
+        [_cache touchKey:key bucketName:bucketName];
+        [self trimObjectsInMemory];
     });
+    
+    [self markKeyAsUpdated:key bucketName:bucketName];
+}
+
+- (void)upsertObjectsForBucket:(SPBucket *)bucket versions:(NSArray *)versions
+{
+    NSParameterAssert(bucket);
+    
+    NSString *bucketName            = bucket.name;
+    SPSchema *schema                = bucket.differ.schema;
+    NSMutableArray *keys            = [NSMutableArray arrayWithCapacity:versions.count];
+    
+    for (NSArray *versionData in versions) {
+        [keys addObject:versionData[0]];
+    }
+    
+    NSDictionary *existingObjects   = [self faultObjectsForKeys:keys bucketName:bucketName];
+    NSMutableDictionary *newObjects = [NSMutableDictionary dictionaryWithCapacity:versions.count];
+    NSMutableArray *upsertedObjects = [NSMutableArray arrayWithCapacity:versions.count];
+    
+    // New objects aren't reachable by anyone else just yet: build them outside of the barrier, straight from their
+    // member dictionaries. Existing objects go through the regular path, so that indexes and schema keep up
+    for (NSArray *versionData in versions) {
+        NSString *key           = versionData[0];
+        NSString *version       = versionData[1];
+        NSDictionary *data      = versionData[2];
+        id<SPDiffable>object    = existingObjects[key] ?: newObjects[key];
+        
+        if (object) {
+            [object loadMemberData:data];
+        } else {
+            object              = [[SPObject alloc] initWithDictionary:[data mutableCopy]];
+            object.simperiumKey = key;
+            newObjects[key]     = object;
+        }
+        
+        if (!existingObjects[key]) {
+            for (NSString *member in data) {
+                [schema ensureDynamicMemberExistsForObject:data[member] key:member];
+            }
+        }
+        
+        SPGhost *ghost          = [[SPGhost alloc] initWithKey:key memberData:[object dictionary]];
+        ghost.version           = version;
+        object.ghost            = ghost;
+        [super saveGhostForObject:object];
+        
+        [upsertedObjects addObject:object];
+    }
+    
+    // A single barrier for every new object
+    if (newObjects.count) {
+        dispatch_barrier_sync(_storageQueue, ^{
+            NSMutableDictionary *objectDict = [_objects objectForKey:bucketName];
+            if (!objectDict) {
+                objectDict = [NSMutableDictionary dictionaryWithCapacity:newObjects.count];
+                [_objects setObject:objectDict forKey:bucketName];
+            }
+            
+            [objectDict addEntriesFromDictionary:newObjects];
+            [_allObjects addEntriesFromDictionary:newObjects];
+            
+            for (NSString *key in newObjects) {
+                id<SPDiffable>object = newObjects[key];
+                object.bucket = bucket;
+                
+                [_objectKeys addKey:key bucketName:bucketName];
+                [self indexObject:object forKey:key bucketName:bucketName];
+                [_cache removeKey:key];
+                [_cache touchKey:key bucketName:bucketName];
+            }
+            
+            [self trimObjectsInMemory];
+        });
+    }
+    
+    for (id<SPDiffable>object in upsertedObjects) {
+        [self markKeyAsUpdated:object.simperiumKey bucketName:bucketName];
+    }
+}
+
+// Note: Expected to be called from within the Storage Queue
+- (void)indexObject:(id<SPDiffable>)object forKey:(NSString *)key bucketName:(NSString *)bucketName
+{
+    NSDictionary *bucketIndexes = _indexes[bucketName];
+    for (SPJSONStorageIndex *index in bucketIndexes.allValues) {
+        [index setValue:[object simperiumValueForKey:index.memberName] forObjectKey:key];
+    }
 }
 
 - (void)setMetadata:(NSDictionary *)metadata {
-    // TODO: support metadata for JSON store
-    // [[NSUserDefaults standardUserDefaults] setObject:json forKey: key];
-    // [[NSUserDefaults standardUserDefaults] synchronize];
+    // Metadata is kept in memory, and journaled right away (if needed)
+    self.storedMetadata = metadata;
+    [_journal saveMetadata:metadata];
 }
 
 - (NSDictionary *)metadata {
-    return nil;
+    return self.storedMetadata;
 }
 
 - (void)deleteObject:(id)dict
 {
-    // TODO: this is where an associative reference to simperiumKey on the dict will be needed
-//    SPManagedObject *managedObject = (SPManagedObject *)object;
-//    [managedObject.managedObjectContext deleteObject:managedObject];
+    // Diffables know their own bucket, and can be nuked right away (along with their indexed values)
+    if ([dict conformsToProtocol:@protocol(SPDiffable)]) {
+        id<SPDiffable>object    = dict;
+        NSString *key           = object.simperiumKey;
+        NSString *bucketName    = object.bucket.name;
+        
+        if (key && bucketName) {
+            dispatch_barrier_sync(_storageQueue, ^{
+                [[_objects objectForKey:bucketName] removeObjectForKey:key];
+                [_allObjects removeObjectForKey:key];
+                [_objectKeys removeKey:key bucketName:bucketName];
+                [_cache removeKey:key];
+                
+                for (SPJSONStorageIndex *index in [_indexes[bucketName] allValues]) {
+                    [index removeObjectKey:key];
+                }
+            });
+            
+            [self markKeyAsDeleted:key bucketName:bucketName];
+        }
+        return;
+    }
+    
+    // Anything else doesn't know its own key, and was never stored in the first place
+    SPLogWarn(@"Simperium can't delete an object that doesn't conform to SPDiffable: %@", dict);
 }
 
 - (void)deleteAllObjectsForBucketName:(NSString *)bucketName {
-    dispatch_sync(self.storageQueue, ^{
+    dispatch_barrier_sync(self.storageQueue, ^{
         // Nuke Bucket Entities from the `allObjects` collection
         NSDictionary<NSString *, SPObject *> *bucket = [self.objects objectForKey:bucketName];
         for (NSString *key in bucket.allKeys) {
             [self.allObjects removeObjectForKey:key];
+            [self.cache removeKey:key];
         }
 
         // And now nuke the entire bucket
         [self.objects removeObjectForKey:bucketName];
+        [self.objectKeys removeAllKeysForBucketName:bucketName];
+
+        // Indexes remain registered, but empty
+        for (SPJSONStorageIndex *index in [self.indexes[bucketName] allValues]) {
+            [index removeAllObjectKeys];
+        }
     });
+    
+    // Pending changes are meaningless from now on
+    dispatch_sync(self.pendingChangesQueue, ^{
+        for (NSMutableDictionary *pendingKeys in @[self.updatedKeys, self.deletedKeys]) {
+            [pendingKeys removeObjectsForKeys:[pendingKeys allKeysForObject:bucketName]];
+        }
+    });
+    
+    [self.journal removeAllRecordsForBucketName:bucketName];
 }
 
 - (void)validateObjectsForBucketName:(NSString *)bucketName
@@ -279,33 +642,27 @@
 }
 
 - (BOOL)save {
-    // This needs to write all objects to disk in a thread-safe way, perhaps asynchronously since it can be
-    // triggered from the main thread and could take awhile
-    
-    // Sync all changes: Fake it for now by trying to send all objects
-
-    // TODO: JSONStorage is readonly at this stage.
-    // Local changes should be captured via `didChangeValue:forKey:`
-    /*
-    NSMutableSet *updatedObjects = [NSMutableSet set];
-    
-    for (NSDictionary *objectDict in _objects.allValues) {
-        NSArray *objectsAsList = [objectDict allValues];
-        [updatedObjects addObjectsFromArray:objectsAsList];
-    }
-    */
+    // Objects touched since the last save get encoded right here, and are written to disk asynchronously
+    BOOL success = [self journalPendingChanges];
 
+    // Note: Local changes are tracked as they happen (via `didChangeValues:`), and were just journaled. Observers
+    // don't get the individual objects, though
     [_delegate storageWillSave:self deletedObjects:nil];
     [_delegate storageDidSave:self insertedObjects:nil updatedObjects:nil];
     
-    return NO;
+    return success;
 }
 
 - (void)commitPendingOperations:(void (^)())completion {
     NSAssert(completion, @"Please, provide a completion handler");
     
-    // NO-OP
-    completion();
+    if (!_journal) {
+        completion();
+        return;
+    }
+    
+    // Wait until every journaled change has hit the disk
+    [_journal synchronizeWithCompletion:completion];
 }
 
 - (void)performSafeBlockAndWait:(void (^)())block {
@@ -323,7 +680,7 @@
 }
 
 - (BOOL)isEphemeral {
-    return YES;
+    return _journal == nil;
 }
 
 - (void)stashUnsavedObjects {
@@ -335,7 +692,319 @@
 }
 
 - (void)unloadAllObjects {
-    // NO-OP
+    if (!_cache) {
+        return;
+    }
+    
+    // Spill everything that's not in use (including anything recently brought back)
+    dispatch_barrier_sync(_storageQueue, ^{
+        [self trimObjectsInMemory];
+        
+        for (NSString *key in _allObjects) {
+            if (![_allObjects[key] isKindOfClass:[SPJSONStorageSpill class]]) {
+                [_cache demoteKey:key];
+            }
+        }
+        
+        [self trimObjectsInMemory];
+    });
+}
+
+
+#pragma mark - Persistence
+
+- (BOOL)loadPersistentStoreAtURL:(NSURL *)URL {
+    NSParameterAssert(URL);
+    
+    if (_journal) {
+        return NO;
+    }
+    
+    SPJSONStorageJournal *journal = [[SPJSONStorageJournal alloc] initWithURL:URL];
+    
+    // Records are memory mapped, and decoded one at a time: the Memory Budget is enforced as we go
+    dispatch_barrier_sync(_storageQueue, ^{
+        __block NSUInteger count = 0;
+        [journal enumerateRecordsUsingBlock:^(NSString *bucketName, NSString *simperiumKey, NSData *record) {
+            id<SPDiffable>object = [SPJSONStorageCache objectWithRecord:record key:simperiumKey bucket:nil];
+            if (!object) {
+                return;
+            }
+            
+            NSMutableDictionary *objectDict = [_objects objectForKey:bucketName];
+            if (!objectDict) {
+                objectDict = [NSMutableDictionary dictionary];
+                [_objects setObject:objectDict forKey:bucketName];
+            }
+            
+            [objectDict setObject:object forKey:simperiumKey];
+            [_allObjects setObject:object forKey:simperiumKey];
+            [_objectKeys addKey:simperiumKey bucketName:bucketName];
+            [self indexObject:object forKey:simperiumKey bucketName:bucketName];
+            [_cache touchKey:simperiumKey bucketName:bucketName];
+            
+            if (++count % SPJSONStorageLoadTrimInterval == 0) {
+                [self trimObjectsInMemory];
+            }
+        }];
+        
+        [self trimObjectsInMemory];
+        
+        _journal = journal;
+    });
+    
+    self.storedMetadata = [journal loadMetadata];
+    
+    return YES;
+}
+
+- (void)adoptObjectsForBucket:(SPBucket *)bucket {
+    NSParameterAssert(bucket);
+    
+    dispatch_barrier_sync(_storageQueue, ^{
+        // Objects brought back while orphan should be adopted as well
+        [self trimObjectsInMemory];
+        
+        for (id entry in [[_objects objectForKey:bucket.name] allValues]) {
+            if ([entry isKindOfClass:[SPJSONStorageSpill class]]) {
+                [(SPJSONStorageSpill *)entry setBucket:bucket];
+            } else if ([entry conformsToProtocol:@protocol(SPDiffable)] && [entry bucket] == nil) {
+                [(id<SPDiffable>)entry setBucket:bucket];
+            }
+        }
+    });
+}
+
+- (void)saveGhostForObject:(id<SPDiffable>)object {
+    [super saveGhostForObject:object];
+    [self markKeyAsUpdated:object.simperiumKey bucketName:object.bucket.name];
+}
+
+- (void)markKeyAsUpdated:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    if (!_journal || !simperiumKey || !bucketName) {
+        return;
+    }
+    
+    dispatch_async(_pendingChangesQueue, ^{
+        [_deletedKeys removeObjectForKey:simperiumKey];
+        [_updatedKeys setObject:bucketName forKey:simperiumKey];
+    });
+}
+
+- (void)markKeyAsDeleted:(NSString *)simperiumKey bucketName:(NSString *)bucketName {
+    if (!_journal || !simperiumKey || !bucketName) {
+        return;
+    }
+    
+    dispatch_async(_pendingChangesQueue, ^{
+        [_updatedKeys removeObjectForKey:simperiumKey];
+        [_deletedKeys setObject:bucketName forKey:simperiumKey];
+    });
+}
+
+// Appends every pending change to the journal. Returns NO if any of them couldn't be journaled
+- (BOOL)journalPendingChanges {
+    if (!_journal) {
+        return YES;
+    }
+    
+    __block NSDictionary *updatedKeys = nil;
+    __block NSDictionary *deletedKeys = nil;
+    dispatch_sync(_pendingChangesQueue, ^{
+        updatedKeys = [_updatedKeys copy];
+        deletedKeys = [_deletedKeys copy];
+        [_updatedKeys removeAllObjects];
+        [_deletedKeys removeAllObjects];
+    });
+    
+    if (updatedKeys.count == 0 && deletedKeys.count == 0) {
+        return YES;
+    }
+    
+    NSMutableDictionary *recordsByBucket = [NSMutableDictionary dictionary];
+    NSMutableDictionary *(^recordsForBucketName)(NSString *) = ^(NSString *bucketName) {
+        NSMutableDictionary *records = recordsByBucket[bucketName];
+        if (!records) {
+            records = [NSMutableDictionary dictionary];
+            recordsByBucket[bucketName] = records;
+        }
+        return records;
+    };
+    
+    BOOL success = YES;
+    
+    for (NSString *key in updatedKeys) {
+        @autoreleasepool {
+            NSString *bucketName    = updatedKeys[key];
+            id<SPDiffable>object    = [self objectForKey:key bucketName:bucketName];
+            if (!object) {
+                continue;
+            }
+            
+            // Objects holding anything that can't be encoded as JSON won't survive a restart: fail the save
+            NSData *record          = [SPJSONStorageCache recordWithObject:object];
+            if (!record) {
+                SPLogError(@"Simperium couldn't journal object %@ (%@): its members aren't valid JSON", key, bucketName);
+                success = NO;
+                continue;
+            }
+            
+            recordsForBucketName(bucketName)[key] = record;
+        }
+    }
+    
+    for (NSString *key in deletedKeys) {
+        recordsForBucketName(deletedKeys[key])[key] = [NSNull null];
+    }
+    
+    for (NSString *bucketName in recordsByBucket) {
+        [_journal appendRecords:recordsByBucket[bucketName] bucketName:bucketName];
+    }
+    
+    return success;
+}
+
+
+#pragma mark - Memory Budget
+
+- (NSUInteger)maximumObjectsInMemory {
+    return _cache.maximumObjects;
+}
+
+- (void)setMaximumObjectsInMemory:(NSUInteger)maximumObjectsInMemory {
+    dispatch_barrier_sync(_storageQueue, ^{
+        // Bring every spilled object back, before dropping the current cache
+        for (NSString *bucketName in _objects) {
+            NSMutableDictionary *objectDict = _objects[bucketName];
+            for (NSString *key in objectDict.allKeys) {
+                id<SPDiffable>object = [self resolvedEntry:objectDict[key]];
+                if (object) {
+                    objectDict[key]     = object;
+                    _allObjects[key]    = object;
+                }
+            }
+        }
+        
+        _cache = (maximumObjectsInMemory > 0) ? [[SPJSONStorageCache alloc] initWithMaximumObjects:maximumObjectsInMemory] : nil;
+        
+        for (NSString *bucketName in _objects) {
+            for (NSString *key in _objects[bucketName]) {
+                [_cache touchKey:key bucketName:bucketName];
+            }
+        }
+        
+        [self trimObjectsInMemory];
+    });
+}
+
+// Note: Expected to be called from within the Storage Queue. Returns the actual object for a given entry
+- (id)resolvedEntry:(id)entry {
+    if (!_cache || entry == nil) {
+        return entry;
+    }
+    
+    if ([entry isKindOfClass:[SPJSONStorageSpill class]]) {
+        return [_cache rehydrateObjectForSpill:entry];
+    }
+    
+    // Readers run concurrently: their touches get applied by the next barrier, rather than hitting the cache's queue
+    if ([entry conformsToProtocol:@protocol(SPDiffable)]) {
+        id<SPDiffable>object = entry;
+        [_cache recordTouchForKey:object.simperiumKey];
+    }
+    
+    return entry;
+}
+
+- (NSArray *)resolvedEntries:(NSArray *)entries {
+    if (!_cache) {
+        return entries;
+    }
+    
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:entries.count];
+    for (id entry in entries) {
+        id object = [self resolvedEntry:entry];
+        if (object) {
+            [objects addObject:object];
+        }
+    }
+    
+    return objects;
+}
+
+- (void)scheduleTrimIfNeeded {
+    if (!_cache || !([_cache needsEviction] || [_cache hasPendingTouchesBacklog])) {
+        return;
+    }
+    
+    // A single pending trim is enough
+    if (atomic_exchange(&_trimScheduled, true)) {
+        return;
+    }
+    
+    dispatch_barrier_async(_storageQueue, ^{
+        atomic_store(&_trimScheduled, false);
+        [self trimObjectsInMemory];
+    });
+}
+
+// Note: Expected to be called from within the Storage Queue, as a barrier
+- (void)trimObjectsInMemory {
+    if (!_cache) {
+        return;
+    }
+    
+    // Objects brought back by readers take the place of their Spills
+    @autoreleasepool {
+        NSDictionary *rehydratedObjects = [_cache drainRehydratedObjects];
+        for (NSString *key in rehydratedObjects) {
+            SPJSONStorageSpill *spill = _allObjects[key];
+            if (![spill isKindOfClass:[SPJSONStorageSpill class]]) {
+                continue;
+            }
+            
+            id<SPDiffable>object = rehydratedObjects[key];
+            [_objects[spill.bucketName] setObject:object forKey:key];
+            [_allObjects setObject:object forKey:key];
+        }
+    }
+    
+    NSDictionary *keysToEvict = [_cache bucketNamesForKeysToEvict];
+    for (NSString *key in keysToEvict) {
+        [self evictObjectForKey:key bucketName:keysToEvict[key]];
+    }
+}
+
+- (void)evictObjectForKey:(NSString *)key bucketName:(NSString *)bucketName {
+    NSMutableDictionary *objectDict     = _objects[bucketName];
+    __weak id<SPDiffable>weakObject     = nil;
+    
+    @autoreleasepool {
+        id<SPDiffable>object = objectDict[key];
+        if (![object isKindOfClass:[SPObject class]]) {
+            return;
+        }
+        
+        if (![_cache spillObject:object forKey:key]) {
+            [_cache touchKey:key bucketName:bucketName];
+            return;
+        }
+        
+        SPJSONStorageSpill *spill = [[SPJSONStorageSpill alloc] initWithKey:key bucketName:bucketName bucket:object.bucket];
+        objectDict[key]     = spill;
+        _allObjects[key]    = spill;
+        weakObject          = object;
+    }
+    
+    // Objects still referenced elsewhere may keep on changing: they stay in memory, and their record is dropped
+    id<SPDiffable>liveObject = weakObject;
+    if (liveObject) {
+        objectDict[key]     = liveObject;
+        _allObjects[key]    = liveObject;
+        
+        [_cache removeKey:key];
+        [_cache touchKey:key bucketName:bucketName];
+    }
 }
 
 @end
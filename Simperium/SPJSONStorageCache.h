@@ -0,0 +1,100 @@
+//
+//  SPJSONStorageCache.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPDiffable.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageSpill
+#pragma mark ====================================================================================
+
+/// Stands in for an object that was evicted from memory, and now lives in the cache's segment file
+///
+@interface SPJSONStorageSpill : NSObject
+
+@property (nonatomic, copy, readonly) NSString  *simperiumKey;
+@property (nonatomic, copy, readonly) NSString  *bucketName;
+@property (nonatomic, weak)           SPBucket  *bucket;
+
+- (instancetype)initWithKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName bucket:(SPBucket *)bucket;
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageCache
+#pragma mark ====================================================================================
+
+/// Keeps track of the objects held in memory by SPJSONStorage, in Least Recently Used order, and of the ones that
+/// were spilled over to disk. Spilled objects are stored in a scratch segment file, which gets compacted as records
+/// become stale, and is nuked when the cache goes away.
+///
+/// Note: This class is thread safe. SPJSONStorage itself is in charge of swapping objects with their Spills.
+///
+@interface SPJSONStorageCache : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger  maximumObjects;
+@property (nonatomic, assign, readonly) NSUInteger  numberOfObjectsInMemory;
+@property (nonatomic, assign, readonly) NSUInteger  numberOfSpilledObjects;
+
+- (instancetype)initWithMaximumObjects:(NSUInteger)maximumObjects;
+
+/// Marks the specified object as the Most Recently Used one
+///
+- (void)touchKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName;
+
+/// Lock free version of `touchKey:bucketName:`, meant for concurrent readers. Recorded touches only apply to objects
+/// already in memory, and take effect right before the next write performed on the cache
+///
+- (void)recordTouchForKey:(NSString *)simperiumKey;
+
+/// Indicates whether enough touches were recorded, that they should be applied without waiting for a write
+///
+- (BOOL)hasPendingTouchesBacklog;
+
+/// Flags the specified object for eviction, regardless of the memory budget
+///
+- (void)demoteKey:(NSString *)simperiumKey;
+
+/// Forgets about the specified object, whether it's in memory or spilled
+///
+- (void)removeKey:(NSString *)simperiumKey;
+
+/// Forgets about everything
+///
+- (void)removeAllKeys;
+
+/// Returns the Bucket Name of every object that should be evicted, keyed by Simperium Key
+///
+- (NSDictionary *)bucketNamesForKeysToEvict;
+
+/// Indicates whether there are objects that should be evicted. Lock free
+///
+- (BOOL)needsEviction;
+
+/// Writes the specified object to the segment file. Returns NO if the object can't be serialized
+///
+- (BOOL)spillObject:(id<SPDiffable>)object forKey:(NSString *)simperiumKey;
+
+/// Returns the object represented by the specified Spill, decoding it from disk only once. Rehydrated objects are
+/// tracked as Most Recently Used, and held until `drainRehydratedObjects` is called
+///
+- (id<SPDiffable>)rehydrateObjectForSpill:(SPJSONStorageSpill *)spill;
+
+/// Returns (and forgets about) the objects rehydrated since the last call, keyed by Simperium Key
+///
+- (NSDictionary *)drainRehydratedObjects;
+
+/// Record Helpers: members, ghost and ghostData, encoded as JSON. Returns nil for objects that can't be encoded
+///
++ (NSData *)recordWithObject:(id<SPDiffable>)object;
++ (id<SPDiffable>)objectWithRecord:(NSData *)record key:(NSString *)simperiumKey bucket:(SPBucket *)bucket;
+
+@end
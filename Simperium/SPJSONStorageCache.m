@@ -0,0 +1,554 @@
+//
+//  SPJSONStorageCache.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPJSONStorageCache.h"
+#import "SPObject.h"
+#import "SPGhost.h"
+#import "SPLogger.h"
+#import "NSString+Simperium.h"
+#import <stdatomic.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPJSONStorageCacheMembersKey        = @"members";
+static NSString * const SPJSONStorageCacheGhostKey          = @"ghost";
+static NSString * const SPJSONStorageCacheGhostDataKey      = @"ghostData";
+
+// The segment gets rewritten once stale records outweigh live ones, and are big enough to be worth the effort
+static unsigned long long const SPJSONStorageCacheCompactionThreshold = 1024 * 1024;
+
+// Touches recorded by readers are applied by the next write, or as soon as this many are pending
+static NSUInteger const SPJSONStorageCacheMaximumPendingTouches       = 1024;
+
+static SPLogLevels logLevel                                 = SPLogLevelsInfo;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageSpill
+#pragma mark ====================================================================================
+
+@implementation SPJSONStorageSpill
+
+- (instancetype)initWithKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName bucket:(SPBucket *)bucket
+{
+    self = [super init];
+    if (self) {
+        _simperiumKey   = [simperiumKey copy];
+        _bucketName     = [bucketName copy];
+        _bucket         = bucket;
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageCacheNode
+#pragma mark ====================================================================================
+
+// Doubly Linked List Node: touching an object is O(1)
+@interface SPJSONStorageCacheNode : NSObject
+@property (nonatomic, copy)              NSString               *key;
+@property (nonatomic, copy)              NSString               *bucketName;
+@property (nonatomic, strong)            SPJSONStorageCacheNode *next;
+@property (nonatomic, unsafe_unretained) SPJSONStorageCacheNode *previous;
+@end
+
+@implementation SPJSONStorageCacheNode
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageCacheTouch
+#pragma mark ====================================================================================
+
+// Lock free Stack Node: readers push their touches without ever hitting the cache's queue
+typedef struct SPJSONStorageCacheTouch {
+    struct SPJSONStorageCacheTouch  *next;
+    CFTypeRef                       key;
+} SPJSONStorageCacheTouch;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPJSONStorageCache ()
+@property (nonatomic, strong) dispatch_queue_t              queue;
+@property (nonatomic, strong) NSMutableDictionary           *nodes;
+@property (nonatomic, strong) SPJSONStorageCacheNode        *head;
+@property (nonatomic, unsafe_unretained) SPJSONStorageCacheNode *tail;
+@property (nonatomic, strong) NSMutableDictionary           *demotedKeys;
+@property (nonatomic, strong) NSMutableDictionary           *rehydratedObjects;
+@property (nonatomic, strong) NSString                      *segmentPath;
+@property (nonatomic, strong) NSFileHandle                  *segment;
+@property (nonatomic, strong) NSMutableDictionary           *records;
+@property (nonatomic, assign) unsigned long long            liveBytes;
+@property (nonatomic, assign) unsigned long long            staleBytes;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageCache
+#pragma mark ====================================================================================
+
+@implementation SPJSONStorageCache {
+    _Atomic(SPJSONStorageCacheTouch *)  _pendingTouches;
+    atomic_ulong                        _numberOfPendingTouches;
+    atomic_bool                         _needsEviction;
+}
+
+- (void)dealloc
+{
+    SPJSONStorageCacheTouch *touch = atomic_exchange(&_pendingTouches, NULL);
+    while (touch) {
+        SPJSONStorageCacheTouch *next = touch->next;
+        CFRelease(touch->key);
+        free(touch);
+        touch = next;
+    }
+    
+    [_segment closeFile];
+    [[NSFileManager defaultManager] removeItemAtPath:_segmentPath error:nil];
+}
+
+- (instancetype)initWithMaximumObjects:(NSUInteger)maximumObjects
+{
+    self = [super init];
+    if (self) {
+        _maximumObjects     = maximumObjects;
+        _queue              = dispatch_queue_create("com.simperium.SPJSONStorageCache", NULL);
+        _nodes              = [NSMutableDictionary dictionary];
+        _demotedKeys        = [NSMutableDictionary dictionary];
+        _rehydratedObjects  = [NSMutableDictionary dictionary];
+        _records            = [NSMutableDictionary dictionary];
+    
+        NSString *filename  = [NSString stringWithFormat:@"com.simperium.JSONStorage-%@.segment", [NSString sp_makeUUID]];
+        _segmentPath        = [NSTemporaryDirectory() stringByAppendingPathComponent:filename];
+        _segment            = [self createSegmentAtPath:_segmentPath];
+    }
+    return self;
+}
+
+- (NSFileHandle *)createSegmentAtPath:(NSString *)path
+{
+    [[NSFileManager defaultManager] createFileAtPath:path contents:nil attributes:nil];
+    return [NSFileHandle fileHandleForUpdatingAtPath:path];
+}
+
+- (NSUInteger)numberOfObjectsInMemory
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        count = self.nodes.count;
+    });
+    return count;
+}
+
+- (NSUInteger)numberOfSpilledObjects
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        count = self.records.count;
+    });
+    return count;
+}
+
+
+#pragma mark - LRU
+
+- (void)touchKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName
+{
+    NSParameterAssert(simperiumKey);
+    
+    dispatch_sync(self.queue, ^{
+        [self unsafeApplyPendingTouches];
+        [self unsafeTouchKey:simperiumKey bucketName:bucketName];
+        [self unsafeUpdateEvictionState];
+    });
+}
+
+- (void)recordTouchForKey:(NSString *)simperiumKey
+{
+    NSParameterAssert(simperiumKey);
+    
+    SPJSONStorageCacheTouch *touch  = malloc(sizeof(SPJSONStorageCacheTouch));
+    touch->key                      = CFBridgingRetain([simperiumKey copy]);
+    touch->next                     = atomic_load_explicit(&_pendingTouches, memory_order_relaxed);
+    
+    // Note: Counted before being pushed, so that draining never takes the counter below zero
+    atomic_fetch_add_explicit(&_numberOfPendingTouches, 1, memory_order_relaxed);
+    
+    while (!atomic_compare_exchange_weak_explicit(&_pendingTouches, &touch->next, touch, memory_order_release, memory_order_relaxed)) {
+        // Another reader got there first: `touch->next` now points to its node, just retry
+    }
+}
+
+- (BOOL)hasPendingTouchesBacklog
+{
+    return atomic_load_explicit(&_numberOfPendingTouches, memory_order_relaxed) >= SPJSONStorageCacheMaximumPendingTouches;
+}
+
+- (void)demoteKey:(NSString *)simperiumKey
+{
+    NSParameterAssert(simperiumKey);
+    
+    dispatch_sync(self.queue, ^{
+        [self unsafeApplyPendingTouches];
+        
+        SPJSONStorageCacheNode *node = self.nodes[simperiumKey];
+        if (node.bucketName) {
+            self.demotedKeys[simperiumKey] = node.bucketName;
+        }
+        
+        [self unsafeUpdateEvictionState];
+    });
+}
+
+- (void)removeKey:(NSString *)simperiumKey
+{
+    NSParameterAssert(simperiumKey);
+    
+    dispatch_sync(self.queue, ^{
+        [self unsafeApplyPendingTouches];
+        [self unsafeUnlinkKey:simperiumKey];
+        [self.rehydratedObjects removeObjectForKey:simperiumKey];
+        [self unsafeRemoveRecordForKey:simperiumKey];
+        [self unsafeUpdateEvictionState];
+    });
+}
+
+- (void)removeAllKeys
+{
+    dispatch_sync(self.queue, ^{
+        [self unsafeApplyPendingTouches];
+        [self.nodes removeAllObjects];
+        [self.demotedKeys removeAllObjects];
+        [self.rehydratedObjects removeAllObjects];
+        [self.records removeAllObjects];
+    
+        // Break the chain manually: a long list would otherwise be released recursively
+        while (self.head) {
+            self.head = self.head.next;
+        }
+        self.tail = nil;
+    
+        [self.segment truncateFileAtOffset:0];
+        self.liveBytes  = 0;
+        self.staleBytes = 0;
+        
+        [self unsafeUpdateEvictionState];
+    });
+}
+
+- (NSDictionary *)bucketNamesForKeysToEvict
+{
+    __block NSMutableDictionary *keysToEvict = nil;
+    dispatch_sync(self.queue, ^{
+        // Readers' touches must be in place before picking the Least Recently Used objects
+        [self unsafeApplyPendingTouches];
+        
+        keysToEvict = [self.demotedKeys mutableCopy];
+        [self.demotedKeys removeAllObjects];
+    
+        // Walk back from the Least Recently Used object, until we're within budget
+        NSInteger excess = (NSInteger)self.nodes.count - (NSInteger)keysToEvict.count - (NSInteger)self.maximumObjects;
+        for (SPJSONStorageCacheNode *node = self.tail; node && excess > 0; node = node.previous) {
+            if (keysToEvict[node.key]) {
+                continue;
+            }
+    
+            keysToEvict[node.key] = node.bucketName;
+            --excess;
+        }
+        
+        [self unsafeUpdateEvictionState];
+    });
+    
+    return keysToEvict;
+}
+
+- (BOOL)needsEviction
+{
+    return atomic_load(&_needsEviction);
+}
+
+- (void)unsafeUpdateEvictionState
+{
+    atomic_store(&_needsEviction, self.demotedKeys.count > 0 || self.nodes.count > self.maximumObjects);
+}
+
+- (void)unsafeApplyPendingTouches
+{
+    SPJSONStorageCacheTouch *touch = atomic_exchange_explicit(&_pendingTouches, NULL, memory_order_acquire);
+    if (touch == NULL) {
+        return;
+    }
+    
+    // The stack holds the most recent touch first: reverse it, so that the LRU order is preserved
+    SPJSONStorageCacheTouch *ordered    = NULL;
+    unsigned long count                 = 0;
+    while (touch) {
+        SPJSONStorageCacheTouch *next   = touch->next;
+        touch->next                     = ordered;
+        ordered                         = touch;
+        touch                           = next;
+        ++count;
+    }
+    
+    // Note: Readers only touch objects in memory. Keys evicted or removed meanwhile don't get a node back
+    while (ordered) {
+        SPJSONStorageCacheTouch *next   = ordered->next;
+        NSString *key                   = CFBridgingRelease(ordered->key);
+        [self unsafeTouchKey:key bucketName:nil];
+        free(ordered);
+        ordered                         = next;
+    }
+    
+    atomic_fetch_sub_explicit(&_numberOfPendingTouches, count, memory_order_relaxed);
+}
+
+- (void)unsafeTouchKey:(NSString *)simperiumKey bucketName:(NSString *)bucketName
+{
+    SPJSONStorageCacheNode *node = self.nodes[simperiumKey];
+    if (node == nil && bucketName == nil) {
+        return;
+    }
+    
+    if (node == nil) {
+        node                    = [SPJSONStorageCacheNode new];
+        node.key                = simperiumKey;
+        node.bucketName         = bucketName;
+        self.nodes[simperiumKey] = node;
+    } else if (node == self.head) {
+        [self.demotedKeys removeObjectForKey:simperiumKey];
+        return;
+    } else {
+        [self unsafeDetachNode:node];
+        [self.demotedKeys removeObjectForKey:simperiumKey];
+    }
+    
+    node.next       = self.head;
+    node.previous   = nil;
+    self.head.previous = node;
+    self.head       = node;
+    
+    if (self.tail == nil) {
+        self.tail   = node;
+    }
+}
+
+- (void)unsafeUnlinkKey:(NSString *)simperiumKey
+{
+    SPJSONStorageCacheNode *node = self.nodes[simperiumKey];
+    if (node == nil) {
+        return;
+    }
+    
+    [self unsafeDetachNode:node];
+    [self.nodes removeObjectForKey:simperiumKey];
+    [self.demotedKeys removeObjectForKey:simperiumKey];
+}
+
+- (void)unsafeDetachNode:(SPJSONStorageCacheNode *)node
+{
+    // Note: The node must survive until we're done with it, since `head` / `next` may be its only owners
+    SPJSONStorageCacheNode *retainedNode = node;
+    
+    if (retainedNode.previous) {
+        retainedNode.previous.next = retainedNode.next;
+    } else {
+        self.head = retainedNode.next;
+    }
+    
+    if (retainedNode.next) {
+        retainedNode.next.previous = retainedNode.previous;
+    } else {
+        self.tail = retainedNode.previous;
+    }
+    
+    retainedNode.next       = nil;
+    retainedNode.previous   = nil;
+}
+
+
+#pragma mark - Segment
+
+- (BOOL)spillObject:(id<SPDiffable>)object forKey:(NSString *)simperiumKey
+{
+    NSData *record = [[self class] recordWithObject:object];
+    if (record == nil) {
+        return NO;
+    }
+    
+    dispatch_sync(self.queue, ^{
+        [self unsafeRemoveRecordForKey:simperiumKey];
+    
+        unsigned long long offset = [self.segment seekToEndOfFile];
+        [self.segment writeData:record];
+    
+        self.records[simperiumKey]  = [NSValue valueWithRange:NSMakeRange((NSUInteger)offset, record.length)];
+        self.liveBytes              += record.length;
+    
+        [self unsafeApplyPendingTouches];
+        [self unsafeUnlinkKey:simperiumKey];
+        [self.rehydratedObjects removeObjectForKey:simperiumKey];
+        [self unsafeUpdateEvictionState];
+    });
+    
+    return YES;
+}
+
+- (id<SPDiffable>)rehydrateObjectForSpill:(SPJSONStorageSpill *)spill
+{
+    NSParameterAssert(spill);
+    
+    __block id<SPDiffable> object = nil;
+    dispatch_sync(self.queue, ^{
+        NSString *key   = spill.simperiumKey;
+        object          = self.rehydratedObjects[key];
+    
+        if (object == nil) {
+            NSValue *range = self.records[key];
+            if (range == nil) {
+                SPLogError(@"Simperium couldn't find spilled object %@ in bucket %@", key, spill.bucketName);
+                return;
+            }
+    
+            [self.segment seekToFileOffset:range.rangeValue.location];
+            NSData *record = [self.segment readDataOfLength:range.rangeValue.length];
+    
+            object = [[self class] objectWithRecord:record key:key bucket:spill.bucket];
+            if (object == nil) {
+                SPLogError(@"Simperium couldn't decode spilled object %@ in bucket %@", key, spill.bucketName);
+                return;
+            }
+    
+            // The record goes stale as soon as the object is back in memory
+            self.rehydratedObjects[key] = object;
+            [self unsafeRemoveRecordForKey:key];
+        }
+    
+        [self unsafeApplyPendingTouches];
+        [self unsafeTouchKey:key bucketName:spill.bucketName];
+        [self unsafeUpdateEvictionState];
+    });
+    
+    return object;
+}
+
+- (NSDictionary *)drainRehydratedObjects
+{
+    __block NSDictionary *rehydratedObjects = nil;
+    dispatch_sync(self.queue, ^{
+        rehydratedObjects = [self.rehydratedObjects copy];
+        [self.rehydratedObjects removeAllObjects];
+    });
+    return rehydratedObjects;
+}
+
+- (void)unsafeRemoveRecordForKey:(NSString *)simperiumKey
+{
+    NSValue *range = self.records[simperiumKey];
+    if (range == nil) {
+        return;
+    }
+    
+    [self.records removeObjectForKey:simperiumKey];
+    self.liveBytes  -= range.rangeValue.length;
+    self.staleBytes += range.rangeValue.length;
+    
+    if (self.staleBytes > self.liveBytes && self.staleBytes > SPJSONStorageCacheCompactionThreshold) {
+        [self unsafeCompactSegment];
+    }
+}
+
+- (void)unsafeCompactSegment
+{
+    NSString *compactedPath         = [self.segmentPath stringByAppendingPathExtension:@"compacting"];
+    NSFileHandle *compacted         = [self createSegmentAtPath:compactedPath];
+    NSMutableDictionary *records    = [NSMutableDictionary dictionaryWithCapacity:self.records.count];
+    
+    for (NSString *key in self.records) {
+        NSRange range = [self.records[key] rangeValue];
+        [self.segment seekToFileOffset:range.location];
+        NSData *record = [self.segment readDataOfLength:range.length];
+    
+        unsigned long long offset = [compacted offsetInFile];
+        [compacted writeData:record];
+        records[key] = [NSValue valueWithRange:NSMakeRange((NSUInteger)offset, range.length)];
+    }
+    
+    [self.segment closeFile];
+    
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtPath:self.segmentPath error:nil];
+    
+    NSError *error = nil;
+    if (![fileManager moveItemAtPath:compactedPath toPath:self.segmentPath error:&error]) {
+        SPLogError(@"Simperium couldn't compact the JSON Storage segment: %@", error);
+    }
+    
+    self.segment    = compacted;
+    self.records    = records;
+    self.staleBytes = 0;
+    
+    SPLogVerbose(@"Simperium compacted the JSON Storage segment: %lu records, %llu bytes", (unsigned long)records.count, self.liveBytes);
+}
+
+
+#pragma mark - Serialization
+
++ (NSData *)recordWithObject:(id<SPDiffable>)object
+{
+    NSMutableDictionary *record = [NSMutableDictionary dictionary];
+    record[SPJSONStorageCacheMembersKey] = object.dictionary ?: @{};
+    
+    NSDictionary *ghost = object.ghost.dictionary;
+    if (ghost) {
+        record[SPJSONStorageCacheGhostKey] = ghost;
+    }
+    
+    if (object.ghostData) {
+        record[SPJSONStorageCacheGhostDataKey] = object.ghostData;
+    }
+    
+    // Members set locally may hold pretty much anything: those objects just stay in memory
+    if (![NSJSONSerialization isValidJSONObject:record]) {
+        return nil;
+    }
+    
+    return [NSJSONSerialization dataWithJSONObject:record options:0 error:nil];
+}
+
++ (id<SPDiffable>)objectWithRecord:(NSData *)record key:(NSString *)simperiumKey bucket:(SPBucket *)bucket
+{
+    if (record.length == 0) {
+        return nil;
+    }
+    
+    NSDictionary *dict = [NSJSONSerialization JSONObjectWithData:record options:NSJSONReadingMutableContainers error:nil];
+    if (![dict isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    
+    SPObject *object    = [[SPObject alloc] initWithDictionary:dict[SPJSONStorageCacheMembersKey]];
+    object.simperiumKey = simperiumKey;
+    object.ghost        = [[SPGhost alloc] initFromDictionary:dict[SPJSONStorageCacheGhostKey]];
+    object.ghostData    = dict[SPJSONStorageCacheGhostDataKey];
+    object.bucket       = bucket;
+    
+    return object;
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  SPJSONStorageIndex.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageIndex
+#pragma mark ====================================================================================
+
+/// Secondary index over a single member of a JSON Storage bucket: maps every (indexable) value to the set of
+/// Simperium Keys holding it. Sorted indexes also keep their distinct Numbers, Dates and Strings in order, so that
+/// range queries can be answered with a binary search.
+///
+/// Note: This class is not thread safe. SPJSONStorage accesses it from within its own queue.
+///
+@interface SPJSONStorageIndex : NSObject
+
+@property (nonatomic, copy,   readonly) NSString    *memberName;
+@property (nonatomic, assign, readonly) BOOL        sorted;
+
+- (instancetype)initWithMemberName:(NSString *)memberName sorted:(BOOL)sorted;
+
+/// Updates the value indexed for the specified object. A nil value removes the object from the index
+///
+- (void)setValue:(id)value forObjectKey:(NSString *)simperiumKey;
+
+/// Removes the specified object from the index
+///
+- (void)removeObjectKey:(NSString *)simperiumKey;
+
+/// Nukes every single indexed value
+///
+- (void)removeAllObjectKeys;
+
+/// Returns a superset of the keys matching the specified predicate, or nil when the index can't answer it.
+/// Supported operators: ==, IN, and (sorted indexes only) <, <=, >, >=, BETWEEN
+///
+- (NSSet *)objectKeysForPredicate:(NSComparisonPredicate *)predicate;
+
+@end
@@ -0,0 +1,318 @@
+//
+//  SPJSONStorageIndex.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPJSONStorageIndex.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSComparator const SPJSONStorageIndexComparator = ^NSComparisonResult(id lhs, id rhs) {
+    return [lhs compare:rhs];
+};
+
+
+#pragma mark ====================================================================================
+#pragma mark Helpers
+#pragma mark ====================================================================================
+
+// Only values of the same kind can be compared against each other: each family gets its own sorted list
+static NSString *SPJSONStorageIndexFamilyForValue(id value)
+{
+    if ([value isKindOfClass:[NSNumber class]]) {
+        return @"number";
+    }
+    
+    if ([value isKindOfClass:[NSDate class]]) {
+        return @"date";
+    }
+    
+    if ([value isKindOfClass:[NSString class]]) {
+        return @"string";
+    }
+    
+    return nil;
+}
+
+// (Constant OP KeyPath) is equivalent to (KeyPath MIRROR(OP) Constant)
+static NSPredicateOperatorType SPJSONStorageIndexMirroredOperator(NSPredicateOperatorType type)
+{
+    switch (type) {
+        case NSLessThanPredicateOperatorType:
+            return NSGreaterThanPredicateOperatorType;
+        case NSLessThanOrEqualToPredicateOperatorType:
+            return NSGreaterThanOrEqualToPredicateOperatorType;
+        case NSGreaterThanPredicateOperatorType:
+            return NSLessThanPredicateOperatorType;
+        case NSGreaterThanOrEqualToPredicateOperatorType:
+            return NSLessThanOrEqualToPredicateOperatorType;
+        case NSEqualToPredicateOperatorType:
+            return NSEqualToPredicateOperatorType;
+        default:
+            return NSCustomSelectorPredicateOperatorType;
+    }
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPJSONStorageIndex ()
+@property (nonatomic, strong) NSMutableDictionary   *valuesByKey;
+@property (nonatomic, strong) NSMutableDictionary   *keysByValue;
+@property (nonatomic, strong) NSMutableDictionary   *sortedValuesByFamily;
+@property (nonatomic, strong) NSMutableSet          *unindexedKeys;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageIndex
+#pragma mark ====================================================================================
+
+@implementation SPJSONStorageIndex
+
+- (instancetype)initWithMemberName:(NSString *)memberName sorted:(BOOL)sorted
+{
+    self = [super init];
+    if (self) {
+        _memberName             = [memberName copy];
+        _sorted                 = sorted;
+        _valuesByKey            = [NSMutableDictionary dictionary];
+        _keysByValue            = [NSMutableDictionary dictionary];
+        _sortedValuesByFamily   = [NSMutableDictionary dictionary];
+        _unindexedKeys          = [NSMutableSet set];
+    }
+    return self;
+}
+
+
+#pragma mark - Maintenance
+
+- (void)setValue:(id)value forObjectKey:(NSString *)simperiumKey {
+    NSParameterAssert(simperiumKey);
+    
+    id oldValue = self.valuesByKey[simperiumKey];
+    if (oldValue == value || [oldValue isEqual:value]) {
+        return;
+    }
+    
+    [self removeObjectKey:simperiumKey];
+    
+    if (value == nil) {
+        return;
+    }
+    
+    // Values that can't act as dictionary keys are always handed over as candidates: the predicate will decide
+    if (![value conformsToProtocol:@protocol(NSCopying)]) {
+        [self.unindexedKeys addObject:simperiumKey];
+        return;
+    }
+    
+    self.valuesByKey[simperiumKey] = value;
+    
+    NSMutableSet *keys = self.keysByValue[value];
+    if (keys == nil) {
+        keys = [NSMutableSet set];
+        self.keysByValue[value] = keys;
+        [self insertSortedValue:value];
+    }
+    
+    [keys addObject:simperiumKey];
+}
+
+- (void)removeObjectKey:(NSString *)simperiumKey {
+    [self.unindexedKeys removeObject:simperiumKey];
+    
+    id value = self.valuesByKey[simperiumKey];
+    if (value == nil) {
+        return;
+    }
+    
+    [self.valuesByKey removeObjectForKey:simperiumKey];
+    
+    NSMutableSet *keys = self.keysByValue[value];
+    [keys removeObject:simperiumKey];
+    
+    if (keys.count == 0) {
+        [self.keysByValue removeObjectForKey:value];
+        [self removeSortedValue:value];
+    }
+}
+
+- (void)removeAllObjectKeys {
+    [self.valuesByKey removeAllObjects];
+    [self.keysByValue removeAllObjects];
+    [self.sortedValuesByFamily removeAllObjects];
+    [self.unindexedKeys removeAllObjects];
+}
+
+
+#pragma mark - Sorted Values
+
+- (void)insertSortedValue:(id)value {
+    NSString *family = SPJSONStorageIndexFamilyForValue(value);
+    if (!self.sorted || family == nil) {
+        return;
+    }
+    
+    NSMutableArray *sortedValues = self.sortedValuesByFamily[family];
+    if (sortedValues == nil) {
+        sortedValues = [NSMutableArray array];
+        self.sortedValuesByFamily[family] = sortedValues;
+    }
+    
+    NSUInteger index = [sortedValues indexOfObject:value
+                                     inSortedRange:NSMakeRange(0, sortedValues.count)
+                                           options:NSBinarySearchingInsertionIndex
+                                   usingComparator:SPJSONStorageIndexComparator];
+    [sortedValues insertObject:value atIndex:index];
+}
+
+- (void)removeSortedValue:(id)value {
+    NSString *family = SPJSONStorageIndexFamilyForValue(value);
+    if (!self.sorted || family == nil) {
+        return;
+    }
+    
+    NSMutableArray *sortedValues = self.sortedValuesByFamily[family];
+    NSUInteger index = [sortedValues indexOfObject:value
+                                     inSortedRange:NSMakeRange(0, sortedValues.count)
+                                           options:NSBinarySearchingFirstEqual
+                                   usingComparator:SPJSONStorageIndexComparator];
+    if (index != NSNotFound) {
+        [sortedValues removeObjectAtIndex:index];
+    }
+}
+
+- (NSUInteger)boundOfValue:(id)value inSortedValues:(NSArray *)sortedValues inclusive:(BOOL)inclusive lower:(BOOL)lower {
+    // Lower Bounds: first position matching the range. Upper Bounds: first position past the range
+    BOOL firstEqual                     = (lower == inclusive);
+    NSBinarySearchingOptions options    = NSBinarySearchingInsertionIndex | (firstEqual ? NSBinarySearchingFirstEqual : NSBinarySearchingLastEqual);
+    
+    return [sortedValues indexOfObject:value
+                         inSortedRange:NSMakeRange(0, sortedValues.count)
+                               options:options
+                       usingComparator:SPJSONStorageIndexComparator];
+}
+
+
+#pragma mark - Lookups
+
+- (NSSet *)objectKeysForPredicate:(NSComparisonPredicate *)predicate {
+    if (![predicate isKindOfClass:[NSComparisonPredicate class]] ||
+        predicate.comparisonPredicateModifier != NSDirectPredicateModifier ||
+        predicate.options != 0) {
+        return nil;
+    }
+    
+    NSExpression *left                  = predicate.leftExpression;
+    NSExpression *right                 = predicate.rightExpression;
+    NSPredicateOperatorType operator    = predicate.predicateOperatorType;
+    id constant                         = nil;
+    
+    if (left.expressionType == NSKeyPathExpressionType && right.expressionType == NSConstantValueExpressionType) {
+        if (![left.keyPath isEqualToString:self.memberName]) {
+            return nil;
+        }
+        constant = right.constantValue;
+    
+    } else if (left.expressionType == NSConstantValueExpressionType && right.expressionType == NSKeyPathExpressionType) {
+        if (![right.keyPath isEqualToString:self.memberName]) {
+            return nil;
+        }
+        constant = left.constantValue;
+        operator = SPJSONStorageIndexMirroredOperator(operator);
+    
+    } else {
+        return nil;
+    }
+    
+    if (constant == nil) {
+        return nil;
+    }
+    
+    NSMutableSet *keys = nil;
+    
+    switch (operator) {
+        case NSEqualToPredicateOperatorType:
+            keys = [self objectKeysEqualToValues:@[ constant ]];
+            break;
+        case NSInPredicateOperatorType:
+            keys = [self objectKeysEqualToValues:constant];
+            break;
+        case NSLessThanPredicateOperatorType:
+            keys = [self objectKeysFrom:nil inclusive:NO to:constant inclusive:NO];
+            break;
+        case NSLessThanOrEqualToPredicateOperatorType:
+            keys = [self objectKeysFrom:nil inclusive:NO to:constant inclusive:YES];
+            break;
+        case NSGreaterThanPredicateOperatorType:
+            keys = [self objectKeysFrom:constant inclusive:NO to:nil inclusive:NO];
+            break;
+        case NSGreaterThanOrEqualToPredicateOperatorType:
+            keys = [self objectKeysFrom:constant inclusive:YES to:nil inclusive:NO];
+            break;
+        case NSBetweenPredicateOperatorType:
+            if ([constant isKindOfClass:[NSArray class]] && [constant count] == 2) {
+                keys = [self objectKeysFrom:[constant firstObject] inclusive:YES to:[constant lastObject] inclusive:YES];
+            }
+            break;
+        default:
+            break;
+    }
+    
+    [keys unionSet:self.unindexedKeys];
+    
+    return keys;
+}
+
+- (NSMutableSet *)objectKeysEqualToValues:(id)values {
+    if (![values conformsToProtocol:@protocol(NSFastEnumeration)] || [values isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    
+    NSMutableSet *keys = [NSMutableSet set];
+    for (id value in values) {
+        NSSet *matches = self.keysByValue[value];
+        if (matches) {
+            [keys unionSet:matches];
+        }
+    }
+    
+    return keys;
+}
+
+- (NSMutableSet *)objectKeysFrom:(id)lower inclusive:(BOOL)lowerInclusive to:(id)upper inclusive:(BOOL)upperInclusive {
+    if (!self.sorted) {
+        return nil;
+    }
+    
+    NSString *lowerFamily       = lower ? SPJSONStorageIndexFamilyForValue(lower) : nil;
+    NSString *upperFamily       = upper ? SPJSONStorageIndexFamilyForValue(upper) : nil;
+    NSString *family            = lowerFamily ?: upperFamily;
+    
+    if (family == nil || (lower && upper && ![lowerFamily isEqualToString:upperFamily])) {
+        return nil;
+    }
+    
+    NSArray *sortedValues       = self.sortedValuesByFamily[family];
+    NSUInteger start            = lower ? [self boundOfValue:lower inSortedValues:sortedValues inclusive:lowerInclusive lower:YES] : 0;
+    NSUInteger end              = upper ? [self boundOfValue:upper inSortedValues:sortedValues inclusive:upperInclusive lower:NO] : sortedValues.count;
+    
+    NSMutableSet *keys          = [NSMutableSet set];
+    for (NSUInteger i = start; i < end; ++i) {
+        [keys unionSet:self.keysByValue[sortedValues[i]]];
+    }
+    
+    return keys;
+}
+
+@end
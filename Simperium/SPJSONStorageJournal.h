@@ -0,0 +1,57 @@
+//
+//  SPJSONStorageJournal.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageJournal
+#pragma mark ====================================================================================
+
+/// Persists SPJSONStorage records, per bucket, as a Write-Ahead Log plus a periodic Snapshot:
+///
+///     <URL>/<Bucket>/wal          Appended on every save. Checksummed entries: a torn tail is simply dropped
+///     <URL>/<Bucket>/snapshot     Latest record for every object. Rewritten aside, and atomically renamed into place
+///     <URL>/metadata              Storage metadata, written atomically
+///
+/// Writes are performed asynchronously, on the journal's own queue.
+///
+@interface SPJSONStorageJournal : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *URL;
+
+- (instancetype)initWithURL:(NSURL *)URL;
+
+/// Replays every Snapshot and Log, and hands over the latest record of each live object. Files are memory mapped:
+/// records are only valid within the block
+///
+- (void)enumerateRecordsUsingBlock:(void (^)(NSString *bucketName, NSString *simperiumKey, NSData *record))block;
+
+/// Appends the specified records to the bucket's log. NSNull records stand for deletions
+///
+- (void)appendRecords:(NSDictionary *)records bucketName:(NSString *)bucketName;
+
+/// Folds the bucket's log into a brand new snapshot. Triggered automatically, as logs grow
+///
+- (void)writeSnapshotForBucketName:(NSString *)bucketName;
+
+/// Nukes every record stored for the specified bucket
+///
+- (void)removeAllRecordsForBucketName:(NSString *)bucketName;
+
+/// Metadata Helpers
+///
+- (NSDictionary *)loadMetadata;
+- (void)saveMetadata:(NSDictionary *)metadata;
+
+/// Invokes the completion handler once every write enqueued so far has been flushed to disk
+///
+- (void)synchronizeWithCompletion:(void (^)(void))completion;
+
+@end
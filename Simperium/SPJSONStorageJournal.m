@@ -0,0 +1,485 @@
+//
+//  SPJSONStorageJournal.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPJSONStorageJournal.h"
+#import "SPLogger.h"
+#import <zlib.h>
+#import <stdio.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLogLevels logLevel                                     = SPLogLevelsInfo;
+
+// Entry Layout:
+//  [Operation: uint8] [Key Length: uint32] [Key: UTF8] [Record Length: uint32] [Record] [CRC32: uint32]
+//
+// Snapshots start with a Magic, followed by Put entries. Logs are just a sequence of entries
+//
+static char const SPJSONStorageJournalSnapshotMagic[4]          = { 'S', 'P', 'J', '1' };
+
+static NSString * const SPJSONStorageJournalLogFilename         = @"wal";
+static NSString * const SPJSONStorageJournalSnapshotFilename    = @"snapshot";
+static NSString * const SPJSONStorageJournalMetadataFilename    = @"metadata";
+
+// Logs get folded into a new Snapshot beyond this size
+static unsigned long long const SPJSONStorageJournalLogThreshold = 4 * 1024 * 1024;
+
+// Snapshots are written in chunks of (about) this size
+static NSUInteger const SPJSONStorageJournalWriteChunkLength    = 1024 * 1024;
+
+typedef NS_ENUM(uint8_t, SPJSONStorageJournalOperation) {
+    SPJSONStorageJournalOperationPut                            = 'P',
+    SPJSONStorageJournalOperationDelete                         = 'D'
+};
+
+
+#pragma mark ====================================================================================
+#pragma mark Binary Helpers
+#pragma mark ====================================================================================
+
+static void SPJSONStorageJournalAppendUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t littleEndian = CFSwapInt32HostToLittle(value);
+    [data appendBytes:&littleEndian length:sizeof(littleEndian)];
+}
+
+static uint32_t SPJSONStorageJournalReadUInt32(const uint8_t *bytes) {
+    uint32_t littleEndian = 0;
+    memcpy(&littleEndian, bytes, sizeof(littleEndian));
+    return CFSwapInt32LittleToHost(littleEndian);
+}
+
+static void SPJSONStorageJournalAppendEntry(NSMutableData *data, SPJSONStorageJournalOperation operation, NSString *key, NSData *record) {
+    NSUInteger start    = data.length;
+    NSData *keyData     = [key dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t op          = operation;
+    
+    [data appendBytes:&op length:sizeof(op)];
+    SPJSONStorageJournalAppendUInt32(data, (uint32_t)keyData.length);
+    [data appendData:keyData];
+    SPJSONStorageJournalAppendUInt32(data, (uint32_t)record.length);
+    
+    if (record) {
+        [data appendData:record];
+    }
+    
+    uLong checksum      = crc32(0L, (const Bytef *)data.bytes + start, (uInt)(data.length - start));
+    SPJSONStorageJournalAppendUInt32(data, (uint32_t)checksum);
+}
+
+// Returns NO as soon as the data runs out, or an entry doesn't check out (ie. it was torn by a crash)
+static BOOL SPJSONStorageJournalReadEntry(NSData *data, NSUInteger *offset, SPJSONStorageJournalOperation *operation, NSRange *keyRange, NSRange *recordRange) {
+    const uint8_t *bytes    = data.bytes;
+    NSUInteger length       = data.length;
+    NSUInteger start        = *offset;
+    NSUInteger cursor       = start;
+    
+    if (length < cursor || length - cursor < sizeof(uint8_t) + sizeof(uint32_t)) {
+        return NO;
+    }
+    
+    uint8_t op              = bytes[cursor];
+    cursor                  += sizeof(uint8_t);
+    
+    uint32_t keyLength      = SPJSONStorageJournalReadUInt32(bytes + cursor);
+    cursor                  += sizeof(uint32_t);
+    
+    if (length - cursor < (NSUInteger)keyLength + sizeof(uint32_t)) {
+        return NO;
+    }
+    
+    NSRange key             = NSMakeRange(cursor, keyLength);
+    cursor                  += keyLength;
+    
+    uint32_t recordLength   = SPJSONStorageJournalReadUInt32(bytes + cursor);
+    cursor                  += sizeof(uint32_t);
+    
+    if (length - cursor < (NSUInteger)recordLength + sizeof(uint32_t)) {
+        return NO;
+    }
+    
+    NSRange record          = NSMakeRange(cursor, recordLength);
+    cursor                  += recordLength;
+    
+    uint32_t checksum       = SPJSONStorageJournalReadUInt32(bytes + cursor);
+    uLong expected          = crc32(0L, (const Bytef *)bytes + start, (uInt)(cursor - start));
+    cursor                  += sizeof(uint32_t);
+    
+    if (checksum != (uint32_t)expected || (op != SPJSONStorageJournalOperationPut && op != SPJSONStorageJournalOperationDelete)) {
+        return NO;
+    }
+    
+    *operation              = op;
+    *keyRange               = key;
+    *recordRange            = record;
+    *offset                 = cursor;
+    
+    return YES;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPJSONStorageJournal ()
+@property (nonatomic, strong) dispatch_queue_t      queue;
+@property (nonatomic, strong) NSMutableDictionary   *logs;
+@property (nonatomic, strong) NSMutableDictionary   *logLengths;
+@property (nonatomic, strong) NSMutableSet          *unsynchronizedBucketNames;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageJournal
+#pragma mark ====================================================================================
+
+@implementation SPJSONStorageJournal
+
+- (void)dealloc
+{
+    for (NSFileHandle *log in _logs.allValues) {
+        [log synchronizeFile];
+        [log closeFile];
+    }
+}
+
+- (instancetype)initWithURL:(NSURL *)URL
+{
+    NSParameterAssert(URL);
+    
+    self = [super init];
+    if (self) {
+        _URL                        = URL;
+        _queue                      = dispatch_queue_create("com.simperium.SPJSONStorageJournal", NULL);
+        _logs                       = [NSMutableDictionary dictionary];
+        _logLengths                 = [NSMutableDictionary dictionary];
+        _unsynchronizedBucketNames  = [NSMutableSet set];
+    
+        NSError *error = nil;
+        if (![[NSFileManager defaultManager] createDirectoryAtURL:URL withIntermediateDirectories:YES attributes:nil error:&error]) {
+            SPLogError(@"Simperium couldn't create the JSON Storage directory %@: %@", URL, error);
+        }
+    }
+    return self;
+}
+
+
+#pragma mark - Paths
+
+- (NSURL *)directoryURLForBucketName:(NSString *)bucketName
+{
+    NSString *escapedName = [bucketName stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet alphanumericCharacterSet]];
+    return [self.URL URLByAppendingPathComponent:escapedName isDirectory:YES];
+}
+
+- (NSURL *)metadataURL
+{
+    return [self.URL URLByAppendingPathComponent:SPJSONStorageJournalMetadataFilename];
+}
+
+- (NSFileHandle *)logForBucketName:(NSString *)bucketName
+{
+    NSFileHandle *log = self.logs[bucketName];
+    if (log) {
+        return log;
+    }
+    
+    NSFileManager *fileManager  = [NSFileManager defaultManager];
+    NSURL *directoryURL         = [self directoryURLForBucketName:bucketName];
+    NSString *logPath           = [directoryURL URLByAppendingPathComponent:SPJSONStorageJournalLogFilename].path;
+    
+    [fileManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    if (![fileManager fileExistsAtPath:logPath]) {
+        [fileManager createFileAtPath:logPath contents:nil attributes:nil];
+    }
+    
+    log = [NSFileHandle fileHandleForWritingAtPath:logPath];
+    if (!log) {
+        SPLogError(@"Simperium couldn't open the JSON Storage log at %@", logPath);
+        return nil;
+    }
+    
+    self.logs[bucketName]       = log;
+    self.logLengths[bucketName] = @([log seekToEndOfFile]);
+    
+    return log;
+}
+
+
+#pragma mark - Reading
+
+- (void)enumerateRecordsUsingBlock:(void (^)(NSString *bucketName, NSString *simperiumKey, NSData *record))block
+{
+    NSParameterAssert(block);
+    
+    dispatch_sync(self.queue, ^{
+        NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.URL
+                                                          includingPropertiesForKeys:@[NSURLIsDirectoryKey]
+                                                                             options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                               error:nil];
+        for (NSURL *directoryURL in contents) {
+            NSNumber *isDirectory = nil;
+            [directoryURL getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:nil];
+            if (!isDirectory.boolValue) {
+                continue;
+            }
+    
+            NSString *bucketName = directoryURL.lastPathComponent.stringByRemovingPercentEncoding;
+            [self enumerateRecordsForBucketName:bucketName usingBlock:block];
+        }
+    });
+}
+
+- (void)enumerateRecordsForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *bucketName, NSString *simperiumKey, NSData *record))block
+{
+    NSURL *directoryURL     = [self directoryURLForBucketName:bucketName];
+    NSData *snapshot        = [NSData dataWithContentsOfURL:[directoryURL URLByAppendingPathComponent:SPJSONStorageJournalSnapshotFilename]
+                                                    options:NSDataReadingMappedIfSafe
+                                                      error:nil];
+    NSData *log             = [NSData dataWithContentsOfURL:[directoryURL URLByAppendingPathComponent:SPJSONStorageJournalLogFilename]
+                                                    options:NSDataReadingMappedIfSafe
+                                                      error:nil];
+    NSUInteger logLength    = 0;
+    NSDictionary *latest    = [self latestRecordRangesWithSnapshot:snapshot log:log validLogLength:&logLength];
+    
+    // Torn Tail: Whatever follows the last valid entry never made it to disk in one piece
+    if (logLength < log.length) {
+        SPLogWarn(@"Simperium dropping %lu torn bytes from the %@ JSON Storage log", (unsigned long)(log.length - logLength), bucketName);
+    
+        NSFileHandle *handle = [self logForBucketName:bucketName];
+        [handle truncateFileAtOffset:logLength];
+        [handle synchronizeFile];
+        self.logLengths[bucketName] = @(logLength);
+    }
+    
+    for (NSString *key in latest) {
+        @autoreleasepool {
+            NSRange range   = [latest[key] rangeValue];
+            NSData *record  = [self recordWithRange:range snapshot:snapshot log:log];
+            block(bucketName, key, record);
+        }
+    }
+}
+
+// Folds the Snapshot and the Log: Ranges are expressed as if the Log was appended right after the Snapshot
+- (NSDictionary *)latestRecordRangesWithSnapshot:(NSData *)snapshot log:(NSData *)log validLogLength:(NSUInteger *)validLogLength
+{
+    NSMutableDictionary *latest = [NSMutableDictionary dictionary];
+    NSUInteger magicLength      = sizeof(SPJSONStorageJournalSnapshotMagic);
+    
+    if (snapshot.length >= magicLength && memcmp(snapshot.bytes, SPJSONStorageJournalSnapshotMagic, magicLength) == 0) {
+        [self foldEntriesFromData:snapshot offset:magicLength base:0 into:latest];
+    } else if (snapshot.length > 0) {
+        SPLogError(@"Simperium found an invalid JSON Storage snapshot. Ignoring it");
+    }
+    
+    *validLogLength = [self foldEntriesFromData:log offset:0 base:snapshot.length into:latest];
+    
+    return latest;
+}
+
+- (NSUInteger)foldEntriesFromData:(NSData *)data offset:(NSUInteger)offset base:(NSUInteger)base into:(NSMutableDictionary *)latest
+{
+    const uint8_t *bytes = data.bytes;
+    SPJSONStorageJournalOperation operation;
+    NSRange keyRange;
+    NSRange recordRange;
+    
+    while (SPJSONStorageJournalReadEntry(data, &offset, &operation, &keyRange, &recordRange)) {
+        NSString *key = [[NSString alloc] initWithBytes:bytes + keyRange.location length:keyRange.length encoding:NSUTF8StringEncoding];
+        if (!key) {
+            continue;
+        }
+    
+        if (operation == SPJSONStorageJournalOperationDelete) {
+            [latest removeObjectForKey:key];
+        } else {
+            latest[key] = [NSValue valueWithRange:NSMakeRange(base + recordRange.location, recordRange.length)];
+        }
+    }
+    
+    return offset;
+}
+
+- (NSData *)recordWithRange:(NSRange)range snapshot:(NSData *)snapshot log:(NSData *)log
+{
+    NSData *source      = (range.location < snapshot.length) ? snapshot : log;
+    NSUInteger location = (source == snapshot) ? range.location : range.location - snapshot.length;
+    
+    // No copies: the record is backed by the mapped file
+    return [NSData dataWithBytesNoCopy:(void *)((const uint8_t *)source.bytes + location) length:range.length freeWhenDone:NO];
+}
+
+
+#pragma mark - Writing
+
+- (void)appendRecords:(NSDictionary *)records bucketName:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    if (records.count == 0) {
+        return;
+    }
+    
+    // Encode right away: the caller's thread is way less busy than ours
+    NSMutableData *entries = [NSMutableData data];
+    for (NSString *key in records) {
+        NSData *record = records[key];
+        if ([record isKindOfClass:[NSData class]]) {
+            SPJSONStorageJournalAppendEntry(entries, SPJSONStorageJournalOperationPut, key, record);
+        } else {
+            SPJSONStorageJournalAppendEntry(entries, SPJSONStorageJournalOperationDelete, key, nil);
+        }
+    }
+    
+    dispatch_async(self.queue, ^{
+        NSFileHandle *log = [self logForBucketName:bucketName];
+        [log writeData:entries];
+    
+        unsigned long long logLength    = [self.logLengths[bucketName] unsignedLongLongValue] + entries.length;
+        self.logLengths[bucketName]     = @(logLength);
+        [self.unsynchronizedBucketNames addObject:bucketName];
+    
+        if (logLength > SPJSONStorageJournalLogThreshold) {
+            [self unsafeWriteSnapshotForBucketName:bucketName];
+        }
+    });
+}
+
+- (void)writeSnapshotForBucketName:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    dispatch_async(self.queue, ^{
+        [self unsafeWriteSnapshotForBucketName:bucketName];
+    });
+}
+
+- (void)unsafeWriteSnapshotForBucketName:(NSString *)bucketName
+{
+    NSFileManager *fileManager  = [NSFileManager defaultManager];
+    NSURL *directoryURL         = [self directoryURLForBucketName:bucketName];
+    NSURL *snapshotURL          = [directoryURL URLByAppendingPathComponent:SPJSONStorageJournalSnapshotFilename];
+    NSURL *temporaryURL         = [snapshotURL URLByAppendingPathExtension:@"tmp"];
+    NSFileHandle *log           = [self logForBucketName:bucketName];
+    
+    // Fold the current Snapshot + Log
+    NSData *snapshot            = [NSData dataWithContentsOfURL:snapshotURL options:NSDataReadingMappedIfSafe error:nil];
+    NSData *logData             = [NSData dataWithContentsOfURL:[directoryURL URLByAppendingPathComponent:SPJSONStorageJournalLogFilename]
+                                                        options:NSDataReadingMappedIfSafe
+                                                          error:nil];
+    NSUInteger logLength        = 0;
+    NSDictionary *latest        = [self latestRecordRangesWithSnapshot:snapshot log:logData validLogLength:&logLength];
+    
+    // Write it aside
+    [fileManager createFileAtPath:temporaryURL.path contents:nil attributes:nil];
+    NSFileHandle *output        = [NSFileHandle fileHandleForWritingAtPath:temporaryURL.path];
+    if (!output) {
+        SPLogError(@"Simperium couldn't create a JSON Storage snapshot at %@", temporaryURL);
+        return;
+    }
+    
+    NSMutableData *buffer       = [NSMutableData dataWithBytes:SPJSONStorageJournalSnapshotMagic length:sizeof(SPJSONStorageJournalSnapshotMagic)];
+    for (NSString *key in latest) {
+        @autoreleasepool {
+            NSData *record = [self recordWithRange:[latest[key] rangeValue] snapshot:snapshot log:logData];
+            SPJSONStorageJournalAppendEntry(buffer, SPJSONStorageJournalOperationPut, key, record);
+    
+            if (buffer.length >= SPJSONStorageJournalWriteChunkLength) {
+                [output writeData:buffer];
+                buffer.length = 0;
+            }
+        }
+    }
+    
+    [output writeData:buffer];
+    [output synchronizeFile];
+    [output closeFile];
+    
+    // Atomically swap Snapshots. A crash right after this point just replays the old log over the new snapshot,
+    // which yields the very same state
+    if (rename(temporaryURL.path.fileSystemRepresentation, snapshotURL.path.fileSystemRepresentation) != 0) {
+        SPLogError(@"Simperium couldn't move the JSON Storage snapshot into place: %s", strerror(errno));
+        [fileManager removeItemAtURL:temporaryURL error:nil];
+        return;
+    }
+    
+    [log truncateFileAtOffset:0];
+    [log synchronizeFile];
+    
+    self.logLengths[bucketName] = @(0);
+    [self.unsynchronizedBucketNames removeObject:bucketName];
+    
+    SPLogVerbose(@"Simperium wrote a JSON Storage snapshot for %@: %lu records", bucketName, (unsigned long)latest.count);
+}
+
+- (void)removeAllRecordsForBucketName:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    dispatch_async(self.queue, ^{
+        [self.logs[bucketName] closeFile];
+        [self.logs removeObjectForKey:bucketName];
+        [self.logLengths removeObjectForKey:bucketName];
+        [self.unsynchronizedBucketNames removeObject:bucketName];
+    
+        [[NSFileManager defaultManager] removeItemAtURL:[self directoryURLForBucketName:bucketName] error:nil];
+    });
+}
+
+- (void)synchronizeWithCompletion:(void (^)(void))completion
+{
+    NSParameterAssert(completion);
+    
+    dispatch_async(self.queue, ^{
+        for (NSString *bucketName in self.unsynchronizedBucketNames) {
+            [self.logs[bucketName] synchronizeFile];
+        }
+    
+        [self.unsynchronizedBucketNames removeAllObjects];
+        completion();
+    });
+}
+
+
+#pragma mark - Metadata
+
+- (NSDictionary *)loadMetadata
+{
+    __block NSDictionary *metadata = nil;
+    dispatch_sync(self.queue, ^{
+        NSData *data = [NSData dataWithContentsOfURL:self.metadataURL];
+        if (data) {
+            metadata = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+        }
+    });
+    
+    return [metadata isKindOfClass:[NSDictionary class]] ? metadata : nil;
+}
+
+- (void)saveMetadata:(NSDictionary *)metadata
+{
+    NSDictionary *metadataCopy = [metadata copy] ?: @{};
+    
+    if (![NSJSONSerialization isValidJSONObject:metadataCopy]) {
+        SPLogError(@"Simperium couldn't encode the JSON Storage metadata");
+        return;
+    }
+    
+    dispatch_async(self.queue, ^{
+        NSData *data = [NSJSONSerialization dataWithJSONObject:metadataCopy options:0 error:nil];
+        [data writeToURL:self.metadataURL atomically:YES];
+    });
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+//  SPLogBuffer.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPLogger.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Types
+#pragma mark ====================================================================================
+
+typedef void (^SPLogBufferHandler)(NSDate *date, SPLogFlags flag, NSString *message);
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLogBuffer
+#pragma mark ====================================================================================
+
+/// Lock-free log record buffer. Every logging thread gets its own single-producer / single-consumer ring, and
+/// appending a record just copies the format pointer plus the raw arguments. Messages are formatted lazily, on the
+/// buffer's queue, right before being handed over to the handler in chronological order.
+///
+/// Formats are parsed once per thread, and cached. Formats with unsupported specifiers (positional arguments, '*'
+/// widths, long doubles) are formatted right away, instead.
+///
+/// Object arguments get copied, whenever they support it: mutable collections won't change behind the logger's back.
+/// Objects that can't be copied are retained, and their -description is evaluated later on, on the buffer's queue.
+///
+/// When a ring fills up faster than it gets drained, new Info and Verbose records are dropped, and accounted for in a
+/// single summary line. Warnings and Errors are never dropped: they're formatted right away, and handed over
+/// synchronously, right after every pending record.
+///
+@interface SPLogBuffer : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger  capacity;
+@property (nonatomic, assign, readonly) uint64_t    droppedRecordCount;
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity queue:(dispatch_queue_t)queue handler:(SPLogBufferHandler)handler;
+
+/// Hot path: safe to be called from any thread
+///
+- (void)appendRecordWithFlag:(SPLogFlags)flag format:(NSString *)format arguments:(va_list)arguments;
+
+/// Formats every pending record, and hands them over to the handler. Must be called on the buffer's queue
+///
+- (void)drain;
+
+@end
@@ -0,0 +1,682 @@
+//
+//  SPLogBuffer.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPLogBuffer.h"
+#import <pthread.h>
+#import <stdatomic.h>
+#import <stdlib.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+#define SPLogRecordMaxArguments                         8
+
+static CFIndex const SPLogFormatCacheLimit              = 512;
+static int64_t const SPLogBufferDrainDelay              = 5 * NSEC_PER_MSEC;
+static SPLogFlags const SPLogBufferCriticalFlags        = SPLogFlagsError | SPLogFlagsWarn;
+static char const SPLogBufferQueueKey;
+
+typedef NS_ENUM(uint8_t, SPLogArgumentType) {
+    SPLogArgumentTypeInteger,
+    SPLogArgumentTypeCharacter,
+    SPLogArgumentTypeDouble,
+    SPLogArgumentTypePointer,
+    SPLogArgumentTypeObject,
+    SPLogArgumentTypeCString
+};
+
+typedef NS_ENUM(uint8_t, SPLogArgumentLength) {
+    SPLogArgumentLengthDefault,
+    SPLogArgumentLengthChar,
+    SPLogArgumentLengthShort,
+    SPLogArgumentLengthLong,
+    SPLogArgumentLengthLongLong,
+    SPLogArgumentLengthSize,
+    SPLogArgumentLengthPointerDiff,
+    SPLogArgumentLengthIntMax
+};
+
+typedef struct {
+    SPLogArgumentType   type;
+    SPLogArgumentLength length;
+    bool                isUnsigned;
+} SPLogArgumentDescriptor;
+
+typedef union {
+    long long           integer;
+    double              real;
+    const void          *pointer;
+} SPLogArgument;
+
+typedef struct {
+    CFAbsoluteTime      timestamp;
+    const void          *format;                // Retained SPLogFormat. NULL for messages formatted right away
+    SPLogFlags          flag;
+    SPLogArgument       arguments[SPLogRecordMaxArguments];
+} SPLogRecord;
+
+typedef struct SPLogRing {
+    SPLogRecord             *records;
+    uint64_t                mask;
+    _Atomic(uint64_t)       head;               // Written by the producer thread only
+    _Atomic(uint64_t)       tail;               // Written by the consumer only
+    _Atomic(bool)           orphaned;           // Set once the producer thread is gone
+    CFMutableDictionaryRef  formats;            // Producer only: Format String > SPLogFormat
+    struct SPLogRing        *next;              // Guarded by the registry lock
+} SPLogRing;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLogFormat
+#pragma mark ====================================================================================
+
+@interface SPLogFormat : NSObject
+@property (nonatomic, strong, readonly) NSString                *format;
+@property (nonatomic, strong, readonly) NSString                *prefix;
+@property (nonatomic, strong, readonly) NSArray                 *segments;
+@property (nonatomic, assign, readonly) BOOL                    supported;
+@property (nonatomic, assign, readonly) NSUInteger              argumentCount;
+@property (nonatomic, assign, readonly) SPLogArgumentDescriptor *descriptors;
+- (instancetype)initWithFormat:(NSString *)format;
+- (NSString *)messageWithArguments:(const SPLogArgument *)arguments;
+@end
+
+@implementation SPLogFormat {
+    SPLogArgumentDescriptor _descriptors[SPLogRecordMaxArguments];
+}
+
+- (instancetype)initWithFormat:(NSString *)format
+{
+    self = [super init];
+    if (self) {
+        _format = format;
+        [self parse];
+    }
+    return self;
+}
+
+// Splits the format in segments holding a single specifier each (plus the literal text that follows it), so that
+// every segment can be formatted on its own. Integers are always stored as long long's: specifiers are rewritten.
+- (void)parse
+{
+    NSString *format            = _format;
+    NSUInteger length           = format.length;
+    NSMutableString *prefix     = [NSMutableString string];
+    NSMutableString *current    = prefix;
+    NSMutableArray *segments    = [NSMutableArray array];
+    NSCharacterSet *flags       = [NSCharacterSet characterSetWithCharactersInString:@"-+ #0'"];
+    NSUInteger count            = 0;
+    
+    _supported = NO;
+    
+    for (NSUInteger i = 0; i < length; ++i) {
+        unichar c = [format characterAtIndex:i];
+        if (c != '%') {
+            [current appendFormat:@"%C", c];
+            continue;
+        }
+    
+        if (i + 1 < length && [format characterAtIndex:i + 1] == '%') {
+            [current appendString:(current == prefix) ? @"%" : @"%%"];
+            ++i;
+            continue;
+        }
+    
+        // Flags, Width and Precision are kept as they are
+        NSUInteger j = i + 1;
+        while (j < length && [flags characterIsMember:[format characterAtIndex:j]]) {
+            ++j;
+        }
+    
+        while (j < length && ([format characterAtIndex:j] == '.' || isdigit([format characterAtIndex:j]))) {
+            ++j;
+        }
+    
+        if (j >= length) {
+            return;
+        }
+    
+        unichar next = [format characterAtIndex:j];
+        if (next == '*' || next == '$') {
+            return;
+        }
+    
+        NSString *modifiers = [format substringWithRange:NSMakeRange(i + 1, j - i - 1)];
+    
+        // Length
+        SPLogArgumentLength argumentLength = SPLogArgumentLengthDefault;
+        if (next == 'h') {
+            argumentLength = SPLogArgumentLengthShort;
+            if (++j < length && [format characterAtIndex:j] == 'h') {
+                argumentLength = SPLogArgumentLengthChar;
+                ++j;
+            }
+        } else if (next == 'l') {
+            argumentLength = SPLogArgumentLengthLong;
+            if (++j < length && [format characterAtIndex:j] == 'l') {
+                argumentLength = SPLogArgumentLengthLongLong;
+                ++j;
+            }
+        } else if (next == 'q') {
+            argumentLength = SPLogArgumentLengthLongLong;
+            ++j;
+        } else if (next == 'z') {
+            argumentLength = SPLogArgumentLengthSize;
+            ++j;
+        } else if (next == 't') {
+            argumentLength = SPLogArgumentLengthPointerDiff;
+            ++j;
+        } else if (next == 'j') {
+            argumentLength = SPLogArgumentLengthIntMax;
+            ++j;
+        } else if (next == 'L') {
+            return;
+        }
+    
+        if (j >= length || count == SPLogRecordMaxArguments) {
+            return;
+        }
+    
+        // Conversion
+        unichar conversion                  = [format characterAtIndex:j];
+        SPLogArgumentDescriptor descriptor  = { SPLogArgumentTypeInteger, argumentLength, false };
+        NSString *specifier                 = nil;
+    
+        switch (conversion) {
+            case 'd':
+            case 'i':
+            case 'D':
+                descriptor.length   = (conversion == 'D') ? SPLogArgumentLengthLong : argumentLength;
+                specifier           = [NSString stringWithFormat:@"%%%@lld", modifiers];
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'U':
+            case 'O':
+                descriptor.length       = (conversion == 'U' || conversion == 'O') ? SPLogArgumentLengthLong : argumentLength;
+                descriptor.isUnsigned   = true;
+                specifier               = [NSString stringWithFormat:@"%%%@ll%C", modifiers, (unichar)(conversion == 'X' ? 'X' : tolower(conversion))];
+                break;
+            case 'c':
+            case 'C':
+                descriptor.type     = SPLogArgumentTypeCharacter;
+                specifier           = [NSString stringWithFormat:@"%%%@%C", modifiers, conversion];
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                descriptor.type     = SPLogArgumentTypeDouble;
+                specifier           = [NSString stringWithFormat:@"%%%@%C", modifiers, conversion];
+                break;
+            case 'p':
+                descriptor.type     = SPLogArgumentTypePointer;
+                specifier           = [NSString stringWithFormat:@"%%%@p", modifiers];
+                break;
+            case '@':
+                descriptor.type     = SPLogArgumentTypeObject;
+                specifier           = [NSString stringWithFormat:@"%%%@@", modifiers];
+                break;
+            case 's':
+                if (argumentLength != SPLogArgumentLengthDefault || [modifiers containsString:@"."]) {
+                    return;
+                }
+                descriptor.type     = SPLogArgumentTypeCString;
+                specifier           = [NSString stringWithFormat:@"%%%@@", modifiers];
+                break;
+            default:
+                return;
+        }
+    
+        _descriptors[count++]   = descriptor;
+        current                 = [specifier mutableCopy];
+        [segments addObject:current];
+        i = j;
+    }
+    
+    _prefix         = prefix;
+    _segments       = segments;
+    _argumentCount  = count;
+    _supported      = YES;
+}
+
+- (SPLogArgumentDescriptor *)descriptors
+{
+    return _descriptors;
+}
+
+- (NSString *)messageWithArguments:(const SPLogArgument *)arguments
+{
+    NSMutableString *message = [_prefix mutableCopy];
+    
+    for (NSUInteger i = 0; i < _argumentCount; ++i) {
+        NSString *segment = _segments[i];
+    
+        switch (_descriptors[i].type) {
+            case SPLogArgumentTypeInteger:
+                [message appendFormat:segment, arguments[i].integer];
+                break;
+            case SPLogArgumentTypeCharacter:
+                [message appendFormat:segment, (int)arguments[i].integer];
+                break;
+            case SPLogArgumentTypeDouble:
+                [message appendFormat:segment, arguments[i].real];
+                break;
+            case SPLogArgumentTypePointer:
+                [message appendFormat:segment, arguments[i].pointer];
+                break;
+            case SPLogArgumentTypeObject:
+            case SPLogArgumentTypeCString:
+                [message appendFormat:segment, (__bridge id)arguments[i].pointer];
+                break;
+        }
+    }
+    
+    return message;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark Ring Helpers
+#pragma mark ====================================================================================
+
+static void SPLogRingOrphan(void *value)
+{
+    SPLogRing *ring = value;
+    atomic_store_explicit(&ring->orphaned, true, memory_order_release);
+}
+
+static SPLogRing *SPLogRingCreate(NSUInteger capacity)
+{
+    SPLogRing *ring = calloc(1, sizeof(SPLogRing));
+    ring->records   = calloc(capacity, sizeof(SPLogRecord));
+    ring->mask      = capacity - 1;
+    ring->formats   = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->orphaned, false);
+    return ring;
+}
+
+static void SPLogRecordRelease(SPLogRecord *record)
+{
+    if (!record->format) {
+        CFBridgingRelease(record->arguments[0].pointer);
+        return;
+    }
+    
+    SPLogFormat *format = CFBridgingRelease(record->format);
+    for (NSUInteger i = 0; i < format.argumentCount; ++i) {
+        SPLogArgumentType type = format.descriptors[i].type;
+        if (type == SPLogArgumentTypeObject || type == SPLogArgumentTypeCString) {
+            CFBridgingRelease(record->arguments[i].pointer);
+        }
+    }
+}
+
+static void SPLogRingFree(SPLogRing *ring)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for (uint64_t i = atomic_load_explicit(&ring->tail, memory_order_relaxed); i < head; ++i) {
+        SPLogRecordRelease(&ring->records[i & ring->mask]);
+    }
+    
+    CFRelease(ring->formats);
+    free(ring->records);
+    free(ring);
+}
+
+static inline SPLogFormat *SPLogRingFormat(SPLogRing *ring, NSString *format)
+{
+    // Cached formats retain their string: its address can't possibly get recycled
+    SPLogFormat *parsed = (__bridge SPLogFormat *)CFDictionaryGetValue(ring->formats, (__bridge const void *)format);
+    if (parsed) {
+        return parsed;
+    }
+    
+    if (CFDictionaryGetCount(ring->formats) >= SPLogFormatCacheLimit) {
+        CFDictionaryRemoveAllValues(ring->formats);
+    }
+    
+    parsed = [[SPLogFormat alloc] initWithFormat:format];
+    CFDictionarySetValue(ring->formats, (__bridge const void *)format, (__bridge const void *)parsed);
+    return parsed;
+}
+
+static inline long long SPLogReadInteger(va_list *arguments, SPLogArgumentDescriptor descriptor)
+{
+    switch (descriptor.length) {
+        case SPLogArgumentLengthChar:
+            return descriptor.isUnsigned ? (unsigned char)va_arg(*arguments, int) : (signed char)va_arg(*arguments, int);
+        case SPLogArgumentLengthShort:
+            return descriptor.isUnsigned ? (unsigned short)va_arg(*arguments, int) : (short)va_arg(*arguments, int);
+        case SPLogArgumentLengthLong:
+            return descriptor.isUnsigned ? (long long)va_arg(*arguments, unsigned long) : va_arg(*arguments, long);
+        case SPLogArgumentLengthLongLong:
+            return va_arg(*arguments, long long);
+        case SPLogArgumentLengthSize:
+            return descriptor.isUnsigned ? (long long)va_arg(*arguments, size_t) : va_arg(*arguments, ssize_t);
+        case SPLogArgumentLengthPointerDiff:
+            return va_arg(*arguments, ptrdiff_t);
+        case SPLogArgumentLengthIntMax:
+            return va_arg(*arguments, intmax_t);
+        case SPLogArgumentLengthDefault:
+            return descriptor.isUnsigned ? (long long)va_arg(*arguments, unsigned int) : va_arg(*arguments, int);
+    }
+}
+
+static inline void SPLogReadArgument(va_list *arguments, SPLogArgumentDescriptor descriptor, SPLogArgument *argument)
+{
+    switch (descriptor.type) {
+        case SPLogArgumentTypeInteger:
+            argument->integer = SPLogReadInteger(arguments, descriptor);
+            break;
+        case SPLogArgumentTypeCharacter:
+            argument->integer = va_arg(*arguments, int);
+            break;
+        case SPLogArgumentTypeDouble:
+            argument->real = va_arg(*arguments, double);
+            break;
+        case SPLogArgumentTypePointer:
+            argument->pointer = va_arg(*arguments, void *);
+            break;
+        case SPLogArgumentTypeObject: {
+            // Immutable objects return themselves: mutable ones won't change before being formatted
+            id object = va_arg(*arguments, id);
+            if ([object respondsToSelector:@selector(copyWithZone:)]) {
+                object = [object copy];
+            }
+            argument->pointer = CFBridgingRetain(object);
+            break;
+        }
+        case SPLogArgumentTypeCString: {
+            const char *string  = va_arg(*arguments, const char *);
+            argument->pointer   = CFBridgingRetain(string ? @(string) : @"(null)");
+            break;
+        }
+    }
+}
+
+static int SPLogRecordCompare(const void *lhs, const void *rhs)
+{
+    CFAbsoluteTime left     = ((const SPLogRecord *)lhs)->timestamp;
+    CFAbsoluteTime right    = ((const SPLogRecord *)rhs)->timestamp;
+    return (left > right) - (left < right);
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPLogBuffer ()
+@property (nonatomic, strong) dispatch_queue_t      queue;
+@property (nonatomic, copy)   SPLogBufferHandler    handler;
+@property (nonatomic, assign) uint64_t              reportedDropCount;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLogBuffer
+#pragma mark ====================================================================================
+
+@implementation SPLogBuffer {
+    pthread_key_t       _ringKey;
+    pthread_mutex_t     _ringsLock;
+    SPLogRing           *_rings;
+    _Atomic(bool)       _drainScheduled;
+    _Atomic(uint64_t)   _droppedCount;
+}
+
+- (void)dealloc
+{
+    pthread_key_delete(_ringKey);
+    
+    SPLogRing *ring = _rings;
+    while (ring) {
+        SPLogRing *next = ring->next;
+        SPLogRingFree(ring);
+        ring = next;
+    }
+    
+    pthread_mutex_destroy(&_ringsLock);
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity queue:(dispatch_queue_t)queue handler:(SPLogBufferHandler)handler
+{
+    NSParameterAssert(capacity > 0);
+    NSParameterAssert(queue);
+    NSParameterAssert(handler);
+    
+    self = [super init];
+    if (self) {
+        // Power of two capacities: slots are picked with a mask
+        NSUInteger roundedCapacity = 1;
+        while (roundedCapacity < capacity) {
+            roundedCapacity <<= 1;
+        }
+    
+        _capacity   = roundedCapacity;
+        _queue      = queue;
+        _handler    = handler;
+    
+        pthread_key_create(&_ringKey, SPLogRingOrphan);
+        pthread_mutex_init(&_ringsLock, NULL);
+        dispatch_queue_set_specific(queue, &SPLogBufferQueueKey, (__bridge void *)self, NULL);
+        atomic_init(&_drainScheduled, false);
+        atomic_init(&_droppedCount, 0);
+    }
+    return self;
+}
+
+- (uint64_t)droppedRecordCount
+{
+    return atomic_load_explicit(&_droppedCount, memory_order_relaxed);
+}
+
+
+#pragma mark - Producer
+
+- (void)appendRecordWithFlag:(SPLogFlags)flag format:(NSString *)format arguments:(va_list)arguments
+{
+    SPLogRing *ring = [self currentRing];
+    uint64_t head   = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail   = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    
+    if (head - tail > ring->mask) {
+        // Warnings and Errors are never dropped: they take the slow path instead
+        if (flag & SPLogBufferCriticalFlags) {
+            [self writeRecordWithFlag:flag format:format arguments:arguments];
+            return;
+        }
+    
+        atomic_fetch_add_explicit(&_droppedCount, 1, memory_order_relaxed);
+        [self scheduleDrainIfNeeded];
+        return;
+    }
+    
+    SPLogRecord *record = &ring->records[head & ring->mask];
+    SPLogFormat *parsed = SPLogRingFormat(ring, format);
+    record->timestamp   = CFAbsoluteTimeGetCurrent();
+    record->flag        = flag;
+    
+    va_list copy;
+    va_copy(copy, arguments);
+    
+    if (parsed.supported) {
+        NSUInteger count                            = parsed.argumentCount;
+        const SPLogArgumentDescriptor *descriptors  = parsed.descriptors;
+    
+        for (NSUInteger i = 0; i < count; ++i) {
+            SPLogReadArgument(&copy, descriptors[i], &record->arguments[i]);
+        }
+        record->format = CFBridgingRetain(parsed);
+    } else {
+        NSString *message           = [[NSString alloc] initWithFormat:format arguments:copy];
+        record->arguments[0].pointer = CFBridgingRetain(message);
+        record->format              = NULL;
+    }
+    
+    va_end(copy);
+    
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    [self scheduleDrainIfNeeded];
+}
+
+// Formats the message right away, drains everything that was logged before it, and hands it over: all of that
+// before returning
+- (void)writeRecordWithFlag:(SPLogFlags)flag format:(NSString *)format arguments:(va_list)arguments
+{
+    va_list copy;
+    va_copy(copy, arguments);
+    NSString *message       = [[NSString alloc] initWithFormat:format arguments:copy];
+    va_end(copy);
+    
+    NSDate *date            = [NSDate date];
+    dispatch_block_t block  = ^{
+        [self drain];
+        self.handler(date, flag, message);
+    };
+    
+    // Loggers may very well log from within the handler
+    if (dispatch_get_specific(&SPLogBufferQueueKey) == (__bridge void *)self) {
+        block();
+    } else {
+        dispatch_sync(self.queue, block);
+    }
+}
+
+- (SPLogRing *)currentRing
+{
+    SPLogRing *ring = pthread_getspecific(_ringKey);
+    if (ring) {
+        return ring;
+    }
+    
+    ring = SPLogRingCreate(_capacity);
+    pthread_setspecific(_ringKey, ring);
+    
+    pthread_mutex_lock(&_ringsLock);
+    ring->next  = _rings;
+    _rings      = ring;
+    pthread_mutex_unlock(&_ringsLock);
+    
+    return ring;
+}
+
+- (void)scheduleDrainIfNeeded
+{
+    if (atomic_load_explicit(&_drainScheduled, memory_order_relaxed)) {
+        return;
+    }
+    
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&_drainScheduled, &expected, true)) {
+        return;
+    }
+    
+    __weak __typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, SPLogBufferDrainDelay), self.queue, ^{
+        [weakSelf drain];
+    });
+}
+
+
+#pragma mark - Consumer
+
+- (void)drain
+{
+    // Reset first: records appended from now on will schedule a brand new drain
+    atomic_store(&_drainScheduled, false);
+    
+    pthread_mutex_lock(&_ringsLock);
+    SPLogRing *rings = _rings;
+    pthread_mutex_unlock(&_ringsLock);
+    
+    // Grab every pending record. Slots are released right away: records now own their arguments
+    NSMutableData *pending  = [NSMutableData data];
+    BOOL hasOrphans         = NO;
+    
+    for (SPLogRing *ring = rings; ring; ring = ring->next) {
+        bool orphaned   = atomic_load_explicit(&ring->orphaned, memory_order_acquire);
+        uint64_t tail   = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head   = atomic_load_explicit(&ring->head, memory_order_acquire);
+    
+        for (uint64_t i = tail; i < head; ++i) {
+            [pending appendBytes:&ring->records[i & ring->mask] length:sizeof(SPLogRecord)];
+        }
+    
+        atomic_store_explicit(&ring->tail, head, memory_order_release);
+        hasOrphans |= orphaned;
+    }
+    
+    // Chronological order, across threads
+    SPLogRecord *records    = pending.mutableBytes;
+    size_t count            = pending.length / sizeof(SPLogRecord);
+    
+    if (count > 1) {
+        mergesort(records, count, sizeof(SPLogRecord), SPLogRecordCompare);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        @autoreleasepool {
+            SPLogRecord *record = &records[i];
+            NSString *message   = record->format ? [(__bridge SPLogFormat *)record->format messageWithArguments:record->arguments]
+                                                 : (__bridge NSString *)record->arguments[0].pointer;
+            NSDate *date        = [NSDate dateWithTimeIntervalSinceReferenceDate:record->timestamp];
+    
+            self.handler(date, record->flag, message);
+            SPLogRecordRelease(record);
+        }
+    }
+    
+    uint64_t droppedCount = self.droppedRecordCount;
+    if (droppedCount != self.reportedDropCount) {
+        NSString *message = [NSString stringWithFormat:@"%@ dropped %llu info / verbose records", NSStringFromClass([self class]), droppedCount - self.reportedDropCount];
+        self.reportedDropCount = droppedCount;
+        self.handler([NSDate date], SPLogFlagsWarn, message);
+    }
+    
+    if (hasOrphans) {
+        [self freeOrphanedRings];
+    }
+}
+
+- (void)freeOrphanedRings
+{
+    pthread_mutex_lock(&_ringsLock);
+    
+    SPLogRing **link = &_rings;
+    while (*link) {
+        SPLogRing *ring = *link;
+        bool orphaned   = atomic_load_explicit(&ring->orphaned, memory_order_acquire);
+        bool empty      = atomic_load_explicit(&ring->head, memory_order_acquire) == atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    
+        if (orphaned && empty) {
+            *link = ring->next;
+            SPLogRingFree(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    
+    pthread_mutex_unlock(&_ringsLock);
+}
+
+@end
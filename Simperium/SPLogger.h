@@ -70,12 +70,17 @@ typedef NS_ENUM(NSInteger, SPLogLevels) {
 @property (nonatomic, weak,   readwrite) id<SPLoggerDelegate>   delegate;
 @property (nonatomic, assign, readwrite) SPLogLevels            sharedLogLevel;
 @property (nonatomic, assign, readwrite) BOOL                   writesToDisk;
+@property (nonatomic, assign, readwrite) BOOL                   writesToConsole;
 @property (nonatomic, assign, readwrite) NSUInteger             maxLogfiles;
 @property (nonatomic, assign, readwrite) unsigned long long     maxLogfileSize;
 @property (nonatomic, strong,  readonly) NSURL                  *logfilesFolderURL;
 
 + (instancetype)sharedInstance;
 
+// Messages are buffered, and formatted asynchronously, as the delegate / disk / console get fed
 - (void)logWithLevel:(SPLogLevels)level flag:(SPLogFlags)flag format:(NSString*)format, ...;
 
+// Synchronously processes every buffered message. Must not be called from the delegate
+- (void)flush;
+
 @end
@@ -7,6 +7,7 @@
 //
 
 #import "SPLogger.h"
+#import "SPLogBuffer.h"
 
 
 
@@ -17,6 +18,9 @@
 static unsigned long long const SPLoggerDefaultMaxFilesize  = (1024 * 1024 * 2);
 static NSUInteger const SPLoggerDefaultMaxLogfiles          = 20;
 static NSString *const SPLoggerDefaultFileExtension         = @"log";
+static NSUInteger const SPLoggerDefaultBufferCapacity       = 1024;
+static NSUInteger const SPLoggerDiskBufferSize              = (1024 * 64);
+static int64_t const SPLoggerDiskFlushInterval              = NSEC_PER_SEC;
 
 
 #pragma mark ====================================================================================
@@ -28,6 +32,14 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
 @property (nonatomic, strong) NSFileHandle          *logfileHandle;
 @property (nonatomic, strong) dispatch_source_t     logfileNode;
 @property (nonatomic, strong) NSDateFormatter       *logDateFormatter;
+@property (nonatomic, strong) SPLogBuffer           *logBuffer;
+@property (nonatomic, strong) NSMutableData         *diskBuffer;
+@property (nonatomic, strong) dispatch_source_t     diskTimer;
+@property (nonatomic, assign) BOOL                  diskTimerSuspended;
+@property (nonatomic, assign) unsigned long long    logfileSize;
+@property (nonatomic, assign) BOOL                  needsLogfilesCleanup;
+@property (nonatomic, assign) long long             cachedDateSecond;
+@property (nonatomic, strong) NSData                *cachedDatePrefix;
 @end
 
 
@@ -38,16 +50,32 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
 @implementation SPLogger
 
 - (void)dealloc {
+    if (_diskTimer) {
+        // Suspended sources must be resumed before they can be cancelled
+        if (_diskTimerSuspended) {
+            dispatch_resume(_diskTimer);
+        }
+        dispatch_source_cancel(_diskTimer);
+    }
     [self closeLogfile];
 }
 
 - (instancetype)init {
     if ((self = [super init])) {
-        self.sharedLogLevel     = SPLogLevelsOff;
-        self.queue              = dispatch_queue_create("com.simperium.SPLogger", NULL);
-        self.maxLogfileSize     = SPLoggerDefaultMaxFilesize;
-        self.maxLogfiles        = SPLoggerDefaultMaxLogfiles;
-        self.writesToDisk       = NO;
+        self.sharedLogLevel         = SPLogLevelsOff;
+        self.queue                  = dispatch_queue_create("com.simperium.SPLogger", NULL);
+        self.maxLogfileSize         = SPLoggerDefaultMaxFilesize;
+        self.maxLogfiles            = SPLoggerDefaultMaxLogfiles;
+        self.writesToDisk           = NO;
+        self.writesToConsole        = YES;
+        self.diskBuffer             = [NSMutableData dataWithCapacity:SPLoggerDiskBufferSize];
+        self.needsLogfilesCleanup   = YES;
+        self.cachedDateSecond       = LLONG_MIN;
+        
+        __weak __typeof(self) weakSelf = self;
+        self.logBuffer              = [[SPLogBuffer alloc] initWithCapacity:SPLoggerDefaultBufferCapacity queue:self.queue handler:^(NSDate *date, SPLogFlags flag, NSString *message) {
+            [weakSelf processLogMessage:message date:date];
+        }];
     }
     return self;
 }
@@ -64,22 +92,32 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
 }
 
 - (void)logWithLevel:(SPLogLevels)level flag:(SPLogFlags)flag format:(NSString*)format, ... {
+    // Just buffer the raw arguments: formatting takes place afterwards, on our own queue
     va_list args;
     va_start(args, format);
-    NSString *message = [[NSString alloc] initWithFormat:format arguments:args];
+    [self.logBuffer appendRecordWithFlag:flag format:format arguments:args];
     va_end(args);
+}
+
+- (void)flush {
+    dispatch_sync(self.queue, ^{
+        [self.logBuffer drain];
+        [self flushDiskBuffer];
+    });
+}
+
+- (void)processLogMessage:(NSString *)message date:(NSDate *)date {
+    if (_delegate) {
+        [_delegate handleLogMessage:message];
+    }
     
-    dispatch_async(self.queue, ^{
-        if (_delegate) {
-            [_delegate handleLogMessage:message];
-        }
-        
-        if (_writesToDisk) {
-            [self writeLogMessage:message];
-        }
-        
+    if (_writesToDisk) {
+        [self writeLogMessage:message date:date];
+    }
+    
+    if (_writesToConsole) {
         NSLog(@"%@", message);
-    });
+    }
 }
 
 
@@ -87,25 +125,107 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
 #pragma mark Writing to Disk!
 #pragma mark ====================================================================================
 
-- (void)writeLogMessage:(NSString *)message {
+- (void)writeLogMessage:(NSString *)message date:(NSDate *)date {
+    
+    // Messages are group-committed: they hit the disk once the buffer is full, or as the timer fires
+    [self appendDatePrefix:date];
+    
+    const char *utf8Message = message.UTF8String ?: "";
+    [self.diskBuffer appendBytes:utf8Message length:strlen(utf8Message)];
+    [self.diskBuffer appendBytes:"\n" length:1];
+    
+    if (self.diskBuffer.length >= SPLoggerDiskBufferSize) {
+        [self flushDiskBuffer];
+    }
+    
+    [self startDiskTimerIfNeeded];
+}
+
+- (void)appendDatePrefix:(NSDate *)date {
     
-    NSString *formattedDate     = [self.logDateFormatter stringFromDate:[NSDate date]];
-    NSString *formattedMessage  = [NSString stringWithFormat:@"[%@] %@\n", formattedDate, message];
-    NSData *logData             = [formattedMessage dataUsingEncoding:NSUTF8StringEncoding];
+    // Dates are formatted once per second: milliseconds get appended by hand
+    NSTimeInterval interval = date.timeIntervalSinceReferenceDate;
+    long long second        = (long long)floor(interval);
+    
+    if (second != self.cachedDateSecond) {
+        NSDate *secondDate      = [NSDate dateWithTimeIntervalSinceReferenceDate:second];
+        NSString *prefix        = [NSString stringWithFormat:@"[%@.", [self.logDateFormatter stringFromDate:secondDate]];
+        self.cachedDatePrefix   = [prefix dataUsingEncoding:NSUTF8StringEncoding];
+        self.cachedDateSecond   = second;
+    }
+    
+    char milliseconds[8];
+    int length = snprintf(milliseconds, sizeof(milliseconds), "%03d] ", (int)((interval - second) * 1000) % 1000);
+    
+    [self.diskBuffer appendData:self.cachedDatePrefix];
+    [self.diskBuffer appendBytes:milliseconds length:length];
+}
+
+- (void)flushDiskBuffer {
+    if (self.diskBuffer.length == 0) {
+        return;
+    }
     
     @try {
-        [self.logfileHandle writeData:logData];
-        [self rotateLogfileIfNeeded];
+        [self.logfileHandle writeData:self.diskBuffer];
+        self.logfileSize += self.diskBuffer.length;
     } @catch (NSException *exception) {
         NSLog(@"Disk Logger Error: %@", exception);
     }
+    
+    self.diskBuffer.length = 0;
+    [self rotateLogfileIfNeeded];
+}
+
+- (void)startDiskTimerIfNeeded {
+    if (_diskTimer) {
+        [self resumeDiskTimerIfNeeded];
+        return;
+    }
+    
+    __weak __typeof(self) weakSelf = self;
+    _diskTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(_diskTimer, dispatch_time(DISPATCH_TIME_NOW, SPLoggerDiskFlushInterval), SPLoggerDiskFlushInterval, SPLoggerDiskFlushInterval / 10);
+    dispatch_source_set_event_handler(_diskTimer, ^{ @autoreleasepool {
+        [weakSelf handleDiskTimer];
+    }});
+    
+    dispatch_resume(_diskTimer);
+}
+
+- (void)resumeDiskTimerIfNeeded {
+    if (!self.diskTimerSuspended) {
+        return;
+    }
+    
+    // Restart the interval: otherwise the missed fire would get delivered right away
+    dispatch_source_set_timer(_diskTimer, dispatch_time(DISPATCH_TIME_NOW, SPLoggerDiskFlushInterval), SPLoggerDiskFlushInterval, SPLoggerDiskFlushInterval / 10);
+    dispatch_resume(_diskTimer);
+    self.diskTimerSuspended = NO;
+}
+
+- (void)handleDiskTimer {
+    // Nothing to write: stop waking up until the next message gets enqueued
+    if (self.diskBuffer.length == 0 && !self.needsLogfilesCleanup) {
+        dispatch_suspend(_diskTimer);
+        self.diskTimerSuspended = YES;
+        return;
+    }
+    
+    [self flushDiskBuffer];
+    
+    // Old logfiles are nuked off the write path
+    if (self.needsLogfilesCleanup) {
+        self.needsLogfilesCleanup = NO;
+        [self nukeOldLogfiles];
+    }
 }
 
 - (NSDateFormatter *)logDateFormatter
 {
     if (!_logDateFormatter) {
         NSDateFormatter *dateFormatter  = [[NSDateFormatter alloc] init];
-        dateFormatter.dateFormat        = @"yyyy-MM-dd HH:mm:ss.sss";
+        dateFormatter.dateFormat        = @"yyyy-MM-dd HH:mm:ss";
         _logDateFormatter               = dateFormatter;
     }
     return _logDateFormatter;
@@ -114,14 +234,11 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
 - (NSFileHandle *)logfileHandle {
     if (!_logfileHandle) {
 
-        // Nuke old logfiles
-        [self nukeOldLogfiles];
-        
-        // Prepare the fileHandle
+        // Prepare the fileHandle: from now on, the logfile size is tracked by hand
         NSURL *logFileURL = [self createLogfileIfNeeded];
         
         _logfileHandle = [NSFileHandle fileHandleForWritingAtPath:logFileURL.path];
-        [_logfileHandle seekToEndOfFile];
+        _logfileSize = [_logfileHandle seekToEndOfFile];
         
         // Listen for Deletions / Rename's
         if (_logfileHandle) {
@@ -238,7 +355,7 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
     }
     
     NSDateFormatter *dateFormatter  = [[NSDateFormatter alloc] init];
-    dateFormatter.dateFormat        = @"yyyyMMdd-HHmmss";
+    dateFormatter.dateFormat        = @"yyyyMMdd-HHmmss-SSS";
     NSString *date                  = [dateFormatter stringFromDate:[NSDate date]];
     
     return [NSString stringWithFormat:@"%@-%@.%@", filename, date, SPLoggerDefaultFileExtension];
@@ -283,9 +400,10 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
         return;
     }
 
-    if (self.logfileHandle.offsetInFile >= _maxLogfileSize) {
+    if (_logfileHandle && _logfileSize >= _maxLogfileSize) {
         NSLog(@"Rotating Logfile!...");
         [self closeLogfile];
+        self.needsLogfilesCleanup = YES;
     }
 }
 
@@ -293,6 +411,8 @@ static NSString *const SPLoggerDefaultFileExtension         = @"log";
     if (!_logfileHandle) {
         return;
     }
+    
+    [self flushDiskBuffer];
 
     if (_logfileNode) {
         dispatch_source_cancel(_logfileNode);
@@ -13,6 +13,7 @@
 #import "SPMember.h"
 #import "Simperium.h"
 #import "SPGhost.h"
+#import "SPGhostStore.h"
 #import "JSONKit+Simperium.h"
 #import "SPLogger.h"
 #import <objc/runtime.h>
@@ -25,6 +26,22 @@
 
 static SPLogLevels logLevel = SPLogLevelsInfo;
 
+// Lazy Loading: Wire values that get persisted as they are (rather than decoded) are wrapped up with this key.
+// Only Transformable attributes handled by the system archivers can hold them: dictionaries round trip just fine
+static NSString * const SPManagedObjectRawValueKey              = @"com.simperium.rawValue";
+static NSString * const SPManagedObjectKeyedArchiveTransformer  = @"NSKeyedUnarchiveFromData";
+static NSString * const SPManagedObjectSecureArchiveTransformer = @"NSSecureUnarchiveFromData";
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPManagedObject ()
+// Lazy Loading: Wire values that haven't been decoded yet, keyed by member name
+@property (nonatomic, strong) NSMutableDictionary *pendingMemberData;
+@end
+
 
 #pragma mark ====================================================================================
 #pragma mark SPManagedObject
@@ -64,11 +81,34 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 
 - (void)awakeFromFetch {
     [super awakeFromFetch];
-    SPGhost *newGhost = [[SPGhost alloc] initFromDictionary: [self.ghostData sp_objectFromJSONString]];
-    self.ghost = newGhost;
     [self configureBucket];
 }
 
+- (SPGhostStore *)ghostStore {
+    NSPersistentStoreCoordinator *persistentStoreCoordinator = self.managedObjectContext.persistentStoreCoordinator;
+    return objc_getAssociatedObject(persistentStoreCoordinator, SPCoreDataGhostStoreKey);
+}
+
+- (SPGhost *)ghost {
+    // Ghosts are only needed for diffing: load them lazily. Newly inserted objects have nothing stored yet
+    if (ghost == nil && !self.isInserted && !self.isDeleted) {
+        ghost = [self loadGhost];
+    }
+    
+    return ghost;
+}
+
+- (SPGhost *)loadGhost {
+    SPGhost *storedGhost = [self.ghostStore ghostForKey:self.simperiumKey bucketName:self.bucket.name];
+    if (storedGhost) {
+        return storedGhost;
+    }
+    
+    // Ghosts used to be stored alongside the object. They'll get moved to the Ghost Store (if any) as soon as the
+    // Change / Index processors update them. Note that writing them back from here might stomp a newer ghost!
+    return [[SPGhost alloc] initFromDictionary: [self.ghostData sp_objectFromJSONString]];
+}
+
 - (void)awakeFromInsert {
     [super awakeFromInsert];
     [self configureBucket];
@@ -83,15 +123,46 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 
 - (void)didTurnIntoFault {
     ghost = nil;
+    self.pendingMemberData = nil;
     [super didTurnIntoFault];
 }
 
+- (void)willAccessValueForKey:(NSString *)key {
+    [super willAccessValueForKey:key];
+    
+    // Note: A nil key means the fault is firing, not that any member is about to be read
+    if (key) {
+        [self materializeMemberForKey:key];
+    }
+}
+
+- (void)willChangeValueForKey:(NSString *)key {
+    // Whatever gets set from now on wins over the wire value that's still pending
+    if (key && self.pendingMemberData.count) {
+        [self.pendingMemberData removeObjectForKey:key];
+    }
+    
+    [super willChangeValueForKey:key];
+}
+
 - (void)willSave {
+    // Lazily loaded members get stored as they are, whenever possible. Deleted objects won't write them at all
+    if (!self.isDeleted) {
+        [self persistPendingMembers];
+    } else {
+        self.pendingMemberData = nil;
+    }
+    
     // When the entity is saved, check to see if its ghost has changed, in which case its data needs to be converted
     // to a string for storage
     if (ghost.needsSave) {
-        // Careful not to use self.ghostData here, which would trigger KVC and cause strange things to happen (since willSave itself is related to Core Data's KVC triggerings). This manifested itself as an erroneous insertion notification being sent to fetchedResultsControllers after an object had been deleted. The underlying cause seemed to be that the deleted object sticks around as a fault, but probably shouldn't.
-        ghostData = [[[ghost dictionary] sp_JSONString] copy];
+        SPGhostStore *ghostStore = self.ghostStore;
+        if (ghostStore && !self.isDeleted) {
+            [ghostStore setGhost:ghost forKey:self.simperiumKey bucketName:self.bucket.name];
+        } else {
+            // Careful not to use self.ghostData here, which would trigger KVC and cause strange things to happen (since willSave itself is related to Core Data's KVC triggerings). This manifested itself as an erroneous insertion notification being sent to fetchedResultsControllers after an object had been deleted. The underlying cause seemed to be that the deleted object sticks around as a fault, but probably shouldn't.
+            ghostData = [[[ghost dictionary] sp_JSONString] copy];
+        }
         ghost.needsSave = NO;
     }
 }
@@ -125,24 +196,98 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
 
 - (void)loadMemberData:(NSDictionary *)memberData {    
     // Copy data for each member from the dictionary
+    SPSchema *schema = bucket.differ.schema;
     for (NSString *memberKey in [memberData allKeys]) {
-        SPMember *member = [bucket.differ.schema memberForKey:memberKey];
+        SPMember *member = [schema memberForKey:memberKey];
         if (member) {
-            id data = [member getValueFromDictionary:memberData key:memberKey object:self];
-            
             // NSManagedObject disables automatic key-value observing (KVO) change notifications for modeled
             // properties, and the primitive accessor methods do not invoke the access and change
             // notification methods. For that reason, we need to manually hit willChange/didChange, so we
             // make sure the fields are marked as updated, internally by CoreData.
-            
-            // This sets the actual instance data
             [self willChangeValueForKey:member.keyName];
-            [self safeSetValue:data forKey:[member keyName]];
+            
+            if (schema.lazyLoadingEnabled && member.lazyLoadingEnabled) {
+                // Lazy Loading: Keep the wire value around, it'll get decoded on first access (Transformables are even persisted raw).
+                // Setting the current primitive value back makes sure Core Data considers the object as updated
+                if (!self.pendingMemberData) {
+                    self.pendingMemberData = [NSMutableDictionary dictionary];
+                }
+                
+                [self.pendingMemberData setObject:memberData[memberKey] forKey:member.keyName];
+                [self setPrimitiveValue:[self primitiveValueForKey:member.keyName] forKey:member.keyName];
+            } else {
+                // This sets the actual instance data
+                id data = [member getValueFromDictionary:memberData key:memberKey object:self];
+                
+                [self.pendingMemberData removeObjectForKey:member.keyName];
+                [self safeSetValue:data forKey:[member keyName]];
+            }
+            
             [self didChangeValueForKey:member.keyName];
         }
     }
 }
 
+- (void)materializeMemberForKey:(NSString *)key {
+    // Note: Remove it first, member conversions might end up accessing this very same key
+    id rawValue = self.pendingMemberData[key];
+    if (rawValue) {
+        [self.pendingMemberData removeObjectForKey:key];
+    } else {
+        rawValue = [self persistedRawValueForKey:key];
+    }
+    
+    if (!rawValue) {
+        return;
+    }
+    
+    // KVO observers were already notified when the member was loaded. Values that were persisted raw stay that way
+    // in the store, until the object gets saved again
+    SPMember *member = [bucket.differ.schema memberForKey:key];
+    id data = [member getValueFromDictionary:@{ key : rawValue } key:key object:self];
+    [self setPrimitiveValue:data forKey:key];
+}
+
+- (void)persistPendingMembers {
+    for (NSString *key in self.pendingMemberData.allKeys) {
+        if (![self canPersistRawValueForKey:key]) {
+            [self materializeMemberForKey:key];
+            continue;
+        }
+        
+        // The store gets the wire value: it'll only be decoded if (and when) the member is read
+        [self setPrimitiveValue:@{ SPManagedObjectRawValueKey : self.pendingMemberData[key] } forKey:key];
+        [self.pendingMemberData removeObjectForKey:key];
+    }
+}
+
+- (BOOL)canPersistRawValueForKey:(NSString *)key {
+    NSAttributeDescription *attribute = self.entity.attributesByName[key];
+    if (attribute.attributeType != NSTransformableAttributeType) {
+        return NO;
+    }
+    
+    // Custom transformers would choke on the wrapped up wire value
+    NSString *transformerName = attribute.valueTransformerName;
+    return transformerName == nil ||
+        [transformerName isEqualToString:SPManagedObjectKeyedArchiveTransformer] ||
+        [transformerName isEqualToString:SPManagedObjectSecureArchiveTransformer];
+}
+
+- (id)persistedRawValueForKey:(NSString *)key {
+    // Note: Raw values may have been persisted in a previous session, even if Lazy Loading is now disabled
+    if (![self canPersistRawValueForKey:key]) {
+        return nil;
+    }
+    
+    NSDictionary *value = [self primitiveValueForKey:key];
+    if (![value isKindOfClass:[NSDictionary class]] || value.count != 1) {
+        return nil;
+    }
+    
+    return value[SPManagedObjectRawValueKey];
+}
+
 - (void)willBeRead {
     // Bit of a hack to force fire the fault
     if ([self isFault]) {
@@ -156,7 +301,17 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     
     NSMutableDictionary *dict = [NSMutableDictionary dictionary];
     
+    // Raw values are read straight from the primitives: make sure they're there
+    [self willBeRead];
+    
     for (SPMember *member in [bucket.differ.schema.members allValues]) {
+        // Lazily loaded members are still in their JSON-compatible wire format: no need to decode them
+        id rawValue = self.pendingMemberData[member.keyName] ?: [self persistedRawValueForKey:member.keyName];
+        if (rawValue) {
+            dict[member.keyName] = rawValue;
+            continue;
+        }
+        
         id data = [self valueForKey:[member keyName]];
         
         // The setValue:forKey:inDictionary: method can perform conversions to JSON-compatible formats
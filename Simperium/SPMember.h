@@ -10,6 +10,8 @@
 #import "SPDiffable.h"
 
 @class SPManagedObject;
+@class SPGhost;
+@class DiffMatchPatch;
 
 extern NSString * const OP_OP;
 extern NSString * const OP_VALUE;
@@ -24,17 +26,25 @@ extern NSString * const OP_LIST;
 extern NSString * const OP_LIST_DMP;
 extern NSString * const OP_OBJECT;
 extern NSString * const OP_STRING;
+extern NSString * const OP_BINARY_DELTA;
 
 @interface SPMember : NSObject {
     NSString *keyName;
     NSString *type;
     NSString *valueTransformerName;
     id modelDefaultValue;
+    NSTimeInterval diffBudget;
+    BOOL lazyLoadingEnabled;
 }
 
 @property (nonatomic, readonly, strong) NSString *keyName;
 @property (nonatomic, readonly, strong) NSString *valueTransformerName;
 @property (nonatomic, readonly, strong) id modelDefaultValue;
+@property (nonatomic, readonly, assign) NSTimeInterval diffBudget;
+@property (nonatomic, readonly, assign) BOOL lazyLoadingEnabled;
+
+// Thread local: members are shared by every object in the bucket, and diffing may happen on several threads at once
+@property (nonatomic, readonly, strong) DiffMatchPatch *diffMatchPatch;
 
 - (instancetype)initFromDictionary:(NSDictionary *)dict;
 - (id)defaultValue;
@@ -44,7 +54,11 @@ extern NSString * const OP_STRING;
 - (id)getValueFromDictionary:(NSDictionary *)dict key:(NSString *)key object:(id<SPDiffable>)object;
 - (void)setValue:(id)value forKey:(NSString *)key inDictionary:(NSMutableDictionary *)dict;
 - (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue;
+- (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue ghost:(SPGhost *)ghost;
+- (BOOL)supportsIncrementalDiffFromEncodedValue:(id)encodedValue;
 - (id)applyDiff:(id)thisValue otherValue:(id)otherValue error:(NSError **)error;
+- (id)applyDiff:(id)thisValue otherValue:(id)otherValue encodedValue:(id)encodedValue error:(NSError **)error;
 - (NSDictionary *)transform:(id)thisValue otherValue:(id)otherValue oldValue:(id)oldValue error:(NSError **)error;
+- (NSDictionary *)transformChange:(NSDictionary *)change otherChange:(NSDictionary *)otherChange oldValue:(id)oldValue object:(id<SPDiffable>)object error:(NSError **)error;
 
 @end
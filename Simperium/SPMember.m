@@ -9,11 +9,15 @@
 #import "Simperium.h"
 #import "SPMember.h"
 #import "JSONKit+Simperium.h"
+#import "DiffMatchPatch+Simperium.h"
+#import "SPDiffBudget.h"
 
 @implementation SPMember
 @synthesize keyName;
 @synthesize valueTransformerName;
 @synthesize modelDefaultValue;
+@synthesize diffBudget;
+@synthesize lazyLoadingEnabled;
 
 // Operations used for diff and transform
 NSString * const OP_OP              = @"o";
@@ -29,6 +33,7 @@ NSString * const OP_LIST            = @"L";
 NSString * const OP_LIST_DMP        = @"dL";
 NSString * const OP_OBJECT          = @"O";
 NSString * const OP_STRING          = @"d";
+NSString * const OP_BINARY_DELTA    = @"dB";
 
 - (instancetype)initFromDictionary:(NSDictionary *)dict
 {
@@ -38,11 +43,17 @@ NSString * const OP_STRING          = @"d";
         type = [[dict objectForKey:@"type"] copy];
         valueTransformerName = [[dict objectForKey:@"valueTransformerName"] copy];
         modelDefaultValue = [[dict objectForKey:@"defaultValue"] copy];
+        diffBudget = [dict objectForKey:@"diffBudget"] ? [[dict objectForKey:@"diffBudget"] doubleValue] : SPDiffBudgetDefaultMemberTimeInterval;
+        lazyLoadingEnabled = [dict objectForKey:@"lazy"] ? [[dict objectForKey:@"lazy"] boolValue] : YES;
     }
     
     return self;
 }
 
+- (DiffMatchPatch *)diffMatchPatch {
+    return [DiffMatchPatch sp_threadLocalInstance];
+}
+
 - (NSString *)description {
     return [NSString stringWithFormat:@"%@ of type %@", keyName, type];
 }
@@ -91,16 +102,39 @@ NSString * const OP_STRING          = @"d";
     return nil;
 }
 
+- (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue ghost:(SPGhost *)ghost {
+    // By default, the ghost (whose member data holds thisValue) isn't needed
+    return [self diff:thisValue otherValue:otherValue];
+}
+
+- (BOOL)supportsIncrementalDiffFromEncodedValue:(id)encodedValue {
+    // By default, any diff can be applied over the encoded (ghost) value
+    return YES;
+}
+
 - (id)applyDiff:(id)thisValue otherValue:(id)otherValue error:(NSError **)error {
     return otherValue;
 }
 
+- (id)applyDiff:(id)thisValue otherValue:(id)otherValue encodedValue:(id)encodedValue error:(NSError **)error {
+    // By default, the encoded (ghost) value isn't needed: the converted one will do
+    return [self applyDiff:thisValue otherValue:otherValue error:error];
+}
+
 
 - (NSDictionary *)transform:(id)thisValue otherValue:(id)otherValue oldValue:(id)oldValue error:(NSError **)error {
     // By default, don't perform any transformation
     return nil;
 }
 
+- (NSDictionary *)transformChange:(NSDictionary *)change otherChange:(NSDictionary *)otherChange oldValue:(id)oldValue object:(id<SPDiffable>)object error:(NSError **)error {
+    // By default, members only need the values carried by both changes
+    id thisValue    = [self getValueFromDictionary:change key:OP_VALUE object:object];
+    id otherValue   = [self getValueFromDictionary:otherChange key:OP_VALUE object:object];
+    
+    return [self transform:thisValue otherValue:otherValue oldValue:oldValue error:error];
+}
+
 @end
 
 
@@ -10,4 +10,8 @@
 
 @interface SPMemberBase64 : SPMember
 
+// Opt-in: Send chunked OP_BINARY_DELTA operations over the decoded bytes, rather than full replacements.
+// Every client syncing this bucket must understand binary deltas.
+@property (nonatomic, assign, readonly) BOOL binaryDeltaEnabled;
+
 @end
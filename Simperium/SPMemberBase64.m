@@ -9,25 +9,172 @@
 #import "SPMemberBase64.h"
 #import "NSData+Simperium.h"
 #import "NSString+Simperium.h"
+#import "NSError+Simperium.h"
+#import "SPGhost.h"
+#import <objc/runtime.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+// Smaller blobs are cheap enough to re-encode. This also keeps us away from tagged pointers, which don't
+// support associated objects
+static NSUInteger const SPMemberBase64MinimumCachedLength   = 4096;
+static char const SPMemberBase64CacheKey;
+
+// Binary Deltas: Only worth it for large blobs, and as long as the delta is substantially smaller than the blob
+static NSUInteger const SPMemberBase64MinimumDeltaLength    = 64 * 1024;
+static double const SPMemberBase64MaximumDeltaRatio         = 0.5;
+static NSInteger const SPMemberBase64InvalidDeltaError      = -9999;
+
+// Ghost Metadata: Chunk Signatures for the ghost's value, along with the digest of the data they were built for
+static NSString * const SPMemberBase64DigestKey             = @"digest";
+static NSString * const SPMemberBase64SignaturesKey         = @"chunks";
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberBase64Cache
+#pragma mark ====================================================================================
+
+// Attached to binary values (holding their base64 representation), and to base64 strings (pointing back to
+// their decoded value). Since Core Data hands us a brand new instance whenever a Transformable attribute is set,
+// the cache is effectively invalidated on set
+@interface SPMemberBase64Cache : NSObject
+@property (nonatomic, copy,   readonly) NSString    *valueTransformerName;
+@property (nonatomic, copy,   readonly) NSString    *encoded;
+@property (nonatomic, weak,   readonly) id          decoded;
+@property (nonatomic, strong, readonly) NSData      *digest;
+@end
+
+@implementation SPMemberBase64Cache
+
+- (instancetype)initWithEncoded:(NSString *)encoded decoded:(id)decoded digest:(NSData *)digest valueTransformerName:(NSString *)valueTransformerName
+{
+    self = [super init];
+    if (self) {
+        _encoded                = [encoded copy];
+        _decoded                = decoded;
+        _digest                 = digest;
+        _valueTransformerName   = [valueTransformerName copy];
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberBase64Delta
+#pragma mark ====================================================================================
+
+// Wraps an OP_BINARY_DELTA, so that it can't be mistaken for an archived NSString value
+@interface SPMemberBase64Delta : NSObject
+@property (nonatomic, copy, readonly) NSString *delta;
+@end
+
+@implementation SPMemberBase64Delta
+
+- (instancetype)initWithDelta:(NSString *)delta
+{
+    self = [super init];
+    if (self) {
+        _delta = [delta copy];
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberBase64
+#pragma mark ====================================================================================
 
 @implementation SPMemberBase64
 
+- (instancetype)initFromDictionary:(NSDictionary *)dict
+{
+    self = [super initFromDictionary:dict];
+    if (self) {
+        _binaryDeltaEnabled = [dict[@"binaryDelta"] boolValue];
+    }
+    return self;
+}
+
 - (id)defaultValue {
     return nil;
 }
 
+- (SPMemberBase64Cache *)cacheForObject:(id)object {
+    if (object == nil) {
+        return nil;
+    }
+    
+    // Transformers are set per member: a cache built by a different member is of no use
+    SPMemberBase64Cache *cache = objc_getAssociatedObject(object, &SPMemberBase64CacheKey);
+    BOOL isSameTransformer = (cache.valueTransformerName == self.valueTransformerName) || [cache.valueTransformerName isEqualToString:self.valueTransformerName];
+    
+    return isSameTransformer ? cache : nil;
+}
+
+// Mutable values could be edited in place: their cached encoding (and digest) would go stale. Note that bridged
+// classes (__NSCFString, __NSCFData) are kinds of their mutable counterparts, even when immutable: we rely on
+// immutable instances returning themselves on copy instead
+- (BOOL)isCacheableValue:(id)value {
+    if (![value conformsToProtocol:@protocol(NSMutableCopying)] || ![value conformsToProtocol:@protocol(NSCopying)]) {
+        return YES;
+    }
+    
+    return [value copy] == value;
+}
+
+// Cache hits hand over a brand new instance, carrying the very same cache: the object and its ghost never share
+// their values. Classes without a mutable counterpart (UIImage) are immutable, and can be shared
+- (id)copyOfCachedValue:(id)value {
+    if (![value conformsToProtocol:@protocol(NSMutableCopying)]) {
+        return value;
+    }
+    
+    id copied = [[value mutableCopy] copy];
+    objc_setAssociatedObject(copied, &SPMemberBase64CacheKey, objc_getAssociatedObject(value, &SPMemberBase64CacheKey), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    return copied;
+}
+
+- (void)cacheValue:(id)value encoded:(NSString *)encoded data:(NSData *)data {
+    if (value == nil || encoded.length < SPMemberBase64MinimumCachedLength || ![self isCacheableValue:value]) {
+        return;
+    }
+    
+    // Note: The string's cache can't hold the string itself, or we'd end up with a retain cycle
+    NSData *digest                   = [data sp_sha256Digest];
+    SPMemberBase64Cache *valueCache  = [[SPMemberBase64Cache alloc] initWithEncoded:encoded decoded:nil digest:digest valueTransformerName:self.valueTransformerName];
+    SPMemberBase64Cache *stringCache = [[SPMemberBase64Cache alloc] initWithEncoded:nil decoded:value digest:digest valueTransformerName:self.valueTransformerName];
+    
+    objc_setAssociatedObject(value, &SPMemberBase64CacheKey, valueCache, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(encoded, &SPMemberBase64CacheKey, stringCache, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
 - (NSString *)stringValueFromTransformable:(id)value {
     if (value == nil) {
         return @"";
     }
     
+    NSString *encoded = [self cacheForObject:value].encoded;
+    if (encoded) {
+        return encoded;
+    }
+    
     // Convert from a Transformable class to a base64 string
     NSData *data = (self.valueTransformerName ?
                     [[NSValueTransformer valueTransformerForName:self.valueTransformerName] transformedValue:value] :
                     [NSKeyedArchiver archivedDataWithRootObject:value]);
     
     NSString *base64 = [NSString sp_encodeBase64WithData:data];
-
+    [self cacheValue:value encoded:base64 data:data];
+    
     return base64;
 }
 
@@ -37,6 +184,17 @@
         return value;
     }
     
+    // Binary Deltas are applied over the ghost's data: don't decode them
+    if ([key isEqualToString:OP_VALUE] && [dict[OP_OP] isEqualToString:OP_BINARY_DELTA]) {
+        return [[SPMemberBase64Delta alloc] initWithDelta:value];
+    }
+    
+    // Ghosts keep their base64 strings around: skip the decoding if we've done it already
+    id decoded = [self cacheForObject:value].decoded;
+    if (decoded) {
+        return [self copyOfCachedValue:decoded];
+    }
+    
     // Convert from NSString (base64) to NSData
     NSData *data = [NSData sp_decodeBase64WithString:value];
     
@@ -58,6 +216,8 @@
         return nil;
     }
     
+    [self cacheValue:obj encoded:value data:data];
+    
     return obj;
 }
 
@@ -67,29 +227,139 @@
 }
 
 - (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue {
+    return [self diff:thisValue otherValue:otherValue ghost:nil];
+}
+
+- (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue ghost:(SPGhost *)ghost {
+    
+    if (thisValue == otherValue) {
+        return @{ };
+    }
     
-    if ([thisValue isEqual:otherValue]) {
+    // Cached Digests: Unchanged blobs can be compared in O(1)
+    NSData *thisDigest  = [self cacheForObject:thisValue].digest;
+    NSData *otherDigest = [self cacheForObject:otherValue].digest;
+    
+    BOOL hasDigests     = thisDigest && otherDigest;
+    
+    if (hasDigests && [thisDigest isEqualToData:otherDigest]) {
+        return @{ };
+    }
+    
+    if (!hasDigests && [thisValue isEqual:otherValue]) {
         return @{ };
     }
     
     // Some binary data, like UIImages, won't detect equality with isEqual:
-    // Therefore, compare base64 instead; this can be very slow
-    // TODO: think of better ways to handle this
+    // Therefore, compare base64 instead; this can be very slow, but the encodings (and digests) get cached
     NSString *thisStr   = [self stringValueFromTransformable:thisValue];
     NSString *otherStr  = [self stringValueFromTransformable:otherValue];
-    if ([thisStr compare:otherStr] == NSOrderedSame) {
+    if (!hasDigests && [thisStr compare:otherStr] == NSOrderedSame) {
         return @{ };
     }
     
+    // Large blobs: attempt to send just the chunks that changed
+    NSString *delta = [self binaryDeltaFromString:thisStr digest:thisDigest toString:otherStr ghost:ghost];
+    if (delta) {
+        return @{
+            OP_OP       : OP_BINARY_DELTA,
+            OP_VALUE    : delta
+        };
+    }
+    
     // Construct the diff in the expected format
     return [NSDictionary dictionaryWithObjectsAndKeys:
             OP_REPLACE, OP_OP,
-            [self stringValueFromTransformable:otherValue], OP_VALUE, nil];
+            otherStr, OP_VALUE, nil];
+}
+
+// Chunks are defined over the decoded bytes, rather than the base64 text: insertions that aren't a multiple of 3 bytes
+// long would otherwise shift every single character that follows them
+- (NSString *)binaryDeltaFromString:(NSString *)thisStr digest:(NSData *)thisDigest toString:(NSString *)otherStr ghost:(SPGhost *)ghost {
+    if (!self.binaryDeltaEnabled || otherStr.length < SPMemberBase64MinimumDeltaLength || thisStr.length < SPMemberBase64MinimumDeltaLength) {
+        return nil;
+    }
+    
+    NSData *thisData    = [NSData sp_decodeBase64WithString:thisStr];
+    NSData *otherData   = [NSData sp_decodeBase64WithString:otherStr];
+    NSData *signatures  = [self chunkSignaturesForData:thisData digest:thisDigest ghost:ghost];
+    NSString *delta     = [otherData sp_binaryDeltaFromData:thisData signatures:signatures];
+    
+    return (delta.length < otherStr.length * SPMemberBase64MaximumDeltaRatio) ? delta : nil;
+}
+
+// Signatures for the ghost's value are kept in the ghost's metadata: the next diff against it won't need to chunk it
+// again, not even after a relaunch
+- (NSData *)chunkSignaturesForData:(NSData *)data digest:(NSData *)digest ghost:(SPGhost *)ghost {
+    if (ghost == nil) {
+        return [data sp_chunkSignatures];
+    }
+    
+    NSDictionary *metadata  = ghost.metadata[self.keyName];
+    NSString *digestStr     = [NSString sp_encodeBase64WithData:digest ?: [data sp_sha256Digest]];
+    
+    if ([metadata isKindOfClass:[NSDictionary class]] && [metadata[SPMemberBase64DigestKey] isEqual:digestStr]) {
+        return [NSData sp_decodeBase64WithString:metadata[SPMemberBase64SignaturesKey]];
+    }
+    
+    NSData *signatures              = [data sp_chunkSignatures];
+    NSMutableDictionary *updated    = [NSMutableDictionary dictionaryWithDictionary:ghost.metadata];
+    updated[self.keyName]           = @{
+        SPMemberBase64DigestKey     : digestStr,
+        SPMemberBase64SignaturesKey : [NSString sp_encodeBase64WithData:signatures]
+    };
+    ghost.metadata                  = updated;
+    
+    return signatures;
 }
 
 - (id)applyDiff:(id)thisValue otherValue:(id)otherValue error:(NSError **)error {
+    return [self applyDiff:thisValue otherValue:otherValue encodedValue:nil error:error];
+}
+
+- (id)applyDiff:(id)thisValue otherValue:(id)otherValue encodedValue:(id)encodedValue error:(NSError **)error {
+    
+    if (![otherValue isKindOfClass:[SPMemberBase64Delta class]]) {
+        return otherValue;
+    }
+    
+    // Binary Delta: Apply the delta over the data it was built against. Whenever available, that's the one stored
+    // in the ghost: re-encoding the value isn't guaranteed to produce the very same bytes
+    NSString *thisStr   = [encodedValue isKindOfClass:[NSString class]] ? encodedValue : [self stringValueFromTransformable:thisValue];
+    NSData *thisData    = [NSData sp_decodeBase64WithString:thisStr];
+    NSData *newData     = [thisData sp_dataByApplyingBinaryDelta:[otherValue delta]];
+    id newValue         = nil;
+    
+    if (newData.length) {
+        newValue = [self getValueFromDictionary:@{ OP_VALUE : [NSString sp_encodeBase64WithData:newData] } key:OP_VALUE object:nil];
+    }
+    
+    if (!newValue && error) {
+        *error = [NSError sp_errorWithDomain:NSStringFromClass([self class])
+                                        code:SPMemberBase64InvalidDeltaError
+                                 description:@"Binary delta couldn't be applied"];
+    }
+    
+    return newValue;
+}
+
+- (NSDictionary *)transform:(id)thisValue otherValue:(id)otherValue oldValue:(id)oldValue error:(NSError **)error {
+    
+    if (![thisValue isKindOfClass:[SPMemberBase64Delta class]]) {
+        return nil;
+    }
+    
+    // Local Binary Deltas were built against the old ghost: Rebase by sending the full local value instead
+    NSError *theError   = nil;
+    id localValue       = [self applyDiff:oldValue otherValue:thisValue error:&theError];
+    if (theError) {
+        if (error) {
+            *error = theError;
+        }
+        return nil;
+    }
     
-    return otherValue;
+    return [self diffForReplacement:localValue];
 }
 
 @end
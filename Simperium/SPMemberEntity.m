@@ -39,6 +39,11 @@ static SPLogLevels logLevel = SPLogLevelsWarn;
     return nil;
 }
 
+- (BOOL)lazyLoadingEnabled {
+    // Relationships get resolved as soon as they're loaded
+    return NO;
+}
+
 - (id)simperiumKeyForObject:(id)value {
     NSString *simperiumKey = [value simperiumKey];
     return simperiumKey == nil ? @"" : simperiumKey;
@@ -12,6 +12,16 @@
 #import "JSONKit+Simperium.h"
 
 
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+// Beyond these limits, a structural diff isn't worth it: we'll just send the full replacement
+static NSInteger const SPMemberJSONMaxDiffDepth         = 16;
+static NSInteger const SPMemberJSONMaxDiffOperations    = 512;
+
+
 /**
     Support for JSON entities stored in CoreData fields. In order to map this helper, you'll need to:
     -   Toggle your CoreData attribute as Transformable
@@ -68,29 +78,211 @@
 }
 
 - (void)setValue:(id)value forKey:(NSString *)key inDictionary:(NSMutableDictionary *)dict {
-    // Let's archive objects before they can be safely stored in CoreData
+    // JSON Dictionaries are stored natively, so that they can be diffed structurally.
+    // Anything else gets archived before it can be safely stored in CoreData
+    if ([self isNativeJSONValue:value]) {
+        dict[key] = value;
+        return;
+    }
+    
     dict[key] = [self stringValueFromTransformable:value];
 }
 
+// Members with a custom Value Transformer always get their values archived through it
+- (BOOL)isNativeJSONValue:(id)value {
+    return self.valueTransformerName == nil && [value isKindOfClass:[NSDictionary class]] && [NSJSONSerialization isValidJSONObject:value];
+}
+
+- (BOOL)supportsIncrementalDiffFromEncodedValue:(id)encodedValue {
+    // Archived values are opaque strings on the backend: structural diffs can't be applied to them
+    return [encodedValue isKindOfClass:[NSDictionary class]];
+}
+
 - (NSDictionary *)diff:(id)thisValue otherValue:(id)otherValue {
     
-    if ([thisValue isEqual: otherValue]) {
+    if (thisValue == otherValue) {
         return @{ };
     }
     
-    NSString *thisStr  = [self stringValueFromTransformable:thisValue];
-    NSString *otherStr = [self stringValueFromTransformable:otherValue];
-    if ([thisStr compare:otherStr] == NSOrderedSame) {
-        return @{ };
+    // JSON Dictionaries: Attempt to build a nested OP_OBJECT diff
+    if ([self isNativeJSONValue:thisValue] && [self isNativeJSONValue:otherValue]) {
+        NSInteger operationCount    = 0;
+        NSDictionary *objectDiff    = [self diffFromDictionary:thisValue toDictionary:otherValue depth:0 operationCount:&operationCount];
+        
+        if (objectDiff.count == 0 && objectDiff != nil) {
+            return @{ };
+        }
+        
+        if (objectDiff != nil) {
+            return @{
+                OP_OP       : OP_OBJECT,
+                OP_VALUE    : objectDiff
+            };
+        }
+    } else {
+        if ([thisValue isEqual:otherValue]) {
+            return @{ };
+        }
+        
+        NSString *thisStr  = [self stringValueFromTransformable:thisValue];
+        NSString *otherStr = [self stringValueFromTransformable:otherValue];
+        if ([thisStr compare:otherStr] == NSOrderedSame) {
+            return @{ };
+        }
     }
     
     // Construct the diff in the expected format
+    NSMutableDictionary *diff = [NSMutableDictionary dictionaryWithObject:OP_REPLACE forKey:OP_OP];
+    [self setValue:otherValue forKey:OP_VALUE inDictionary:diff];
+    
+    return diff;
+}
+
+// Returns the set of +, -, r and O operations required to go from thisDict to otherDict, or nil whenever
+// the depth or operation limits are exceeded (in which case the caller should fallback to OP_REPLACE)
+- (NSDictionary *)diffFromDictionary:(NSDictionary *)thisDict
+                        toDictionary:(NSDictionary *)otherDict
+                               depth:(NSInteger)depth
+                      operationCount:(NSInteger *)operationCount
+{
+    if (depth > SPMemberJSONMaxDiffDepth) {
+        return nil;
+    }
+    
+    NSMutableDictionary *diff = [NSMutableDictionary dictionary];
+    
+    // Removed Keys
+    for (NSString *key in thisDict) {
+        if (otherDict[key] == nil) {
+            diff[key] = @{ OP_OP : OP_OBJECT_REMOVE };
+        }
+    }
+    
+    // Added + Updated Keys
+    for (NSString *key in otherDict) {
+        id thisValue    = thisDict[key];
+        id otherValue   = otherDict[key];
+        
+        if (thisValue == otherValue) {
+            continue;
+        }
+        
+        if (thisValue == nil) {
+            diff[key] = @{ OP_OP : OP_OBJECT_ADD, OP_VALUE : otherValue };
+            continue;
+        }
+        
+        BOOL isThisDictionary   = [thisValue isKindOfClass:[NSDictionary class]];
+        BOOL isOtherDictionary  = [otherValue isKindOfClass:[NSDictionary class]];
+        
+        if (isThisDictionary && isOtherDictionary) {
+            NSDictionary *nestedDiff = [self diffFromDictionary:thisValue toDictionary:otherValue depth:depth + 1 operationCount:operationCount];
+            if (nestedDiff) {
+                if (nestedDiff.count) {
+                    diff[key] = @{ OP_OP : OP_OBJECT, OP_VALUE : nestedDiff };
+                }
+                continue;
+            }
+            
+            // Too deep: replace the whole subtree, unless we've run out of budget altogether
+            if (*operationCount > SPMemberJSONMaxDiffOperations) {
+                return nil;
+            }
+            
+        // Leaf values: different hashes are different values. Note that NSDictionary / NSArray hashes are just
+        // their count, so we still need to fallback to isEqual
+        } else if ([thisValue hash] == [otherValue hash] && [thisValue isEqual:otherValue]) {
+            continue;
+        }
+        
+        diff[key] = @{ OP_OP : OP_OBJECT_REPLACE, OP_VALUE : otherValue };
+    }
+    
+    *operationCount += diff.count;
+    
+    return (*operationCount > SPMemberJSONMaxDiffOperations) ? nil : diff;
+}
+
+- (NSDictionary *)transformChange:(NSDictionary *)change
+                      otherChange:(NSDictionary *)otherChange
+                         oldValue:(id)oldValue
+                           object:(id<SPDiffable>)object
+                            error:(NSError **)error
+{
+    // Concurrent OP_OBJECT edits: rebase the local operations over the remote ones, key by key
+    BOOL isLocalObjectDiff  = [change[OP_OP] isEqualToString:OP_OBJECT] && [change[OP_VALUE] isKindOfClass:[NSDictionary class]];
+    BOOL isRemoteObjectDiff = [otherChange[OP_OP] isEqualToString:OP_OBJECT] && [otherChange[OP_VALUE] isKindOfClass:[NSDictionary class]];
+    
+    if (!isLocalObjectDiff || !isRemoteObjectDiff) {
+        return [super transformChange:change otherChange:otherChange oldValue:oldValue object:object error:error];
+    }
+    
+    NSDictionary *ghostDict = [oldValue isKindOfClass:[NSDictionary class]] ? oldValue : @{ };
+    
     return @{
-        OP_OP       : OP_REPLACE,
-        OP_VALUE    : [self stringValueFromTransformable: otherValue]
+        OP_OP       : OP_OBJECT,
+        OP_VALUE    : [self transformObjectDiff:change[OP_VALUE] otherObjectDiff:otherChange[OP_VALUE] oldDictionary:ghostDict]
     };
 }
 
+// Returns the local operations, rewritten so that they can be applied over the remote ones. Whenever both sides
+// touched the same key, the local edit wins. Ref.: jsondiff's transform_object_diff
+- (NSDictionary *)transformObjectDiff:(NSDictionary *)thisDiff
+                      otherObjectDiff:(NSDictionary *)otherDiff
+                        oldDictionary:(NSDictionary *)oldDict
+{
+    NSMutableDictionary *transformed = [thisDiff mutableCopy];
+    
+    for (NSString *key in thisDiff) {
+        NSDictionary *thisOp    = thisDiff[key];
+        NSDictionary *otherOp   = otherDiff[key];
+        
+        if (otherOp == nil) {
+            continue;
+        }
+        
+        NSString *thisOpType    = thisOp[OP_OP];
+        NSString *otherOpType   = otherOp[OP_OP];
+        id thisValue            = thisOp[OP_VALUE];
+        id otherValue           = otherOp[OP_VALUE];
+        
+        // Both sides removed, or set, the very same thing: nothing left to do
+        BOOL isSameOperation    = [thisOpType isEqualToString:otherOpType] && (thisValue == otherValue || [thisValue isEqual:otherValue]);
+        if (isSameOperation && ![thisOpType isEqualToString:OP_OBJECT]) {
+            [transformed removeObjectForKey:key];
+            continue;
+        }
+        
+        // Both sides edited the same nested dictionary
+        if ([thisOpType isEqualToString:OP_OBJECT] && [otherOpType isEqualToString:OP_OBJECT]) {
+            NSDictionary *nestedOld = [oldDict[key] isKindOfClass:[NSDictionary class]] ? oldDict[key] : @{ };
+            NSDictionary *nested    = [self transformObjectDiff:thisValue otherObjectDiff:otherValue oldDictionary:nestedOld];
+            
+            if (nested.count) {
+                transformed[key] = @{ OP_OP : OP_OBJECT, OP_VALUE : nested };
+            } else {
+                [transformed removeObjectForKey:key];
+            }
+            continue;
+        }
+        
+        // The remote side removed or replaced a dictionary we've edited: set the locally edited value instead
+        if ([thisOpType isEqualToString:OP_OBJECT] && [oldDict[key] isKindOfClass:[NSDictionary class]]) {
+            id localValue       = [self applyDiff:thisValue onDictionary:oldDict[key]];
+            NSString *opType    = [otherOpType isEqualToString:OP_OBJECT_REMOVE] ? OP_OBJECT_ADD : OP_OBJECT_REPLACE;
+            transformed[key]    = @{ OP_OP : opType, OP_VALUE : localValue };
+            continue;
+        }
+        
+        // Both sides added the same key, with different values: the local value replaces the remote one
+        if ([thisOpType isEqualToString:OP_OBJECT_ADD] && [otherOpType isEqualToString:OP_OBJECT_ADD]) {
+            transformed[key]    = @{ OP_OP : OP_OBJECT_REPLACE, OP_VALUE : thisValue };
+        }
+    }
+    
+    return transformed;
+}
+
 - (id)applyDiff:(id)thisValue otherValue:(id)otherValue error:(NSError **)error {
     
     // Dictionary: Handle +, -, r, O
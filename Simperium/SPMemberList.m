@@ -10,6 +10,7 @@
 #import "JSONKit+Simperium.h"
 #import "DiffMatchPatch.h"
 #import "NSArray+Simperium.h"
+#import "SPDiffBudget.h"
 #import "SPLogger.h"
 
 
@@ -21,29 +22,11 @@
 static SPLogLevels logLevel = SPLogLevelsInfo;
 
 
-#pragma mark ====================================================================================
-#pragma mark Private
-#pragma mark ====================================================================================
-
-@interface SPMemberList ()
-@property (nonatomic, strong, readonly) DiffMatchPatch *diffMatchPatch;
-@end
-
-
 #pragma mark ====================================================================================
 #pragma mark SPMemberList
 #pragma mark ====================================================================================
 
 @implementation SPMemberList
-@synthesize diffMatchPatch = _diffMatchPatch;
-
-- (DiffMatchPatch *)diffMatchPatch
-{
-    if (!_diffMatchPatch) {
-        _diffMatchPatch = [[DiffMatchPatch alloc] init];
-    }
-    return _diffMatchPatch;
-}
 
 - (id)defaultValue {
     return @"[]";
@@ -88,7 +71,13 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     }
     
     // For the moment we can only create OP_LIST_DMP
-    return @{ OP_OP: OP_LIST_DMP, OP_VALUE: [a sp_diffDeltaWithArray:b diffMatchPatch:self.diffMatchPatch] };
+    NSTimeInterval budget       = [SPDiffBudget timeIntervalForMemberBudget:self.diffBudget];
+    NSTimeInterval startTime    = [NSDate timeIntervalSinceReferenceDate];
+    NSString *delta             = [a sp_diffDeltaWithArray:b diffMatchPatch:self.diffMatchPatch budget:budget];
+    
+    [SPDiffBudget recordDiffForMember:self.keyName budget:budget elapsed:[NSDate timeIntervalSinceReferenceDate] - startTime escalated:NO];
+    
+    return @{ OP_OP: OP_LIST_DMP, OP_VALUE: delta };
 }
 
 - (id)applyDiff:(id)thisValue otherValue:(id)otherValue error:(NSError **)error {
@@ -107,7 +96,9 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     NSString *delta1 = thisValue;
     NSString *delta2 = otherValue;
     
-    return @{ OP_OP: OP_LIST_DMP, OP_VALUE: [source sp_transformDelta:delta1 onto:delta2 diffMatchPatch:self.diffMatchPatch] };
+    NSTimeInterval budget = [SPDiffBudget timeIntervalForMemberBudget:self.diffBudget];
+    
+    return @{ OP_OP: OP_LIST_DMP, OP_VALUE: [source sp_transformDelta:delta1 onto:delta2 diffMatchPatch:self.diffMatchPatch budget:budget] };
 }
 
 @end
@@ -9,6 +9,7 @@
 #import "SPMemberText.h"
 #import "DiffMatchPatch.h"
 #import "DiffMatchPatch+Simperium.h"
+#import "SPDiffBudget.h"
 #import "SPLogger.h"
 
 
@@ -20,31 +21,33 @@
 static SPLogLevels logLevel = SPLogLevelsInfo;
 
 
-#pragma mark ====================================================================================
-#pragma mark Private Properties
-#pragma mark ====================================================================================
-
-@interface SPMemberText ()
-@property (nonatomic, strong) DiffMatchPatch *dmp;
-@end
-
-
 #pragma mark ====================================================================================
 #pragma mark SPMemberText
 #pragma mark ====================================================================================
 
 @implementation SPMemberText
 
-- (instancetype)initFromDictionary:(NSDictionary *)dict
+- (NSMutableArray *)budgetedDiffsFromText:(NSString *)oldText toText:(NSString *)newText
 {
-    self = [super initFromDictionary:dict];
-    if (self) {
-        _dmp = [[DiffMatchPatch alloc] init];
-    }
-    return self;
+    // Large documents get escalated to word (or line) diffs, rather than blocking the processor queue
+    NSTimeInterval budget                   = [SPDiffBudget timeIntervalForMemberBudget:self.diffBudget];
+    NSTimeInterval startTime                = [NSDate timeIntervalSinceReferenceDate];
+    DiffMatchPatchGranularity granularity   = DiffMatchPatchGranularityCharacters;
+    
+    NSMutableArray *diffs = [self.diffMatchPatch sp_diffsFromText:oldText
+                                                           toText:newText
+                                                      granularity:DiffMatchPatchGranularityCharacters
+                                                           budget:budget
+                                                  usedGranularity:&granularity];
+    
+    [SPDiffBudget recordDiffForMember:self.keyName
+                               budget:budget
+                              elapsed:[NSDate timeIntervalSinceReferenceDate] - startTime
+                            escalated:(granularity != DiffMatchPatchGranularityCharacters)];
+    
+    return diffs;
 }
 
-
 - (id)defaultValue {
     return @"";
 }
@@ -61,15 +64,15 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     }
     
     // DiffMatchPatch: find the diff, and let's use some logic from MobWrite to clean stuff up
-    NSMutableArray *diffList = [self.dmp diff_mainOfOldString:thisValue andNewString:otherValue];
+    NSMutableArray *diffList = [self budgetedDiffsFromText:thisValue toText:otherValue];
     if (diffList.count > 2) {
-        [self.dmp diff_cleanupSemantic:diffList];
-        [self.dmp diff_cleanupEfficiency:diffList];
+        [self.diffMatchPatch diff_cleanupSemantic:diffList];
+        [self.diffMatchPatch diff_cleanupEfficiency:diffList];
     }
     
-    if (diffList.count > 0 && [self.dmp diff_levenshtein:diffList] != 0) {
+    if (diffList.count > 0 && [self.diffMatchPatch diff_levenshtein:diffList] != 0) {
         // Construct the patch delta and return it as a change operation
-        NSString *delta = [self.dmp diff_toDelta:diffList];
+        NSString *delta = [self.diffMatchPatch diff_toDelta:diffList];
         return @{
             OP_OP       : OP_STRING,
             OP_VALUE    : delta
@@ -86,45 +89,45 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     // if ([thisValue length] == 0)
     //    return otherValue;
     
-    NSMutableArray *diffs   = [self.dmp diff_fromDeltaWithText:thisValue andDelta:otherValue error:error];
-    NSMutableArray *patches = [self.dmp patch_makeFromOldString:thisValue andDiffs:diffs];
-    NSArray *result         = [self.dmp patch_apply:patches toString:thisValue];
+    NSMutableArray *diffs   = [self.diffMatchPatch diff_fromDeltaWithText:thisValue andDelta:otherValue error:error];
+    NSMutableArray *patches = [self.diffMatchPatch patch_makeFromOldString:thisValue andDiffs:diffs];
+    NSArray *result         = [self.diffMatchPatch patch_apply:patches toString:thisValue];
 
     return [result firstObject];
 }
 
 - (NSDictionary *)transform:(id)thisValue otherValue:(id)otherValue oldValue:(id)oldValue error:(NSError **)error {
     // Calculate the delta from the Ghost to the Local + Remote values. Treat any error here as fatal
-    NSMutableArray *thisDiffs       = [self.dmp diff_fromDeltaWithText:oldValue andDelta:thisValue error:error];
-    NSMutableArray *otherDiffs      = [self.dmp diff_fromDeltaWithText:oldValue andDelta:otherValue error:error];
+    NSMutableArray *thisDiffs       = [self.diffMatchPatch diff_fromDeltaWithText:oldValue andDelta:thisValue error:error];
+    NSMutableArray *otherDiffs      = [self.diffMatchPatch diff_fromDeltaWithText:oldValue andDelta:otherValue error:error];
     if (error && *error) {
         return @{ };
     }
     
     // Attempt to apply those two patches
-    NSMutableArray *thisPatches     = [self.dmp patch_makeFromOldString:oldValue andDiffs:thisDiffs];
-    NSMutableArray *otherPatches    = [self.dmp patch_makeFromOldString:oldValue andDiffs:otherDiffs];
+    NSMutableArray *thisPatches     = [self.diffMatchPatch patch_makeFromOldString:oldValue andDiffs:thisDiffs];
+    NSMutableArray *otherPatches    = [self.diffMatchPatch patch_makeFromOldString:oldValue andDiffs:otherDiffs];
     
     NSError *internalError          = nil;
-    NSArray *otherResult            = [self.dmp patch_apply:otherPatches toString:oldValue error:&internalError];
+    NSArray *otherResult            = [self.diffMatchPatch patch_apply:otherPatches toString:oldValue error:&internalError];
     NSString *otherString           = [otherResult firstObject];
     
-    NSArray *combinedResult         = [self.dmp patch_apply:thisPatches toString:otherString error:&internalError];
+    NSArray *combinedResult         = [self.diffMatchPatch patch_apply:thisPatches toString:otherString error:&internalError];
     NSString *combinedString        = [combinedResult firstObject];
     
     // If the rebase fails, fallback to the Local State
     if (internalError) {
-        combinedResult              = [self.dmp patch_apply:thisPatches toString:oldValue error:error];
+        combinedResult              = [self.diffMatchPatch patch_apply:thisPatches toString:oldValue error:error];
         combinedString              = [combinedResult firstObject];
     }
     
-    NSMutableArray *finalDiffs      = [self.dmp diff_mainOfOldString:otherString andNewString:combinedString];
+    NSMutableArray *finalDiffs      = [self budgetedDiffsFromText:otherString toText:combinedString];
     if (finalDiffs.count > 2) {
-        [self.dmp diff_cleanupEfficiency:finalDiffs];
+        [self.diffMatchPatch diff_cleanupEfficiency:finalDiffs];
     }
     
     if (finalDiffs.count > 0) {
-        NSString *delta = [self.dmp diff_toDelta:finalDiffs];
+        NSString *delta = [self.diffMatchPatch diff_toDelta:finalDiffs];
         
         return @{
             OP_OP       : OP_STRING,
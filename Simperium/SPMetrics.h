@@ -0,0 +1,112 @@
+//
+//  SPMetrics.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Metric Names
+#pragma mark ====================================================================================
+
+// Counters
+extern NSString * const SPMetricsChangesSent;
+extern NSString * const SPMetricsChangesAcknowledged;
+extern NSString * const SPMetricsChangesErrored;
+extern NSString * const SPMetricsChangesRetried;
+extern NSString * const SPMetricsRemoteChangesApplied;
+extern NSString * const SPMetricsVersionsFetched;
+extern NSString * const SPMetricsIndexesCompleted;
+
+// Gauges
+extern NSString * const SPMetricsPendingChanges;
+extern NSString * const SPMetricsQueuedChanges;
+extern NSString * const SPMetricsQueuedDeletions;
+extern NSString * const SPMetricsQueuedRetries;
+extern NSString * const SPMetricsPendingVersions;
+extern NSString * const SPMetricsDiffBudgetEscalations;
+extern NSString * const SPMetricsDiffBudgetOverruns;
+
+// Histograms
+extern NSString * const SPMetricsChangeAckLatency;
+extern NSString * const SPMetricsRemoteChangeApplyTime;
+extern NSString * const SPMetricsIndexTime;
+extern NSString * const SPMetricsStorageSaveTime;
+extern NSString * const SPMetricsDiffTimePrefix;
+
+// Snapshot Keys
+extern NSString * const SPMetricsSnapshotCounters;
+extern NSString * const SPMetricsSnapshotGauges;
+extern NSString * const SPMetricsSnapshotHistograms;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsCounter
+#pragma mark ====================================================================================
+
+// Monotonic counter. Lock free: safe to be bumped from any thread
+@interface SPMetricsCounter : NSObject
+
+@property (nonatomic, assign, readonly) int64_t value;
+
+- (void)increment;
+- (void)add:(int64_t)delta;
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsGauge
+#pragma mark ====================================================================================
+
+// Point in time value, such as a queue depth. Lock free
+@interface SPMetricsGauge : NSObject
+
+@property (atomic, assign, readwrite) int64_t value;
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsHistogram
+#pragma mark ====================================================================================
+
+// HDR style histogram, with microsecond resolution. Samples land in log-linear buckets: exact below 32us, and within
+// 1/16th of their value (6.25%) beyond that, up to ~12 days. Recording is lock free, and allocation free.
+@interface SPMetricsHistogram : NSObject
+
+@property (nonatomic, assign, readonly) int64_t count;
+
+- (void)recordMicroseconds:(uint64_t)microseconds;
+- (void)recordTimeInterval:(NSTimeInterval)timeInterval;
+- (void)recordTimeIntervalSinceTime:(CFAbsoluteTime)startTime;
+
+// Highest value (in seconds) recorded at the given percentile [0, 100], within the bucket's precision
+- (NSTimeInterval)valueAtPercentile:(double)percentile;
+
+// count, min, max, mean, p50, p90, p99 and p99.9. Times are expressed in milliseconds
+- (NSDictionary *)snapshot;
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetrics
+#pragma mark ====================================================================================
+
+// Registry of named metrics. Lookups create the metric, on demand, and are thread safe
+@interface SPMetrics : NSObject
+
+- (SPMetricsCounter *)counterNamed:(NSString *)name;
+- (SPMetricsGauge *)gaugeNamed:(NSString *)name;
+- (SPMetricsHistogram *)histogramNamed:(NSString *)name;
+
+// Plist friendly dump of every metric: { counters: { name: value }, gauges: { name: value }, histograms: { name: {...} } }
+- (NSDictionary *)snapshot;
+
+@end
@@ -0,0 +1,324 @@
+//
+//  SPMetrics.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPMetrics.h"
+#import <pthread.h>
+#import <stdatomic.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+NSString * const SPMetricsChangesSent               = @"changes.sent";
+NSString * const SPMetricsChangesAcknowledged       = @"changes.acknowledged";
+NSString * const SPMetricsChangesErrored            = @"changes.errored";
+NSString * const SPMetricsChangesRetried            = @"changes.retried";
+NSString * const SPMetricsRemoteChangesApplied      = @"changes.remote.applied";
+NSString * const SPMetricsVersionsFetched           = @"versions.fetched";
+NSString * const SPMetricsIndexesCompleted          = @"indexes.completed";
+
+NSString * const SPMetricsPendingChanges            = @"queue.changes.pending";
+NSString * const SPMetricsQueuedChanges             = @"queue.changes.queued";
+NSString * const SPMetricsQueuedDeletions           = @"queue.deletions";
+NSString * const SPMetricsQueuedRetries             = @"queue.retries";
+NSString * const SPMetricsPendingVersions           = @"channel.versions.pending";
+NSString * const SPMetricsDiffBudgetEscalations     = @"diff.budget.escalations";
+NSString * const SPMetricsDiffBudgetOverruns        = @"diff.budget.overruns";
+
+NSString * const SPMetricsChangeAckLatency          = @"time.change.ack";
+NSString * const SPMetricsRemoteChangeApplyTime     = @"time.change.remote.apply";
+NSString * const SPMetricsIndexTime                 = @"time.index";
+NSString * const SPMetricsStorageSaveTime           = @"time.storage.save";
+NSString * const SPMetricsDiffTimePrefix            = @"time.diff.";
+
+NSString * const SPMetricsSnapshotCounters          = @"counters";
+NSString * const SPMetricsSnapshotGauges            = @"gauges";
+NSString * const SPMetricsSnapshotHistograms        = @"histograms";
+
+// Log-linear buckets: 16 sub-buckets per power of two. Values below 32us are exact, and anything beyond 2^40us is clamped
+static NSUInteger const SPMetricsSubBucketBits      = 4;
+static NSUInteger const SPMetricsSubBucketCount     = 1 << SPMetricsSubBucketBits;
+static NSUInteger const SPMetricsMaxExponent        = 40;
+static uint64_t const SPMetricsMaxValue             = (1ULL << SPMetricsMaxExponent) - 1;
+
+#define SPMetricsBucketCount                        ((SPMetricsMaxExponent - SPMetricsSubBucketBits + 2) * SPMetricsSubBucketCount)
+
+static double const SPMetricsMicrosecondsPerSecond  = 1e6;
+static double const SPMetricsMicrosecondsPerMilli   = 1e3;
+static double const SPMetricsMillisPerSecond        = 1e3;
+
+
+#pragma mark ====================================================================================
+#pragma mark Bucket Helpers
+#pragma mark ====================================================================================
+
+static inline NSUInteger SPMetricsBucketIndex(uint64_t value)
+{
+    if (value < SPMetricsSubBucketCount) {
+        return (NSUInteger)value;
+    }
+    
+    value               = MIN(value, SPMetricsMaxValue);
+    NSUInteger exponent = 63 - __builtin_clzll(value);
+    NSUInteger shift    = exponent - SPMetricsSubBucketBits;
+    
+    return (exponent - SPMetricsSubBucketBits + 1) * SPMetricsSubBucketCount + (NSUInteger)((value >> shift) - SPMetricsSubBucketCount);
+}
+
+// Highest value that maps to the given bucket
+static inline uint64_t SPMetricsBucketValue(NSUInteger index)
+{
+    if (index < SPMetricsSubBucketCount) {
+        return index;
+    }
+    
+    NSUInteger exponent = index / SPMetricsSubBucketCount + SPMetricsSubBucketBits - 1;
+    NSUInteger shift    = exponent - SPMetricsSubBucketBits;
+    uint64_t subBucket  = index % SPMetricsSubBucketCount + SPMetricsSubBucketCount;
+    
+    return ((subBucket + 1) << shift) - 1;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsCounter
+#pragma mark ====================================================================================
+
+@implementation SPMetricsCounter {
+    _Atomic(int64_t) _value;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        atomic_init(&_value, 0);
+    }
+    return self;
+}
+
+- (int64_t)value {
+    return atomic_load_explicit(&_value, memory_order_relaxed);
+}
+
+- (void)increment {
+    atomic_fetch_add_explicit(&_value, 1, memory_order_relaxed);
+}
+
+- (void)add:(int64_t)delta {
+    atomic_fetch_add_explicit(&_value, delta, memory_order_relaxed);
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsGauge
+#pragma mark ====================================================================================
+
+@implementation SPMetricsGauge {
+    _Atomic(int64_t) _value;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        atomic_init(&_value, 0);
+    }
+    return self;
+}
+
+- (int64_t)value {
+    return atomic_load_explicit(&_value, memory_order_relaxed);
+}
+
+- (void)setValue:(int64_t)value {
+    atomic_store_explicit(&_value, value, memory_order_relaxed);
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsHistogram
+#pragma mark ====================================================================================
+
+@implementation SPMetricsHistogram {
+    _Atomic(uint64_t)   _buckets[SPMetricsBucketCount];
+    _Atomic(int64_t)    _count;
+    _Atomic(uint64_t)   _sum;
+    _Atomic(uint64_t)   _min;
+    _Atomic(uint64_t)   _max;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        for (NSUInteger i = 0; i < SPMetricsBucketCount; ++i) {
+            atomic_init(&_buckets[i], 0);
+        }
+        atomic_init(&_count, 0);
+        atomic_init(&_sum, 0);
+        atomic_init(&_min, UINT64_MAX);
+        atomic_init(&_max, 0);
+    }
+    return self;
+}
+
+- (int64_t)count {
+    return atomic_load_explicit(&_count, memory_order_relaxed);
+}
+
+- (void)recordMicroseconds:(uint64_t)microseconds {
+    atomic_fetch_add_explicit(&_buckets[SPMetricsBucketIndex(microseconds)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_sum, microseconds, memory_order_relaxed);
+    
+    uint64_t min = atomic_load_explicit(&_min, memory_order_relaxed);
+    while (microseconds < min && !atomic_compare_exchange_weak_explicit(&_min, &min, microseconds, memory_order_relaxed, memory_order_relaxed));
+    
+    uint64_t max = atomic_load_explicit(&_max, memory_order_relaxed);
+    while (microseconds > max && !atomic_compare_exchange_weak_explicit(&_max, &max, microseconds, memory_order_relaxed, memory_order_relaxed));
+    
+    // Bumped last: readers never see more samples than bucket hits
+    atomic_fetch_add_explicit(&_count, 1, memory_order_release);
+}
+
+- (void)recordTimeInterval:(NSTimeInterval)timeInterval {
+    [self recordMicroseconds:(uint64_t)MAX(timeInterval * SPMetricsMicrosecondsPerSecond, 0)];
+}
+
+- (void)recordTimeIntervalSinceTime:(CFAbsoluteTime)startTime {
+    [self recordTimeInterval:CFAbsoluteTimeGetCurrent() - startTime];
+}
+
+- (NSTimeInterval)valueAtPercentile:(double)percentile {
+    int64_t count = atomic_load_explicit(&_count, memory_order_acquire);
+    if (count == 0) {
+        return 0;
+    }
+    
+    double clamped  = MIN(MAX(percentile, 0), 100);
+    uint64_t target = MAX((uint64_t)ceil(clamped / 100.0 * count), 1);
+    uint64_t seen   = 0;
+    
+    for (NSUInteger i = 0; i < SPMetricsBucketCount; ++i) {
+        seen += atomic_load_explicit(&_buckets[i], memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t value = MIN(SPMetricsBucketValue(i), atomic_load_explicit(&_max, memory_order_relaxed));
+            return value / SPMetricsMicrosecondsPerSecond;
+        }
+    }
+    
+    return atomic_load_explicit(&_max, memory_order_relaxed) / SPMetricsMicrosecondsPerSecond;
+}
+
+- (NSDictionary *)snapshot {
+    int64_t count = atomic_load_explicit(&_count, memory_order_acquire);
+    if (count == 0) {
+        return @{ @"count" : @0 };
+    }
+    
+    double sum = atomic_load_explicit(&_sum, memory_order_relaxed);
+    double min = atomic_load_explicit(&_min, memory_order_relaxed);
+    double max = atomic_load_explicit(&_max, memory_order_relaxed);
+    
+    return @{
+        @"count"    : @(count),
+        @"min"      : @(min / SPMetricsMicrosecondsPerMilli),
+        @"max"      : @(max / SPMetricsMicrosecondsPerMilli),
+        @"mean"     : @(sum / count / SPMetricsMicrosecondsPerMilli),
+        @"p50"      : @([self valueAtPercentile:50] * SPMetricsMillisPerSecond),
+        @"p90"      : @([self valueAtPercentile:90] * SPMetricsMillisPerSecond),
+        @"p99"      : @([self valueAtPercentile:99] * SPMetricsMillisPerSecond),
+        @"p99.9"    : @([self valueAtPercentile:99.9] * SPMetricsMillisPerSecond)
+    };
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetrics
+#pragma mark ====================================================================================
+
+@implementation SPMetrics {
+    pthread_mutex_t         _lock;
+    NSMutableDictionary     *_counters;
+    NSMutableDictionary     *_gauges;
+    NSMutableDictionary     *_histograms;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        pthread_mutex_init(&_lock, NULL);
+        _counters   = [NSMutableDictionary dictionary];
+        _gauges     = [NSMutableDictionary dictionary];
+        _histograms = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (id)metricNamed:(NSString *)name inDictionary:(NSMutableDictionary *)dictionary class:(Class)metricClass {
+    NSParameterAssert(name);
+    
+    pthread_mutex_lock(&_lock);
+    id metric = dictionary[name];
+    if (!metric) {
+        metric = [metricClass new];
+        dictionary[name] = metric;
+    }
+    pthread_mutex_unlock(&_lock);
+    
+    return metric;
+}
+
+- (SPMetricsCounter *)counterNamed:(NSString *)name {
+    return [self metricNamed:name inDictionary:_counters class:[SPMetricsCounter class]];
+}
+
+- (SPMetricsGauge *)gaugeNamed:(NSString *)name {
+    return [self metricNamed:name inDictionary:_gauges class:[SPMetricsGauge class]];
+}
+
+- (SPMetricsHistogram *)histogramNamed:(NSString *)name {
+    return [self metricNamed:name inDictionary:_histograms class:[SPMetricsHistogram class]];
+}
+
+- (NSDictionary *)snapshot {
+    pthread_mutex_lock(&_lock);
+    NSDictionary *counters      = [_counters copy];
+    NSDictionary *gauges        = [_gauges copy];
+    NSDictionary *histograms    = [_histograms copy];
+    pthread_mutex_unlock(&_lock);
+    
+    NSMutableDictionary *counterValues      = [NSMutableDictionary dictionaryWithCapacity:counters.count];
+    NSMutableDictionary *gaugeValues        = [NSMutableDictionary dictionaryWithCapacity:gauges.count];
+    NSMutableDictionary *histogramValues    = [NSMutableDictionary dictionaryWithCapacity:histograms.count];
+    
+    [counters enumerateKeysAndObjectsUsingBlock:^(NSString *name, SPMetricsCounter *counter, BOOL *stop) {
+        counterValues[name] = @(counter.value);
+    }];
+    
+    [gauges enumerateKeysAndObjectsUsingBlock:^(NSString *name, SPMetricsGauge *gauge, BOOL *stop) {
+        gaugeValues[name] = @(gauge.value);
+    }];
+    
+    [histograms enumerateKeysAndObjectsUsingBlock:^(NSString *name, SPMetricsHistogram *histogram, BOOL *stop) {
+        histogramValues[name] = [histogram snapshot];
+    }];
+    
+    return @{
+        SPMetricsSnapshotCounters   : counterValues,
+        SPMetricsSnapshotGauges     : gaugeValues,
+        SPMetricsSnapshotHistograms : histogramValues
+    };
+}
+
+@end
@@ -46,6 +46,7 @@
 - (void)simperiumSetValue:(id)value forKey:(NSString *)key {
     [self.mutableStorage setObject:value forKey:key];
     [self.bucket.schema ensureDynamicMemberExistsForObject:value key:key];
+    [self notifyStorageOfValues:@{ key : value ?: [NSNull null] }];
 }
 
 - (id)simperiumValueForKey:(NSString *)key {
@@ -55,6 +56,20 @@
 - (void)loadMemberData:(NSDictionary *)data {
     [self.mutableStorage setValuesForKeysWithDictionary:data];
     [self ensureSchemaMembersAreAdded];
+    [self notifyStorageOfValues:data];
+}
+
+- (void)notifyStorageOfValues:(NSDictionary *)values {
+    // Secondary Indexes need to know about every change: a single notification per batch
+    id<SPStorageProvider> storage = self.bucket.storage;
+    if ([storage respondsToSelector:@selector(object:forKey:didChangeValues:)]) {
+        [storage object:self forKey:self.simperiumKey didChangeValues:values];
+    }
+}
+
+// Allows predicates to be evaluated against the object's members
+- (id)valueForUndefinedKey:(NSString *)key {
+    return [self simperiumValueForKey:key];
 }
 
 - (void)ensureSchemaMembersAreAdded {
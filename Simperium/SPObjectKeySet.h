@@ -0,0 +1,48 @@
+//
+//  SPObjectKeySet.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark SPObjectKeySet
+#pragma mark ====================================================================================
+
+/// Thread safe collection of the Simperium Keys stored in every bucket. Storages keep it in sync as objects get
+/// inserted or deleted, so that the keys don't need to be fetched over and over again.
+///
+/// Enumerations walk through an immutable snapshot, which gets reused until the bucket changes.
+///
+@interface SPObjectKeySet : NSObject
+
+/// Indicates whether the keys for the specified bucket were ever loaded
+///
+- (BOOL)containsKeysForBucketName:(NSString *)bucketName;
+
+/// Loading: Changes reported after `beginLoadingKeysForBucketName:` are replayed on top of the keys eventually set.
+/// This way, keys can be fetched while other threads keep on inserting and deleting objects
+///
+- (void)beginLoadingKeysForBucketName:(NSString *)bucketName;
+- (void)setKeys:(NSArray *)keys forBucketName:(NSString *)bucketName;
+
+/// Incremental Updates
+///
+- (void)addKey:(NSString *)key bucketName:(NSString *)bucketName;
+- (void)removeKey:(NSString *)key bucketName:(NSString *)bucketName;
+- (void)removeAllKeysForBucketName:(NSString *)bucketName;
+
+/// Returns the keys for the specified bucket, or nil if they were never loaded
+///
+- (NSSet *)keysForBucketName:(NSString *)bucketName;
+
+/// Enumerates the keys for the specified bucket. The block may safely mutate the set
+///
+- (void)enumerateKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *key, BOOL *stop))block;
+
+@end
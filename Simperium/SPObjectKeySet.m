@@ -0,0 +1,166 @@
+//
+//  SPObjectKeySet.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPObjectKeySet.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPObjectKeySet ()
+@property (nonatomic, strong) NSMutableDictionary   *keysByBucket;
+@property (nonatomic, strong) NSMutableDictionary   *snapshotsByBucket;
+@property (nonatomic, strong) NSMutableDictionary   *pendingChangesByBucket;
+@property (nonatomic, strong) dispatch_queue_t      queue;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPObjectKeySet
+#pragma mark ====================================================================================
+
+@implementation SPObjectKeySet
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _keysByBucket           = [NSMutableDictionary dictionary];
+        _snapshotsByBucket      = [NSMutableDictionary dictionary];
+        _pendingChangesByBucket = [NSMutableDictionary dictionary];
+        _queue                  = dispatch_queue_create("com.simperium.SPObjectKeySet", NULL);
+    }
+    return self;
+}
+
+- (BOOL)containsKeysForBucketName:(NSString *)bucketName
+{
+    __block BOOL contains = NO;
+    dispatch_sync(self.queue, ^{
+        contains = (self.keysByBucket[bucketName] != nil);
+    });
+    return contains;
+}
+
+- (void)beginLoadingKeysForBucketName:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    dispatch_sync(self.queue, ^{
+        if (!self.keysByBucket[bucketName] && !self.pendingChangesByBucket[bucketName]) {
+            self.pendingChangesByBucket[bucketName] = [NSMutableArray array];
+        }
+    });
+}
+
+- (void)setKeys:(NSArray *)keys forBucketName:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    NSMutableSet *keySet = [NSMutableSet setWithArray:keys ?: @[]];
+    dispatch_sync(self.queue, ^{
+        // Every change is idempotent: replaying the ones that made it into the keys is harmless
+        for (NSArray *change in self.pendingChangesByBucket[bucketName]) {
+            if ([change.firstObject boolValue]) {
+                [keySet addObject:change.lastObject];
+            } else {
+                [keySet removeObject:change.lastObject];
+            }
+        }
+    
+        self.keysByBucket[bucketName] = keySet;
+        [self.pendingChangesByBucket removeObjectForKey:bucketName];
+        [self.snapshotsByBucket removeObjectForKey:bucketName];
+    });
+}
+
+- (void)addKey:(NSString *)key bucketName:(NSString *)bucketName
+{
+    [self updateKey:key bucketName:bucketName added:YES];
+}
+
+- (void)removeKey:(NSString *)key bucketName:(NSString *)bucketName
+{
+    [self updateKey:key bucketName:bucketName added:NO];
+}
+
+- (void)updateKey:(NSString *)key bucketName:(NSString *)bucketName added:(BOOL)added
+{
+    if (!key || !bucketName) {
+        return;
+    }
+    
+    dispatch_sync(self.queue, ^{
+        // Buckets being loaded get the change replayed. The ones that were never loaded will be loaded from scratch
+        NSMutableSet *keys = self.keysByBucket[bucketName];
+        if (!keys) {
+            [self.pendingChangesByBucket[bucketName] addObject:@[ @(added), key ]];
+            return;
+        }
+    
+        if ([keys containsObject:key] == added) {
+            return;
+        }
+    
+        if (added) {
+            [keys addObject:key];
+        } else {
+            [keys removeObject:key];
+        }
+        [self.snapshotsByBucket removeObjectForKey:bucketName];
+    });
+}
+
+- (void)removeAllKeysForBucketName:(NSString *)bucketName
+{
+    if (!bucketName) {
+        return;
+    }
+    
+    dispatch_sync(self.queue, ^{
+        if (self.keysByBucket[bucketName]) {
+            self.keysByBucket[bucketName] = [NSMutableSet set];
+        }
+        [self.pendingChangesByBucket[bucketName] removeAllObjects];
+        [self.snapshotsByBucket removeObjectForKey:bucketName];
+    });
+}
+
+- (NSSet *)keysForBucketName:(NSString *)bucketName
+{
+    __block NSSet *snapshot = nil;
+    dispatch_sync(self.queue, ^{
+        snapshot = self.snapshotsByBucket[bucketName];
+        if (snapshot) {
+            return;
+        }
+    
+        NSMutableSet *keys = self.keysByBucket[bucketName];
+        if (!keys) {
+            return;
+        }
+    
+        // Copied once per change: repeated enumerations of an idle bucket come for free
+        snapshot = [keys copy];
+        self.snapshotsByBucket[bucketName] = snapshot;
+    });
+    return snapshot;
+}
+
+- (void)enumerateKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *key, BOOL *stop))block
+{
+    NSParameterAssert(block);
+    
+    // The block runs outside of our queue: it might very well insert or delete objects
+    NSSet *keys = [self keysForBucketName:bucketName];
+    [keys enumerateObjectsUsingBlock:block];
+}
+
+@end
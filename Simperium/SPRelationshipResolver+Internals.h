@@ -32,6 +32,9 @@
 // Returns the number of pending relationships between two keys
 - (NSInteger)countPendingRelationshipsWithSourceKey:(NSString *)sourceKey andTargetKey:(NSString *)targetKey;
 
+// Invokes the completion handler once every journal write has been flushed to disk
+- (void)synchronizeWithCompletion:(void (^)())completion;
+
 #endif
 
 @end
@@ -21,6 +21,10 @@
 // Loads Pending Relationships stored in the Storage Provider's Metadata
 - (void)loadPendingRelationships:(id<SPStorageProvider>)storage;
 
+// Loads Pending Relationships stored in a journal at the specified URL: saves will only append what changed since the
+// previous one. Relationships found in the Storage Provider's Metadata get migrated into the journal
+- (void)loadPendingRelationships:(id<SPStorageProvider>)storage journalURL:(NSURL *)journalURL;
+
 // Adds a new pending relationship
 - (void)addPendingRelationship:(SPRelationship *)relationship;
 
@@ -29,7 +33,13 @@
                                bucketName:(NSString *)bucketName
                                   storage:(id<SPStorageProvider>)storage;
 
-// Persists the Pending Relationships in the Storage's metadata
+// Attempts to establish every pending relationship (from/to) a set of objects: they're faulted in batches, and
+// saved just once
+- (void)resolvePendingRelationshipsForKeys:(NSSet *)simperiumKeys
+                                bucketName:(NSString *)bucketName
+                                   storage:(id<SPStorageProvider>)storage;
+
+// Persists the Pending Relationships in the journal (if any), or the Storage's metadata
 - (void)saveWithStorage:(id<SPStorageProvider>)storage;
 
 // Nukes all of the pending relationships
@@ -10,6 +10,7 @@
 #import "SPDiffable.h"
 #import "SPStorage.h"
 #import "SPStorageProvider.h"
+#import "SPJSONStorageJournal.h"
 #import "JSONKit+Simperium.h"
 #import "SPGhost.h"
 #import "SPLogger.h"
@@ -22,6 +23,8 @@
 
 static NSString * const SPRelationshipsPendingsLegacyKey    = @"SPPendingReferences";
 static NSString * const SPRelationshipsPendingsNewKey       = @"SPRelationshipsPendingsNewKey";
+static NSString * const SPRelationshipsJournalBucket        = @"PendingRelationships";
+static NSString * const SPRelationshipsIdentifierSeparator  = @"\x1F";
 
 static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 
@@ -32,8 +35,13 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 
 @interface SPRelationshipResolver()
 
-@property (nonatomic, strong, readwrite) dispatch_queue_t   queue;
-@property (nonatomic, strong, readwrite) NSHashTable        *pendingRelationships;
+@property (nonatomic, strong, readwrite) dispatch_queue_t       queue;
+@property (nonatomic, strong, readwrite) NSHashTable            *pendingRelationships;
+@property (nonatomic, strong, readwrite) NSMutableDictionary    *relationshipsBySourceKey;
+@property (nonatomic, strong, readwrite) NSMutableDictionary    *relationshipsByTargetKey;
+@property (nonatomic, strong, readwrite) NSMutableSet           *addedRelationships;
+@property (nonatomic, strong, readwrite) NSMutableSet           *removedRelationships;
+@property (nonatomic, strong, readwrite) SPJSONStorageJournal   *journal;
 
 @end
 
@@ -47,9 +55,13 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 - (instancetype)init {
     self = [super init];
     if (self) {
-        NSString *label         = [@"com.simperium." stringByAppendingString:[[self class] description]];
-        _queue                  = dispatch_queue_create([label cStringUsingEncoding:NSUTF8StringEncoding], NULL);
-        _pendingRelationships   = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+        NSString *label             = [@"com.simperium." stringByAppendingString:[[self class] description]];
+        _queue                      = dispatch_queue_create([label cStringUsingEncoding:NSUTF8StringEncoding], NULL);
+        _pendingRelationships       = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+        _relationshipsBySourceKey   = [NSMutableDictionary dictionary];
+        _relationshipsByTargetKey   = [NSMutableDictionary dictionary];
+        _addedRelationships         = [NSMutableSet set];
+        _removedRelationships       = [NSMutableSet set];
     }
     
     return self;
@@ -59,10 +71,18 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 #pragma mark - Public Methods
 
 - (void)loadPendingRelationships:(id<SPStorageProvider>)storage {
+    [self loadPendingRelationships:storage journalURL:nil];
+}
+
+- (void)loadPendingRelationships:(id<SPStorageProvider>)storage journalURL:(NSURL *)journalURL {
     
     NSAssert([NSThread isMainThread],                                   @"Invalid Thread");
     NSAssert([storage conformsToProtocol:@protocol(SPStorageProvider)], @"Invalid Parameter");
     
+    if (journalURL) {
+        [self loadJournalAtURL:journalURL];
+    }
+    
     NSArray *legacy = [SPRelationship parseFromLegacyDictionary:storage.metadata[SPRelationshipsPendingsLegacyKey]];
     for (SPRelationship *relationship in legacy) {
         [self addPendingRelationship:relationship];
@@ -73,7 +93,7 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
         [self addPendingRelationship:relationship];
     }
     
-    if (legacy.count) {
+    if (legacy.count || (self.journal && pendings.count)) {
         [self saveWithStorage:storage];
     }
 }
@@ -82,20 +102,39 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
     
     NSAssert([NSThread isMainThread],                                   @"Invalid Thread");
     NSAssert([relationship isKindOfClass:[SPRelationship class]],       @"Invalid Parameter");
-        
-    [self.pendingRelationships addObject:relationship];
+    
+    if ([self.pendingRelationships containsObject:relationship]) {
+        return;
+    }
+    
+    [self indexRelationship:relationship];
+    [self.removedRelationships removeObject:relationship];
+    [self.addedRelationships addObject:relationship];
 }
 
 - (void)resolvePendingRelationshipsForKey:(NSString *)simperiumKey
                                bucketName:(NSString *)bucketName
                                   storage:(id<SPStorageProvider>)storage
 {
-    NSAssert([NSThread isMainThread],                                   @"Invalid Thread");
     NSAssert([simperiumKey isKindOfClass:[NSString class]],             @"Invalid Parameter");
+    
+    [self resolvePendingRelationshipsForKeys:[NSSet setWithObject:simperiumKey] bucketName:bucketName storage:storage];
+}
+
+- (void)resolvePendingRelationshipsForKeys:(NSSet *)simperiumKeys
+                                bucketName:(NSString *)bucketName
+                                   storage:(id<SPStorageProvider>)storage
+{
+    NSAssert([NSThread isMainThread],                                   @"Invalid Thread");
+    NSAssert([simperiumKeys isKindOfClass:[NSSet class]],               @"Invalid Parameter");
     NSAssert([bucketName isKindOfClass:[NSString class]],               @"Invalid Parameter");
     NSAssert([storage conformsToProtocol:@protocol(SPStorageProvider)], @"Invalid Parameter");
     
-    NSHashTable *relationships = [self relationshipsForKey:simperiumKey];
+    NSHashTable *relationships = [NSHashTable weakObjectsHashTable];
+    for (NSString *simperiumKey in simperiumKeys) {
+        [relationships unionHashTable:[self relationshipsForKey:simperiumKey]];
+    }
+    
     if (relationships.count == 0) {
         return;
     }
@@ -105,7 +144,7 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
         
         [threadSafeStorage performSafeBlockAndWait:^{
             NSHashTable *resolvedRelationships = [self _resolvePendingRelationships:relationships
-                                                                       simperiumKey:simperiumKey
+                                                                      simperiumKeys:simperiumKeys
                                                                          bucketName:bucketName
                                                                   threadSafeStorage:threadSafeStorage];
         
@@ -124,16 +163,18 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 }
 
 - (NSHashTable *)_resolvePendingRelationships:(NSHashTable *)relationships
-                                 simperiumKey:(NSString *)simperiumKey
+                                simperiumKeys:(NSSet *)simperiumKeys
                                    bucketName:(NSString *)bucketName
                             threadSafeStorage:(id<SPStorageProvider>)threadSafeStorage
 {
     NSParameterAssert(relationships);
-    NSParameterAssert(simperiumKey);
+    NSParameterAssert(simperiumKeys);
     NSParameterAssert(bucketName);
     NSParameterAssert(threadSafeStorage);
     
-    NSHashTable *processed = [NSHashTable hashTableWithOptions:NSHashTableStrongMemory];
+    // Group every Source and Target key by bucket
+    NSMapTable *targetBuckets           = [NSMapTable strongToStrongObjectsMapTable];
+    NSMutableDictionary *keysByBucket   = [NSMutableDictionary dictionary];
     
     for (SPRelationship *relationship in relationships) {
 
@@ -141,7 +182,7 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
         NSString *targetBucket = relationship.targetBucket;
         
         if (!targetBucket) {
-            if ([simperiumKey isEqualToString:relationship.targetKey]) {
+            if ([simperiumKeys containsObject:relationship.targetKey]) {
                 targetBucket = bucketName;
             } else {
                 // Unhandled scenario: There is no way to determine the targetBucket!
@@ -151,8 +192,24 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
             }
         }
         
-        id<SPDiffable>sourceObject  = [threadSafeStorage objectForKey:relationship.sourceKey bucketName:relationship.sourceBucket];
-        id<SPDiffable>targetObject  = [threadSafeStorage objectForKey:relationship.targetKey bucketName:targetBucket];
+        [targetBuckets setObject:targetBucket forKey:relationship];
+        [self addKey:relationship.sourceKey toBucketName:relationship.sourceBucket keysByBucket:keysByBucket];
+        [self addKey:relationship.targetKey toBucketName:targetBucket keysByBucket:keysByBucket];
+    }
+    
+    // Batch fault the objects: a single storage pass per bucket
+    NSMutableDictionary *objectsByBucket = [NSMutableDictionary dictionaryWithCapacity:keysByBucket.count];
+    for (NSString *name in keysByBucket) {
+        NSArray *keys           = [keysByBucket[name] allObjects];
+        objectsByBucket[name]   = [threadSafeStorage faultObjectsForKeys:keys bucketName:name] ?: @{};
+    }
+    
+    NSHashTable *processed = [NSHashTable hashTableWithOptions:NSHashTableStrongMemory];
+    
+    for (SPRelationship *relationship in targetBuckets) {
+        NSString *targetBucket      = [targetBuckets objectForKey:relationship];
+        id<SPDiffable>sourceObject  = objectsByBucket[relationship.sourceBucket][relationship.sourceKey];
+        id<SPDiffable>targetObject  = objectsByBucket[targetBucket][relationship.targetKey];
         
         if (!sourceObject || !targetObject) {
             continue;
@@ -175,6 +232,7 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
         [processed addObject:relationship];
     }
     
+    // Save once, regardless of the number of keys being resolved
     if (processed.count) {
         [threadSafeStorage save];
     }
@@ -187,10 +245,21 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
     NSAssert([storage conformsToProtocol:@protocol(SPStorageProvider)], @"Invalid Storage");
     NSAssert([NSThread isMainThread], @"Invalid Thread");
     
+    if (self.journal) {
+        [self saveDeltasToJournal];
+        [self removeJournaledPendingsFromStorage:storage];
+        return;
+    }
+    
     NSMutableDictionary *metadata = [storage.metadata mutableCopy];
+    BOOL hasPendings = (metadata[SPRelationshipsPendingsNewKey] || metadata[SPRelationshipsPendingsLegacyKey]);
+    BOOL hasChanges = (self.addedRelationships.count || self.removedRelationships.count);
     
-    // If there's already nothing there, save some CPU by not writing anything
-    if (_pendingRelationships.count == 0 && !metadata[SPRelationshipsPendingsNewKey]) {
+    [self.addedRelationships removeAllObjects];
+    [self.removedRelationships removeAllObjects];
+    
+    // When nothing changed, skip the write
+    if (!hasChanges && (hasPendings || _pendingRelationships.count == 0)) {
         return;
     }
     
@@ -204,7 +273,19 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 - (void)reset:(id<SPStorageProvider>)storage {
     
     [self.pendingRelationships removeAllObjects];
-    [self saveWithStorage:storage];
+    [self.relationshipsBySourceKey removeAllObjects];
+    [self.relationshipsByTargetKey removeAllObjects];
+    [self.addedRelationships removeAllObjects];
+    [self.removedRelationships removeAllObjects];
+    [self.journal removeAllRecordsForBucketName:SPRelationshipsJournalBucket];
+    
+    // Any relationship left in the metadata must go away as well
+    NSMutableDictionary *metadata = [storage.metadata mutableCopy];
+    if (metadata[SPRelationshipsPendingsNewKey] || metadata[SPRelationshipsPendingsLegacyKey]) {
+        [metadata removeObjectForKey:SPRelationshipsPendingsNewKey];
+        [metadata removeObjectForKey:SPRelationshipsPendingsLegacyKey];
+        storage.metadata = metadata;
+    }
     
     [storage save];
 }
@@ -220,10 +301,12 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
     NSAssert([simperiumKey isKindOfClass:[NSString class]],     @"Invalid Parameter");
     
     NSHashTable *relationships = [NSHashTable weakObjectsHashTable];
-    for (SPRelationship *relationship in self.pendingRelationships) {
-        if ([relationship.sourceKey isEqualToString:simperiumKey] || [relationship.targetKey isEqualToString:simperiumKey]) {
-            [relationships addObject:relationship];
-        }
+    for (SPRelationship *relationship in self.relationshipsBySourceKey[simperiumKey]) {
+        [relationships addObject:relationship];
+    }
+    
+    for (SPRelationship *relationship in self.relationshipsByTargetKey[simperiumKey]) {
+        [relationships addObject:relationship];
     }
     
     return relationships;
@@ -234,7 +317,158 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
     NSAssert([NSThread isMainThread],                           @"Invalid Thread");
     NSAssert([relationships isKindOfClass:[NSHashTable class]], @"Invalid Parameter");
     
-    [self.pendingRelationships minusHashTable:relationships];
+    for (SPRelationship *relationship in relationships) {
+        if (![self.pendingRelationships containsObject:relationship]) {
+            continue;
+        }
+        
+        [self unindexRelationship:relationship];
+        [self.addedRelationships removeObject:relationship];
+        [self.removedRelationships addObject:relationship];
+    }
+}
+
+- (void)addKey:(NSString *)key toBucketName:(NSString *)bucketName keysByBucket:(NSMutableDictionary *)keysByBucket {
+    
+    if (!key || !bucketName) {
+        return;
+    }
+    
+    NSMutableSet *keys = keysByBucket[bucketName];
+    if (!keys) {
+        keys = [NSMutableSet set];
+        keysByBucket[bucketName] = keys;
+    }
+    
+    [keys addObject:key];
+}
+
+- (void)indexRelationship:(SPRelationship *)relationship {
+    
+    [self.pendingRelationships addObject:relationship];
+    [self addRelationship:relationship toIndex:self.relationshipsBySourceKey key:relationship.sourceKey];
+    [self addRelationship:relationship toIndex:self.relationshipsByTargetKey key:relationship.targetKey];
+}
+
+- (void)unindexRelationship:(SPRelationship *)relationship {
+    
+    [self.pendingRelationships removeObject:relationship];
+    [self removeRelationship:relationship fromIndex:self.relationshipsBySourceKey key:relationship.sourceKey];
+    [self removeRelationship:relationship fromIndex:self.relationshipsByTargetKey key:relationship.targetKey];
+}
+
+- (void)addRelationship:(SPRelationship *)relationship toIndex:(NSMutableDictionary *)index key:(NSString *)key {
+    
+    if (!key) {
+        return;
+    }
+    
+    NSMutableSet *relationships = index[key];
+    if (!relationships) {
+        relationships = [NSMutableSet set];
+        index[key] = relationships;
+    }
+    
+    [relationships addObject:relationship];
+}
+
+- (void)removeRelationship:(SPRelationship *)relationship fromIndex:(NSMutableDictionary *)index key:(NSString *)key {
+    
+    if (!key) {
+        return;
+    }
+    
+    NSMutableSet *relationships = index[key];
+    [relationships removeObject:relationship];
+    
+    if (relationships.count == 0) {
+        [index removeObjectForKey:key];
+    }
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Journal Helpers
+#pragma mark ====================================================================================
+
+- (void)loadJournalAtURL:(NSURL *)journalURL {
+    
+    NSAssert(self.journal == nil, @"Pending Relationships were already loaded");
+    
+    self.journal = [[SPJSONStorageJournal alloc] initWithURL:journalURL];
+    
+    NSMutableArray *rawRelationships = [NSMutableArray array];
+    [self.journal enumerateRecordsUsingBlock:^(NSString *bucketName, NSString *simperiumKey, NSData *record) {
+        NSArray *rawRelationship = [record sp_objectFromJSONString];
+        if ([rawRelationship isKindOfClass:[NSArray class]]) {
+            [rawRelationships addObjectsFromArray:rawRelationship];
+        }
+    }];
+    
+    // Journaled relationships are already persisted: they don't belong to the next delta
+    for (SPRelationship *relationship in [SPRelationship parseFromArray:rawRelationships]) {
+        [self indexRelationship:relationship];
+    }
+}
+
+- (void)saveDeltasToJournal {
+    
+    if (self.addedRelationships.count == 0 && self.removedRelationships.count == 0) {
+        return;
+    }
+    
+    NSMutableDictionary *records = [NSMutableDictionary dictionary];
+    
+    for (SPRelationship *relationship in self.removedRelationships) {
+        records[[self identifierForRelationship:relationship]] = [NSNull null];
+    }
+    
+    for (SPRelationship *relationship in self.addedRelationships) {
+        records[[self identifierForRelationship:relationship]] = [[SPRelationship serializeFromArray:@[relationship]] sp_JSONData];
+    }
+    
+    [self.addedRelationships removeAllObjects];
+    [self.removedRelationships removeAllObjects];
+    
+    [self.journal appendRecords:records bucketName:SPRelationshipsJournalBucket];
+}
+
+// Journaled relationships get (only once) wiped from the metadata. Until the journal hits the disk, the metadata
+// remains their only durable copy
+- (void)removeJournaledPendingsFromStorage:(id<SPStorageProvider>)storage {
+    
+    if (!storage.metadata[SPRelationshipsPendingsNewKey] && !storage.metadata[SPRelationshipsPendingsLegacyKey]) {
+        return;
+    }
+    
+    [self.journal synchronizeWithCompletion:^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            NSMutableDictionary *metadata = [storage.metadata mutableCopy];
+            if (!metadata[SPRelationshipsPendingsNewKey] && !metadata[SPRelationshipsPendingsLegacyKey]) {
+                return;
+            }
+            
+            [metadata removeObjectForKey:SPRelationshipsPendingsNewKey];
+            [metadata removeObjectForKey:SPRelationshipsPendingsLegacyKey];
+            storage.metadata = metadata;
+            
+            [storage save];
+        });
+    }];
+}
+
+- (NSString *)identifierForRelationship:(SPRelationship *)relationship {
+    
+    // Legacy relationships carry no targetBucket
+    NSArray *components = @[
+        relationship.sourceBucket       ?: @"",
+        relationship.sourceKey          ?: @"",
+        relationship.sourceAttribute    ?: @"",
+        relationship.targetBucket       ?: @"",
+        relationship.targetKey          ?: @""
+    ];
+    
+    return [components componentsJoinedByString:SPRelationshipsIdentifierSeparator];
 }
 
 
@@ -254,8 +488,8 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
 
 - (NSInteger)countPendingRelationshipsWithSourceKey:(NSString *)sourceKey andTargetKey:(NSString *)targetKey {
     NSInteger count = 0;
-    for (SPRelationship *relationship in self.pendingRelationships) {
-        if ([relationship.sourceKey isEqualToString:sourceKey] && [relationship.targetKey isEqualToString:targetKey]) {
+    for (SPRelationship *relationship in self.relationshipsBySourceKey[sourceKey]) {
+        if ([relationship.targetKey isEqualToString:targetKey]) {
             ++count;
         }
     }
@@ -263,6 +497,14 @@ static SPLogLevels logLevel                                 = SPLogLevelsInfo;
     return count;
 }
 
+- (void)synchronizeWithCompletion:(void (^)())completion {
+    if (self.journal) {
+        [self.journal synchronizeWithCompletion:completion];
+    } else {
+        completion();
+    }
+}
+
 #endif
 
 @end
@@ -19,6 +19,7 @@
 @property (nonatomic, strong) NSMutableDictionary   *members;
 @property (nonatomic, strong) NSMutableArray        *binaryMembers;
 @property (nonatomic, assign) BOOL                  dynamic;
+@property (nonatomic, assign) BOOL                  lazyLoadingEnabled;
 
 - (instancetype)initWithBucketName:(NSString *)name data:(NSDictionary *)definition;
 - (SPMember *)memberForKey:(NSString *)memberName;
@@ -72,6 +72,10 @@
             if (member) {
                 [self.members setObject:member forKey:member.keyName];
             }
+            
+            if ([member isKindOfClass:[SPMemberBase64 class]]) {
+                [self.binaryMembers addObject:member];
+            }
         }        
     }
     
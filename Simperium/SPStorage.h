@@ -9,9 +9,13 @@
 #import <Foundation/Foundation.h>
 #import "SPDiffable.h"
 
+@protocol SPStorageProvider;
+
 @interface SPStorage : NSObject
 - (void)stopManagingObjectWithKey:(NSString *)key;
 - (void)configureInsertedObject:(id<SPDiffable>)object;
 - (void)configureInsertedObjects:(NSSet *)insertedObjects;
 - (void)configureNewGhost:(id<SPDiffable>)object;
+- (void)saveGhostForObject:(id<SPDiffable>)object;
++ (void)saveGhostForObject:(id<SPDiffable>)object storage:(id<SPStorageProvider>)storage;
 @end
@@ -7,8 +7,10 @@
 //
 
 #import "SPStorage.h"
+#import "SPStorageProvider.h"
 #import "SPGhost.h"
 #import "NSString+Simperium.h"
+#import "JSONKit+Simperium.h"
 #import "SPLogger.h"
 
 
@@ -44,6 +46,24 @@ static SPLogLevels logLevel = SPLogLevelsInfo;
     object.ghost.version = @"0";
 }
 
+- (void)saveGhostForObject:(id<SPDiffable>)object
+{
+    // Slight hack to ensure Core Data realizes the object has changed and needs a save
+    NSString *ghostDataCopy = [[[object.ghost dictionary] sp_JSONString] copy];
+    object.ghostData        = ghostDataCopy;
+}
+
++ (void)saveGhostForObject:(id<SPDiffable>)object storage:(id<SPStorageProvider>)storage
+{
+    // Third party providers might not implement saveGhostForObject: at all
+    if ([storage respondsToSelector:@selector(saveGhostForObject:)]) {
+        [storage saveGhostForObject:object];
+        return;
+    }
+    
+    object.ghostData = [[[object.ghost dictionary] sp_JSONString] copy];
+}
+
 - (void)configureInsertedObject:(id<SPDiffable>)object
 {
     if (object.simperiumKey == nil || object.simperiumKey.length == 0) {
@@ -52,6 +52,18 @@
 - (void)performCriticalBlockAndWait:(void (^)())block;
 
 @optional
+- (void)enumerateObjectKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *simperiumKey, BOOL *stop))block;
 - (void)object:(id)object forKey:(NSString *)simperiumKey didChangeValue:(id)value forKey:(NSString *)key;
 
+// Batched version of the above: NSNull stands for removed values
+- (void)object:(id)object forKey:(NSString *)simperiumKey didChangeValues:(NSDictionary *)values;
+- (void)addIndexForMemberNamed:(NSString *)memberName sorted:(BOOL)sorted bucketName:(NSString *)bucketName;
+
+// Persists the object's ghost. When not implemented, the ghost gets serialized into the object's ghostData
+- (void)saveGhostForObject:(id<SPDiffable>)object;
+
+// Bulk Upserts: Each version is a [Key, Version, Member Data] tuple. Objects are created (or overwritten), and get their
+// ghost updated and saved, as in one go. Useful while bootstrapping large indexes
+- (void)upsertObjectsForBucket:(SPBucket *)bucket versions:(NSArray *)versions;
+
 @end
@@ -0,0 +1,88 @@
+//
+//  SPTracer.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+typedef NS_ENUM(char, SPTracePhase) {
+    SPTracePhaseBegin           = 'B',
+    SPTracePhaseEnd             = 'E'
+};
+
+extern BOOL SPTracerEnabled;
+
+
+#pragma mark ====================================================================================
+#pragma mark "Private": Direct usage is not recommended
+#pragma mark ====================================================================================
+
+#define SPTRACE_CONCAT_(a, b)               a##b
+#define SPTRACE_CONCAT(a, b)                SPTRACE_CONCAT_(a, b)
+
+static inline BOOL SPTracerIsEnabled(void) {
+    return __atomic_load_n(&SPTracerEnabled, __ATOMIC_RELAXED);
+}
+
+static inline const char *SPTraceScopeBegin(const char *name, NSString *bucketName, NSString *key);
+static inline void SPTraceScopeEnd(const char **name);
+
+
+#pragma mark ====================================================================================
+#pragma mark Tracing Macros
+#pragma mark ====================================================================================
+
+// Opens a span that lasts until the end of the enclosing scope (early returns included). Names should be C string
+// literals. The bucket and key arguments are only evaluated while tracing is enabled: the disabled cost is a single load.
+#define SPTraceScope(name, bucketName, key) __attribute__((cleanup(SPTraceScopeEnd), unused))                          \
+                                            const char *SPTRACE_CONCAT(_spTraceScope, __LINE__) =                       \
+                                                SPTracerIsEnabled() ? SPTraceScopeBegin(name, bucketName, key) : NULL
+
+
+#pragma mark ====================================================================================
+#pragma mark SPTracer
+#pragma mark ====================================================================================
+
+// Writes the sync pipeline's spans to disk, as Chrome trace-event JSON (chrome://tracing, or ui.perfetto.dev).
+// Events are stamped on the calling thread, and serialized on a background queue.
+@interface SPTracer : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *traceFileURL;
+
++ (instancetype)sharedInstance;
+
+// Any previous trace gets finished first. The file is overwritten
+- (void)startTracingToURL:(NSURL *)traceFileURL;
+- (void)stopTracing;
+
+// Blocks until every recorded event has been written
+- (void)flush;
+
+- (void)recordEventWithPhase:(SPTracePhase)phase name:(const char *)name bucketName:(NSString *)bucketName key:(NSString *)key;
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark Scope Helpers
+#pragma mark ====================================================================================
+
+static inline const char *SPTraceScopeBegin(const char *name, NSString *bucketName, NSString *key) {
+    [[SPTracer sharedInstance] recordEventWithPhase:SPTracePhaseBegin name:name bucketName:bucketName key:key];
+    return name;
+}
+
+static inline void SPTraceScopeEnd(const char **name) {
+    if (*name) {
+        [[SPTracer sharedInstance] recordEventWithPhase:SPTracePhaseEnd name:*name bucketName:nil key:nil];
+    }
+}
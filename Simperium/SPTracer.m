@@ -0,0 +1,168 @@
+//
+//  SPTracer.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPTracer.h"
+#import "SPBufferedFileWriter.h"
+#import "SPLogger.h"
+#import <pthread.h>
+#import <unistd.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+BOOL SPTracerEnabled                                = NO;
+
+static SPLogLevels logLevel                         = SPLogLevelsInfo;
+static double const SPTracerNanosecondsPerMicro     = 1e3;
+static NSString * const SPTracerCategory            = @"simperium";
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPTracer ()
+@property (nonatomic, strong, readwrite) NSURL                  *traceFileURL;
+@property (   atomic, strong, readwrite) SPBufferedFileWriter   *writer;
+@property (nonatomic, assign, readwrite) BOOL                   needsSeparator;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPTracer
+#pragma mark ====================================================================================
+
+@implementation SPTracer
+
++ (instancetype)sharedInstance {
+    static SPTracer *_tracer;
+    static dispatch_once_t _once;
+    
+    dispatch_once(&_once, ^{
+        _tracer = [[[self class] alloc] init];
+    });
+    
+    return _tracer;
+}
+
+#pragma mark - Public Methods
+
+- (void)startTracingToURL:(NSURL *)traceFileURL {
+    NSParameterAssert(traceFileURL);
+    
+    @synchronized(self) {
+        [self finishTrace];
+        
+        SPBufferedFileWriter *writer = [SPBufferedFileWriter writerWithURL:traceFileURL];
+        if (!writer) {
+            return;
+        }
+        
+        // Note: The previous writer is done by now, nobody else touches the separator flag
+        self.needsSeparator = NO;
+        self.traceFileURL   = traceFileURL;
+        self.writer         = writer;
+        
+        [writer appendWithBlock:^(NSMutableData *buffer) {
+            [buffer appendBytes:"[\n" length:2];
+        }];
+        
+        __atomic_store_n(&SPTracerEnabled, YES, __ATOMIC_RELEASE);
+        SPLogInfo(@"Simperium tracing to %@", traceFileURL.path);
+    }
+}
+
+- (void)stopTracing {
+    __atomic_store_n(&SPTracerEnabled, NO, __ATOMIC_RELEASE);
+    
+    @synchronized(self) {
+        [self finishTrace];
+    }
+}
+
+- (void)flush {
+    [self.writer flush];
+}
+
+- (void)recordEventWithPhase:(SPTracePhase)phase name:(const char *)name bucketName:(NSString *)bucketName key:(NSString *)key {
+    NSParameterAssert(name);
+    
+    // Stamp the event right away: formatting is deferred to the writer's queue
+    uint64_t timestamp              = [SPBufferedFileWriter timestamp];
+    uint64_t threadID               = 0;
+    pthread_threadid_np(NULL, &threadID);
+    
+    SPBufferedFileWriter *writer    = self.writer;
+    NSString *bucket                = [bucketName copy];
+    NSString *objectKey             = [key copy];
+    
+    // Events stamped before the current trace started belong to nobody
+    if (!writer || timestamp < writer.startTime) {
+        return;
+    }
+    
+    [writer appendWithBlock:^(NSMutableData *buffer) {
+        [self appendEventWithPhase:phase name:name bucketName:bucket key:objectKey timestamp:timestamp - writer.startTime threadID:threadID buffer:buffer];
+    }];
+}
+
+
+#pragma mark - Private Methods
+
+- (void)appendEventWithPhase:(SPTracePhase)phase
+                        name:(const char *)name
+                  bucketName:(NSString *)bucketName
+                         key:(NSString *)key
+                   timestamp:(uint64_t)timestamp
+                    threadID:(uint64_t)threadID
+                      buffer:(NSMutableData *)buffer
+{
+    NSMutableDictionary *event = [@{
+        @"name"     : @(name),
+        @"cat"      : SPTracerCategory,
+        @"ph"       : [NSString stringWithFormat:@"%c", phase],
+        @"ts"       : @(timestamp / SPTracerNanosecondsPerMicro),
+        @"pid"      : @(getpid()),
+        @"tid"      : @(threadID)
+    } mutableCopy];
+    
+    if (bucketName || key) {
+        NSMutableDictionary *args = [NSMutableDictionary dictionary];
+        args[@"bucket"]     = bucketName;
+        args[@"key"]        = key;
+        event[@"args"]      = args;
+    }
+    
+    NSData *data = [NSJSONSerialization dataWithJSONObject:event options:0 error:nil];
+    if (!data) {
+        return;
+    }
+    
+    if (self.needsSeparator) {
+        [buffer appendBytes:",\n" length:2];
+    }
+    
+    [buffer appendData:data];
+    self.needsSeparator = YES;
+}
+
+// Note: Expected to be called from within a @synchronized(self) block
+- (void)finishTrace {
+    SPBufferedFileWriter *writer = self.writer;
+    if (!writer) {
+        return;
+    }
+    
+    self.writer = nil;
+    [writer closeWithTrailer:[NSData dataWithBytes:"\n]\n" length:3]];
+}
+
+@end
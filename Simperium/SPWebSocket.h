@@ -49,6 +49,11 @@ typedef enum {
 
 - (instancetype)initWithURLRequest:(NSURLRequest *)request;
 
++ (instancetype)webSocketWithURLRequest:(NSURLRequest *)request;
+
+// Subclass to be instantiated by webSocketWithURLRequest:. Meant for testing purposes only
++ (void)registerClass:(Class)c;
+
 - (void)open;
 - (void)close;
 - (void)send:(id)data;
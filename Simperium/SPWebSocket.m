@@ -179,4 +179,24 @@ NSTimeInterval const SPWebSocketTimeoutInterval = 60;
     [self resetTimeoutTimer];
 }
 
+
+#pragma mark ====================================================================================
+#pragma mark Static Helpers:
+#pragma mark SPLoopbackWebSocket relies on this mechanism to register itself, while running the Integration Tests
+#pragma mark ====================================================================================
+
+static Class _class;
+
++ (void)load {
+    _class = [SPWebSocket class];
+}
+
++ (void)registerClass:(Class)c {
+    _class = c;
+}
+
++ (instancetype)webSocketWithURLRequest:(NSURLRequest *)request {
+    return [[_class alloc] initWithURLRequest:request];
+}
+
 @end
@@ -22,6 +22,8 @@
 #import "JSONKit+Simperium.h"
 #import "NSString+Simperium.h"
 #import "SPLogger.h"
+#import "SPMetrics.h"
+#import "SPTracer.h"
 
 
 
@@ -60,6 +62,7 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
 @property (nonatomic, assign) NSInteger                     objectVersionsPending;
 @property (nonatomic, assign) BOOL                          started;
 @property (nonatomic, assign) BOOL                          indexing;
+@property (nonatomic, assign) CFAbsoluteTime                indexStartTime;
 @property (nonatomic, assign) BOOL                          retrievingObjectHistory;
 @property (nonatomic, assign) BOOL                          shouldSendEverything;
 @property (nonatomic,   copy) SPWebSocketSyncedBlockType    onLocalChangesSent;
@@ -207,7 +210,7 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
                 NSSet *wrappedKey   = [NSSet setWithObject:key];
                 NSArray *changes    = [processor processLocalDeletionsWithKeys:wrappedKey];
                 for (NSDictionary *change in changes) {
-                    [self sendChange:change];
+                    [self sendChange:change bucket:bucket];
                 }
             }
         }
@@ -235,7 +238,7 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
                 NSSet *wrappedKey = [NSSet setWithObject:key];
                 NSArray *changes = [processor processLocalObjectsWithKeys:wrappedKey bucket:object.bucket];
                 for (NSDictionary *change in changes) {
-                    [self sendChange:change];
+                    [self sendChange:change bucket:bucket];
                 }
             }
         }
@@ -341,6 +344,7 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     
     NSAssert([NSThread isMainThread] == false, @"This should NOT get called on the main thread!");
     
+    SPTraceScope("processor.changes", bucket.name, nil);
     SPLogVerbose(@"Simperium handling changes (%@) %@", bucket.name ,changes);
     
     SPChangeProcessor *changeProcessor  = bucket.changeProcessor;
@@ -592,7 +596,7 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     BOOL onlyQueuedChanges              = !self.shouldSendEverything;
     SPChangeProcessor *processor        = bucket.changeProcessor;
     SPChangeEnumerationBlockType block  = ^(NSDictionary *change) {
-        [self sendChange:change];
+        [self sendChange:change bucket:bucket];
     };
     
     // This gets called after remote changes have been handled in order to pick up any local changes that happened in the meantime
@@ -637,11 +641,14 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     self.shouldSendEverything = NO;
 }
 
-- (void)sendChange:(NSDictionary *)change {
+- (void)sendChange:(NSDictionary *)change bucket:(SPBucket *)bucket {
     if (!change) {
         return;
     }
     
+    // Note: Invoked on the processor's queue
+    [bucket.changeProcessor didSendChange:change bucket:bucket];
+    
     dispatch_async(dispatch_get_main_queue(), ^{
         NSString *message = [NSString stringWithFormat:@"%d:c:%@", self.number, [change sp_JSONString]];
         SPLogVerbose(@"Simperium sending change (%@-%@) %@", self.name, self.simperium.label, message);
@@ -663,6 +670,10 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     }
 
     // Get an index of all objects and fetch their latest versions
+    if (!mark) {
+        self.indexStartTime = CFAbsoluteTimeGetCurrent();
+    }
+    
     self.indexing = YES;
     
     NSString *message = [NSString stringWithFormat:@"%d:i::%@::%d", self.number, mark ? mark : @"", SPWebsocketIndexPageSize];
@@ -704,6 +715,8 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     
     self.objectVersionsPending = newPendings;
     [self.versionsBatch removeAllObjects];
+    
+    [bucket.metrics gaugeNamed:SPMetricsPendingVersions].value = newPendings;
 }
 
 - (void)requestVersionsForKeys:(NSArray *)currentIndexArray bucket:(SPBucket *)bucket {
@@ -757,6 +770,12 @@ typedef void(^SPWebSocketSyncedBlockType)(void);
     self.pendingLastChangeSignature = nil;
     self.nextMark                   = nil;
     self.indexing                   = NO;
+    
+    if (self.indexStartTime) {
+        [[bucket.metrics counterNamed:SPMetricsIndexesCompleted] increment];
+        [[bucket.metrics histogramNamed:SPMetricsIndexTime] recordTimeIntervalSinceTime:self.indexStartTime];
+        self.indexStartTime = 0;
+    }
 
     // There could be some processing happening on the queue still, so don't start until they're done
     dispatch_async(bucket.processorQueue, ^{
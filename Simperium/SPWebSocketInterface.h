@@ -13,6 +13,7 @@
 
 @class Simperium;
 @class SPWebSocket;
+@class SPWebSocketRecorder;
 
 #pragma mark ====================================================================================
 #pragma mark SPWebSocketInterface
@@ -20,6 +21,9 @@
 
 @interface SPWebSocketInterface : NSObject <SPNetworkInterface>
 
+// When set, every message sent or received through the socket gets recorded
+@property (nonatomic, strong, readwrite) SPWebSocketRecorder *recorder;
+
 - (void)loadChannelsForBuckets:(NSDictionary *)bucketList;
 - (void)send:(NSString *)message;
 - (void)reopen;
@@ -15,7 +15,9 @@
 #import "SPLogger.h"
 #import "SPWebSocket.h"
 #import "SPWebSocketChannel.h"
+#import "SPWebSocketRecorder.h"
 #import "SPEnvironment.h"
+#import "SPTracer.h"
 #import <Security/Security.h>
 
 
@@ -192,7 +194,7 @@ typedef NS_ENUM(NSInteger, SPMessageIndex) {
     NSURLRequest *request           = [NSURLRequest requestWithURL:[NSURL URLWithString:urlString]];
 
     // Open the socket!
-    SPWebSocket *newWebSocket       = [[SPWebSocket alloc] initWithURLRequest:request];
+    SPWebSocket *newWebSocket       = [SPWebSocket webSocketWithURLRequest:request];
     self.webSocket                  = newWebSocket;
     self.webSocket.delegate         = self;
     self.open                       = NO;
@@ -256,6 +258,7 @@ typedef NS_ENUM(NSInteger, SPMessageIndex) {
     if (!self.open) {
         return;
     }
+    [self.recorder recordMessage:message direction:SPWebSocketDirectionOutbound];
     [self.webSocket send:message];
     [self resetHeartbeatTimer];
 }
@@ -331,6 +334,8 @@ typedef NS_ENUM(NSInteger, SPMessageIndex) {
 
 - (void)webSocket:(SPWebSocket *)webSocket didReceiveMessage:(id)message {
     
+    [self.recorder recordMessage:message direction:SPWebSocketDirectionInbound];
+    
     NSArray *components = [message sp_componentsSeparatedByString:@":" limit:SPMessageIndexLast];
     
     // Shortest messages have the form: [CHANNEL:COMMAND]
@@ -361,6 +366,8 @@ typedef NS_ENUM(NSInteger, SPMessageIndex) {
     SPWebSocketChannel *channel = [self channelForNumber:@(channelStr.intValue)];
     SPBucket *bucket            = [self.simperium bucketForName:channel.name];
     
+    SPTraceScope("websocket.message", bucket.name, nil);
+    
     // Data: Is it empty?
     if (!data) {
         SPLogWarn(@"Simperium received unrecognized websocket message: %@", message);
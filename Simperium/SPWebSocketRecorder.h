@@ -0,0 +1,53 @@
+//
+//  SPWebSocketRecorder.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+typedef NS_ENUM(char, SPWebSocketDirection) {
+    SPWebSocketDirectionInbound     = '<',
+    SPWebSocketDirectionOutbound    = '>'
+};
+
+extern NSString * const SPWebSocketRecordingHeader;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketRecorder
+#pragma mark ====================================================================================
+
+// Writes every websocket message, in both directions, to a compact log file:
+//
+//      SPWS 1\n
+//      <direction> <microseconds since the recording started> <byte length>\n
+//      <message>\n
+//
+// Messages are length prefixed, so that they don't need any escaping. Timestamps are taken on the calling thread,
+// and writes happen on a background queue.
+//
+@interface SPWebSocketRecorder : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *recordingURL;
+
+// The file is overwritten. Returns nil if it can't be opened
++ (instancetype)recorderWithURL:(NSURL *)recordingURL;
+
+- (void)recordMessage:(NSString *)message direction:(SPWebSocketDirection)direction;
+
+// Blocks until every recorded message has been written
+- (void)flush;
+
+// Flushes and closes the file. Further messages are dropped
+- (void)close;
+
+@end
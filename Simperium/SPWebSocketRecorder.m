@@ -0,0 +1,143 @@
+//
+//  SPWebSocketRecorder.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPWebSocketRecorder.h"
+#import "SPBufferedFileWriter.h"
+#import "SPLogger.h"
+#import "NSString+Simperium.h"
+#import "JSONKit+Simperium.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+NSString * const SPWebSocketRecordingHeader                 = @"SPWS 1\n";
+
+static SPLogLevels logLevel                                 = SPLogLevelsInfo;
+static uint64_t const SPWebSocketRecorderNanosPerMicro      = 1000;
+static NSString * const SPWebSocketRecorderInitCommand      = @"init";
+static NSString * const SPWebSocketRecorderAuthCommand      = @"auth";
+static NSString * const SPWebSocketRecorderTokenKey         = @"token";
+static NSString * const SPWebSocketRecorderUsernameKey      = @"username";
+static NSString * const SPWebSocketRecorderRedacted         = @"[redacted]";
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPWebSocketRecorder ()
+@property (nonatomic, strong, readwrite) SPBufferedFileWriter *writer;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketRecorder
+#pragma mark ====================================================================================
+
+@implementation SPWebSocketRecorder
+
++ (instancetype)recorderWithURL:(NSURL *)recordingURL {
+    NSParameterAssert(recordingURL);
+    
+    SPBufferedFileWriter *writer = [SPBufferedFileWriter writerWithURL:recordingURL];
+    if (!writer) {
+        return nil;
+    }
+    
+    [writer appendWithBlock:^(NSMutableData *buffer) {
+        [buffer appendData:[SPWebSocketRecordingHeader dataUsingEncoding:NSUTF8StringEncoding]];
+    }];
+    
+    SPWebSocketRecorder *recorder   = [[self class] new];
+    recorder.writer                 = writer;
+    
+    SPLogInfo(@"Simperium recording websocket messages to %@", recordingURL.path);
+    
+    return recorder;
+}
+
+- (NSURL *)recordingURL {
+    return self.writer.fileURL;
+}
+
+
+#pragma mark - Public Methods
+
+- (void)recordMessage:(NSString *)message direction:(SPWebSocketDirection)direction {
+    NSParameterAssert(message);
+    
+    // Timestamps are taken on the calling thread, while redaction and encoding happen on the writer's queue
+    uint64_t timestamp  = [SPBufferedFileWriter timestamp];
+    uint64_t startTime  = self.writer.startTime;
+    NSString *payload   = [message copy];
+    
+    [self.writer appendWithBlock:^(NSMutableData *buffer) {
+        NSData *data        = [[[self class] redactedMessage:payload direction:direction] dataUsingEncoding:NSUTF8StringEncoding];
+        uint64_t elapsed    = (timestamp > startTime) ? (timestamp - startTime) / SPWebSocketRecorderNanosPerMicro : 0;
+        NSString *prefix    = [NSString stringWithFormat:@"%c %llu %lu\n", direction, elapsed, (unsigned long)data.length];
+        
+        [buffer appendData:[prefix dataUsingEncoding:NSUTF8StringEncoding]];
+        [buffer appendData:data];
+        [buffer appendBytes:"\n" length:1];
+    }];
+}
+
+- (void)flush {
+    [self.writer flush];
+}
+
+- (void)close {
+    [self.writer closeWithTrailer:nil];
+    SPLogInfo(@"Simperium finished websocket recording at %@", self.recordingURL.path);
+}
+
+
+#pragma mark - Private Methods
+
+// Credentials never hit the disk: `init` carries the user's token and email, and successful `auth` replies echo the email
++ (NSString *)redactedMessage:(NSString *)message direction:(SPWebSocketDirection)direction {
+    NSArray *components = [message sp_componentsSeparatedByString:@":" limit:3];
+    if (components.count < 3) {
+        return message;
+    }
+    
+    NSString *command = components[1];
+    
+    if (direction == SPWebSocketDirectionInbound && [command isEqualToString:SPWebSocketRecorderAuthCommand]) {
+        // Errors come as JSON, and carry no credentials
+        NSString *response = components[2];
+        if ([response hasPrefix:@"{"]) {
+            return message;
+        }
+            
+        return [NSString stringWithFormat:@"%@:%@:%@", components[0], command, SPWebSocketRecorderRedacted];
+    }
+        
+    if (direction == SPWebSocketDirectionOutbound && [command isEqualToString:SPWebSocketRecorderInitCommand]) {
+        NSMutableDictionary *payload = [[components[2] sp_objectFromJSONString] mutableCopy];
+        if (![payload isKindOfClass:[NSMutableDictionary class]]) {
+            return message;
+        }
+            
+        for (NSString *key in @[ SPWebSocketRecorderTokenKey, SPWebSocketRecorderUsernameKey ]) {
+            if (payload[key]) {
+                payload[key] = SPWebSocketRecorderRedacted;
+            }
+        }
+            
+        return [NSString stringWithFormat:@"%@:%@:%@", components[0], command, [payload sp_JSONString]];
+    }
+        
+    return message;
+}
+    
+@end
+    
\ No newline at end of file
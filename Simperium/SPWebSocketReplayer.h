@@ -0,0 +1,55 @@
+//
+//  SPWebSocketReplayer.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+@class Simperium;
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+typedef NS_ENUM(NSInteger, SPWebSocketReplayTiming) {
+    SPWebSocketReplayTimingRecorded     = 0,
+    SPWebSocketReplayTimingImmediate    = 1
+};
+
+typedef void (^SPWebSocketReplayCompletion)(NSUInteger messageCount, NSTimeInterval elapsed);
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketReplayer
+#pragma mark ====================================================================================
+
+// Feeds the inbound messages of an SPWebSocketRecorder log back through SPWebSocketInterface, as if they had just
+// arrived through the socket. Meant to be pointed at a Simperium instance backed by a fresh storage, that has already
+// been authenticated, and has its buckets loaded:
+//
+//  -   Outbound messages are never sent. They're only used to map the recorded channel numbers, through their
+//      `init` remote names, onto the local channels.
+//  -   Messages are delivered on the main thread, in the recorded order. Processing is asynchronous, as usual:
+//      the completion block means every message was handed over, not that the processors are done.
+//
+@interface SPWebSocketReplayer : NSObject
+
+@property (nonatomic, strong, readonly) NSURL           *recordingURL;
+@property (nonatomic, assign, readonly) NSUInteger      inboundCount;
+@property (nonatomic, assign, readonly) NSUInteger      outboundCount;
+@property (nonatomic, assign, readonly) NSTimeInterval  duration;
+
+// Returns nil if the recording can't be read, or is malformed
++ (instancetype)replayerWithURL:(NSURL *)recordingURL;
+
+- (void)replayIntoSimperium:(Simperium *)simperium timing:(SPWebSocketReplayTiming)timing completion:(SPWebSocketReplayCompletion)completion;
+
+// Messages that weren't delivered yet get dropped. The completion block won't get called
+- (void)cancel;
+
+@end
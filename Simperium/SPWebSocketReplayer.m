@@ -0,0 +1,314 @@
+//
+//  SPWebSocketReplayer.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPWebSocketReplayer.h"
+#import "SPWebSocketRecorder.h"
+#import "SPWebSocketInterface.h"
+#import "SPWebSocketChannel.h"
+#import "Simperium+Internals.h"
+#import "NSString+Simperium.h"
+#import "JSONKit+Simperium.h"
+#import "SPLogger.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLogLevels logLevel                             = SPLogLevelsInfo;
+static NSString * const SPWebSocketReplayerInitCommand  = @"init";
+static NSString * const SPWebSocketReplayerNameKey      = @"name";
+static double const SPWebSocketReplayerMicrosPerSecond  = 1e6;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketInterface: Exposing Private Methods
+#pragma mark ====================================================================================
+
+@interface SPWebSocketInterface ()
+- (NSMutableDictionary *)channels;
+- (void)webSocket:(SPWebSocket *)webSocket didReceiveMessage:(id)message;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketReplayEntry
+#pragma mark ====================================================================================
+
+@interface SPWebSocketReplayEntry : NSObject
+@property (nonatomic, assign) SPWebSocketDirection  direction;
+@property (nonatomic, assign) uint64_t              timestamp;
+@property (nonatomic, strong) NSString              *message;
+@end
+
+@implementation SPWebSocketReplayEntry
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPWebSocketReplayer ()
+@property (nonatomic, strong, readwrite) NSURL                  *recordingURL;
+@property (nonatomic, strong, readwrite) NSArray                *inboundEntries;
+@property (nonatomic, strong, readwrite) NSDictionary           *remoteNames;
+@property (nonatomic, assign, readwrite) NSUInteger             outboundCount;
+@property (nonatomic, assign, readwrite) NSUInteger             generation;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketReplayer
+#pragma mark ====================================================================================
+
+@implementation SPWebSocketReplayer
+
++ (instancetype)replayerWithURL:(NSURL *)recordingURL {
+    NSParameterAssert(recordingURL);
+    
+    NSData *data = [NSData dataWithContentsOfURL:recordingURL];
+    if (!data) {
+        SPLogError(@"Simperium couldn't read websocket recording at %@", recordingURL.path);
+        return nil;
+    }
+    
+    NSArray *entries = [self entriesFromData:data];
+    if (!entries) {
+        SPLogError(@"Simperium found a malformed websocket recording at %@", recordingURL.path);
+        return nil;
+    }
+    
+    NSMutableArray *inboundEntries      = [NSMutableArray array];
+    NSMutableDictionary *remoteNames    = [NSMutableDictionary dictionary];
+    NSUInteger outboundCount            = 0;
+    
+    for (SPWebSocketReplayEntry *entry in entries) {
+        if (entry.direction == SPWebSocketDirectionInbound) {
+            [inboundEntries addObject:entry];
+            continue;
+        }
+        
+        // Outbound: We only care about the channel initialization, which carries the bucket's remote name
+        ++outboundCount;
+        
+        NSArray *components = [entry.message sp_componentsSeparatedByString:@":" limit:3];
+        if (components.count < 3 || ![components[1] isEqualToString:SPWebSocketReplayerInitCommand]) {
+            continue;
+        }
+        
+        NSDictionary *payload = [components[2] sp_objectFromJSONString];
+        if ([payload isKindOfClass:[NSDictionary class]] && payload[SPWebSocketReplayerNameKey]) {
+            remoteNames[@([components[0] intValue])] = payload[SPWebSocketReplayerNameKey];
+        }
+    }
+    
+    SPWebSocketReplayer *replayer   = [[self class] new];
+    replayer.recordingURL           = recordingURL;
+    replayer.inboundEntries         = inboundEntries;
+    replayer.remoteNames            = remoteNames;
+    replayer.outboundCount          = outboundCount;
+    
+    return replayer;
+}
+
+- (NSUInteger)inboundCount {
+    return self.inboundEntries.count;
+}
+
+- (NSTimeInterval)duration {
+    SPWebSocketReplayEntry *first   = self.inboundEntries.firstObject;
+    SPWebSocketReplayEntry *last    = self.inboundEntries.lastObject;
+    
+    return (last.timestamp - first.timestamp) / SPWebSocketReplayerMicrosPerSecond;
+}
+
+
+#pragma mark - Public Methods
+
+- (void)replayIntoSimperium:(Simperium *)simperium timing:(SPWebSocketReplayTiming)timing completion:(SPWebSocketReplayCompletion)completion {
+    NSAssert([NSThread isMainThread], @"This should get called on the main thread!");
+    NSAssert([simperium.network isKindOfClass:[SPWebSocketInterface class]], @"Simperium should be backed by a SPWebSocketInterface");
+    
+    SPWebSocketInterface *interface = (SPWebSocketInterface *)simperium.network;
+    NSDictionary *channelMap        = [self channelMapForInterface:interface];
+    NSUInteger generation           = ++self.generation;
+    CFAbsoluteTime startTime        = CFAbsoluteTimeGetCurrent();
+    
+    SPLogInfo(@"Simperium replaying %lu websocket messages from %@", (unsigned long)self.inboundCount, self.recordingURL.path);
+    
+    [self deliverEntryAtIndex:0
+                    interface:interface
+                   channelMap:channelMap
+                       timing:timing
+                    startTime:startTime
+                   generation:generation
+                   completion:completion];
+}
+
+- (void)cancel {
+    ++self.generation;
+}
+
+
+#pragma mark - Private Methods
+
+- (void)deliverEntryAtIndex:(NSUInteger)index
+                  interface:(SPWebSocketInterface *)interface
+                 channelMap:(NSDictionary *)channelMap
+                     timing:(SPWebSocketReplayTiming)timing
+                  startTime:(CFAbsoluteTime)startTime
+                 generation:(NSUInteger)generation
+                 completion:(SPWebSocketReplayCompletion)completion
+{
+    if (generation != self.generation) {
+        return;
+    }
+    
+    if (index >= self.inboundEntries.count) {
+        NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - startTime;
+        SPLogInfo(@"Simperium replayed %lu websocket messages in %.3fs", (unsigned long)index, elapsed);
+        
+        if (completion) {
+            completion(index, elapsed);
+        }
+        return;
+    }
+    
+    // Every message gets its own runloop pass, so that the interface behaves just as it would with a live socket
+    dispatch_block_t block = ^{
+        if (generation != self.generation) {
+            return;
+        }
+        
+        SPWebSocketReplayEntry *entry = self.inboundEntries[index];
+        [interface webSocket:nil didReceiveMessage:[self message:entry.message mappedWithChannelMap:channelMap]];
+        
+        [self deliverEntryAtIndex:index + 1
+                        interface:interface
+                       channelMap:channelMap
+                           timing:timing
+                        startTime:startTime
+                       generation:generation
+                       completion:completion];
+    };
+    
+    if (timing == SPWebSocketReplayTimingImmediate) {
+        dispatch_async(dispatch_get_main_queue(), block);
+        return;
+    }
+    
+    SPWebSocketReplayEntry *first   = self.inboundEntries.firstObject;
+    SPWebSocketReplayEntry *entry   = self.inboundEntries[index];
+    NSTimeInterval offset           = (entry.timestamp - first.timestamp) / SPWebSocketReplayerMicrosPerSecond;
+    NSTimeInterval delay            = MAX(offset - (CFAbsoluteTimeGetCurrent() - startTime), 0);
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), block);
+}
+
+// Recorded Channel Number > Local Channel Number. Channels are matched through their remote names
+- (NSDictionary *)channelMapForInterface:(SPWebSocketInterface *)interface {
+    NSMutableDictionary *channelMap = [NSMutableDictionary dictionary];
+    
+    for (NSNumber *recordedNumber in self.remoteNames) {
+        NSString *remoteName = self.remoteNames[recordedNumber];
+        
+        for (SPWebSocketChannel *channel in [interface.channels allValues]) {
+            if ([channel.remoteName isEqualToString:remoteName]) {
+                channelMap[recordedNumber] = @(channel.number);
+                break;
+            }
+        }
+        
+        if (!channelMap[recordedNumber]) {
+            SPLogWarn(@"Simperium couldn't find a local channel for recorded bucket %@", remoteName);
+        }
+    }
+    
+    return channelMap;
+}
+
+// Recordings that don't carry their `init` messages get replayed with their original channel numbers
+- (NSString *)message:(NSString *)message mappedWithChannelMap:(NSDictionary *)channelMap {
+    NSRange range = [message rangeOfString:@":"];
+    if (range.location == NSNotFound || range.location == 0) {
+        return message;
+    }
+    
+    NSString *channelStr = [message substringToIndex:range.location];
+    if ([channelStr rangeOfCharacterFromSet:[[NSCharacterSet decimalDigitCharacterSet] invertedSet]].location != NSNotFound) {
+        return message;
+    }
+    
+    NSNumber *localNumber = channelMap[@(channelStr.intValue)];
+    if (!localNumber || localNumber.intValue == channelStr.intValue) {
+        return message;
+    }
+    
+    return [localNumber.stringValue stringByAppendingString:[message substringFromIndex:range.location]];
+}
+
+
+#pragma mark - Parsing
+
++ (NSArray *)entriesFromData:(NSData *)data {
+    NSData *header = [SPWebSocketRecordingHeader dataUsingEncoding:NSUTF8StringEncoding];
+    if (data.length < header.length || ![[data subdataWithRange:NSMakeRange(0, header.length)] isEqualToData:header]) {
+        return nil;
+    }
+    
+    NSMutableArray *entries = [NSMutableArray array];
+    const char *bytes       = data.bytes;
+    NSUInteger length       = data.length;
+    NSUInteger offset       = header.length;
+    
+    while (offset < length) {
+        // Prefix: <direction> <timestamp> <length>\n
+        const char *newline = memchr(bytes + offset, '\n', length - offset);
+        if (!newline) {
+            return nil;
+        }
+        
+        NSString *prefix                = [[NSString alloc] initWithBytes:bytes + offset length:newline - (bytes + offset) encoding:NSUTF8StringEncoding];
+        NSArray *fields                 = [prefix componentsSeparatedByString:@" "];
+        if (fields.count != 3 || [fields[0] length] != 1) {
+            return nil;
+        }
+        
+        SPWebSocketDirection direction  = (SPWebSocketDirection)[fields[0] characterAtIndex:0];
+        uint64_t timestamp              = strtoull([fields[1] UTF8String], NULL, 10);
+        NSUInteger messageLength        = (NSUInteger)strtoull([fields[2] UTF8String], NULL, 10);
+        
+        if (direction != SPWebSocketDirectionInbound && direction != SPWebSocketDirectionOutbound) {
+            return nil;
+        }
+        
+        // Payload: <message>\n
+        offset = newline - bytes + 1;
+        if (messageLength + 1 > length - offset) {
+            return nil;
+        }
+        
+        SPWebSocketReplayEntry *entry   = [SPWebSocketReplayEntry new];
+        entry.direction                 = direction;
+        entry.timestamp                 = timestamp;
+        entry.message                   = [[NSString alloc] initWithBytes:bytes + offset length:messageLength encoding:NSUTF8StringEncoding];
+        
+        if (!entry.message) {
+            return nil;
+        }
+        
+        [entries addObject:entry];
+        offset += messageLength + 1;
+    }
+    
+    return entries;
+}
+
+@end
@@ -172,6 +172,12 @@ typedef void (^SimperiumSignoutCompletion)(void);
 // Toggle remote logging.
 @property (nonatomic, readwrite, assign) BOOL remoteLoggingEnabled;
 
+// When set, sync pipeline spans get written to this file, as Chrome trace-event JSON. Set to nil to finish the trace.
+@property (nonatomic, readwrite, copy, nullable) NSURL *traceFileURL;
+
+// When set, every websocket message, in both directions, gets recorded to this file (see SPWebSocketReplayer). Set to nil to finish the recording.
+@property (nonatomic, readwrite, copy, nullable) NSURL *webSocketRecordingURL;
+
 // Enables or disables the network.
 @property (nonatomic, readwrite, assign) BOOL networkEnabled;
 
@@ -181,6 +187,22 @@ typedef void (^SimperiumSignoutCompletion)(void);
 // Delays Inserted Objects initialization until the MOC is saved. Useful for importing data while preventing duplicates.
 @property (nonatomic, readwrite, assign) BOOL delaysNewObjectsInitialization;
 
+// Stores Core Data ghosts in a standalone binary store, rather than in each object's ghostData attribute: acknowledgements
+// will no longer dirty your objects. Should be set before starting Simperium, and not disabled afterwards.
+@property (nonatomic, readwrite, assign) BOOL ghostStoreEnabled;
+
+// Defers decoding incoming Core Data member values until they're first accessed (or saved). Members can opt out
+// by setting the `spDisableLazyLoading` key in their attribute's userInfo.
+@property (nonatomic, readwrite, assign) BOOL lazyMemberLoadingEnabled;
+
+// Caps the number of objects held in memory by non Core Data buckets. Least recently used objects will be spilled
+// to disk, and loaded back when needed. Zero (default) means unbounded.
+@property (nonatomic, readwrite, assign) NSUInteger maximumJSONObjectsInMemory;
+
+// Persists non Core Data buckets to disk (in a write-ahead log, plus periodic snapshots), so that they survive
+// restarts. Must be enabled before any of those buckets is accessed. Disabled by default.
+@property (nonatomic, readwrite, assign) BOOL JSONStoragePersistenceEnabled;
+
 // Enables or disables full database validation: objects with missing simperiumKey or ghost will be initialized.
 // By default this is enabled, and should be ran at least once after implementing Simperium on legacy databases.
 @property (nonatomic, readwrite, assign) BOOL validatesObjects;
@@ -13,13 +13,16 @@
 #import "SPMember.h"
 #import "SPDiffer.h"
 #import "SPGhost.h"
+#import "SPGhostStore.h"
 #import "SPEnvironment.h"
 #import "SPWebSocketInterface.h"
+#import "SPWebSocketRecorder.h"
 #import "SPBucket+Internals.h"
 #import "SPRelationshipResolver.h"
 #import "JSONKit+Simperium.h"
 #import "NSString+Simperium.h"
 #import "SPLogger.h"
+#import "SPTracer.h"
 #import "SPAuthenticationConfiguration.h"
 #import "TrustKit.h"
 
@@ -157,8 +160,33 @@ static SPLogLevels logLevel                     = SPLogLevelsInfo;
     // SPManagedObject's need the bucket list
     [storage setBucketList:buckets];
     
-    // Load metadata for pending references among objects
-    [self.relationshipResolver loadPendingRelationships:storage];
+    // Load pending references among objects: they get journaled next to the store (if possible)
+    NSURL *journalURL = [self relationshipJournalURLForCoordinator:coordinator];
+    [self.relationshipResolver loadPendingRelationships:storage journalURL:journalURL];
+}
+
+// Pending Relationships belong to a specific store: they're journaled next to it, under the store's UUID. Journals left
+// behind by a store that was deleted (or recreated) are never reapplied, and get nuked right away. Stores that aren't
+// backed by a file just keep them in their metadata.
+- (NSURL *)relationshipJournalURLForCoordinator:(NSPersistentStoreCoordinator *)coordinator {
+    NSPersistentStore *store = coordinator.persistentStores.firstObject;
+    if (!store.URL.isFileURL || store.identifier.length == 0 || [store.type isEqualToString:NSInMemoryStoreType]) {
+        return nil;
+    }
+    
+    NSString *folder            = [store.URL.lastPathComponent stringByAppendingString:@"-Simperium"];
+    NSURL *baseURL              = [store.URL.URLByDeletingLastPathComponent URLByAppendingPathComponent:folder isDirectory:YES];
+    NSFileManager *fileManager  = [NSFileManager defaultManager];
+    
+    for (NSURL *staleURL in [fileManager contentsOfDirectoryAtURL:baseURL includingPropertiesForKeys:nil options:0 error:nil]) {
+        if (![staleURL.lastPathComponent isEqualToString:store.identifier]) {
+            SPLogInfo(@"Simperium removing journals for stale store: %@", staleURL.lastPathComponent);
+            [fileManager removeItemAtURL:staleURL error:nil];
+        }
+    }
+    
+    NSString *journal           = [NSString stringWithFormat:@"Relationships-%@", self.label];
+    return [[baseURL URLByAppendingPathComponent:store.identifier isDirectory:YES] URLByAppendingPathComponent:journal isDirectory:YES];
 }
 
 
@@ -187,6 +215,8 @@ static SPLogLevels logLevel                     = SPLogLevelsInfo;
             bucket = [[SPBucket alloc] initWithSchema:schema storage:self.JSONStorage networkInterface:self.network
                                 relationshipResolver:self.relationshipResolver label:self.label remoteName:remoteName clientID:self.clientID];
 
+            // Objects loaded from disk don't know about their bucket just yet
+            [self.JSONStorage adoptObjectsForBucket:bucket];
             [self.buckets setObject:bucket forKey:name];
             
             if (self.networkManagersStarted) {
@@ -265,6 +295,52 @@ static SPLogLevels logLevel                     = SPLogLevelsInfo;
     return self.coreDataStorage.delaysNewObjectsInitialization;
 }
 
+- (void)setGhostStoreEnabled:(BOOL)ghostStoreEnabled {
+    if (ghostStoreEnabled == self.ghostStoreEnabled) {
+        return;
+    }
+    
+    NSString *ghostsLabel = [NSString stringWithFormat:@"ghosts-%@", self.label];
+    self.coreDataStorage.ghostStore = ghostStoreEnabled ? [SPGhostStore loadStoreWithLabel:ghostsLabel] : nil;
+}
+
+- (BOOL)ghostStoreEnabled {
+    return self.coreDataStorage.ghostStore != nil;
+}
+
+- (void)setLazyMemberLoadingEnabled:(BOOL)lazyMemberLoadingEnabled {
+    _lazyMemberLoadingEnabled = lazyMemberLoadingEnabled;
+    
+    for (SPBucket *bucket in self.buckets.allValues) {
+        bucket.schema.lazyLoadingEnabled = lazyMemberLoadingEnabled;
+    }
+}
+
+- (void)setMaximumJSONObjectsInMemory:(NSUInteger)maximumJSONObjectsInMemory {
+    self.JSONStorage.maximumObjectsInMemory = maximumJSONObjectsInMemory;
+}
+
+- (NSUInteger)maximumJSONObjectsInMemory {
+    return self.JSONStorage.maximumObjectsInMemory;
+}
+
+- (void)setJSONStoragePersistenceEnabled:(BOOL)JSONStoragePersistenceEnabled {
+    // Once loaded, the persistent store stays around
+    if (!JSONStoragePersistenceEnabled || self.JSONStoragePersistenceEnabled) {
+        return;
+    }
+    
+    NSURL *baseURL      = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] lastObject];
+    NSString *folder    = [NSString stringWithFormat:@"JSONStorage-%@", self.label];
+    NSURL *storeURL     = [[baseURL URLByAppendingPathComponent:@"Simperium" isDirectory:YES] URLByAppendingPathComponent:folder isDirectory:YES];
+    
+    [self.JSONStorage loadPersistentStoreAtURL:storeURL];
+}
+
+- (BOOL)JSONStoragePersistenceEnabled {
+    return !self.JSONStorage.isEphemeral;
+}
+
 
 #pragma mark ====================================================================================
 #pragma mark Buckets
@@ -624,6 +700,14 @@ static SPLogLevels logLevel                     = SPLogLevelsInfo;
 
 - (void)_finishSignout:(BOOL)remove completion:(SimperiumSignoutCompletion)completion {
     
+    // Ghosts belong to the account that just signed out: the next sync must not reuse them
+    SPGhostStore *ghostStore = self.coreDataStorage.ghostStore;
+    [ghostStore removeAllGhosts];
+    [ghostStore save];
+    
+    // Same goes for pending relationships, journaled or not
+    [self.relationshipResolver reset:self.coreDataStorage];
+    
     // Now delete all local content; no more changes will be coming in at this point
     if (remove) {
         SPLogInfo(@"Simperium removing all entities...");
@@ -729,6 +813,24 @@ static SPLogLevels logLevel                     = SPLogLevelsInfo;
     [[SPLogger sharedInstance] setSharedLogLevel:on ? SPLogLevelsVerbose : SPLogLevelsWarn];
 }
 
+- (void)setTraceFileURL:(NSURL *)traceFileURL {
+    _traceFileURL = [traceFileURL copy];
+    
+    if (traceFileURL) {
+        [[SPTracer sharedInstance] startTracingToURL:traceFileURL];
+    } else {
+        [[SPTracer sharedInstance] stopTracing];
+    }
+}
+
+- (void)setWebSocketRecordingURL:(NSURL *)webSocketRecordingURL {
+    _webSocketRecordingURL          = [webSocketRecordingURL copy];
+    
+    SPWebSocketInterface *websocket = (SPWebSocketInterface *)self.network;
+    [websocket.recorder close];
+    websocket.recorder              = webSocketRecordingURL ? [SPWebSocketRecorder recorderWithURL:webSocketRecordingURL] : nil;
+}
+
 - (BOOL)objectsShouldSync {
     // TODO: rename or possibly (re)move this
     return !self.skipContextProcessing;
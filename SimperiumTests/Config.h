@@ -18,5 +18,6 @@
 @property (nonatomic, strong) NSNumber *shieldPercent;
 @property (nonatomic, strong) NSDecimalNumber *cost;
 @property (nonatomic, strong) NSDate *date;
+@property (nonatomic, strong) NSDictionary *hologram;
 
 @end
@@ -17,6 +17,7 @@
 @dynamic shieldPercent;
 @dynamic cost;
 @dynamic date;
+@dynamic hologram;
 
 - (void)awakeFromInsert {
     [super awakeFromInsert];
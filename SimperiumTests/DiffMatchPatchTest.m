@@ -1047,6 +1047,60 @@
   XCTAssertEqual((NSUInteger)0, [dmp match_bitapOfText:@"abcdefghijklmnopqrstuvwxyz" andPattern:@"abcdefg" near:24], @"match_bitap: Distance test #3.");
 }
 
+- (void)testMatchBitapLongPatternTest {
+  DiffMatchPatch *dmp = [DiffMatchPatch new];
+  dmp.Match_MaxBits = 1024;
+  dmp.Match_Distance = 1000;
+  dmp.Match_Threshold = 0.5f;
+
+  NSMutableString *text = [NSMutableString string];
+  for (NSUInteger i = 0; i < 40; i++) {
+    [text appendFormat:@"%02lu: the quick brown fox jumps over the lazy dog. ", (unsigned long)i];
+  }
+
+  // Spans several 64-bit words, with a handful of errors.
+  NSMutableString *pattern = [[text substringWithRange:NSMakeRange(480, 300)] mutableCopy];
+  [pattern replaceCharactersInRange:NSMakeRange(10, 5) withString:@"XXXXX"];
+  [pattern replaceCharactersInRange:NSMakeRange(150, 3) withString:@"YY"];
+  [pattern replaceCharactersInRange:NSMakeRange(290, 4) withString:@"ZZZZZZ"];
+  XCTAssertEqual((NSUInteger)480, [dmp match_bitapOfText:text andPattern:pattern near:470], @"match_bitap: Long fuzzy match.");
+
+  // Word boundaries: exactly 64 and 65 characters.
+  NSString *pattern64 = [text substringWithRange:NSMakeRange(100, 64)];
+  NSString *pattern65 = [text substringWithRange:NSMakeRange(100, 65)];
+  XCTAssertEqual((NSUInteger)100, [dmp match_bitapOfText:text andPattern:pattern64 near:90], @"match_bitap: 64 characters.");
+  XCTAssertEqual((NSUInteger)100, [dmp match_bitapOfText:text andPattern:pattern65 near:90], @"match_bitap: 65 characters.");
+}
+
+- (void)testPatchApplyLongPatternTest {
+  DiffMatchPatch *dmp = [DiffMatchPatch new];
+  dmp.Match_MaxBits = 1024;
+
+  NSMutableString *original = [NSMutableString string];
+  NSMutableString *remote = [NSMutableString string];
+  for (NSUInteger i = 0; i < 40; i++) {
+    NSString *line = [NSString stringWithFormat:@"Line %02lu: the quick brown fox jumps over the lazy dog.\n", (unsigned long)i];
+    [original appendString:line];
+    if (i < 10 || i >= 20) {
+      [remote appendString:line];
+    } else if (i == 10) {
+      [remote appendFormat:@"%@\n", [@"" stringByPaddingToLength:100 withString:@"#" startingAtIndex:0]];
+    }
+  }
+
+  // A large remote change, applied over a locally diverged copy.
+  NSString *local = [original stringByReplacingOccurrencesOfString:@"Line 00" withString:@"First line"];
+  NSString *expected = [remote stringByReplacingOccurrencesOfString:@"Line 00" withString:@"First line"];
+
+  NSMutableArray *patches = [dmp patch_makeFromOldString:original andNewString:remote];
+  NSArray *results = [dmp patch_apply:patches toString:local];
+  NSArray *boolArray = [results objectAtIndex:1];
+
+  XCTAssertEqualObjects(expected, [results objectAtIndex:0], @"patch_apply: Long pattern.");
+  XCTAssertEqual((NSUInteger)1, boolArray.count, @"patch_apply: Long patterns shouldn't be split.");
+  XCTAssertEqualObjects(@"true", stringForBOOL([boolArray objectAtIndex:0]), @"patch_apply: Long pattern should apply.");
+}
+
 - (void)testMatchMainTest {
   DiffMatchPatch *dmp = [DiffMatchPatch new];
 
@@ -53,6 +53,12 @@ static NSInteger const SPWorkersDone = 0;
     return [self.storage[bucketName] allKeys];
 }
 
+- (void)enumerateObjectKeysForBucketName:(NSString *)bucketName usingBlock:(void (^)(NSString *simperiumKey, BOOL *stop))block {
+    [[self objectKeysForBucketName:bucketName] enumerateObjectsUsingBlock:^(NSString *key, NSUInteger idx, BOOL *stop) {
+        block(key, stop);
+    }];
+}
+
 - (id)objectForKey:(NSString *)key bucketName:(NSString *)bucketName {
     return self.storage[bucketName][key];
 }
@@ -0,0 +1,56 @@
+//
+//  SPBenchmarkTestCase.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+// Environment: Path of the JSON Lines file results get appended to. Defaults to $TMPDIR/SimperiumBenchmarks.jsonl
+extern NSString * const SPBenchmarkOutputEnvironmentKey;
+
+// Environment: Revision (commit hash, tag...) stamped on every result, for comparison across commits
+extern NSString * const SPBenchmarkRevisionEnvironmentKey;
+
+typedef void (^SPBenchmarkBlock)(void);
+
+
+#pragma mark ====================================================================================
+#pragma mark SPBenchmarkTestCase
+#pragma mark ====================================================================================
+
+// Base class for the Benchmarks target. Every test gets reseeded with the same fixed seed, so that the generated
+// payloads are identical across runs (and commits).
+//
+// Each benchmark runs a warm-up round, followed by a fixed number of samples. Results get logged, and appended as a
+// single JSON object per line: name, operations, samples, opsPerSecond (median), nsPerOperation (median),
+// allocationsPerOperation, bytesPerOperation, revision, seed and date.
+//
+// Note: Allocations are counted process-wide, via the malloc logger, while a sample is being measured.
+//
+@interface SPBenchmarkTestCase : XCTestCase
+
+@property (nonatomic, assign, readonly) uint64_t seed;
+
+// Deterministic Random Generators
+- (uint64_t)randomNumber;
+- (NSUInteger)randomNumberBelow:(NSUInteger)limit;
+- (NSString *)randomStringOfLength:(NSUInteger)length;
+- (NSString *)randomTextOfLength:(NSUInteger)length;
+- (NSString *)text:(NSString *)text withRandomEdits:(NSUInteger)edits;
+
+// The block is expected to perform `operations` operations per run
+- (void)benchmark:(NSString *)name operations:(NSUInteger)operations block:(SPBenchmarkBlock)block;
+
+// The prepare block runs before every sample (warm-up included), outside of the measurement
+- (void)benchmark:(NSString *)name operations:(NSUInteger)operations prepare:(SPBenchmarkBlock)prepare block:(SPBenchmarkBlock)block;
+
+@end
@@ -0,0 +1,271 @@
+//
+//  SPBenchmarkTestCase.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "JSONKit+Simperium.h"
+#import <time.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+NSString * const SPBenchmarkOutputEnvironmentKey        = @"SIMPERIUM_BENCHMARK_OUTPUT";
+NSString * const SPBenchmarkRevisionEnvironmentKey      = @"SIMPERIUM_BENCHMARK_REVISION";
+
+static NSString * const SPBenchmarkDefaultFilename      = @"SimperiumBenchmarks.jsonl";
+static uint64_t const SPBenchmarkSeed                   = 0x5350424D53454544;
+static NSUInteger const SPBenchmarkSamples              = 10;
+static double const SPBenchmarkNanosecondsPerSecond     = 1e9;
+static char const SPBenchmarkAlphabet[]                 = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static NSUInteger const SPBenchmarkMaxWordLength        = 9;
+
+
+#pragma mark ====================================================================================
+#pragma mark Allocation Counting
+#pragma mark ====================================================================================
+
+// libmalloc's logging hook: it's what `malloc_history` and Instruments rely on. Not declared in any public header.
+typedef void (SPMallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip);
+extern SPMallocLogger *malloc_logger;
+
+static uint32_t const SPMallocLogTypeAllocate           = 2;
+static uint32_t const SPMallocLogTypeDeallocate         = 4;
+
+static SPMallocLogger *SPBenchmarkPreviousLogger        = NULL;
+static BOOL SPBenchmarkCountingAllocations              = NO;
+static uint64_t SPBenchmarkAllocationCount              = 0;
+static uint64_t SPBenchmarkAllocationBytes              = 0;
+
+static void SPBenchmarkMallocLogger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip) {
+    if (SPBenchmarkPreviousLogger) {
+        SPBenchmarkPreviousLogger(type, arg1, arg2, arg3, result, numHotFramesToSkip + 1);
+    }
+    
+    if ((type & SPMallocLogTypeAllocate) == 0 || !__atomic_load_n(&SPBenchmarkCountingAllocations, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    // realloc gets logged as (zone, pointer, size), while malloc + friends as (zone, size)
+    uintptr_t size = (type & SPMallocLogTypeDeallocate) ? arg3 : arg2;
+    
+    __atomic_add_fetch(&SPBenchmarkAllocationCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&SPBenchmarkAllocationBytes, size, __ATOMIC_RELAXED);
+}
+
+static void SPBenchmarkInstallMallocLogger(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        SPBenchmarkPreviousLogger   = malloc_logger;
+        malloc_logger               = SPBenchmarkMallocLogger;
+    });
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPBenchmarkTestCase ()
+@property (nonatomic, assign, readwrite) uint64_t seed;
+@property (nonatomic, assign, readwrite) uint64_t state;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPBenchmarkTestCase
+#pragma mark ====================================================================================
+
+@implementation SPBenchmarkTestCase
+
++ (void)setUp {
+    [super setUp];
+    SPBenchmarkInstallMallocLogger();
+}
+
+- (void)setUp {
+    [super setUp];
+    self.seed   = SPBenchmarkSeed;
+    self.state  = SPBenchmarkSeed;
+}
+
+
+#pragma mark - Random Generators
+
+// xorshift64*: fast, and most importantly, identical on every platform and run
+- (uint64_t)randomNumber {
+    uint64_t x  = self.state;
+    x           ^= x >> 12;
+    x           ^= x << 25;
+    x           ^= x >> 27;
+    self.state  = x;
+    
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+- (NSUInteger)randomNumberBelow:(NSUInteger)limit {
+    NSParameterAssert(limit > 0);
+    return (NSUInteger)([self randomNumber] % limit);
+}
+
+- (NSString *)randomStringOfLength:(NSUInteger)length {
+    NSUInteger alphabetLength   = sizeof(SPBenchmarkAlphabet) - 1;
+    NSMutableString *string     = [NSMutableString stringWithCapacity:length];
+    
+    for (NSUInteger i = 0; i < length; ++i) {
+        [string appendFormat:@"%c", SPBenchmarkAlphabet[[self randomNumberBelow:alphabetLength]]];
+    }
+    
+    return string;
+}
+
+// Words and whitespace: diff-match-patch behaves quite differently on prose than on random characters
+- (NSString *)randomTextOfLength:(NSUInteger)length {
+    NSMutableString *text = [NSMutableString stringWithCapacity:length + SPBenchmarkMaxWordLength];
+    
+    while (text.length < length) {
+        NSUInteger wordLength = [self randomNumberBelow:SPBenchmarkMaxWordLength] + 1;
+        [text appendString:[[self randomStringOfLength:wordLength] lowercaseString]];
+        [text appendString:([self randomNumberBelow:12] == 0 ? @"\n" : @" ")];
+    }
+    
+    return [text substringToIndex:length];
+}
+
+- (NSString *)text:(NSString *)text withRandomEdits:(NSUInteger)edits {
+    NSMutableString *edited = [text mutableCopy];
+    
+    for (NSUInteger i = 0; i < edits; ++i) {
+        NSUInteger location = [self randomNumberBelow:edited.length + 1];
+        NSUInteger length   = MIN([self randomNumberBelow:SPBenchmarkMaxWordLength] + 1, edited.length - location);
+        
+        switch ([self randomNumberBelow:3]) {
+            case 0:
+                [edited insertString:[self randomTextOfLength:SPBenchmarkMaxWordLength] atIndex:location];
+                break;
+            case 1:
+                [edited deleteCharactersInRange:NSMakeRange(location, length)];
+                break;
+            default:
+                [edited replaceCharactersInRange:NSMakeRange(location, length) withString:[self randomStringOfLength:length]];
+                break;
+        }
+    }
+    
+    return edited;
+}
+
+
+#pragma mark - Benchmarking
+
+- (void)benchmark:(NSString *)name operations:(NSUInteger)operations block:(SPBenchmarkBlock)block {
+    [self benchmark:name operations:operations prepare:nil block:block];
+}
+
+- (void)benchmark:(NSString *)name operations:(NSUInteger)operations prepare:(SPBenchmarkBlock)prepare block:(SPBenchmarkBlock)block {
+    NSParameterAssert(name);
+    NSParameterAssert(operations > 0);
+    NSParameterAssert(block);
+    
+    SPBenchmarkInstallMallocLogger();
+    
+    // Warm up: caches, lazily loaded classes and schemas shouldn't count
+    [self runSampleWithPrepare:prepare block:block];
+    
+    uint64_t allocationCount    = __atomic_load_n(&SPBenchmarkAllocationCount, __ATOMIC_RELAXED);
+    uint64_t allocationBytes    = __atomic_load_n(&SPBenchmarkAllocationBytes, __ATOMIC_RELAXED);
+    NSMutableArray *durations   = [NSMutableArray arrayWithCapacity:SPBenchmarkSamples];
+    
+    for (NSUInteger i = 0; i < SPBenchmarkSamples; ++i) {
+        [durations addObject:@([self runSampleWithPrepare:prepare block:block])];
+    }
+    
+    allocationCount             = __atomic_load_n(&SPBenchmarkAllocationCount, __ATOMIC_RELAXED) - allocationCount;
+    allocationBytes             = __atomic_load_n(&SPBenchmarkAllocationBytes, __ATOMIC_RELAXED) - allocationBytes;
+    
+    [durations sortUsingSelector:@selector(compare:)];
+    
+    double totalOperations      = (double)operations * SPBenchmarkSamples;
+    double medianDuration       = MAX([durations[SPBenchmarkSamples / 2] doubleValue], 1);
+    double nsPerOperation       = medianDuration / operations;
+    double opsPerSecond         = SPBenchmarkNanosecondsPerSecond / nsPerOperation;
+    
+    NSDictionary *result = @{
+        @"name"                     : name,
+        @"operations"               : @(operations),
+        @"samples"                  : @(SPBenchmarkSamples),
+        @"opsPerSecond"             : @(round(opsPerSecond)),
+        @"nsPerOperation"           : @(round(nsPerOperation)),
+        @"allocationsPerOperation"  : @(allocationCount / totalOperations),
+        @"bytesPerOperation"        : @(round(allocationBytes / totalOperations)),
+        @"revision"                 : [self revision],
+        @"seed"                     : @(self.seed),
+        @"date"                     : @(floor([[NSDate date] timeIntervalSince1970]))
+    };
+    
+    NSLog(@"<> Benchmark %@: %.0f ops/sec, %.0f ns/op, %.1f allocations/op", name, opsPerSecond, nsPerOperation, allocationCount / totalOperations);
+    [self appendResult:result];
+}
+
+
+#pragma mark - Private Helpers
+
+- (uint64_t)runSampleWithPrepare:(SPBenchmarkBlock)prepare block:(SPBenchmarkBlock)block {
+    @autoreleasepool {
+        if (prepare) {
+            prepare();
+        }
+    }
+    
+    uint64_t startTime = 0;
+    uint64_t endTime   = 0;
+    
+    // Autoreleased objects are part of the cost: drain them within the measurement
+    @autoreleasepool {
+        __atomic_store_n(&SPBenchmarkCountingAllocations, YES, __ATOMIC_RELAXED);
+        startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        
+        @autoreleasepool {
+            block();
+        }
+        
+        endTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        __atomic_store_n(&SPBenchmarkCountingAllocations, NO, __ATOMIC_RELAXED);
+    }
+    
+    return endTime - startTime;
+}
+
+- (NSString *)revision {
+    return [[NSProcessInfo processInfo] environment][SPBenchmarkRevisionEnvironmentKey] ?: @"";
+}
+
+- (NSString *)outputPath {
+    NSString *path = [[NSProcessInfo processInfo] environment][SPBenchmarkOutputEnvironmentKey];
+    return path.length ? path : [NSTemporaryDirectory() stringByAppendingPathComponent:SPBenchmarkDefaultFilename];
+}
+
+- (void)appendResult:(NSDictionary *)result {
+    NSString *path      = [self outputPath];
+    NSString *line      = [[result sp_JSONString] stringByAppendingString:@"\n"];
+    NSFileManager *fm   = [NSFileManager defaultManager];
+    
+    if (![fm fileExistsAtPath:path]) {
+        [fm createFileAtPath:path contents:nil attributes:nil];
+    }
+    
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:path];
+    XCTAssertNotNil(fileHandle, @"Couldn't open the benchmark output at %@", path);
+    
+    [fileHandle seekToEndOfFile];
+    [fileHandle writeData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+    [fileHandle closeFile];
+}
+
+@end
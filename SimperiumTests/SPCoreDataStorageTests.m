@@ -329,6 +329,68 @@ static NSTimeInterval const SPExpectationTimeout         = 60.0;
     }];
 }
 
+- (NSSet *)enumeratedKeysForBucketName:(NSString *)bucketName storage:(id<SPStorageProvider>)storage {
+    NSMutableSet *keys = [NSMutableSet set];
+    [storage enumerateObjectKeysForBucketName:bucketName usingBlock:^(NSString *simperiumKey, BOOL *stop) {
+        [keys addObject:simperiumKey];
+    }];
+    return keys;
+}
+
+- (void)commitPendingOperations {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Commit Expectation"];
+    [self.storage commitPendingOperations:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:SPExpectationTimeout handler:nil];
+}
+
+- (void)testObjectKeySetTracksSavesPerformedByEveryContext {
+    
+    NSString *postBucketName                    = NSStringFromClass([Post class]);
+    NSMutableSet *expected                      = [NSMutableSet set];
+    
+    for (NSInteger i = 0; ++i <= SPNumberOfPosts; ) {
+        Post *post = [self.storage insertNewObjectForBucketName:postBucketName simperiumKey:nil];
+        [expected addObject:post.simperiumKey];
+    }
+    
+    [self.storage save];
+    [self commitPendingOperations];
+    
+    XCTAssertEqualObjects([self enumeratedKeysForBucketName:postBucketName storage:self.storage], expected);
+    
+    // Main Context: Deletions
+    Post *deletedPost = [self.storage objectForKey:expected.anyObject bucketName:postBucketName];
+    [expected removeObject:deletedPost.simperiumKey];
+    [self.storage deleteObject:deletedPost];
+    [self.storage save];
+    [self commitPendingOperations];
+    
+    XCTAssertEqualObjects([self enumeratedKeysForBucketName:postBucketName storage:self.storage], expected);
+    
+    // Worker Contexts: Insertions
+    XCTestExpectation *workerExpectation        = [self expectationWithDescription:@"Worker Expectation"];
+    SPBucket *postBucket                        = [self.simperium bucketForName:postBucketName];
+    
+    dispatch_async(postBucket.processorQueue, ^{
+        id<SPStorageProvider> threadSafeStorage = [self.storage threadSafeStorage];
+        [threadSafeStorage performSafeBlockAndWait:^{
+            Post *post = [threadSafeStorage insertNewObjectForBucketName:postBucketName simperiumKey:@"worker"];
+            post.title = @"Worker";
+            [threadSafeStorage save];
+        }];
+        
+        XCTAssertTrue([[self enumeratedKeysForBucketName:postBucketName storage:threadSafeStorage] containsObject:@"worker"]);
+        [workerExpectation fulfill];
+    });
+    
+    [self waitForExpectationsWithTimeout:SPExpectationTimeout handler:nil];
+    
+    [expected addObject:@"worker"];
+    XCTAssertEqualObjects([NSSet setWithArray:[self.storage objectKeysForBucketName:postBucketName]], expected);
+}
+
 - (void)testDeletedEntitiesInWorkersWithUnmergedChangesAnywhereDontTriggerInaccessibleObjectException {
 
     [SPCoreDataStorage test_simulateWorkerCannotMergeChangesAnywhere];
@@ -0,0 +1,212 @@
+//
+//  SPDifferBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "SPDiffer.h"
+#import "SPSchema.h"
+#import "SPObject.h"
+#import "SPGhost.h"
+#import "JSONKit+Simperium.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPDifferBenchmarksBucket        = @"Benchmark";
+static NSString * const SPDifferBenchmarksMember        = @"value";
+static NSString * const SPDifferBenchmarksKey           = @"key";
+static NSUInteger const SPDifferBenchmarksOperations    = 1000;
+static NSUInteger const SPDifferBenchmarksTextLength    = 1024;
+static NSUInteger const SPDifferBenchmarksTextEdits     = 8;
+static NSUInteger const SPDifferBenchmarksBinaryLength  = 4096;
+static NSUInteger const SPDifferBenchmarksListLength    = 64;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPDifferBenchmarks
+#pragma mark ====================================================================================
+
+// Entity members are left out: they can only be resolved against a Core Data context.
+// List members are left out as well: their ghost values don't round trip through the SPDiffer (see SPMemberList).
+//
+@interface SPDifferBenchmarks : SPBenchmarkTestCase
+
+@end
+
+@implementation SPDifferBenchmarks
+
+- (void)testTextMember {
+    NSString *text      = [self randomTextOfLength:SPDifferBenchmarksTextLength];
+    NSString *edited    = [self text:text withRandomEdits:SPDifferBenchmarksTextEdits];
+    
+    [self benchmarkMemberOfType:@"text" ghostValue:text baseValue:text modifiedValue:edited];
+}
+
+- (void)testIntMember {
+    NSNumber *value     = @([self randomNumberBelow:INT32_MAX]);
+    NSNumber *modified  = @(value.integerValue + 1);
+    
+    [self benchmarkMemberOfType:@"int" ghostValue:value baseValue:value modifiedValue:modified];
+}
+
+- (void)testBoolMember {
+    [self benchmarkMemberOfType:@"bool" ghostValue:@NO baseValue:@NO modifiedValue:@YES];
+}
+
+- (void)testDoubleMember {
+    NSNumber *value     = @([self randomNumberBelow:INT32_MAX] / 1000.0);
+    NSNumber *modified  = @(value.doubleValue + 0.5);
+    
+    [self benchmarkMemberOfType:@"double" ghostValue:value baseValue:value modifiedValue:modified];
+}
+
+- (void)testDateMember {
+    NSTimeInterval timestamp    = [self randomNumberBelow:INT32_MAX];
+    NSDate *date                = [NSDate dateWithTimeIntervalSince1970:timestamp];
+    NSDate *modified            = [date dateByAddingTimeInterval:60];
+    
+    [self benchmarkMemberOfType:@"date" ghostValue:@(timestamp) baseValue:date modifiedValue:modified];
+}
+
+- (void)testDictionaryMember {
+    NSDictionary *value     = [self randomDictionaryWithDepth:1];
+    NSDictionary *modified  = [self dictionary:value withRandomEditsAtDepth:1];
+    
+    [self benchmarkMemberOfType:@"dictionary" ghostValue:value baseValue:value modifiedValue:modified];
+}
+
+- (void)testJSONMember {
+    NSDictionary *value     = [self randomDictionaryWithDepth:3];
+    NSDictionary *modified  = [self dictionary:value withRandomEditsAtDepth:3];
+    
+    [self benchmarkMemberOfType:@"json" ghostValue:value baseValue:value modifiedValue:modified];
+}
+
+- (void)testJSONListMember {
+    NSArray *list           = [self randomListOfLength:SPDifferBenchmarksListLength];
+    NSMutableArray *edited  = [list mutableCopy];
+    [edited replaceObjectAtIndex:[self randomNumberBelow:edited.count] withObject:[self randomStringOfLength:16]];
+    [edited addObject:[self randomStringOfLength:16]];
+    
+    [self benchmarkMemberOfType:@"jsonlist" ghostValue:list baseValue:[list sp_JSONString] modifiedValue:[edited sp_JSONString]];
+}
+
+- (void)testBase64Member {
+    NSData *data            = [self randomDataOfLength:SPDifferBenchmarksBinaryLength];
+    NSMutableData *edited   = [data mutableCopy];
+    [edited appendData:[self randomDataOfLength:SPDifferBenchmarksBinaryLength / 8]];
+    
+    [self benchmarkMemberOfType:@"base64" ghostValue:[data base64EncodedStringWithOptions:0] baseValue:data modifiedValue:edited];
+}
+
+
+#pragma mark - Helpers
+
+// Ghost Values are encoded as they come off the wire. Base and Modified Values are encoded as the objects hold them
+- (void)benchmarkMemberOfType:(NSString *)type ghostValue:(id)ghostValue baseValue:(id)baseValue modifiedValue:(id)modifiedValue {
+    NSDictionary *definition    = @{ @"members" : @[ @{ @"name" : SPDifferBenchmarksMember, @"type" : type } ] };
+    SPSchema *schema            = [[SPSchema alloc] initWithBucketName:SPDifferBenchmarksBucket data:definition];
+    SPDiffer *differ            = [[SPDiffer alloc] initWithSchema:schema];
+    
+    NSDictionary *ghostData     = @{ SPDifferBenchmarksMember : ghostValue };
+    SPObject *modifiedObject    = [self objectWithValue:modifiedValue ghostData:ghostData];
+    NSDictionary *diff          = [differ diffFromDictionary:ghostData toObject:modifiedObject];
+    
+    XCTAssertTrue(diff.count == 1, @"Inconsistency detected");
+    
+    [self benchmark:[NSString stringWithFormat:@"differ.%@.diff", type] operations:SPDifferBenchmarksOperations block:^{
+        for (NSUInteger i = 0; i < SPDifferBenchmarksOperations; ++i) {
+            [differ diffFromDictionary:ghostData toObject:modifiedObject];
+        }
+    }];
+    
+    // Applying mutates the target: every sample gets a fresh batch of objects, outside of the measurement
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:SPDifferBenchmarksOperations];
+    
+    [self benchmark:[NSString stringWithFormat:@"differ.%@.apply", type] operations:SPDifferBenchmarksOperations prepare:^{
+        [objects removeAllObjects];
+        for (NSUInteger i = 0; i < SPDifferBenchmarksOperations; ++i) {
+            [objects addObject:[self objectWithValue:baseValue ghostData:ghostData]];
+        }
+    } block:^{
+        for (SPObject *object in objects) {
+            [differ applyDiffFromDictionary:diff toObject:object error:nil];
+        }
+    }];
+}
+
+- (SPObject *)objectWithValue:(id)value ghostData:(NSDictionary *)ghostData {
+    SPObject *object    = [[SPObject alloc] initWithDictionary:[@{ SPDifferBenchmarksMember : value } mutableCopy]];
+    object.ghost        = [[SPGhost alloc] initWithKey:SPDifferBenchmarksKey memberData:ghostData];
+    object.simperiumKey = SPDifferBenchmarksKey;
+    
+    return object;
+}
+
+- (NSData *)randomDataOfLength:(NSUInteger)length {
+    NSMutableData *data = [NSMutableData dataWithCapacity:length];
+    
+    while (data.length < length) {
+        uint64_t random = [self randomNumber];
+        [data appendBytes:&random length:MIN(sizeof(random), length - data.length)];
+    }
+    
+    return data;
+}
+
+- (NSArray *)randomListOfLength:(NSUInteger)length {
+    NSMutableArray *list = [NSMutableArray arrayWithCapacity:length];
+    
+    for (NSUInteger i = 0; i < length; ++i) {
+        [list addObject:[self randomStringOfLength:16]];
+    }
+    
+    return list;
+}
+
+- (NSDictionary *)randomDictionaryWithDepth:(NSUInteger)depth {
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    
+    for (NSUInteger i = 0; i < 8; ++i) {
+        NSString *key = [NSString stringWithFormat:@"key%lu", (unsigned long)i];
+        
+        switch (i % 4) {
+            case 0:
+                dictionary[key] = [self randomStringOfLength:32];
+                break;
+            case 1:
+                dictionary[key] = @([self randomNumberBelow:INT32_MAX]);
+                break;
+            case 2:
+                dictionary[key] = [self randomListOfLength:4];
+                break;
+            default:
+                dictionary[key] = depth > 1 ? [self randomDictionaryWithDepth:depth - 1] : @([self randomNumberBelow:2] == 0);
+                break;
+        }
+    }
+    
+    return dictionary;
+}
+
+- (NSDictionary *)dictionary:(NSDictionary *)dictionary withRandomEditsAtDepth:(NSUInteger)depth {
+    NSMutableDictionary *edited = [dictionary mutableCopy];
+    
+    edited[@"key0"] = [self randomStringOfLength:32];
+    edited[@"key1"] = @([self randomNumberBelow:INT32_MAX]);
+    
+    if (depth > 1) {
+        edited[@"key3"] = [self dictionary:dictionary[@"key3"] withRandomEditsAtDepth:depth - 1];
+    }
+    
+    return edited;
+}
+
+@end
@@ -0,0 +1,134 @@
+//
+//  SPGhostStoreTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPGhostStore.h"
+#import "SPGhost.h"
+#import "NSString+Simperium.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPGhostStoreTestsBucket = @"Config";
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostStoreTests
+#pragma mark ====================================================================================
+
+@interface SPGhostStoreTests : XCTestCase
+@end
+
+@implementation SPGhostStoreTests
+
+- (SPGhost *)sampleGhost {
+    NSDictionary *memberData = @{
+        @"captainsLog"  : @"Stardate 41153.7 — Our destination is planet Deneb IV 🚀",
+        @"warpSpeed"    : @(9),
+        @"cost"         : @(1.5),
+        @"enabled"      : @(YES),
+        @"tags"         : @[ @"enterprise", @"ncc-1701-d" ],
+        @"settings"     : @{ @"shields" : @"up", @"alert" : [NSNull null] },
+        @"empty"        : @""
+    };
+    
+    SPGhost *ghost  = [[SPGhost alloc] initWithKey:[NSString sp_makeUUID] memberData:memberData];
+    ghost.version   = @"42";
+    return ghost;
+}
+
+- (void)testBinaryEncodingRoundtrips {
+    SPGhost *ghost      = [self sampleGhost];
+    NSData *data        = [SPGhostStore dataWithGhost:ghost];
+    SPGhost *decoded    = [SPGhostStore ghostWithData:data key:ghost.key];
+    
+    XCTAssertNotNil(decoded, @"Error decoding ghost");
+    XCTAssertEqualObjects(decoded.key, ghost.key, @"Invalid Key");
+    XCTAssertEqualObjects(decoded.version, ghost.version, @"Invalid Version");
+    XCTAssertEqualObjects(decoded.memberData, ghost.memberData, @"Invalid Member Data");
+    XCTAssertFalse(decoded.needsSave, @"Freshly decoded ghosts should not need a save");
+}
+
+- (void)testBinaryEncodingPreservesMissingMemberData {
+    SPGhost *ghost      = [[SPGhost alloc] initWithKey:[NSString sp_makeUUID] memberData:nil];
+    ghost.version       = @"0";
+    
+    SPGhost *decoded    = [SPGhostStore ghostWithData:[SPGhostStore dataWithGhost:ghost] key:ghost.key];
+    
+    XCTAssertNotNil(decoded, @"Error decoding ghost");
+    XCTAssertNil(decoded.memberData, @"Ghosts without member data should remain that way");
+    XCTAssertEqualObjects(decoded.version, @"0", @"Invalid Version");
+}
+
+- (void)testMalformedRecordsAreRejected {
+    NSData *data        = [SPGhostStore dataWithGhost:[self sampleGhost]];
+    NSData *truncated   = [data subdataWithRange:NSMakeRange(0, data.length - 1)];
+    
+    XCTAssertNil([SPGhostStore ghostWithData:truncated key:@"key"], @"Truncated records should be rejected");
+    XCTAssertNil([SPGhostStore ghostWithData:[NSData data] key:@"key"], @"Empty records should be rejected");
+}
+
+- (void)testGhostsAreEffectivelyPersisted {
+    NSString *label     = [NSString sp_makeUUID];
+    SPGhostStore *store = [SPGhostStore loadStoreWithLabel:label];
+    SPGhost *ghost      = [self sampleGhost];
+    
+    [store setGhost:ghost forKey:ghost.key bucketName:SPGhostStoreTestsBucket];
+    
+    // Update a single member, and store it again
+    ghost.memberData[@"captainsLog"] = @"Stardate 41153.8";
+    ghost.version = @"43";
+    [store setGhost:ghost forKey:ghost.key bucketName:SPGhostStoreTestsBucket];
+    
+    XCTAssertTrue([store save], @"Error saving the store");
+    
+    // Reload from disk
+    SPGhostStore *reloaded  = [SPGhostStore loadStoreWithLabel:label];
+    SPGhost *stored         = [reloaded ghostForKey:ghost.key bucketName:SPGhostStoreTestsBucket];
+    
+    XCTAssertEqualObjects(stored.version, @"43", @"Invalid Version");
+    XCTAssertEqualObjects(stored.memberData, ghost.memberData, @"Invalid Member Data");
+    XCTAssertFalse(stored == [reloaded ghostForKey:ghost.key bucketName:SPGhostStoreTestsBucket], @"Ghost instances should not be shared");
+    XCTAssertNil([reloaded ghostForKey:ghost.key bucketName:@"AnotherBucket"], @"Ghosts should be keyed by bucket");
+    
+    // Nuke
+    [reloaded removeGhostForKey:ghost.key bucketName:SPGhostStoreTestsBucket];
+    XCTAssertNil([reloaded ghostForKey:ghost.key bucketName:SPGhostStoreTestsBucket], @"Error removing ghost");
+    
+    [reloaded removeAllGhosts];
+    [reloaded save];
+}
+
+- (void)testGhostsAreRemovedPerBucketWithoutCollisions {
+    SPGhostStore *store = [SPGhostStore loadStoreWithLabel:[NSString sp_makeUUID]];
+    SPGhost *ghost      = [self sampleGhost];
+    SPGhost *otherGhost = [self sampleGhost];
+    otherGhost.version  = @"7";
+    
+    // "a.b" + "c" and "a" + "b.c" used to map to the very same record
+    [store setGhost:ghost forKey:@"c" bucketName:@"a.b"];
+    [store setGhost:otherGhost forKey:@"b.c" bucketName:@"a"];
+    
+    XCTAssertEqualObjects([store ghostForKey:@"c" bucketName:@"a.b"].version, @"42", @"Ghosts should not collide");
+    XCTAssertEqualObjects([store ghostForKey:@"b.c" bucketName:@"a"].version, @"7", @"Ghosts should not collide");
+    
+    [store removeGhostsForBucketName:@"a"];
+    
+    XCTAssertNil([store ghostForKey:@"b.c" bucketName:@"a"], @"The bucket's ghosts should be gone");
+    XCTAssertNotNil([store ghostForKey:@"c" bucketName:@"a.b"], @"Other buckets should keep their ghosts");
+    
+    [store removeAllGhosts];
+    
+    XCTAssertNil([store ghostForKey:@"c" bucketName:@"a.b"], @"Every ghost should be gone");
+    [store save];
+}
+
+@end
@@ -0,0 +1,154 @@
+//
+//  SPGhostTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <malloc/malloc.h>
+#import "SPGhost.h"
+#import "SPGhostMemberData.h"
+#import "SPObject.h"
+#import "SPSchema.h"
+#import "SPDiffer.h"
+#import "SPMember.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSInteger const SPGhostTestsMemberCount      = 50;
+static NSInteger const SPGhostTestsRemoteChanges    = 1000;
+static NSInteger const SPGhostTestsEditedMembers    = 5;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPGhostTests
+#pragma mark ====================================================================================
+
+@interface SPGhostTests : XCTestCase
+@end
+
+@implementation SPGhostTests
+
+- (NSString *)memberNameAtIndex:(NSInteger)index {
+    return [NSString stringWithFormat:@"member%ld", (long)index];
+}
+
+- (NSMutableDictionary *)sampleMemberData {
+    NSMutableDictionary *memberData = [NSMutableDictionary dictionary];
+    for (NSInteger i = 0; i < SPGhostTestsMemberCount; ++i) {
+        memberData[[self memberNameAtIndex:i]] = [NSString stringWithFormat:@"Initial value for member %ld", (long)i];
+    }
+    return memberData;
+}
+
+- (size_t)bytesInUse {
+    malloc_statistics_t statistics;
+    malloc_zone_statistics(NULL, &statistics);
+    return statistics.size_in_use;
+}
+
+// Keeps a snapshot of the map before every write, the way the Change Processor keeps the old ghost around
+- (size_t)bytesRetainedBySnapshotsOfMemberData:(NSMutableDictionary *)memberData {
+    NSMutableArray *snapshots   = [NSMutableArray arrayWithCapacity:SPGhostTestsRemoteChanges];
+    size_t before               = [self bytesInUse];
+    
+    @autoreleasepool {
+        for (NSInteger i = 0; i < SPGhostTestsRemoteChanges; ++i) {
+            [snapshots addObject:[memberData mutableCopy]];
+            memberData[[self memberNameAtIndex:i % SPGhostTestsEditedMembers]] = @(i);
+        }
+    }
+    
+    size_t after = [self bytesInUse];
+    XCTAssertEqual(snapshots.count, (NSUInteger)SPGhostTestsRemoteChanges, @"Snapshots went missing");
+    
+    return after > before ? after - before : 0;
+}
+
+- (void)testSnapshotsOnlyAllocateModifiedMembers {
+    NSMutableDictionary *plainData  = [self sampleMemberData];
+    NSMutableDictionary *ghostData  = [SPGhostMemberData dictionaryWithDictionary:[self sampleMemberData]];
+    
+    size_t plainBytes               = [self bytesRetainedBySnapshotsOfMemberData:plainData];
+    size_t ghostBytes               = [self bytesRetainedBySnapshotsOfMemberData:ghostData];
+    
+    XCTAssertEqualObjects(ghostData, plainData, @"Both maps should hold the same members");
+    XCTAssertLessThan(ghostBytes * 3, plainBytes, @"Snapshots should only allocate the members modified after them");
+}
+
+- (void)testCopiesShareStorageUntilMutated {
+    SPGhost *ghost      = [[SPGhost alloc] initWithKey:@"key" memberData:[self sampleMemberData]];
+    SPGhost *ghostCopy  = [ghost copy];
+    SPGhost *ghostMCopy = [ghost mutableCopy];
+    
+    XCTAssertEqualObjects(ghostCopy.memberData, ghost.memberData, @"Copies should hold the same members");
+    XCTAssertEqualObjects(ghostMCopy.memberData, ghost.memberData, @"Copies should hold the same members");
+    
+    // In-place mutations (as done by the Relationship Resolver) must not leak into the copies
+    NSString *originalValue = ghost.memberData[@"member0"];
+    [ghost.memberData setObject:@"Updated" forKey:@"member0"];
+    
+    XCTAssertEqualObjects(ghost.memberData[@"member0"], @"Updated", @"Write went missing");
+    XCTAssertEqualObjects(ghostCopy.memberData[@"member0"], originalValue, @"Write leaked into a copy");
+    XCTAssertEqualObjects(ghostMCopy.memberData[@"member0"], originalValue, @"Write leaked into a copy");
+    
+    [ghost.memberData removeObjectForKey:@"member1"];
+    
+    XCTAssertNil(ghost.memberData[@"member1"], @"Removal went missing");
+    XCTAssertEqual(ghost.memberData.count, (NSUInteger)SPGhostTestsMemberCount - 1, @"Removal wasn't counted");
+    XCTAssertFalse([[ghost.memberData allKeys] containsObject:@"member1"], @"Removed member is still enumerated");
+    XCTAssertNotNil(ghostCopy.memberData[@"member1"], @"Removal leaked into a copy");
+    
+    // Once the copies are gone, the writer owns the storage again
+    ghostCopy   = nil;
+    ghostMCopy  = nil;
+    [ghost.memberData setObject:@"Owned" forKey:@"member2"];
+    
+    SPGhost *laterCopy = [ghost copy];
+    XCTAssertEqualObjects(laterCopy.memberData, ghost.memberData, @"Copies should hold the same members");
+    XCTAssertEqualObjects(laterCopy.memberData[@"member0"], @"Updated", @"Changes should carry over into later copies");
+}
+
+- (void)testRemoteChangesKeepUntouchedMembers {
+    SPSchema *schema            = [[SPSchema alloc] initWithBucketName:@"Ghost" data:@{ @"members" : @[] }];
+    schema.dynamic              = YES;
+    
+    SPDiffer *differ            = [[SPDiffer alloc] initWithSchema:schema];
+    NSMutableDictionary *data   = [self sampleMemberData];
+    SPObject *object            = [[SPObject alloc] initWithDictionary:data];
+    object.ghost                = [[SPGhost alloc] initWithKey:@"key" memberData:data];
+    
+    for (NSString *key in data) {
+        [schema ensureDynamicMemberExistsForObject:data[key] key:key];
+    }
+    
+    NSDictionary *initialData   = [object.ghost.memberData copy];
+    
+    // Simulate the Change Processor's remote modify path: remember the old ghost, then apply the diff to the ghost
+    for (NSInteger i = 0; i < SPGhostTestsRemoteChanges; ++i) {
+        NSString *memberName    = [self memberNameAtIndex:i % (SPGhostTestsMemberCount / 2)];
+        NSString *newValue      = [NSString stringWithFormat:@"Remote value %ld", (long)i];
+        NSDictionary *diff      = @{ memberName : @{ OP_OP : OP_REPLACE, OP_VALUE : newValue } };
+        
+        SPGhost *oldGhost       = [object.ghost copy];
+        NSError *error          = nil;
+        
+        XCTAssertTrue([differ applyGhostDiffFromDictionary:diff toObject:object error:&error], @"Error: %@", error);
+        XCTAssertEqualObjects(object.ghost.memberData[memberName], newValue, @"Diff went missing");
+        XCTAssertFalse([oldGhost.memberData[memberName] isEqual:newValue], @"Diff leaked into the old ghost");
+    }
+    
+    // Untouched members must still be the very same instances
+    for (NSInteger i = SPGhostTestsMemberCount / 2; i < SPGhostTestsMemberCount; ++i) {
+        NSString *memberName = [self memberNameAtIndex:i];
+        XCTAssertTrue(object.ghost.memberData[memberName] == initialData[memberName], @"Untouched member %@ was copied", memberName);
+    }
+}
+
+@end
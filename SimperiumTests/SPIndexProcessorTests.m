@@ -609,6 +609,127 @@ static NSTimeInterval const SPExpectationTimeout    = 60.0;
 }
 
 
+- (void)testProcessVersionsWithManyLocallyModifiedObjectsRebasesEveryObject {
+    
+    // ===================================================================================================
+	// Testing values!
+    // ===================================================================================================
+    //
+    // Enough objects to get the rebase spread across several threads
+    NSString *originalLog           = @"Original Captains Log";
+    NSString *localPendingLog       = @"Something Original Captains Log";
+    NSString *newRemoteLog          = @"Remote Original Captains Log Suffixed";
+    NSString *expectedLog           = @"Remote Something Original Captains Log Suffixed";
+    
+    
+    // ===================================================================================================
+	// Helpers
+    // ===================================================================================================
+    //
+    SPBucket* bucket = self.configBucket;
+    
+    
+    // ===================================================================================================
+	// Insert Configs + Manually Intialize their SPGhost
+    // ===================================================================================================
+    //
+    NSMutableArray *configs         = [NSMutableArray array];
+    
+    for (NSInteger i = 0; i < SPNumberOfEntities; ++i) {
+        Config* config                  = [self.storage insertNewObjectForBucketName:bucket.name simperiumKey:nil];
+        config.captainsLog              = originalLog;
+        
+        NSMutableDictionary *memberData = [config.dictionary mutableCopy];
+        SPGhost *ghost                  = [[SPGhost alloc] initWithKey:config.simperiumKey memberData:memberData];
+        ghost.version                   = @"1";
+        config.ghost                    = ghost;
+        config.ghostData                = [memberData sp_JSONString];
+        
+        [configs addObject:config];
+    }
+    
+    [self.storage save];
+    [self.storage test_waitUntilSaveCompletes];
+    
+    NSLog(@"<> Successfully inserted Config objects");
+    
+    
+    // ===================================================================================================
+    // Prepare Remote Versions Message
+    // ===================================================================================================
+    //
+    NSDictionary *data              = @{
+        NSStringFromSelector(@selector(captainsLog)) : newRemoteLog,
+    };
+    
+    NSMutableArray *versions        = [NSMutableArray array];
+    
+    for (Config *config in configs) {
+        [versions addObject:@[ config.simperiumKey, @"2", data ]];
+    }
+    
+    NSLog(@"<> Successfully generated versions");
+    
+    
+    // ===================================================================================================
+    // Add local pending changes. The first object won't get rebased
+    // ===================================================================================================
+    //
+    for (Config *config in configs) {
+        config.captainsLog = localPendingLog;
+    }
+    
+    [self.storage save];
+    [self.storage test_waitUntilSaveCompletes];
+    
+    Config *disabledConfig          = configs.firstObject;
+    [bucket.indexProcessor disableRebaseForObjectWithKey:disabledConfig.simperiumKey];
+    
+    
+    // ===================================================================================================
+    // Process remote changes
+    // ===================================================================================================
+    //
+    XCTestExpectation *expectation  = [self expectationWithDescription:@"Index Processor Expectation"];
+    NSMutableSet *rebasedKeys       = [NSMutableSet set];
+    
+    dispatch_async(bucket.processorQueue, ^{
+        
+        [bucket.indexProcessor processVersions:versions bucket:bucket changeHandler:^(NSString *key) {
+            [rebasedKeys addObject:key];
+        }];
+        
+        [expectation fulfill];
+    });
+    
+    [self waitForExpectationsWithTimeout:SPExpectationTimeout handler:^(NSError *error) {
+        XCTAssertNil(error, @"Expectations Timeout");
+    }];
+    
+    NSLog(@"<> Finished processing versions");
+    
+    
+    // ===================================================================================================
+    // Verify if the indexProcessor actually did its job
+    // ===================================================================================================
+    //
+    [self.storage refaultObjects:configs];
+    
+    XCTAssertEqual(rebasedKeys.count, configs.count - 1,                        @"Invalid rebased keys");
+    XCTAssertFalse([rebasedKeys containsObject:disabledConfig.simperiumKey],    @"Invalid rebased keys");
+    XCTAssertEqualObjects(disabledConfig.captainsLog, newRemoteLog,             @"Invalid Log");
+    
+    for (Config *config in configs) {
+        if (config != disabledConfig) {
+            XCTAssertEqualObjects(config.captainsLog, expectedLog,              @"Invalid Log");
+        }
+        
+        XCTAssertEqualObjects(config.ghost.version, @"2",                       @"Invalid Ghost Version");
+        XCTAssertTrue([self isGhostEqualToDictionary:data ghost:config.ghost],  @"Invalid Ghost MemberData");
+    }
+}
+
+
 #pragma mark - Helpers
 
 - (BOOL)isGhostEqualToDictionary:(NSDictionary *)dictionary ghost:(SPGhost *)ghost {
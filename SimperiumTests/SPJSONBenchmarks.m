@@ -0,0 +1,102 @@
+//
+//  SPJSONBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "JSONKit+Simperium.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSUInteger const SPJSONBenchmarksEntriesPerRun   = 10000;
+static NSUInteger const SPJSONBenchmarksBatchSize       = 50;
+static NSUInteger const SPJSONBenchmarksIndexPageSize   = 100;
+static NSUInteger const SPJSONBenchmarksContentLength   = 1024;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONBenchmarks
+#pragma mark ====================================================================================
+
+@interface SPJSONBenchmarks : SPBenchmarkTestCase
+
+@end
+
+@implementation SPJSONBenchmarks
+
+- (void)testChangeBatch {
+    NSMutableArray *changes = [NSMutableArray arrayWithCapacity:SPJSONBenchmarksBatchSize];
+    
+    for (NSUInteger i = 0; i < SPJSONBenchmarksBatchSize; ++i) {
+        [changes addObject:@{
+            @"clientid" : [self randomStringOfLength:24],
+            @"cv"       : [self randomStringOfLength:24],
+            @"ev"       : @(i + 2),
+            @"sv"       : @(i + 1),
+            @"id"       : [self randomStringOfLength:24],
+            @"o"        : @"M",
+            @"v"        : @{ @"content" : @{ @"o" : @"d", @"v" : [self randomTextOfLength:SPJSONBenchmarksContentLength / 4] } },
+            @"ccids"    : @[ [self randomStringOfLength:24] ]
+        }];
+    }
+    
+    [self benchmarkArray:changes named:@"json.changes"];
+}
+
+- (void)testIndexPage {
+    NSMutableArray *index = [NSMutableArray arrayWithCapacity:SPJSONBenchmarksIndexPageSize];
+    
+    for (NSUInteger i = 0; i < SPJSONBenchmarksIndexPageSize; ++i) {
+        [index addObject:@{
+            @"id"   : [self randomStringOfLength:24],
+            @"v"    : @([self randomNumberBelow:1000] + 1),
+            @"d"    : @{
+                @"content"      : [self randomTextOfLength:SPJSONBenchmarksContentLength],
+                @"pinned"       : @([self randomNumberBelow:2] == 0),
+                @"modified"     : @([self randomNumberBelow:INT32_MAX] / 1000.0),
+                @"tags"         : @[ [self randomStringOfLength:8], [self randomStringOfLength:8] ],
+                @"systemTags"   : @[ ]
+            }
+        }];
+    }
+    
+    [self benchmarkArray:index named:@"json.index"];
+}
+
+
+#pragma mark - Helpers
+
+- (void)benchmarkArray:(NSArray *)array named:(NSString *)name {
+    NSString *string    = [array sp_JSONString];
+    NSData *data        = [string dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger count    = MAX(SPJSONBenchmarksEntriesPerRun / array.count, 1);
+    
+    XCTAssertTrue([[string sp_objectFromJSONString] count] == array.count, @"Inconsistency detected");
+    
+    [self benchmark:[name stringByAppendingString:@".encode"] operations:count block:^{
+        for (NSUInteger i = 0; i < count; ++i) {
+            [array sp_JSONString];
+        }
+    }];
+    
+    [self benchmark:[name stringByAppendingString:@".decode"] operations:count block:^{
+        for (NSUInteger i = 0; i < count; ++i) {
+            [string sp_objectFromJSONString];
+        }
+    }];
+    
+    [self benchmark:[name stringByAppendingString:@".decodeData"] operations:count block:^{
+        for (NSUInteger i = 0; i < count; ++i) {
+            [data sp_objectFromJSONString];
+        }
+    }];
+}
+
+@end
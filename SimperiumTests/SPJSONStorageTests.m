@@ -0,0 +1,533 @@
+//
+//  SPJSONStorageTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPJSONStorage.h"
+#import "SPObject.h"
+#import "SPGhost.h"
+#import "SPSchema.h"
+#import "SPBucket+Internals.h"
+#import "SPJSONStorageJournal.h"
+#import "SPIndexProcessor.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPJSONStorageTestsBucket        = @"bucket";
+static NSInteger const SPJSONStorageTestsSeedCount      = 1000;
+static NSInteger const SPJSONStorageTestsReaders        = 8;
+static NSInteger const SPJSONStorageTestsReads          = 2000;
+static NSInteger const SPJSONStorageTestsWrites         = 2000;
+static NSTimeInterval const SPJSONStorageTestsTimeout   = 60.0;
+static NSInteger const SPJSONStorageTestsIndexedCount   = 100;
+static NSInteger const SPJSONStorageTestsBudgetedCount  = 100;
+static NSInteger const SPJSONStorageTestsMemoryBudget   = 10;
+static NSInteger const SPJSONStorageTestsJournaledCount = 50;
+static NSInteger const SPJSONStorageTestsUpsertedCount  = 10000;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPJSONStorageTests
+#pragma mark ====================================================================================
+
+@interface SPJSONStorageTests : XCTestCase
+@end
+
+@implementation SPJSONStorageTests
+
+- (NSString *)keyAtIndex:(NSInteger)index {
+    return [NSString stringWithFormat:@"key%ld", (long)index];
+}
+
+- (SPJSONStorage *)seededStorage {
+    SPJSONStorage *storage = [[SPJSONStorage alloc] initWithDelegate:nil];
+    for (NSInteger i = 0; i < SPJSONStorageTestsSeedCount; ++i) {
+        [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:i]];
+    }
+    return storage;
+}
+
+// Runs N readers against a single writer, and returns the number of failed lookups
+- (NSInteger)runReadersAgainstWriterWithStorage:(SPJSONStorage *)storage writeOffset:(NSInteger)writeOffset {
+    dispatch_group_t group      = dispatch_group_create();
+    NSPredicate *predicate      = [NSPredicate predicateWithFormat:@"simperiumKey != nil"];
+    __block NSInteger failures  = 0;
+
+    for (NSInteger reader = 0; reader < SPJSONStorageTestsReaders; ++reader) {
+        dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            NSInteger readerFailures = 0;
+            for (NSInteger i = 0; i < SPJSONStorageTestsReads; ++i) {
+                NSString *key = [self keyAtIndex:(i + reader) % SPJSONStorageTestsSeedCount];
+                if ([storage objectForKey:key bucketName:SPJSONStorageTestsBucket] == nil) {
+                    ++readerFailures;
+                }
+
+                // Every now and then, hit the (more expensive) full bucket scans
+                if (i % 100 == 0 && [storage numObjectsForBucketName:SPJSONStorageTestsBucket predicate:predicate] < SPJSONStorageTestsSeedCount) {
+                    ++readerFailures;
+                }
+            }
+
+            @synchronized(group) {
+                failures += readerFailures;
+            }
+        });
+    }
+
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        for (NSInteger i = 0; i < SPJSONStorageTestsWrites; ++i) {
+            NSString *key = [self keyAtIndex:SPJSONStorageTestsSeedCount + writeOffset + i];
+            [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:key];
+        }
+    });
+
+    long result = dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SPJSONStorageTestsTimeout * NSEC_PER_SEC)));
+    XCTAssertEqual(result, 0, @"Readers and writer should complete");
+
+    return failures;
+}
+
+- (void)testConcurrentReadersSeeConsistentDataWhileWriting {
+    SPJSONStorage *storage  = [self seededStorage];
+    NSInteger failures      = [self runReadersAgainstWriterWithStorage:storage writeOffset:0];
+
+    XCTAssertEqual(failures, 0, @"Seeded objects should always be visible to readers");
+
+    NSInteger expected      = SPJSONStorageTestsSeedCount + SPJSONStorageTestsWrites;
+    XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, expected, @"Every write should land");
+
+    NSString *lastKey       = [self keyAtIndex:expected - 1];
+    XCTAssertNotNil([storage objectForKey:lastKey bucketName:SPJSONStorageTestsBucket], @"Writes should be visible once done");
+}
+
+- (void)testReaderWriterContentionPerformance {
+    SPJSONStorage *storage      = [self seededStorage];
+    __block NSInteger offset    = 0;
+
+    [self measureBlock:^{
+        [self runReadersAgainstWriterWithStorage:storage writeOffset:offset];
+        offset += SPJSONStorageTestsWrites;
+    }];
+}
+
+- (void)testSecondaryIndexesAnswerPredicatesLikeFullScans {
+    SPJSONStorage *storage  = [[SPJSONStorage alloc] initWithDelegate:nil];
+    SPSchema *schema        = [[SPSchema alloc] initWithBucketName:SPJSONStorageTestsBucket data:@{ @"members" : @[] }];
+    SPBucket *bucket        = [[SPBucket alloc] initWithSchema:schema storage:storage networkInterface:nil relationshipResolver:nil
+                                                         label:@"SPJSONStorageTests" remoteName:SPJSONStorageTestsBucket clientID:@"client"];
+    
+    // Indexes registered before and after the objects are inserted should behave the same
+    [bucket addIndexForMemberNamed:@"pinned" sorted:NO];
+    
+    NSMutableArray *objects = [NSMutableArray array];
+    for (NSInteger i = 0; i < SPJSONStorageTestsIndexedCount; ++i) {
+        id<SPDiffable>object = [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:i]];
+        object.bucket = bucket;
+        [object loadMemberData:@{ @"pinned" : @(i % 2 == 0), @"rank" : @(i) }];
+        [objects addObject:object];
+    }
+    
+    [bucket addIndexForMemberNamed:@"rank" sorted:YES];
+    
+    NSArray *predicates = @[
+        [NSPredicate predicateWithFormat:@"pinned == YES"],
+        [NSPredicate predicateWithFormat:@"rank > 89"],
+        [NSPredicate predicateWithFormat:@"42 == rank"],
+        [NSPredicate predicateWithFormat:@"rank BETWEEN {10, 19}"],
+        [NSPredicate predicateWithFormat:@"rank IN {1, 2, 3, 500}"],
+        [NSPredicate predicateWithFormat:@"pinned == YES AND rank < 10"],
+        [NSPredicate predicateWithFormat:@"rank <= 4 OR rank >= 95"],
+        [NSPredicate predicateWithFormat:@"pinned == NO AND simperiumKey != nil"],
+    ];
+    
+    void (^verify)(NSString *) = ^(NSString *stage) {
+        NSArray *allObjects = [bucket allObjects];
+        for (NSPredicate *predicate in predicates) {
+            NSSet *expected = [NSSet setWithArray:[allObjects filteredArrayUsingPredicate:predicate]];
+            NSSet *indexed  = [NSSet setWithArray:[bucket objectsForPredicate:predicate]];
+    
+            XCTAssertEqualObjects(indexed, expected, @"Mismatch (%@) for predicate: %@", stage, predicate);
+            XCTAssertEqual([bucket numObjectsForPredicate:predicate], expected.count, @"Mismatch (%@) for predicate: %@", stage, predicate);
+        }
+    };
+    
+    verify(@"Inserted");
+    
+    // Updates
+    [objects[0] simperiumSetValue:@(1000) forKey:@"rank"];
+    [objects[1] loadMemberData:@{ @"pinned" : @YES }];
+    XCTAssertEqual([bucket numObjectsForPredicate:[NSPredicate predicateWithFormat:@"rank > 89"]], 11);
+    verify(@"Updated");
+    
+    // Deletions
+    [storage deleteObject:objects[99]];
+    XCTAssertEqual([bucket numObjectsForPredicate:[NSPredicate predicateWithFormat:@"rank > 89"]], 10);
+    verify(@"Deleted");
+}
+
+- (void)testPredicatesWithoutKeyPathsFallBackToFullScans {
+    SPJSONStorage *storage  = [[SPJSONStorage alloc] initWithDelegate:nil];
+    SPSchema *schema        = [[SPSchema alloc] initWithBucketName:SPJSONStorageTestsBucket data:@{ @"members" : @[] }];
+    SPBucket *bucket        = [[SPBucket alloc] initWithSchema:schema storage:storage networkInterface:nil relationshipResolver:nil
+                                                         label:@"SPJSONStorageTests" remoteName:SPJSONStorageTestsBucket clientID:@"client"];
+    
+    [bucket addIndexForMemberNamed:@"title" sorted:YES];
+    
+    for (NSInteger i = 0; i < SPJSONStorageTestsIndexedCount; ++i) {
+        id<SPDiffable>object = [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:i]];
+        object.bucket = bucket;
+        [object loadMemberData:@{ @"title" : [NSString stringWithFormat:@"Title%ld", (long)i] }];
+    }
+    
+    // Function expressions don't have a keyPath: the planner should never ask them for one
+    NSArray *predicates = @[
+        [NSPredicate predicateWithFormat:@"lowercase(title) == 'title7'"],
+        [NSPredicate predicateWithFormat:@"'title7' == lowercase(title)"],
+        [NSPredicate predicateWithFormat:@"lowercase(title) == 'title7' AND title != nil"],
+        [NSPredicate predicateWithFormat:@"lowercase(title) == 'title7' OR title == 'Title8'"],
+    ];
+    
+    NSArray *allObjects = [bucket allObjects];
+    for (NSPredicate *predicate in predicates) {
+        NSSet *expected = [NSSet setWithArray:[allObjects filteredArrayUsingPredicate:predicate]];
+        NSSet *indexed  = [NSSet setWithArray:[bucket objectsForPredicate:predicate]];
+        
+        XCTAssertTrue(expected.count > 0, @"Inconsistency detected");
+        XCTAssertEqualObjects(indexed, expected, @"Mismatch for predicate: %@", predicate);
+        XCTAssertEqual([bucket numObjectsForPredicate:predicate], expected.count, @"Mismatch for predicate: %@", predicate);
+    }
+}
+
+- (NSInteger)numberOfObjectsInMemoryForStorage:(SPJSONStorage *)storage {
+    NSInteger count = 0;
+    for (id object in storage.allObjects.allValues) {
+        if ([object isKindOfClass:[SPObject class]]) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+- (void)testObjectsBeyondMemoryBudgetAreSpilledAndRehydrated {
+    SPJSONStorage *storage          = [[SPJSONStorage alloc] initWithDelegate:nil];
+    storage.maximumObjectsInMemory  = SPJSONStorageTestsMemoryBudget;
+    
+    for (NSInteger i = 0; i < SPJSONStorageTestsBudgetedCount; ++i) {
+        @autoreleasepool {
+            NSString *key           = [self keyAtIndex:i];
+            id<SPDiffable>object    = [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:key];
+            [object loadMemberData:@{ @"rank" : @(i) }];
+            
+            SPGhost *ghost          = [[SPGhost alloc] initWithKey:key memberData:@{ @"rank" : @(i) }];
+            ghost.version           = @"1";
+            object.ghost            = ghost;
+        }
+    }
+    
+    XCTAssertLessThanOrEqual([self numberOfObjectsInMemoryForStorage:storage], SPJSONStorageTestsMemoryBudget, @"Cold objects should be spilled");
+    XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, SPJSONStorageTestsBudgetedCount, @"Spilled objects should still be listed");
+    
+    // Spilled objects come back with their members and ghosts
+    for (NSInteger i = 0; i < SPJSONStorageTestsBudgetedCount; ++i) {
+        @autoreleasepool {
+            id<SPDiffable>object = [storage objectForKey:[self keyAtIndex:i] bucketName:SPJSONStorageTestsBucket];
+            XCTAssertEqualObjects(object.simperiumKey, [self keyAtIndex:i]);
+            XCTAssertEqualObjects([object simperiumValueForKey:@"rank"], @(i));
+            XCTAssertEqualObjects(object.ghost.version, @"1");
+            XCTAssertEqualObjects(object.ghost.memberData[@"rank"], @(i));
+        }
+    }
+    
+    // Predicate scans see every object
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"rank >= 50"];
+    XCTAssertEqual([storage numObjectsForBucketName:SPJSONStorageTestsBucket predicate:predicate], SPJSONStorageTestsBudgetedCount / 2);
+    
+    // Objects in use are never spilled
+    id<SPDiffable>retained = [storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket];
+    [storage unloadAllObjects];
+    
+    XCTAssertEqual([self numberOfObjectsInMemoryForStorage:storage], 1, @"Only the retained object should remain in memory");
+    XCTAssertEqual([storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket], retained, @"Objects in use should not be duplicated");
+}
+
+- (void)testObjectsReadConcurrentlyAreNotEvictedFirst {
+    SPJSONStorage *storage          = [[SPJSONStorage alloc] initWithDelegate:nil];
+    storage.maximumObjectsInMemory  = SPJSONStorageTestsMemoryBudget;
+    
+    for (NSInteger i = 0; i < SPJSONStorageTestsMemoryBudget; ++i) {
+        @autoreleasepool {
+            [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:i]];
+        }
+    }
+    
+    // Reads are recorded on the side: they should still be accounted for, as soon as the next write needs to evict
+    dispatch_apply(SPJSONStorageTestsReaders, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t reader) {
+        @autoreleasepool {
+            [storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket];
+        }
+    });
+    
+    @autoreleasepool {
+        [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:SPJSONStorageTestsMemoryBudget]];
+    }
+    
+    XCTAssertTrue([storage.allObjects[[self keyAtIndex:0]] isKindOfClass:[SPObject class]], @"Recently read objects should stay in memory");
+    XCTAssertFalse([storage.allObjects[[self keyAtIndex:1]] isKindOfClass:[SPObject class]], @"The Least Recently Used object should be spilled");
+}
+
+- (NSURL *)temporaryStoreURL {
+    NSString *folder = [NSString stringWithFormat:@"SPJSONStorageTests-%@", [[NSUUID UUID] UUIDString]];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:folder] isDirectory:YES];
+}
+
+- (SPBucket *)bucketWithStorage:(SPJSONStorage *)storage {
+    SPSchema *schema = [[SPSchema alloc] initWithBucketName:SPJSONStorageTestsBucket data:@{ @"members" : @[] }];
+    return [[SPBucket alloc] initWithSchema:schema storage:storage networkInterface:nil relationshipResolver:nil
+                                      label:@"SPJSONStorageTests" remoteName:SPJSONStorageTestsBucket clientID:@"client"];
+}
+
+- (void)saveAndWaitForStorage:(SPJSONStorage *)storage {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Commit"];
+    
+    [storage save];
+    [storage commitPendingOperations:^{
+        [expectation fulfill];
+    }];
+    
+    [self waitForExpectationsWithTimeout:SPJSONStorageTestsTimeout handler:nil];
+}
+
+- (SPJSONStorage *)journaledStorageAtURL:(NSURL *)URL {
+    SPJSONStorage *storage  = [[SPJSONStorage alloc] initWithDelegate:nil];
+    [storage loadPersistentStoreAtURL:URL];
+    
+    SPBucket *bucket        = [self bucketWithStorage:storage];
+    
+    for (NSInteger i = 0; i < SPJSONStorageTestsJournaledCount; ++i) {
+        NSString *key           = [self keyAtIndex:i];
+        id<SPDiffable>object    = [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:key];
+        object.bucket           = bucket;
+        [object loadMemberData:@{ @"rank" : @(i) }];
+        
+        SPGhost *ghost          = [[SPGhost alloc] initWithKey:key memberData:@{ @"rank" : @(i) }];
+        ghost.version           = @"1";
+        object.ghost            = ghost;
+        [storage saveGhostForObject:object];
+    }
+    
+    // Changes performed after the first save should be journaled as well
+    [self saveAndWaitForStorage:storage];
+    
+    [[storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket] simperiumSetValue:@(1000) forKey:@"rank"];
+    [storage deleteObject:[storage objectForKey:[self keyAtIndex:1] bucketName:SPJSONStorageTestsBucket]];
+    storage.metadata = @{ @"pendings" : @[ @"something" ] };
+    
+    [self saveAndWaitForStorage:storage];
+    
+    return storage;
+}
+
+- (void)verifyJournaledStorage:(SPJSONStorage *)storage {
+    XCTAssertFalse(storage.isEphemeral, @"Journaled storage should not be ephemeral");
+    XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, SPJSONStorageTestsJournaledCount - 1);
+    XCTAssertNil([storage objectForKey:[self keyAtIndex:1] bucketName:SPJSONStorageTestsBucket], @"Deletions should be journaled");
+    XCTAssertEqualObjects(storage.metadata, (@{ @"pendings" : @[ @"something" ] }));
+    
+    id<SPDiffable>updated = [storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket];
+    XCTAssertEqualObjects([updated simperiumValueForKey:@"rank"], @(1000), @"Updates should be journaled");
+    
+    for (NSInteger i = 2; i < SPJSONStorageTestsJournaledCount; ++i) {
+        id<SPDiffable>object = [storage objectForKey:[self keyAtIndex:i] bucketName:SPJSONStorageTestsBucket];
+        XCTAssertEqualObjects([object simperiumValueForKey:@"rank"], @(i));
+        XCTAssertEqualObjects(object.ghost.version, @"1");
+        XCTAssertEqualObjects(object.ghost.memberData[@"rank"], @(i));
+    }
+    
+    // Loaded objects are hooked up with their bucket
+    SPBucket *bucket = [self bucketWithStorage:storage];
+    [storage adoptObjectsForBucket:bucket];
+    XCTAssertEqual([[storage objectForKey:[self keyAtIndex:2] bucketName:SPJSONStorageTestsBucket] bucket], bucket);
+}
+
+- (void)testJournaledObjectsSurviveReload {
+    NSURL *storeURL = [self temporaryStoreURL];
+    [self journaledStorageAtURL:storeURL];
+    
+    SPJSONStorage *reloaded = [[SPJSONStorage alloc] initWithDelegate:nil];
+    XCTAssertTrue(reloaded.isEphemeral, @"Storage should be ephemeral until loaded");
+    [reloaded loadPersistentStoreAtURL:storeURL];
+    
+    [self verifyJournaledStorage:reloaded];
+    [[NSFileManager defaultManager] removeItemAtURL:storeURL error:nil];
+}
+
+- (void)testObjectsThatAreNotValidJSONFailTheSave {
+    NSURL *storeURL         = [self temporaryStoreURL];
+    SPJSONStorage *storage  = [self journaledStorageAtURL:storeURL];
+    
+    id<SPDiffable>object    = [storage objectForKey:[self keyAtIndex:2] bucketName:SPJSONStorageTestsBucket];
+    [object simperiumSetValue:[NSDate date] forKey:@"rank"];
+    
+    XCTAssertFalse([storage save], @"Objects that can't be journaled should fail the save");
+    XCTAssertTrue([storage save], @"Nothing else is pending");
+    [[NSFileManager defaultManager] removeItemAtURL:storeURL error:nil];
+}
+
+- (void)testTornLogTailIsDropped {
+    NSURL *storeURL = [self temporaryStoreURL];
+    [self journaledStorageAtURL:storeURL];
+    
+    // Simulate a crash in the middle of an append
+    NSString *logPath           = [[storeURL URLByAppendingPathComponent:SPJSONStorageTestsBucket] URLByAppendingPathComponent:@"wal"].path;
+    unsigned long long length   = [[[NSFileManager defaultManager] attributesOfItemAtPath:logPath error:nil] fileSize];
+    NSFileHandle *log           = [NSFileHandle fileHandleForWritingAtPath:logPath];
+    uint8_t garbage[]           = { 'P', 0xFF, 0x00, 0x00 };
+    
+    [log seekToEndOfFile];
+    [log writeData:[NSData dataWithBytes:garbage length:sizeof(garbage)]];
+    [log closeFile];
+    
+    SPJSONStorage *reloaded = [[SPJSONStorage alloc] initWithDelegate:nil];
+    [reloaded loadPersistentStoreAtURL:storeURL];
+    
+    [self verifyJournaledStorage:reloaded];
+    XCTAssertEqual([[[NSFileManager defaultManager] attributesOfItemAtPath:logPath error:nil] fileSize], length, @"Torn tail should be truncated");
+    [[NSFileManager defaultManager] removeItemAtURL:storeURL error:nil];
+}
+
+- (void)testSnapshotsFoldTheLog {
+    NSURL *storeURL                 = [self temporaryStoreURL];
+    SPJSONStorageJournal *journal   = [[SPJSONStorageJournal alloc] initWithURL:storeURL];
+    NSData *first                   = [@"first" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *second                  = [@"second" dataUsingEncoding:NSUTF8StringEncoding];
+    
+    [journal appendRecords:@{ @"a" : first, @"b" : first, @"c" : first } bucketName:SPJSONStorageTestsBucket];
+    [journal appendRecords:@{ @"a" : second, @"b" : [NSNull null] } bucketName:SPJSONStorageTestsBucket];
+    [journal writeSnapshotForBucketName:SPJSONStorageTestsBucket];
+    [journal appendRecords:@{ @"c" : [NSNull null], @"d" : second } bucketName:SPJSONStorageTestsBucket];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Synchronize"];
+    [journal synchronizeWithCompletion:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:SPJSONStorageTestsTimeout handler:nil];
+    
+    NSString *logPath = [[storeURL URLByAppendingPathComponent:SPJSONStorageTestsBucket] URLByAppendingPathComponent:@"wal"].path;
+    XCTAssertLessThan([[[NSFileManager defaultManager] attributesOfItemAtPath:logPath error:nil] fileSize], 64, @"Snapshots should truncate the log");
+    
+    NSMutableDictionary *records        = [NSMutableDictionary dictionary];
+    SPJSONStorageJournal *reloaded      = [[SPJSONStorageJournal alloc] initWithURL:storeURL];
+    [reloaded enumerateRecordsUsingBlock:^(NSString *bucketName, NSString *simperiumKey, NSData *record) {
+        XCTAssertEqualObjects(bucketName, SPJSONStorageTestsBucket);
+        records[simperiumKey] = [NSData dataWithBytes:record.bytes length:record.length];
+    }];
+    
+    XCTAssertEqualObjects(records, (@{ @"a" : second, @"d" : second }));
+    [[NSFileManager defaultManager] removeItemAtURL:storeURL error:nil];
+}
+
+- (void)testObjectKeySetTracksInsertionsAndDeletions {
+    SPJSONStorage *storage  = [[SPJSONStorage alloc] initWithDelegate:nil];
+    SPBucket *bucket        = [self bucketWithStorage:storage];
+    
+    NSMutableSet *expected  = [NSMutableSet set];
+    for (NSInteger i = 0; i < SPJSONStorageTestsIndexedCount; ++i) {
+        id<SPDiffable>object = [storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:[self keyAtIndex:i]];
+        object.bucket = bucket;
+        [expected addObject:object.simperiumKey];
+    }
+    
+    NSMutableSet *(^enumeratedKeys)(void) = ^{
+        NSMutableSet *keys = [NSMutableSet set];
+        [storage enumerateObjectKeysForBucketName:SPJSONStorageTestsBucket usingBlock:^(NSString *simperiumKey, BOOL *stop) {
+            [keys addObject:simperiumKey];
+        }];
+        return keys;
+    };
+    
+    XCTAssertEqualObjects(enumeratedKeys(), expected);
+    
+    // Changes performed once loaded are tracked incrementally
+    [[storage insertNewObjectForBucketName:SPJSONStorageTestsBucket simperiumKey:@"inserted"] setBucket:bucket];
+    [storage deleteObject:[storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket]];
+    [expected addObject:@"inserted"];
+    [expected removeObject:[self keyAtIndex:0]];
+    
+    XCTAssertEqualObjects(enumeratedKeys(), expected);
+    XCTAssertEqualObjects([NSSet setWithArray:[storage objectKeysForBucketName:SPJSONStorageTestsBucket]], expected);
+    
+    // The enumeration may stop early, and even mutate the storage
+    __block NSInteger visited = 0;
+    [storage enumerateObjectKeysForBucketName:SPJSONStorageTestsBucket usingBlock:^(NSString *simperiumKey, BOOL *stop) {
+        [storage deleteObject:[storage objectForKey:simperiumKey bucketName:SPJSONStorageTestsBucket]];
+        *stop = (++visited == 10);
+    }];
+    
+    XCTAssertEqual(visited, 10);
+    XCTAssertEqual(enumeratedKeys().count, expected.count - 10);
+    
+    [storage deleteAllObjectsForBucketName:SPJSONStorageTestsBucket];
+    XCTAssertEqual(enumeratedKeys().count, 0);
+}
+
+- (NSArray *)versionsWithCount:(NSInteger)count version:(NSString *)version {
+    NSMutableArray *versions = [NSMutableArray arrayWithCapacity:count];
+    for (NSInteger i = 0; i < count; ++i) {
+        [versions addObject:@[ [self keyAtIndex:i], version, @{ @"rank" : @(i), @"title" : version } ]];
+    }
+    return versions;
+}
+
+- (void)testProcessVersionsUpsertsNewObjectsInBulk {
+    SPJSONStorage *storage          = [[SPJSONStorage alloc] initWithDelegate:nil];
+    SPBucket *bucket                = [self bucketWithStorage:storage];
+    SPIndexProcessor *processor     = [SPIndexProcessor new];
+    
+    [bucket addIndexForMemberNamed:@"rank" sorted:YES];
+    
+    // New Objects: Upserted
+    [processor processVersions:[self versionsWithCount:SPJSONStorageTestsIndexedCount version:@"1"] bucket:bucket changeHandler:^(NSString *key) { }];
+    
+    XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, SPJSONStorageTestsIndexedCount);
+    XCTAssertEqual([bucket numObjectsForPredicate:[NSPredicate predicateWithFormat:@"rank >= 90"]], 10, @"Upserted objects should be indexed");
+    
+    for (NSInteger i = 0; i < SPJSONStorageTestsIndexedCount; ++i) {
+        id<SPDiffable>object = [storage objectForKey:[self keyAtIndex:i] bucketName:SPJSONStorageTestsBucket];
+        XCTAssertEqual(object.bucket, bucket);
+        XCTAssertEqualObjects([object simperiumValueForKey:@"rank"], @(i));
+        XCTAssertEqualObjects(object.ghost.version, @"1");
+        XCTAssertEqualObjects(object.ghost.memberData[@"rank"], @(i));
+        XCTAssertNotNil(object.ghostData);
+    }
+    
+    // Existing Objects: Regular path
+    NSArray *updates = [[self versionsWithCount:SPJSONStorageTestsIndexedCount version:@"2"] subarrayWithRange:NSMakeRange(0, 10)];
+    [processor processVersions:updates bucket:bucket changeHandler:^(NSString *key) { }];
+    
+    id<SPDiffable>updated = [storage objectForKey:[self keyAtIndex:0] bucketName:SPJSONStorageTestsBucket];
+    XCTAssertEqualObjects([updated simperiumValueForKey:@"title"], @"2");
+    XCTAssertEqualObjects(updated.ghost.version, @"2");
+    XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, SPJSONStorageTestsIndexedCount);
+}
+
+- (void)testBulkUpsertPerformance {
+    NSArray *versions = [self versionsWithCount:SPJSONStorageTestsUpsertedCount version:@"1"];
+    
+    [self measureBlock:^{
+        SPJSONStorage *storage  = [[SPJSONStorage alloc] initWithDelegate:nil];
+        SPBucket *bucket        = [self bucketWithStorage:storage];
+        
+        [storage upsertObjectsForBucket:bucket versions:versions];
+        XCTAssertEqual([storage objectKeysForBucketName:SPJSONStorageTestsBucket].count, SPJSONStorageTestsUpsertedCount);
+    }];
+}
+
+@end
@@ -0,0 +1,267 @@
+//
+//  SPLoggerTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPLogger.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSInteger const SPLoggerTestsThreads             = 4;
+static NSInteger const SPLoggerTestsThreadIterations    = 200;
+static NSInteger const SPLoggerTestsIterations          = 1000;
+static NSInteger const SPLoggerTestsDiskLines           = 10000;
+static NSInteger const SPLoggerTestsBenchmarkLines      = 1000000;
+static NSInteger const SPLoggerTestsOverflowLines       = 4096;
+static double const SPLoggerTestsMaximumCallCost        = 100;
+static NSTimeInterval const SPLoggerTestsTimeout        = 10;
+static NSString * const SPLoggerTestsBlockingMessage    = @"Blocking the logger's queue";
+static unsigned long long const SPLoggerTestsFilesize   = 64 * 1024;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPTemporaryLogger: Writes to a temporary folder
+#pragma mark ====================================================================================
+
+@interface SPTemporaryLogger : SPLogger
+@property (nonatomic, strong) NSURL *temporaryFolderURL;
+@end
+
+@implementation SPTemporaryLogger
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        NSString *folder        = [NSString stringWithFormat:@"SPLoggerTests-%@", [[NSUUID UUID] UUIDString]];
+        _temporaryFolderURL     = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:folder] isDirectory:YES];
+    }
+    return self;
+}
+
+- (NSURL *)logfilesFolderURL {
+    return self.temporaryFolderURL;
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLoggerTests
+#pragma mark ====================================================================================
+
+@interface SPLoggerTests : XCTestCase <SPLoggerDelegate>
+@property (nonatomic, strong) SPLogger              *logger;
+@property (nonatomic, strong) NSMutableArray        *messages;
+@property (nonatomic, strong) dispatch_semaphore_t  queueBlocked;
+@property (nonatomic, strong) dispatch_semaphore_t  queueReleased;
+@end
+
+@implementation SPLoggerTests
+
+- (void)setUp {
+    [super setUp];
+    self.messages               = [NSMutableArray array];
+    self.logger                 = [SPLogger new];
+    self.logger.delegate        = self;
+    self.logger.writesToConsole = NO;
+}
+
+- (void)handleLogMessage:(NSString *)logMessage {
+    // Invoked on the logger's queue
+    [self.messages addObject:logMessage];
+    
+    if ([logMessage isEqualToString:SPLoggerTestsBlockingMessage]) {
+        dispatch_semaphore_signal(self.queueBlocked);
+        dispatch_semaphore_wait(self.queueReleased, [self timeout]);
+    }
+}
+
+- (dispatch_time_t)timeout {
+    return dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SPLoggerTestsTimeout * NSEC_PER_SEC));
+}
+
+- (void)testBufferedMessagesMatchEagerFormatting {
+    NSMutableDictionary *payload    = [NSMutableDictionary dictionaryWithObject:@"value" forKey:@"key"];
+    const char *name                = "simperium";
+    
+    [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Payload %@ (%lu keys) 100%% done", payload, (unsigned long)payload.count];
+    [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"%d %i %5ld %llu %hd %x %X %o", -1, 2, 3L, 4ULL, (short)5, 255, 255, 8];
+    [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"%.2f %e %c %s %p", 3.14159, 1e10, 'z', name, (void *)self];
+    [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Unsupported %*d", 4, 2];
+    
+    // Mutating an argument should not affect the buffered message
+    NSString *expectedPayload = [NSString stringWithFormat:@"Payload %@ (%lu keys) 100%% done", payload, (unsigned long)payload.count];
+    payload[@"another"] = @"value";
+    
+    [self.logger flush];
+    
+    NSArray *expected = @[
+        expectedPayload,
+        [NSString stringWithFormat:@"%d %i %5ld %llu %hd %x %X %o", -1, 2, 3L, 4ULL, (short)5, 255, 255, 8],
+        [NSString stringWithFormat:@"%.2f %e %c %s %p", 3.14159, 1e10, 'z', name, (void *)self],
+        [NSString stringWithFormat:@"Unsupported %*d", 4, 2]
+    ];
+    
+    XCTAssertEqualObjects(self.messages, expected, @"Inconsistency detected");
+}
+
+- (void)testMessagesLoggedFromSeveralThreadsKeepTheirOrder {
+    dispatch_apply(SPLoggerTestsThreads, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        for (NSInteger i = 0; i < SPLoggerTestsThreadIterations; ++i) {
+            [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"%zu:%ld", thread, (long)i];
+        }
+    });
+    
+    [self.logger flush];
+    
+    // Every thread's messages should show up in order
+    NSMutableDictionary *lastIndexes = [NSMutableDictionary dictionary];
+    for (NSString *message in self.messages) {
+        NSArray *components = [message componentsSeparatedByString:@":"];
+        if (components.count != 2) {
+            continue;
+        }
+    
+        NSInteger index = [components.lastObject integerValue];
+        NSNumber *last  = lastIndexes[components.firstObject];
+        XCTAssertTrue(!last || last.integerValue < index, @"Inconsistency detected");
+        lastIndexes[components.firstObject] = @(index);
+    }
+    
+    XCTAssertTrue(self.messages.count == SPLoggerTestsThreads * SPLoggerTestsThreadIterations, @"Inconsistency detected");
+    XCTAssertTrue(lastIndexes.count == SPLoggerTestsThreads, @"Inconsistency detected");
+}
+
+- (void)testWarningsAreNeverDropped {
+    self.queueBlocked   = dispatch_semaphore_create(0);
+    self.queueReleased  = dispatch_semaphore_create(0);
+    
+    // Keep the logger's queue busy, so that nothing gets drained
+    [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"%@", SPLoggerTestsBlockingMessage];
+    XCTAssertTrue(dispatch_semaphore_wait(self.queueBlocked, [self timeout]) == 0, @"Inconsistency detected");
+    
+    // Overflow a brand new ring, and log a warning right afterwards
+    dispatch_semaphore_t ringFilled = dispatch_semaphore_create(0);
+    dispatch_group_t group          = dispatch_group_create();
+    
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        for (NSInteger i = 0; i < SPLoggerTestsOverflowLines; ++i) {
+            [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Line %ld", (long)i];
+        }
+    
+        dispatch_semaphore_signal(ringFilled);
+        [self.logger logWithLevel:SPLogLevelsWarn flag:SPLogFlagsWarn format:@"Warning %d", 1];
+        [self.logger logWithLevel:SPLogLevelsError flag:SPLogFlagsError format:@"Error %d", 2];
+    });
+    
+    XCTAssertTrue(dispatch_semaphore_wait(ringFilled, [self timeout]) == 0, @"Inconsistency detected");
+    dispatch_semaphore_signal(self.queueReleased);
+    XCTAssertTrue(dispatch_group_wait(group, [self timeout]) == 0, @"Inconsistency detected");
+    
+    [self.logger flush];
+    
+    NSUInteger warningIndex = [self.messages indexOfObject:@"Warning 1"];
+    NSUInteger errorIndex   = [self.messages indexOfObject:@"Error 2"];
+    NSUInteger summaryIndex = [self.messages indexOfObjectPassingTest:^BOOL(NSString *message, NSUInteger idx, BOOL *stop) {
+        return [message hasSuffix:@"info / verbose records"];
+    }];
+    
+    XCTAssertTrue(warningIndex != NSNotFound, @"Warnings should never be dropped");
+    XCTAssertTrue(errorIndex != NSNotFound && errorIndex > warningIndex, @"Errors should never be dropped");
+    XCTAssertTrue(summaryIndex != NSNotFound, @"Dropped records should be reported");
+}
+
+- (void)testLoggingPerformance {
+    NSString *key               = [[NSUUID UUID] UUIDString];
+    __block double bestCallCost = DBL_MAX;
+    
+    [self measureMetrics:[[self class] defaultPerformanceMetrics] automaticallyStartMeasuring:NO forBlock:^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [self startMeasuring];
+    
+        for (NSInteger i = 0; i < SPLoggerTestsIterations; ++i) {
+            [self.logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Simperium received change %@ version %ld", key, (long)i];
+        }
+    
+        [self stopMeasuring];
+        bestCallCost = MIN(bestCallCost, (CFAbsoluteTimeGetCurrent() - start) * 1e9 / SPLoggerTestsIterations);
+    
+        // Formatting happens off the clock
+        [self.logger flush];
+    }];
+    
+    // The best run is the least noisy one
+    XCTAssertLessThan(bestCallCost, SPLoggerTestsMaximumCallCost, @"Logging should cost less than %.0f ns per call", SPLoggerTestsMaximumCallCost);
+}
+
+- (void)testDiskLogfilesGetRotated {
+    SPTemporaryLogger *logger   = [SPTemporaryLogger new];
+    logger.writesToConsole      = NO;
+    logger.writesToDisk         = YES;
+    logger.maxLogfiles          = 0;
+    logger.maxLogfileSize       = SPLoggerTestsFilesize;
+    
+    for (NSInteger i = 0; i < SPLoggerTestsDiskLines; ++i) {
+        [logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Line %ld", (long)i];
+    
+        // Stay within the buffer's capacity
+        if (i % SPLoggerTestsIterations == 0) {
+            [logger flush];
+        }
+    }
+    
+    [logger flush];
+    
+    // Every single line should have made it to disk, spread across several logfiles
+    NSArray *filenames  = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:logger.temporaryFolderURL.path error:nil];
+    NSInteger lines     = 0;
+    
+    for (NSString *filename in filenames) {
+        NSURL *fileURL      = [logger.temporaryFolderURL URLByAppendingPathComponent:filename];
+        NSString *contents  = [NSString stringWithContentsOfURL:fileURL encoding:NSUTF8StringEncoding error:nil];
+    
+        for (NSString *line in [contents componentsSeparatedByString:@"\n"]) {
+            if (line.length) {
+                XCTAssertTrue([line hasPrefix:@"["] && [line containsString:@"] Line "], @"Inconsistency detected");
+                ++lines;
+            }
+        }
+    }
+    
+    XCTAssertTrue(filenames.count > 1, @"Logfiles should have been rotated");
+    XCTAssertTrue(lines == SPLoggerTestsDiskLines, @"Inconsistency detected");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:logger.temporaryFolderURL error:nil];
+}
+
+- (void)testDiskLoggingPerformance {
+    SPTemporaryLogger *logger   = [SPTemporaryLogger new];
+    logger.writesToConsole      = NO;
+    logger.writesToDisk         = YES;
+    
+    NSString *key = [[NSUUID UUID] UUIDString];
+    
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < SPLoggerTestsBenchmarkLines; ++i) {
+            [logger logWithLevel:SPLogLevelsVerbose flag:SPLogFlagsVerbose format:@"Simperium received change %@ version %ld", key, (long)i];
+    
+            // Stay within the buffer's capacity
+            if (i % SPLoggerTestsIterations == 0) {
+                [logger flush];
+            }
+        }
+    
+        [logger flush];
+    }];
+    
+    [[NSFileManager defaultManager] removeItemAtURL:logger.temporaryFolderURL error:nil];
+}
+
+@end
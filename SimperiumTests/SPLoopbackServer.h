@@ -0,0 +1,87 @@
+//
+//  SPLoopbackServer.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+
+@class SPLoopbackWebSocket;
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+extern NSString * const SPLoopbackStatsMessagesReceived;
+extern NSString * const SPLoopbackStatsMessagesSent;
+extern NSString * const SPLoopbackStatsBytesReceived;
+extern NSString * const SPLoopbackStatsBytesSent;
+extern NSString * const SPLoopbackStatsChangesApplied;
+extern NSString * const SPLoopbackStatsChangesRejected;
+extern NSString * const SPLoopbackStatsErrorsInjected;
+extern NSString * const SPLoopbackStatsIndexPages;
+extern NSString * const SPLoopbackStatsEntities;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLoopbackServer
+#pragma mark ====================================================================================
+
+// In-process stand-in for the Simperium backend, so that Farms can be load tested offline. It speaks the subset of
+// the websocket protocol the client relies on:
+//
+//  -   init:   Channel authentication. Buckets are scoped by token, just like they're scoped by user remotely.
+//  -   i:      Index paging, with marks.
+//  -   e:      Entity versions. Every version of every object is kept around.
+//  -   cv:     Changes since a given change version, or `cv:?` when it's unknown (or trimmed from the log).
+//  -   c:      Changes. These get applied with a schemaless jsondiff, and get broadcasted to every subscribed
+//              channel, with their ccids. The sender gets errors back (405, 409, 412, 440...), as the backend would.
+//              Note: Stale start versions get rejected (405) rather than transformed, so clients fall back to full data.
+//
+// Every connection gets two links (upstream and downstream). Messages are serialized through them according to
+// the configured bandwidth, and are delivered after the configured latency, always in order.
+//
+// Note: Once started, every SPWebSocket opened by Simperium gets routed to this server.
+//
+@interface SPLoopbackServer : NSObject
+
+// One way latency, applied to every message, in both directions
+@property (atomic, assign) NSTimeInterval   latency;
+
+// Bytes per second, per link. Zero means unlimited
+@property (atomic, assign) NSUInteger       bandwidth;
+
+// Ratio [0, 1] of valid changes that get rejected with the changeErrorCode. Defaults to zero
+@property (atomic, assign) double           changeErrorRate;
+
+// Error code for the rejected changes. Defaults to 503
+@property (atomic, assign) NSInteger        changeErrorCode;
+
+// Maximum number of entries per index page. Zero means the client's limit is honored
+@property (atomic, assign) NSUInteger       indexPageSize;
+
+// Maximum number of changes kept per bucket. Clients that fall behind get a `cv:?`, and re-index
+@property (atomic, assign) NSUInteger       changeLogCapacity;
+
+// Seed for the error injection. Runs with the same seed (and the same traffic) reject the same changes
+@property (atomic, assign) uint64_t         seed;
+
+- (void)start;
+- (void)stop;
+
+// Server side disconnection: clients will see an unclean close, and reconnect
+- (void)dropAllConnections;
+
+// Snapshot of the SPLoopbackStats counters
+- (NSDictionary *)stats;
+
+// Transport: Invoked by SPLoopbackWebSocket, on the main thread
+- (void)openConnectionForWebSocket:(SPLoopbackWebSocket *)webSocket;
+- (void)closeConnectionForWebSocket:(SPLoopbackWebSocket *)webSocket;
+- (void)receiveMessage:(NSString *)message fromWebSocket:(SPLoopbackWebSocket *)webSocket;
+
+@end
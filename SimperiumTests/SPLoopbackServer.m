@@ -0,0 +1,823 @@
+//
+//  SPLoopbackServer.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPLoopbackServer.h"
+#import "SPLoopbackWebSocket.h"
+#import "SPProcessorConstants.h"
+#import "SPMember.h"
+#import "JSONKit+Simperium.h"
+#import "NSArray+Simperium.h"
+#import "NSString+Simperium.h"
+#import "NSData+Simperium.h"
+#import "DiffMatchPatch+Simperium.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+NSString * const SPLoopbackStatsMessagesReceived            = @"messagesReceived";
+NSString * const SPLoopbackStatsMessagesSent                = @"messagesSent";
+NSString * const SPLoopbackStatsBytesReceived               = @"bytesReceived";
+NSString * const SPLoopbackStatsBytesSent                   = @"bytesSent";
+NSString * const SPLoopbackStatsChangesApplied              = @"changesApplied";
+NSString * const SPLoopbackStatsChangesRejected             = @"changesRejected";
+NSString * const SPLoopbackStatsErrorsInjected              = @"errorsInjected";
+NSString * const SPLoopbackStatsIndexPages                  = @"indexPages";
+NSString * const SPLoopbackStatsEntities                    = @"entities";
+
+static NSString * const SPLoopbackCommandInit               = @"init";
+static NSString * const SPLoopbackCommandAuth               = @"auth";
+static NSString * const SPLoopbackCommandIndex              = @"i";
+static NSString * const SPLoopbackCommandEntity             = @"e";
+static NSString * const SPLoopbackCommandChange             = @"c";
+static NSString * const SPLoopbackCommandChangeVersion      = @"cv";
+static NSString * const SPLoopbackCommandHeartbeat          = @"h";
+static NSString * const SPLoopbackCommandError              = @"?";
+static NSString * const SPLoopbackDefaultUsername           = @"loopback@simperium.com";
+static NSInteger const SPLoopbackMessageComponents          = 3;
+static NSUInteger const SPLoopbackChangesPageSize           = 50;
+static NSUInteger const SPLoopbackDefaultChangeLogCapacity  = 10000;
+static uint64_t const SPLoopbackDefaultSeed                 = 0x53504C4F4F504241;
+
+
+#pragma mark ====================================================================================
+#pragma mark Server State
+#pragma mark ====================================================================================
+
+@interface SPLoopbackObject : NSObject
+@property (nonatomic, assign) NSInteger             version;
+@property (nonatomic, strong) NSDictionary          *data;
+@property (nonatomic, strong) NSMutableDictionary   *history;
+@end
+
+@implementation SPLoopbackObject
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _history = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+@end
+
+
+@interface SPLoopbackBucket : NSObject
+@property (nonatomic, strong) NSMutableDictionary   *objects;
+@property (nonatomic, strong) NSMutableArray        *changes;
+@property (nonatomic, strong) NSMutableSet          *ccids;
+@property (nonatomic, assign) uint64_t              sequence;
+@end
+
+@implementation SPLoopbackBucket
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _objects    = [NSMutableDictionary dictionary];
+        _changes    = [NSMutableArray array];
+        _ccids      = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (NSString *)currentVersion {
+    return self.sequence ? [NSString stringWithFormat:@"%016llx", self.sequence] : @"";
+}
+
+// Returns nil whenever the change version is unknown, or has already been trimmed from the log
+- (NSArray *)changesSinceVersion:(NSString *)changeVersion {
+    unsigned long long since = 0;
+    
+    if (changeVersion.length) {
+        NSScanner *scanner = [NSScanner scannerWithString:changeVersion];
+        if (![scanner scanHexLongLong:&since] || !scanner.isAtEnd) {
+            return nil;
+        }
+    }
+    
+    uint64_t first = self.sequence - self.changes.count + 1;
+    if (since > self.sequence || since + 1 < first) {
+        return nil;
+    }
+    
+    return [self.changes subarrayWithRange:NSMakeRange((NSUInteger)(since + 1 - first), (NSUInteger)(self.sequence - since))];
+}
+
+@end
+
+
+@interface SPLoopbackChannel : NSObject
+@property (nonatomic, strong) SPLoopbackBucket      *bucket;
+@property (nonatomic,   copy) NSString              *clientID;
+@property (nonatomic, assign) NSInteger             number;
+@property (nonatomic, assign) BOOL                  subscribed;
+@end
+
+@implementation SPLoopbackChannel
+
+@end
+
+
+@interface SPLoopbackConnection : NSObject
+@property (nonatomic,   weak) SPLoopbackWebSocket   *webSocket;
+@property (nonatomic, strong) NSMutableDictionary   *channels;
+@property (nonatomic, strong) NSMutableArray        *upstream;
+@property (nonatomic, strong) NSMutableArray        *downstream;
+@property (nonatomic, assign) CFAbsoluteTime        upstreamBusyUntil;
+@property (nonatomic, assign) CFAbsoluteTime        downstreamBusyUntil;
+@property (nonatomic, assign) BOOL                  closed;
+@end
+
+@implementation SPLoopbackConnection
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _channels   = [NSMutableDictionary dictionary];
+        _upstream   = [NSMutableArray array];
+        _downstream = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)close {
+    self.closed = YES;
+    [self.upstream removeAllObjects];
+    [self.downstream removeAllObjects];
+}
+
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPLoopbackServer ()
+@property (nonatomic, strong) dispatch_queue_t      queue;
+@property (nonatomic, strong) NSMapTable            *connections;
+@property (nonatomic, strong) NSMutableDictionary   *buckets;
+@property (nonatomic, strong) NSMutableDictionary   *counters;
+@property (nonatomic, assign) uint64_t              randomState;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLoopbackServer
+#pragma mark ====================================================================================
+
+@implementation SPLoopbackServer
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _queue              = dispatch_queue_create("com.simperium.SPLoopbackServer", DISPATCH_QUEUE_SERIAL);
+        _connections        = [NSMapTable strongToStrongObjectsMapTable];
+        _buckets            = [NSMutableDictionary dictionary];
+        _counters           = [NSMutableDictionary dictionary];
+        _changeErrorCode    = CH_ERRORS_THRESHOLD;
+        _changeLogCapacity  = SPLoopbackDefaultChangeLogCapacity;
+        _seed               = SPLoopbackDefaultSeed;
+    }
+    return self;
+}
+
+- (void)start {
+    dispatch_sync(self.queue, ^{
+        self.randomState = self.seed ?: SPLoopbackDefaultSeed;
+    });
+    
+    [SPLoopbackWebSocket registerServer:self];
+}
+
+- (void)stop {
+    [SPLoopbackWebSocket registerServer:nil];
+    
+    dispatch_sync(self.queue, ^{
+        for (SPLoopbackConnection *connection in self.connections.objectEnumerator) {
+            [connection close];
+        }
+        [self.connections removeAllObjects];
+    });
+}
+
+- (void)dropAllConnections {
+    dispatch_async(self.queue, ^{
+        for (SPLoopbackConnection *connection in self.connections.objectEnumerator) {
+            [connection close];
+            
+            SPLoopbackWebSocket *webSocket = connection.webSocket;
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [webSocket didCloseWithCode:SPRStatusCodeGoingAway reason:@"Dropped" wasClean:NO];
+            });
+        }
+        [self.connections removeAllObjects];
+    });
+}
+
+- (NSDictionary *)stats {
+    __block NSDictionary *stats = nil;
+    dispatch_sync(self.queue, ^{
+        stats = [self.counters copy];
+    });
+    return stats;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Transport
+#pragma mark ====================================================================================
+
+- (void)openConnectionForWebSocket:(SPLoopbackWebSocket *)webSocket {
+    dispatch_async(self.queue, ^{
+        SPLoopbackConnection *connection    = [SPLoopbackConnection new];
+        connection.webSocket                = webSocket;
+        [self.connections setObject:connection forKey:webSocket];
+        
+        // Handshake: one round trip
+        [self transmitLength:0 connection:connection downstream:NO block:^{
+            [self transmitLength:0 connection:connection downstream:YES block:^{
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [webSocket didOpen];
+                });
+            }];
+        }];
+    });
+}
+
+- (void)closeConnectionForWebSocket:(SPLoopbackWebSocket *)webSocket {
+    dispatch_async(self.queue, ^{
+        SPLoopbackConnection *connection = [self.connections objectForKey:webSocket];
+        [connection close];
+        [self.connections removeObjectForKey:webSocket];
+    });
+}
+
+- (void)receiveMessage:(NSString *)message fromWebSocket:(SPLoopbackWebSocket *)webSocket {
+    dispatch_async(self.queue, ^{
+        SPLoopbackConnection *connection = [self.connections objectForKey:webSocket];
+        if (!connection || connection.closed) {
+            return;
+        }
+        
+        NSUInteger length = [message lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        [self incrementCounter:SPLoopbackStatsMessagesReceived by:1];
+        [self incrementCounter:SPLoopbackStatsBytesReceived by:length];
+        
+        [self transmitLength:length connection:connection downstream:NO block:^{
+            [self handleMessage:message connection:connection];
+        }];
+    });
+}
+
+- (void)sendMessage:(NSString *)message connection:(SPLoopbackConnection *)connection {
+    if (connection.closed) {
+        return;
+    }
+    
+    NSUInteger length = [message lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    [self incrementCounter:SPLoopbackStatsMessagesSent by:1];
+    [self incrementCounter:SPLoopbackStatsBytesSent by:length];
+    
+    [self transmitLength:length connection:connection downstream:YES block:^{
+        SPLoopbackWebSocket *webSocket = connection.webSocket;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [webSocket didReceiveMessage:message];
+        });
+    }];
+}
+
+// Links behave as pipes: a message can't start going through until the previous one is done, and then it takes
+// length / bandwidth to get through. Latency gets added on top of that.
+// Every scheduled delivery pops the link's head, so that timer jitter can't ever reorder messages.
+//
+- (void)transmitLength:(NSUInteger)length connection:(SPLoopbackConnection *)connection downstream:(BOOL)downstream block:(dispatch_block_t)block {
+    CFAbsoluteTime now          = CFAbsoluteTimeGetCurrent();
+    NSUInteger bandwidth        = self.bandwidth;
+    NSTimeInterval duration     = bandwidth ? (double)length / bandwidth : 0;
+    CFAbsoluteTime busyUntil    = downstream ? connection.downstreamBusyUntil : connection.upstreamBusyUntil;
+    CFAbsoluteTime sentTime     = MAX(now, busyUntil) + duration;
+    NSMutableArray *link        = downstream ? connection.downstream : connection.upstream;
+    
+    if (downstream) {
+        connection.downstreamBusyUntil = sentTime;
+    } else {
+        connection.upstreamBusyUntil = sentTime;
+    }
+    
+    [link addObject:[block copy]];
+    
+    NSTimeInterval delay = sentTime + self.latency - now;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.queue, ^{
+        if (connection.closed || link.count == 0) {
+            return;
+        }
+        
+        dispatch_block_t next = link.firstObject;
+        [link removeObjectAtIndex:0];
+        next();
+    });
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Message Handlers
+#pragma mark ====================================================================================
+
+- (void)handleMessage:(NSString *)message connection:(SPLoopbackConnection *)connection {
+    NSArray *components = [message sp_componentsSeparatedByString:@":" limit:SPLoopbackMessageComponents];
+    if (components.count < 2) {
+        return;
+    }
+    
+    NSString *channelStr    = components[0];
+    NSString *command       = components[1];
+    NSString *data          = (components.count > 2) ? components[2] : @"";
+    
+    // Heartbeats have the form [h:COUNT]
+    if ([channelStr isEqualToString:SPLoopbackCommandHeartbeat]) {
+        NSString *reply = [NSString stringWithFormat:@"%@:%ld", SPLoopbackCommandHeartbeat, (long)command.integerValue + 1];
+        [self sendMessage:reply connection:connection];
+        return;
+    }
+    
+    NSInteger number = channelStr.integerValue;
+    
+    if ([command isEqualToString:SPLoopbackCommandInit]) {
+        [self handleInit:data number:number connection:connection];
+        return;
+    }
+    
+    SPLoopbackChannel *channel = connection.channels[@(number)];
+    
+    if (!channel) {
+        [self sendCommand:SPLoopbackCommandError data:nil number:number connection:connection];
+    } else if ([command isEqualToString:SPLoopbackCommandIndex]) {
+        [self handleIndex:data channel:channel connection:connection];
+    } else if ([command isEqualToString:SPLoopbackCommandEntity]) {
+        [self handleEntity:data channel:channel connection:connection];
+    } else if ([command isEqualToString:SPLoopbackCommandChangeVersion]) {
+        [self handleChangeVersion:data channel:channel connection:connection];
+    } else if ([command isEqualToString:SPLoopbackCommandChange]) {
+        [self handleChange:data channel:channel connection:connection];
+    } else {
+        [self sendCommand:SPLoopbackCommandError data:nil number:number connection:connection];
+    }
+}
+
+- (void)handleInit:(NSString *)data number:(NSInteger)number connection:(SPLoopbackConnection *)connection {
+    NSDictionary *payload   = [data sp_objectFromJSONString];
+    BOOL isValid            = [payload isKindOfClass:[NSDictionary class]];
+    NSString *token         = isValid ? payload[@"token"] : nil;
+    NSString *name          = isValid ? payload[@"name"] : nil;
+    
+    if (token.length == 0 || name.length == 0) {
+        NSDictionary *error = @{ @"code" : @(CH_ERRORS_INVALID_PERMISSION), @"msg" : @"Invalid token" };
+        [self sendCommand:SPLoopbackCommandAuth data:[error sp_JSONString] number:number connection:connection];
+        return;
+    }
+    
+    // Buckets are scoped by token, as they'd be scoped by user
+    NSString *bucketKey         = [NSString stringWithFormat:@"%@/%@", token, name];
+    SPLoopbackBucket *bucket    = self.buckets[bucketKey];
+    if (!bucket) {
+        bucket                  = [SPLoopbackBucket new];
+        self.buckets[bucketKey] = bucket;
+    }
+    
+    SPLoopbackChannel *channel      = [SPLoopbackChannel new];
+    channel.bucket                  = bucket;
+    channel.clientID                = payload[@"clientid"];
+    channel.number                  = number;
+    connection.channels[@(number)]  = channel;
+    
+    NSString *username = [payload[@"username"] length] ? payload[@"username"] : SPLoopbackDefaultUsername;
+    [self sendCommand:SPLoopbackCommandAuth data:username number:number connection:connection];
+}
+
+// Index requests have the form [FLAGS:MARK:SINCE:LIMIT]
+- (void)handleIndex:(NSString *)data channel:(SPLoopbackChannel *)channel connection:(SPLoopbackConnection *)connection {
+    NSArray *parameters     = [data componentsSeparatedByString:@":"];
+    NSString *mark          = (parameters.count > 1) ? parameters[1] : @"";
+    NSUInteger limit        = (parameters.count > 3) ? (NSUInteger)MAX([parameters[3] integerValue], 0) : 0;
+    NSUInteger pageSize     = self.indexPageSize;
+    
+    if (pageSize && (limit == 0 || limit > pageSize)) {
+        limit = pageSize;
+    }
+    
+    SPLoopbackBucket *bucket    = channel.bucket;
+    NSArray *keys               = [bucket.objects.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    NSMutableArray *index       = [NSMutableArray array];
+    NSString *nextMark          = nil;
+    
+    for (NSString *key in keys) {
+        SPLoopbackObject *object = bucket.objects[key];
+        if (object.data == nil || (mark.length && [key compare:mark] == NSOrderedAscending)) {
+            continue;
+        }
+        
+        if (limit && index.count == limit) {
+            nextMark = key;
+            break;
+        }
+        
+        [index addObject:@{ CH_KEY : key, @"v" : @(object.version) }];
+    }
+    
+    NSMutableDictionary *response = [@{
+        @"index"    : index,
+        @"current"  : [bucket currentVersion]
+    } mutableCopy];
+    
+    if (nextMark) {
+        response[@"mark"] = nextMark;
+    }
+    
+    [self incrementCounter:SPLoopbackStatsIndexPages by:1];
+    [self sendCommand:SPLoopbackCommandIndex data:[response sp_JSONString] number:channel.number connection:connection];
+}
+
+// Entity requests have the form [KEY.VERSION], and keys may contain periods
+- (void)handleEntity:(NSString *)data channel:(SPLoopbackChannel *)channel connection:(SPLoopbackConnection *)connection {
+    NSRange separator       = [data rangeOfString:@"." options:NSBackwardsSearch];
+    NSString *key           = (separator.location != NSNotFound) ? [data substringToIndex:separator.location] : nil;
+    NSString *version       = (separator.location != NSNotFound) ? [data substringFromIndex:NSMaxRange(separator)] : nil;
+    SPLoopbackObject *object = key ? channel.bucket.objects[key] : nil;
+    NSDictionary *entity    = version ? object.history[version] : nil;
+    
+    if (!entity) {
+        [self sendCommand:SPLoopbackCommandEntity data:SPLoopbackCommandError number:channel.number connection:connection];
+        return;
+    }
+    
+    NSString *payload = [NSString stringWithFormat:@"%@\n%@", data, [@{ @"data" : entity } sp_JSONString]];
+    
+    [self incrementCounter:SPLoopbackStatsEntities by:1];
+    [self sendCommand:SPLoopbackCommandEntity data:payload number:channel.number connection:connection];
+}
+
+- (void)handleChangeVersion:(NSString *)data channel:(SPLoopbackChannel *)channel connection:(SPLoopbackConnection *)connection {
+    NSArray *changes = [channel.bucket changesSinceVersion:data];
+    
+    if (!changes) {
+        [self sendCommand:SPLoopbackCommandChangeVersion data:SPLoopbackCommandError number:channel.number connection:connection];
+        return;
+    }
+    
+    // From now on, the channel gets every change broadcasted
+    channel.subscribed = YES;
+    
+    for (NSUInteger location = 0; location < changes.count; location += SPLoopbackChangesPageSize) {
+        NSRange range   = NSMakeRange(location, MIN(SPLoopbackChangesPageSize, changes.count - location));
+        NSArray *page   = [changes subarrayWithRange:range];
+        [self sendCommand:SPLoopbackCommandChange data:[page sp_JSONString] number:channel.number connection:connection];
+    }
+}
+
+- (void)handleChange:(NSString *)data channel:(SPLoopbackChannel *)channel connection:(SPLoopbackConnection *)connection {
+    NSDictionary *change = [data sp_objectFromJSONString];
+    if (![change isKindOfClass:[NSDictionary class]]) {
+        [self sendCommand:SPLoopbackCommandError data:nil number:channel.number connection:connection];
+        return;
+    }
+    
+    SPLoopbackBucket *bucket    = channel.bucket;
+    NSString *ccid              = change[CH_LOCAL_ID];
+    
+    if ([change[CH_OPERATION] isEqual:CH_EMPTY]) {
+        [self emptyBucket:bucket channel:channel ccid:ccid];
+        return;
+    }
+    
+    if (ccid && [bucket.ccids containsObject:ccid]) {
+        [self rejectChange:change code:CH_ERRORS_DUPLICATE channel:channel connection:connection];
+        return;
+    }
+    
+    if (self.changeErrorRate > 0 && [self randomRatio] < self.changeErrorRate) {
+        [self incrementCounter:SPLoopbackStatsErrorsInjected by:1];
+        [self rejectChange:change code:self.changeErrorCode channel:channel connection:connection];
+        return;
+    }
+    
+    NSInteger errorCode             = 0;
+    NSDictionary *appliedChange     = [self applyChange:change bucket:bucket channel:channel errorCode:&errorCode];
+    
+    if (!appliedChange) {
+        [self rejectChange:change code:errorCode channel:channel connection:connection];
+        return;
+    }
+    
+    [bucket.ccids addObject:ccid];
+    [self broadcastChanges:@[ appliedChange ] bucket:bucket origin:channel];
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Change Helpers
+#pragma mark ====================================================================================
+
+- (NSDictionary *)applyChange:(NSDictionary *)change bucket:(SPLoopbackBucket *)bucket channel:(SPLoopbackChannel *)channel errorCode:(NSInteger *)errorCode {
+    NSString *key               = change[CH_KEY];
+    NSString *ccid              = change[CH_LOCAL_ID];
+    NSString *operation         = change[CH_OPERATION];
+    id startVersion             = change[CH_START_VERSION];
+    
+    if (![key isKindOfClass:[NSString class]] || key.length == 0 || ![ccid isKindOfClass:[NSString class]]) {
+        *errorCode = CH_ERRORS_INVALID_SCHEMA;
+        return nil;
+    }
+    
+    SPLoopbackObject *object    = bucket.objects[key];
+    BOOL exists                 = (object.data != nil);
+    NSDictionary *base          = exists ? object.data : @{ };
+    NSDictionary *data          = nil;
+    NSDictionary *diff          = nil;
+    
+    if ([operation isEqual:CH_REMOVE]) {
+        if (!exists) {
+            *errorCode = CH_ERRORS_NOT_FOUND;
+            return nil;
+        }
+        
+    } else if ([operation isEqual:CH_MODIFY]) {
+        NSDictionary *fullData = change[CH_DATA];
+        
+        // Full data overrides whatever is there, regardless of the start version
+        if ([fullData isKindOfClass:[NSDictionary class]]) {
+            data = fullData;
+            diff = [self replaceDiffFromDictionary:base toDictionary:fullData];
+            
+        } else {
+            diff = change[CH_VALUE];
+            
+            if (![diff isKindOfClass:[NSDictionary class]] || diff.count == 0) {
+                *errorCode = CH_ERRORS_EMPTY_CHANGE;
+                return nil;
+            }
+            
+            if (startVersion && (!exists || [startVersion integerValue] != object.version)) {
+                *errorCode = exists ? CH_ERRORS_BAD_VERSION : CH_ERRORS_NOT_FOUND;
+                return nil;
+            }
+            
+            data = [self applyDiff:diff toDictionary:base];
+            if (!data) {
+                *errorCode = CH_ERRORS_INVALID_DIFF;
+                return nil;
+            }
+        }
+        
+        if (exists && [data isEqualToDictionary:base]) {
+            *errorCode = CH_ERRORS_EMPTY_CHANGE;
+            return nil;
+        }
+        
+    } else {
+        *errorCode = CH_ERRORS_INVALID_SCHEMA;
+        return nil;
+    }
+    
+    if (!object) {
+        object                  = [SPLoopbackObject new];
+        bucket.objects[key]     = object;
+    }
+    
+    NSInteger previousVersion   = object.version;
+    NSMutableDictionary *record = [NSMutableDictionary dictionary];
+    record[CH_KEY]              = key;
+    record[CH_OPERATION]        = operation;
+    record[@"ccids"]            = @[ ccid ];
+    
+    if (diff) {
+        record[CH_VALUE]        = diff;
+    }
+    
+    // Recreated objects start over, as far as clients are concerned
+    if (exists) {
+        record[CH_START_VERSION] = @(previousVersion);
+    }
+    
+    [self commitData:data object:object record:record bucket:bucket clientID:channel.clientID];
+    [self incrementCounter:SPLoopbackStatsChangesApplied by:1];
+    
+    return record;
+}
+
+- (void)emptyBucket:(SPLoopbackBucket *)bucket channel:(SPLoopbackChannel *)channel ccid:(NSString *)ccid {
+    NSMutableArray *removals = [NSMutableArray array];
+    
+    for (NSString *key in bucket.objects) {
+        SPLoopbackObject *object = bucket.objects[key];
+        if (object.data == nil) {
+            continue;
+        }
+        
+        NSMutableDictionary *record = [@{
+            CH_KEY              : key,
+            CH_OPERATION        : CH_REMOVE,
+            CH_START_VERSION    : @(object.version),
+            @"ccids"            : (ccid ? @[ ccid ] : @[ ])
+        } mutableCopy];
+        
+        [self commitData:nil object:object record:record bucket:bucket clientID:channel.clientID];
+        [removals addObject:record];
+    }
+    
+    if (removals.count) {
+        [self broadcastChanges:removals bucket:bucket origin:channel];
+    }
+}
+
+- (void)commitData:(NSDictionary *)data object:(SPLoopbackObject *)object record:(NSMutableDictionary *)record bucket:(SPLoopbackBucket *)bucket clientID:(NSString *)clientID {
+    object.version  += 1;
+    object.data     = data;
+    bucket.sequence += 1;
+    
+    if (data) {
+        object.history[[NSString stringWithFormat:@"%ld", (long)object.version]] = data;
+    }
+    
+    record[CH_CLIENT_ID]        = clientID ?: @"";
+    record[CH_CHANGE_VERSION]   = [bucket currentVersion];
+    record[CH_END_VERSION]      = @(object.version);
+    
+    [bucket.changes addObject:record];
+    
+    NSUInteger capacity = self.changeLogCapacity;
+    if (capacity && bucket.changes.count > capacity) {
+        [bucket.changes removeObjectsInRange:NSMakeRange(0, bucket.changes.count - capacity)];
+    }
+}
+
+// The sender always gets its acknowledgements. Everybody else, only once they've caught up with a cv
+- (void)broadcastChanges:(NSArray *)changes bucket:(SPLoopbackBucket *)bucket origin:(SPLoopbackChannel *)origin {
+    NSString *payload = [changes sp_JSONString];
+    
+    for (SPLoopbackConnection *connection in self.connections.objectEnumerator) {
+        for (SPLoopbackChannel *channel in connection.channels.objectEnumerator) {
+            if (channel.bucket != bucket || (channel != origin && !channel.subscribed)) {
+                continue;
+            }
+            
+            [self sendCommand:SPLoopbackCommandChange data:payload number:channel.number connection:connection];
+        }
+    }
+}
+
+- (void)rejectChange:(NSDictionary *)change code:(NSInteger)code channel:(SPLoopbackChannel *)channel connection:(SPLoopbackConnection *)connection {
+    NSDictionary *error = @{
+        CH_KEY      : change[CH_KEY] ?: @"",
+        @"ccids"    : change[CH_LOCAL_ID] ? @[ change[CH_LOCAL_ID] ] : @[ ],
+        CH_ERROR    : @(code)
+    };
+    
+    [self incrementCounter:SPLoopbackStatsChangesRejected by:1];
+    [self sendCommand:SPLoopbackCommandChange data:[@[ error ] sp_JSONString] number:channel.number connection:connection];
+}
+
+- (void)sendCommand:(NSString *)command data:(NSString *)data number:(NSInteger)number connection:(SPLoopbackConnection *)connection {
+    NSString *message = data ? [NSString stringWithFormat:@"%ld:%@:%@", (long)number, command, data]
+                             : [NSString stringWithFormat:@"%ld:%@", (long)number, command];
+    [self sendMessage:message connection:connection];
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Schemaless jsondiff
+#pragma mark ====================================================================================
+
+// The server has no idea about schemas: operations get applied based on their type alone, as jsondiff does
+- (NSDictionary *)applyDiff:(NSDictionary *)diff toDictionary:(NSDictionary *)dictionary {
+    if (![diff isKindOfClass:[NSDictionary class]] || ![dictionary isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    
+    NSMutableDictionary *updated = [dictionary mutableCopy];
+    
+    for (NSString *key in diff) {
+        NSDictionary *operation = diff[key];
+        if (![operation isKindOfClass:[NSDictionary class]]) {
+            return nil;
+        }
+        
+        if ([operation[OP_OP] isEqual:OP_OBJECT_REMOVE]) {
+            [updated removeObjectForKey:key];
+            continue;
+        }
+        
+        id value = [self applyOperation:operation toValue:updated[key]];
+        if (!value) {
+            return nil;
+        }
+        
+        updated[key] = value;
+    }
+    
+    return updated;
+}
+
+- (id)applyOperation:(NSDictionary *)operation toValue:(id)value {
+    NSString *op    = operation[OP_OP];
+    id argument     = operation[OP_VALUE];
+    
+    if ([op isEqual:OP_OBJECT_ADD] || [op isEqual:OP_OBJECT_REPLACE]) {
+        return argument;
+    }
+    
+    if ([op isEqual:OP_OBJECT]) {
+        return [self applyDiff:argument toDictionary:(value ?: @{ })];
+    }
+    
+    if ([op isEqual:OP_INTEGER]) {
+        value = value ?: @0;
+        if (![value isKindOfClass:[NSNumber class]] || ![argument isKindOfClass:[NSNumber class]]) {
+            return nil;
+        }
+        return @([value longLongValue] + [argument longLongValue]);
+    }
+    
+    if ([op isEqual:OP_STRING]) {
+        value = value ?: @"";
+        if (![value isKindOfClass:[NSString class]] || ![argument isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        
+        DiffMatchPatch *dmp     = [DiffMatchPatch sp_threadLocalInstance];
+        NSError *error          = nil;
+        NSMutableArray *diffs   = [dmp diff_fromDeltaWithText:value andDelta:argument error:&error];
+        
+        return error ? nil : [dmp diff_text2:diffs];
+    }
+    
+    if ([op isEqual:OP_LIST_DMP]) {
+        value = value ?: @[ ];
+        if (![value isKindOfClass:[NSArray class]] || ![argument isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        return [value sp_arrayByApplyingDiffDelta:argument diffMatchPatch:[DiffMatchPatch sp_threadLocalInstance]];
+    }
+    
+    if ([op isEqual:OP_BINARY_DELTA]) {
+        if (![value isKindOfClass:[NSString class]] || ![argument isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        
+        NSData *data = [[NSData sp_decodeBase64WithString:value] sp_dataByApplyingBinaryDelta:argument];
+        
+        return data ? [NSString sp_encodeBase64WithData:data] : nil;
+    }
+    
+    // OP_LIST (index based list operations) isn't ever produced by the client
+    return nil;
+}
+
+- (NSDictionary *)replaceDiffFromDictionary:(NSDictionary *)base toDictionary:(NSDictionary *)target {
+    NSMutableDictionary *diff = [NSMutableDictionary dictionary];
+    
+    for (NSString *key in target) {
+        if (![base[key] isEqual:target[key]]) {
+            diff[key] = @{ OP_OP : OP_OBJECT_REPLACE, OP_VALUE : target[key] };
+        }
+    }
+    
+    for (NSString *key in base) {
+        if (!target[key]) {
+            diff[key] = @{ OP_OP : OP_OBJECT_REMOVE };
+        }
+    }
+    
+    return diff;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Helpers
+#pragma mark ====================================================================================
+
+- (void)incrementCounter:(NSString *)name by:(NSUInteger)delta {
+    self.counters[name] = @([self.counters[name] unsignedLongLongValue] + delta);
+}
+
+// xorshift64*, mapped onto [0, 1)
+- (double)randomRatio {
+    uint64_t x          = self.randomState;
+    x                   ^= x >> 12;
+    x                   ^= x << 25;
+    x                   ^= x >> 27;
+    self.randomState    = x;
+    
+    return ((x * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  SPLoopbackWebSocket.h
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPWebSocket.h"
+
+
+
+@class SPLoopbackServer;
+
+#pragma mark ====================================================================================
+#pragma mark SPLoopbackWebSocket
+#pragma mark ====================================================================================
+
+// SPWebSocket that talks to an SPLoopbackServer, rather than to the network.
+// Every delegate callback is delivered asynchronously, on the main thread, just like SPRWebSocket does.
+//
+@interface SPLoopbackWebSocket : SPWebSocket
+
+// Routes every SPWebSocket to the given server. Nil restores the regular SPWebSocket
++ (void)registerServer:(SPLoopbackServer *)server;
+
+// Transport: Invoked by SPLoopbackServer, on the main thread
+- (void)didOpen;
+- (void)didReceiveMessage:(NSString *)message;
+- (void)didCloseWithCode:(NSInteger)code reason:(NSString *)reason wasClean:(BOOL)wasClean;
+
+@end
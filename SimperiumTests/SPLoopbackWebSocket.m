@@ -0,0 +1,152 @@
+//
+//  SPLoopbackWebSocket.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPLoopbackWebSocket.h"
+#import "SPLoopbackServer.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static SPLoopbackServer *SPLoopbackRegisteredServer = nil;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private
+#pragma mark ====================================================================================
+
+@interface SPLoopbackWebSocket ()
+@property (nonatomic, strong) SPLoopbackServer      *server;
+@property (nonatomic, assign) SPRReadyState         state;
+@property (nonatomic, strong) NSDate                *lastSeen;
+@property (nonatomic, assign) NSUInteger            sentCount;
+@property (nonatomic, assign) NSUInteger            receivedCount;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPLoopbackWebSocket
+#pragma mark ====================================================================================
+
+@implementation SPLoopbackWebSocket
+
++ (void)registerServer:(SPLoopbackServer *)server {
+    NSAssert([NSThread isMainThread], @"This should get called on the main thread!");
+    
+    SPLoopbackRegisteredServer = server;
+    [SPWebSocket registerClass:(server ? [SPLoopbackWebSocket class] : [SPWebSocket class])];
+}
+
+// Note: SPWebSocket's initializer would spin up an actual SPRWebSocket
+- (instancetype)initWithURLRequest:(NSURLRequest *)request {
+    self = [super init];
+    if (self) {
+        _server = SPLoopbackRegisteredServer;
+        _state  = SPR_CLOSED;
+    }
+    return self;
+}
+
+- (void)open {
+    NSAssert(self.server, @"Missing SPLoopbackServer");
+    
+    self.state          = SPR_CONNECTING;
+    self.sentCount      = 0;
+    self.receivedCount  = 0;
+    [self.server openConnectionForWebSocket:self];
+}
+
+- (void)close {
+    if (self.state == SPR_CLOSED || self.state == SPR_CLOSING) {
+        return;
+    }
+    
+    self.state = SPR_CLOSING;
+    [self.server closeConnectionForWebSocket:self];
+    
+    // Local close: the delegate hears about it asynchronously, once the socket is gone
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self didCloseWithCode:SPRStatusCodeNormal reason:nil wasClean:YES];
+    });
+}
+
+- (void)send:(id)data {
+    NSAssert([data isKindOfClass:[NSString class]], @"SPLoopbackWebSocket only supports text messages");
+    
+    if (self.state != SPR_OPEN) {
+        return;
+    }
+    
+    self.sentCount = [data lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    [self.server receiveMessage:data fromWebSocket:self];
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Overridden Properties
+#pragma mark ====================================================================================
+
+- (SPRReadyState)readyState {
+    return self.state;
+}
+
+- (NSDate *)lastSeenTimestamp {
+    return self.lastSeen;
+}
+
+- (NSUInteger)bytesSent {
+    return self.sentCount;
+}
+
+- (NSUInteger)bytesReceived {
+    return self.receivedCount;
+}
+
+
+#pragma mark ====================================================================================
+#pragma mark Transport
+#pragma mark ====================================================================================
+
+- (void)didOpen {
+    NSAssert([NSThread isMainThread], @"This should get called on the main thread!");
+    
+    if (self.state != SPR_CONNECTING) {
+        return;
+    }
+    
+    self.state      = SPR_OPEN;
+    self.lastSeen   = [NSDate date];
+    [self.delegate webSocketDidOpen:self];
+}
+
+- (void)didReceiveMessage:(NSString *)message {
+    NSAssert([NSThread isMainThread], @"This should get called on the main thread!");
+    
+    if (self.state != SPR_OPEN) {
+        return;
+    }
+    
+    self.lastSeen       = [NSDate date];
+    self.receivedCount  = [message lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    [self.delegate webSocket:self didReceiveMessage:message];
+}
+
+- (void)didCloseWithCode:(NSInteger)code reason:(NSString *)reason wasClean:(BOOL)wasClean {
+    NSAssert([NSThread isMainThread], @"This should get called on the main thread!");
+    
+    if (self.state == SPR_CLOSED) {
+        return;
+    }
+    
+    self.state = SPR_CLOSED;
+    [self.delegate webSocket:self didCloseWithCode:code reason:reason wasClean:wasClean];
+}
+
+@end
@@ -0,0 +1,177 @@
+//
+//  SPManagedObjectBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "MockStorage.h"
+#import "SPBucket+Internals.h"
+#import "SPCoreDataStorage.h"
+#import "SPManagedObject.h"
+#import "SPSchema.h"
+#import "NSData+Simperium.h"
+#import "NSString+Simperium.h"
+#import <objc/runtime.h>
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPManagedObjectBenchmarksEntity         = @"Hologram";
+static NSString * const SPManagedObjectBenchmarksLabel          = @"SPManagedObjectBenchmarks";
+static NSString * const SPManagedObjectBenchmarksClientID       = @"Benchmark-Local";
+static NSString * const SPManagedObjectBenchmarksMember         = @"program";
+static NSString * const SPManagedObjectBenchmarksTransformer    = @"NSSecureUnarchiveFromData";
+static NSUInteger const SPManagedObjectBenchmarksObjectCount    = 200;
+static NSUInteger const SPManagedObjectBenchmarksProgramLength  = 64;
+static NSUInteger const SPManagedObjectBenchmarksTextLength     = 64;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPManagedObjectBenchmarks
+#pragma mark ====================================================================================
+
+// Mimics the Index Processor: wire values get loaded into a batch of objects, which then get saved.
+// Eager and Lazy runs are meant to be compared against each other.
+//
+@interface SPManagedObjectBenchmarks : SPBenchmarkTestCase
+@property (nonatomic, strong) MockStorage               *storage;
+@property (nonatomic, strong) SPBucket                  *bucket;
+@property (nonatomic, strong) NSManagedObjectContext    *context;
+@property (nonatomic, strong) NSArray                   *objects;
+@property (nonatomic, strong) NSArray                   *wireValues;
+@property (nonatomic, strong) NSArray                   *otherWireValues;
+@end
+
+@implementation SPManagedObjectBenchmarks
+
+- (void)setUp {
+    [super setUp];
+    
+    NSPersistentStoreCoordinator *coordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:[self model]];
+    [coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:nil URL:nil options:nil error:nil];
+    
+    NSDictionary *definition = @{
+        @"members" : @[
+            @{ @"name" : SPManagedObjectBenchmarksMember, @"type" : @"base64", @"valueTransformerName" : SPManagedObjectBenchmarksTransformer }
+        ]
+    };
+    
+    // Note: The bucket only keeps a weak reference to its storage
+    SPSchema *schema    = [[SPSchema alloc] initWithBucketName:SPManagedObjectBenchmarksEntity data:definition];
+    self.storage        = [MockStorage new];
+    self.bucket         = [[SPBucket alloc] initWithSchema:schema
+                                                   storage:self.storage
+                                          networkInterface:nil
+                                      relationshipResolver:nil
+                                                     label:SPManagedObjectBenchmarksLabel
+                                                remoteName:SPManagedObjectBenchmarksEntity
+                                                  clientID:SPManagedObjectBenchmarksClientID];
+    
+    // SPManagedObject instances find their bucket through the coordinator
+    objc_setAssociatedObject(coordinator, SPCoreDataBucketListKey, @{ SPManagedObjectBenchmarksEntity : self.bucket }, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    self.context                        = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSMainQueueConcurrencyType];
+    self.context.persistentStoreCoordinator = coordinator;
+    
+    NSMutableArray *objects             = [NSMutableArray arrayWithCapacity:SPManagedObjectBenchmarksObjectCount];
+    NSMutableArray *wireValues          = [NSMutableArray arrayWithCapacity:SPManagedObjectBenchmarksObjectCount];
+    NSMutableArray *otherWireValues     = [NSMutableArray arrayWithCapacity:SPManagedObjectBenchmarksObjectCount];
+    
+    for (NSUInteger i = 0; i < SPManagedObjectBenchmarksObjectCount; ++i) {
+        SPManagedObject *object = [NSEntityDescription insertNewObjectForEntityForName:SPManagedObjectBenchmarksEntity inManagedObjectContext:self.context];
+        object.simperiumKey     = [self randomStringOfLength:24];
+        
+        [objects addObject:object];
+        [wireValues addObject:[self randomWireValue]];
+        [otherWireValues addObject:[self randomWireValue]];
+    }
+    
+    [self.context save:nil];
+    
+    self.objects            = objects;
+    self.wireValues         = wireValues;
+    self.otherWireValues    = otherWireValues;
+}
+
+- (void)testLoadAndSaveEagerly {
+    [self benchmarkLoadAndSaveNamed:@"managedObject.loadAndSave.eager" lazy:NO];
+}
+
+- (void)testLoadAndSaveLazily {
+    [self benchmarkLoadAndSaveNamed:@"managedObject.loadAndSave.lazy" lazy:YES];
+}
+
+
+#pragma mark - Helpers
+
+- (void)benchmarkLoadAndSaveNamed:(NSString *)name lazy:(BOOL)lazy {
+    NSArray *objects                    = self.objects;
+    NSManagedObjectContext *context     = self.context;
+    __block NSArray *wireValues         = self.wireValues;
+    __block NSError *error              = nil;
+    
+    self.bucket.differ.schema.lazyLoadingEnabled = lazy;
+    
+    // Alternate between two sets of wire values, so that every sample actually changes every object
+    [self benchmark:name operations:objects.count prepare:^{
+        wireValues = (wireValues == self.wireValues) ? self.otherWireValues : self.wireValues;
+    } block:^{
+        for (NSUInteger i = 0; i < objects.count; ++i) {
+            [objects[i] loadMemberData:@{ SPManagedObjectBenchmarksMember : wireValues[i] }];
+        }
+        [context save:&error];
+    }];
+    
+    XCTAssertNil(error, @"Inconsistency detected");
+    
+    // Either way, the members must read back the same
+    NSValueTransformer *transformer = [NSValueTransformer valueTransformerForName:SPManagedObjectBenchmarksTransformer];
+    NSData *archived                = [NSData sp_decodeBase64WithString:wireValues.firstObject];
+    
+    XCTAssertEqualObjects([objects.firstObject valueForKey:SPManagedObjectBenchmarksMember], [transformer reverseTransformedValue:archived], @"Inconsistency detected");
+}
+
+- (NSString *)randomWireValue {
+    NSMutableDictionary *program = [NSMutableDictionary dictionaryWithCapacity:SPManagedObjectBenchmarksProgramLength];
+    for (NSUInteger i = 0; i < SPManagedObjectBenchmarksProgramLength; ++i) {
+        program[[self randomStringOfLength:8]] = [self randomTextOfLength:SPManagedObjectBenchmarksTextLength];
+    }
+    
+    NSData *archived = [[NSValueTransformer valueTransformerForName:SPManagedObjectBenchmarksTransformer] transformedValue:program];
+    return [NSString sp_encodeBase64WithData:archived];
+}
+
+- (NSManagedObjectModel *)model {
+    NSAttributeDescription *program         = [self attributeNamed:SPManagedObjectBenchmarksMember type:NSTransformableAttributeType];
+    program.valueTransformerName            = SPManagedObjectBenchmarksTransformer;
+    
+    NSEntityDescription *entity             = [NSEntityDescription new];
+    entity.name                             = SPManagedObjectBenchmarksEntity;
+    entity.managedObjectClassName           = NSStringFromClass([SPManagedObject class]);
+    entity.properties                       = @[
+        [self attributeNamed:@"simperiumKey" type:NSStringAttributeType],
+        [self attributeNamed:@"ghostData" type:NSStringAttributeType],
+        program
+    ];
+    
+    NSManagedObjectModel *model             = [NSManagedObjectModel new];
+    model.entities                          = @[ entity ];
+    
+    return model;
+}
+
+- (NSAttributeDescription *)attributeNamed:(NSString *)name type:(NSAttributeType)type {
+    NSAttributeDescription *attribute   = [NSAttributeDescription new];
+    attribute.name                      = name;
+    attribute.attributeType             = type;
+    attribute.optional                  = YES;
+    return attribute;
+}
+
+@end
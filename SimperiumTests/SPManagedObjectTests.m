@@ -12,6 +12,7 @@
 #import "Post.h"
 #import "PostComment.h"
 #import "Config.h"
+#import "NSString+Simperium.h"
 
 
 
@@ -99,4 +100,92 @@
     XCTAssertNil(comment.post, @"The post shouldn't have been set due to type mismatch");
 }
 
+- (void)testLazyMemberLoadingDefersDecodingUntilFirstAccess {
+    self.simperium.lazyMemberLoadingEnabled = YES;
+    
+    Config *config          = [NSEntityDescription insertNewObjectForEntityForName:[Config entityName] inManagedObjectContext:self.managedObjectContext];
+    NSString *captainsLog   = NSStringFromSelector(@selector(captainsLog));
+    NSString *warpSpeed     = NSStringFromSelector(@selector(warpSpeed));
+    
+    [config loadMemberData:@{ captainsLog : @"Lazy Log", warpSpeed : @(9) }];
+    
+    XCTAssertNil([config primitiveValueForKey:captainsLog],                 @"Members should not be decoded before being accessed");
+    XCTAssertEqualObjects(config.dictionary[captainsLog], @"Lazy Log",      @"The wire value should be available without decoding");
+    XCTAssertNil([config primitiveValueForKey:captainsLog],                 @"Building the dictionary should not decode members");
+    
+    XCTAssertEqualObjects([config simperiumValueForKey:captainsLog], @"Lazy Log", @"Invalid value after first access");
+    XCTAssertEqualObjects([config primitiveValueForKey:captainsLog], @"Lazy Log", @"The member should be decoded after first access");
+    XCTAssertNil([config primitiveValueForKey:warpSpeed],                   @"Other members should remain untouched");
+    
+    // Pending members get decoded before hitting the store
+    NSError *error = nil;
+    [self.managedObjectContext save:&error];
+    
+    XCTAssertNil(error, @"Save shouldn't throw an error");
+    XCTAssertEqualObjects([config primitiveValueForKey:warpSpeed], @(9),    @"Pending members should be decoded on save");
+}
+
+- (void)testLazyMemberLoadingKeepsValuesSetBeforeFirstAccess {
+    self.simperium.lazyMemberLoadingEnabled = YES;
+    
+    Config *config          = [NSEntityDescription insertNewObjectForEntityForName:[Config entityName] inManagedObjectContext:self.managedObjectContext];
+    NSString *captainsLog   = NSStringFromSelector(@selector(captainsLog));
+    NSString *warpSpeed     = NSStringFromSelector(@selector(warpSpeed));
+    
+    [config loadMemberData:@{ captainsLog : @"Remote Log", warpSpeed : @(9) }];
+    
+    // Set the members without reading them first: the pending wire values must not win
+    config.captainsLog = @"User Log";
+    [config simperiumSetValue:@(42) forKey:warpSpeed];
+    
+    NSError *error = nil;
+    [self.managedObjectContext save:&error];
+    
+    XCTAssertNil(error, @"Save shouldn't throw an error");
+    XCTAssertEqualObjects([config primitiveValueForKey:captainsLog], @"User Log", @"The user's value should survive the save");
+    XCTAssertEqualObjects([config primitiveValueForKey:warpSpeed], @(42),         @"The user's value should survive the save");
+    XCTAssertEqualObjects(config.dictionary[captainsLog], @"User Log",            @"The dictionary should reflect the user's value");
+}
+
+- (void)testLazyMemberLoadingPersistsTransformableWireValues {
+    self.simperium.lazyMemberLoadingEnabled = YES;
+    
+    Config *config          = [NSEntityDescription insertNewObjectForEntityForName:[Config entityName] inManagedObjectContext:self.managedObjectContext];
+    NSString *hologram      = NSStringFromSelector(@selector(hologram));
+    NSDictionary *program   = @{ @"holodeck" : @"Dixon Hill", @"safeties" : @(YES) };
+    NSData *archived        = [[NSValueTransformer valueTransformerForName:@"NSSecureUnarchiveFromData"] transformedValue:program];
+    NSString *wireValue     = [NSString sp_encodeBase64WithData:archived];
+    
+    [config loadMemberData:@{ hologram : wireValue }];
+    
+    // Saving should store the wire value as it is, rather than decoding it
+    NSError *error = nil;
+    [self.managedObjectContext save:&error];
+    [self.managedObjectContext refreshObject:config mergeChanges:NO];
+    
+    XCTAssertNil(error, @"Save shouldn't throw an error");
+    XCTAssertEqualObjects(config.dictionary[hologram], wireValue,           @"The stored wire value should be available without decoding");
+    XCTAssertFalse([[config primitiveValueForKey:hologram] isEqual:program], @"Building the dictionary should not decode members");
+    
+    XCTAssertEqualObjects(config.hologram, program,                         @"The member should be decoded on first access");
+    XCTAssertEqualObjects([config primitiveValueForKey:hologram], program,  @"The member should remain decoded");
+    
+    // Changes win over the stored wire value
+    config.hologram = @{ @"holodeck" : @"Sherlock Holmes" };
+    [self.managedObjectContext save:&error];
+    [self.managedObjectContext refreshObject:config mergeChanges:NO];
+    
+    XCTAssertNil(error, @"Save shouldn't throw an error");
+    XCTAssertEqualObjects(config.hologram[@"holodeck"], @"Sherlock Holmes", @"The user's value should survive the save");
+}
+
+- (void)testLazyMemberLoadingIsDisabledByDefault {
+    Config *config          = [NSEntityDescription insertNewObjectForEntityForName:[Config entityName] inManagedObjectContext:self.managedObjectContext];
+    NSString *captainsLog   = NSStringFromSelector(@selector(captainsLog));
+    
+    [config loadMemberData:@{ captainsLog : @"Eager Log" }];
+    
+    XCTAssertEqualObjects([config primitiveValueForKey:captainsLog], @"Eager Log", @"Members should be decoded right away");
+}
+
 @end
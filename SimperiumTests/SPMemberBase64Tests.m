@@ -0,0 +1,283 @@
+//
+//  SPMemberBase64Tests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPMemberBase64.h"
+#import "SPGhost.h"
+#import "SPGhostStore.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSUInteger const SPMemberBase64TestsBlobLength       = 64 * 1024;
+static NSUInteger const SPMemberBase64TestsLargeBlobLength  = 5 * 1024 * 1024;
+
+
+#pragma mark ====================================================================================
+#pragma mark Private Methods
+#pragma mark ====================================================================================
+
+@interface SPMemberBase64 ()
+- (NSString *)stringValueFromTransformable:(id)value;
+@end
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberBase64Tests
+#pragma mark ====================================================================================
+
+@interface SPMemberBase64Tests : XCTestCase
+@property (nonatomic, strong) SPMemberBase64 *binaryMember;
+@end
+
+@implementation SPMemberBase64Tests
+
+- (void)setUp {
+    self.binaryMember = [[SPMemberBase64 alloc] initFromDictionary:@{ @"name" : @"blob", @"type" : @"base64" }];
+}
+
+- (NSMutableData *)randomBlob {
+    return [self randomBlobWithLength:SPMemberBase64TestsBlobLength];
+}
+
+- (NSMutableData *)randomBlobWithLength:(NSUInteger)length {
+    NSMutableData *blob = [NSMutableData dataWithLength:length];
+    arc4random_buf(blob.mutableBytes, blob.length);
+    return blob;
+}
+
+- (SPMemberBase64 *)binaryDeltaMember {
+    return [[SPMemberBase64 alloc] initFromDictionary:@{ @"name" : @"blob", @"type" : @"base64", @"binaryDelta" : @(YES) }];
+}
+
+- (void)testEncodingIsCachedForTheSameInstance {
+    NSData *blob        = [[self randomBlob] copy];
+    NSString *first     = [self.binaryMember stringValueFromTransformable:blob];
+    NSString *second    = [self.binaryMember stringValueFromTransformable:blob];
+    
+    XCTAssertTrue(first == second, @"The encoded form should have been cached");
+}
+
+- (void)testDecodedValueIsCachedForTheSameEncoding {
+    NSData *blob            = [self randomBlob];
+    NSDictionary *ghost     = @{ @"blob" : [self.binaryMember stringValueFromTransformable:[blob copy]] };
+    
+    id first                = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    id second               = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    
+    XCTAssertEqualObjects(first, blob, @"Error decoding binary member");
+    XCTAssertEqualObjects(second, blob, @"Error decoding binary member");
+    XCTAssertTrue(first != second, @"Cached values should never be shared");
+    
+    // Cache Hit: the copy should carry the original encoding along
+    XCTAssertTrue([self.binaryMember stringValueFromTransformable:second] == ghost[@"blob"], @"The decoded value should have been cached");
+}
+
+- (void)testBridgedValuesAreCached {
+    NSData *blob            = [self randomBlob];
+    NSData *bridgedBlob     = (__bridge_transfer NSData *)CFDataCreate(kCFAllocatorDefault, blob.bytes, blob.length);
+    NSString *first         = [self.binaryMember stringValueFromTransformable:bridgedBlob];
+    NSString *second        = [self.binaryMember stringValueFromTransformable:bridgedBlob];
+    
+    XCTAssertTrue(first == second, @"Immutable bridged values should be cached");
+    
+    NSString *text          = [@"" stringByPaddingToLength:SPMemberBase64TestsBlobLength withString:@"simperium" startingAtIndex:0];
+    NSString *bridgedText   = (__bridge_transfer NSString *)CFStringCreateCopy(kCFAllocatorDefault, (__bridge CFStringRef)text);
+    
+    XCTAssertTrue([self.binaryMember stringValueFromTransformable:bridgedText] == [self.binaryMember stringValueFromTransformable:bridgedText], @"Immutable bridged values should be cached");
+}
+
+- (void)testMutableBlobsEditedInPlaceProduceReplacement {
+    NSMutableData *blob     = [self randomBlob];
+    NSDictionary *ghost     = @{ @"blob" : [self.binaryMember stringValueFromTransformable:blob] };
+    
+    // Encoded right before being edited: the digest must not outlive the edit
+    ((uint8_t *)blob.mutableBytes)[0] ^= 0xFF;
+    
+    id ghostValue           = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    NSDictionary *diff      = [self.binaryMember diff:ghostValue otherValue:blob];
+    
+    XCTAssertEqualObjects(diff[@"o"], @"r", @"Blobs edited in place should be replaced");
+    
+    // Decoded from the ghost: the object must not share its instance with the ghost
+    NSMutableData *objectValue = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    XCTAssertTrue([objectValue isKindOfClass:[NSMutableData class]], @"Inconsistency detected");
+    
+    ((uint8_t *)objectValue.mutableBytes)[1] ^= 0xFF;
+    
+    ghostValue              = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    diff                    = [self.binaryMember diff:ghostValue otherValue:objectValue];
+    
+    XCTAssertTrue(ghostValue != objectValue, @"Mutable values should never be shared");
+    XCTAssertEqualObjects(diff[@"o"], @"r", @"Blobs edited in place should be replaced");
+}
+
+- (void)testUnchangedBlobsProduceEmptyDiff {
+    NSData *blob            = [self randomBlob];
+    NSDictionary *ghost     = @{ @"blob" : [self.binaryMember stringValueFromTransformable:blob] };
+    id ghostValue           = [self.binaryMember getValueFromDictionary:ghost key:@"blob" object:nil];
+    
+    XCTAssertEqualObjects([self.binaryMember diff:ghostValue otherValue:blob], @{ }, @"Unchanged blobs should produce an empty diff");
+}
+
+- (void)testChangedBlobsProduceReplacement {
+    NSData *blob            = [self randomBlob];
+    NSMutableData *edited   = [blob mutableCopy];
+    ((uint8_t *)edited.mutableBytes)[0] ^= 0xFF;
+    
+    // Warm up the caches
+    [self.binaryMember stringValueFromTransformable:blob];
+    [self.binaryMember stringValueFromTransformable:edited];
+    
+    NSDictionary *diff      = [self.binaryMember diff:blob otherValue:edited];
+    
+    XCTAssertEqualObjects(diff[@"o"], @"r", @"Changed blobs should be replaced");
+    XCTAssertEqualObjects(diff[@"v"], [self.binaryMember stringValueFromTransformable:edited], @"Error encoding replacement");
+}
+
+- (void)testBinaryDeltaIsDisabledByDefault {
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    NSMutableData *edited   = [blob mutableCopy];
+    ((uint8_t *)edited.mutableBytes)[edited.length / 2] ^= 0xFF;
+    
+    NSDictionary *diff      = [self.binaryMember diff:blob otherValue:edited];
+    
+    XCTAssertEqualObjects(diff[@"o"], @"r", @"Binary deltas should be opt-in");
+}
+
+- (void)testBinaryDeltaForSmallEditOnLargeBlob {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength];
+    NSDictionary *ghost     = @{ @"blob" : [member stringValueFromTransformable:blob] };
+    id ghostValue           = [member getValueFromDictionary:ghost key:@"blob" object:nil];
+    
+    // Overwrite 1% of the blob
+    NSMutableData *edited   = [blob mutableCopy];
+    NSRange editRange       = NSMakeRange(edited.length / 3, edited.length / 100);
+    arc4random_buf((uint8_t *)edited.mutableBytes + editRange.location, editRange.length);
+    
+    NSDictionary *diff      = [member diff:ghostValue otherValue:edited];
+    NSUInteger deltaBytes   = [diff[@"v"] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger fullBytes    = [[member stringValueFromTransformable:edited] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    
+    NSLog(@"<> Binary Delta: %lu bytes sent for a 1%% edit, versus %lu bytes for a full replacement", (unsigned long)deltaBytes, (unsigned long)fullBytes);
+    
+    XCTAssertEqualObjects(diff[@"o"], @"dB", @"Small edits on large blobs should produce a delta");
+    XCTAssertTrue(deltaBytes < fullBytes / 20, @"The delta should be a fraction of the full replacement");
+    
+    // Apply it, just like an incoming change would
+    NSError *error          = nil;
+    id otherValue           = [member getValueFromDictionary:diff key:@"v" object:nil];
+    id output               = [member applyDiff:ghostValue otherValue:otherValue error:&error];
+    
+    XCTAssertNil(error, @"Error applying binary delta");
+    XCTAssertEqualObjects(output, edited, @"Error applying binary delta");
+}
+
+- (void)testBinaryDeltaForInsertionOnLargeBlob {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    NSMutableData *edited   = [blob mutableCopy];
+    
+    // 7 bytes: not a multiple of 3, so the base64 text shifts right after the insertion
+    [edited replaceBytesInRange:NSMakeRange(edited.length / 2, 0) withBytes:"simperi" length:7];
+    
+    NSDictionary *diff      = [member diff:blob otherValue:edited];
+    NSUInteger deltaBytes   = [diff[@"v"] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger fullBytes    = [[member stringValueFromTransformable:edited] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    
+    XCTAssertEqualObjects(diff[@"o"], @"dB", @"Insertions on large blobs should produce a delta");
+    XCTAssertTrue(deltaBytes < fullBytes / 10, @"Content after the insertion should still be matched");
+    
+    NSError *error          = nil;
+    id otherValue           = [member getValueFromDictionary:diff key:@"v" object:nil];
+    id output               = [member applyDiff:blob otherValue:otherValue error:&error];
+    
+    XCTAssertNil(error, @"Error applying binary delta");
+    XCTAssertEqualObjects(output, edited, @"Shifted content should still produce a valid diff");
+}
+
+- (void)testChunkSignaturesAreKeptInGhostMetadata {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    SPGhost *ghost          = [[SPGhost alloc] initWithKey:@"key" memberData:@{ @"blob" : [member stringValueFromTransformable:blob] }];
+    id ghostValue           = [member getValueFromDictionary:ghost.memberData key:@"blob" object:nil];
+    
+    NSMutableData *edited   = [blob mutableCopy];
+    ((uint8_t *)edited.mutableBytes)[edited.length / 2] ^= 0xFF;
+    
+    NSDictionary *diff      = [member diff:ghostValue otherValue:edited ghost:ghost];
+    NSDictionary *metadata  = ghost.metadata[@"blob"];
+    
+    XCTAssertEqualObjects(diff[@"o"], @"dB", @"Small edits on large blobs should produce a delta");
+    XCTAssertNotNil(metadata, @"Chunk signatures should be kept in the ghost's metadata");
+    
+    // Signatures should survive the Ghost Store, and produce the very same delta
+    SPGhost *storedGhost    = [SPGhostStore ghostWithData:[SPGhostStore dataWithGhost:ghost] key:@"key"];
+    NSDictionary *newDiff   = [member diff:ghostValue otherValue:edited ghost:storedGhost];
+    
+    XCTAssertEqualObjects(storedGhost.metadata, ghost.metadata, @"Ghost metadata should be persisted");
+    XCTAssertEqualObjects(newDiff, diff, @"Persisted signatures should produce the same delta");
+}
+
+- (void)testBinaryDeltaIsAppliedOverTheEncodedGhostValue {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    NSString *ghostString   = [member stringValueFromTransformable:blob];
+    
+    NSMutableData *edited   = [blob mutableCopy];
+    ((uint8_t *)edited.mutableBytes)[edited.length / 2] ^= 0xFF;
+    
+    NSDictionary *diff      = [member diff:blob otherValue:edited];
+    id otherValue           = [member getValueFromDictionary:diff key:@"v" object:nil];
+    
+    // The local value is of no use: the delta should be applied over the ghost's string
+    NSError *error          = nil;
+    id output               = [member applyDiff:[self randomBlob] otherValue:otherValue encodedValue:ghostString error:&error];
+    
+    XCTAssertNil(error, @"Error applying binary delta");
+    XCTAssertEqualObjects(output, edited, @"Error applying binary delta");
+}
+
+- (void)testMalformedBinaryDeltaIsRejected {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    NSString *ghostString   = [member stringValueFromTransformable:blob];
+    NSArray *deltas         = @[
+        [NSString stringWithFormat:@"=%lu\t+!!!!", (unsigned long)blob.length],
+        [NSString stringWithFormat:@"=%lu", (unsigned long)blob.length + 1],
+        [NSString stringWithFormat:@"=%lu", (unsigned long)blob.length - 1],
+        @"x1"
+    ];
+    
+    for (NSString *delta in deltas) {
+        id otherValue       = [member getValueFromDictionary:@{ @"o" : @"dB", @"v" : delta } key:@"v" object:nil];
+        NSError *error      = nil;
+        id output           = [member applyDiff:blob otherValue:otherValue encodedValue:ghostString error:&error];
+        
+        XCTAssertNil(output, @"Malformed deltas should never be applied");
+        XCTAssertNotNil(error, @"Malformed deltas should be reported");
+    }
+}
+
+- (void)testTransformingAnInvalidBinaryDeltaFails {
+    SPMemberBase64 *member  = [self binaryDeltaMember];
+    NSData *blob            = [self randomBlobWithLength:SPMemberBase64TestsLargeBlobLength / 10];
+    id localDelta           = [member getValueFromDictionary:@{ @"o" : @"dB", @"v" : @"=1" } key:@"v" object:nil];
+    
+    NSError *error          = nil;
+    NSDictionary *change    = [member transform:localDelta otherValue:nil oldValue:blob error:&error];
+    
+    XCTAssertNil(change, @"Failed transforms should not produce a change");
+    XCTAssertNotNil(error, @"Failed transforms should be reported");
+}
+
+@end
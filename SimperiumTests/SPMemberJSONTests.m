@@ -11,6 +11,37 @@
 
 
 
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPMemberJSONTestsTransformerName = @"SPMemberJSONTestsTransformer";
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberJSONTestsTransformer
+#pragma mark ====================================================================================
+
+@interface SPMemberJSONTestsTransformer : NSValueTransformer
+@end
+
+@implementation SPMemberJSONTestsTransformer
+
++ (BOOL)allowsReverseTransformation {
+	return YES;
+}
+
+- (id)transformedValue:(id)value {
+	return [NSJSONSerialization dataWithJSONObject:value options:0 error:nil];
+}
+
+- (id)reverseTransformedValue:(id)value {
+	return [NSJSONSerialization JSONObjectWithData:value options:0 error:nil];
+}
+
+@end
+
+
 #pragma mark ====================================================================================
 #pragma mark SPMemberJSONTests
 #pragma mark ====================================================================================
@@ -144,4 +175,167 @@
     XCTAssertNil(error, @"Error applying diff");
 }
 
+- (void)testDiffEmitsNestedObjectOperations {
+	NSDictionary *local		= @{
+								@"flags"	:	@{
+													@"pinned"	: @(NO),
+													@"markdown"	: @(YES)
+												},
+								@"title"	:	@"Settings",
+								@"legacy"	:	@"remove-me"
+								};
+	
+	NSDictionary *remote	= @{
+								@"flags"	:	@{
+													@"pinned"	: @(YES),
+													@"markdown"	: @(YES)
+												},
+								@"title"	:	@"Settings",
+								@"added"	:	@(42)
+								};
+	
+	NSDictionary *expected	= @{
+								@"o" : @"O",
+								@"v" : @{
+											@"flags"	: @{
+																@"o" : @"O",
+																@"v" : @{
+																			@"pinned" : @{ @"o" : @"r", @"v" : @(YES) }
+																		}
+															},
+											@"legacy"	: @{ @"o" : @"-" },
+											@"added"	: @{ @"o" : @"+", @"v" : @(42) }
+										}
+								};
+	
+	NSDictionary *diff = [self.jsonMember diff:local otherValue:remote];
+	XCTAssertEqualObjects(diff, expected, @"Error building nested Object Diff");
+	
+	NSError *error = nil;
+	NSDictionary *output = [self.jsonMember applyDiff:local otherValue:diff[@"v"] error:&error];
+	
+	XCTAssertEqualObjects(output, remote, @"Error applying nested Object Diff");
+	XCTAssertNil(error, @"Error applying diff");
+}
+
+- (void)testDiffOfEqualDictionariesIsEmpty {
+	NSDictionary *local		= @{ @"body" : @{ @"something" : @(31337) } };
+	NSDictionary *remote	= @{ @"body" : @{ @"something" : @(31337) } };
+	
+	XCTAssertEqualObjects([self.jsonMember diff:local otherValue:remote], @{ }, @"Equal dictionaries should produce an empty diff");
+	XCTAssertEqualObjects([self.jsonMember diff:local otherValue:local], @{ }, @"Identical dictionaries should produce an empty diff");
+}
+
+- (void)testDiffFallsBackToReplaceWhenTooDeep {
+	NSMutableDictionary *local	= [NSMutableDictionary dictionaryWithObject:@"a" forKey:@"leaf"];
+	NSMutableDictionary *remote	= [NSMutableDictionary dictionaryWithObject:@"b" forKey:@"leaf"];
+	
+	for (NSInteger i = 0; i < 64; ++i) {
+		local	= [NSMutableDictionary dictionaryWithObject:local forKey:@"nested"];
+		remote	= [NSMutableDictionary dictionaryWithObject:remote forKey:@"nested"];
+	}
+	
+	NSDictionary *diff = [self.jsonMember diff:local otherValue:remote];
+	
+	XCTAssertEqualObjects(diff[@"o"], @"O", @"The outer levels should still be diffed structurally");
+	
+	NSError *error = nil;
+	NSDictionary *output = [self.jsonMember applyDiff:local otherValue:diff[@"v"] error:&error];
+	
+	XCTAssertEqualObjects(output, remote, @"Error applying deep Object Diff");
+	XCTAssertNil(error, @"Error applying diff");
+}
+
+- (void)testConcurrentObjectEditsAreTransformed {
+	NSDictionary *ghost		= @{
+								@"title"	:	@"Settings",
+								@"flags"	:	@{
+													@"pinned"	: @(NO),
+													@"markdown"	: @(YES)
+												},
+								@"legacy"	:	@"remove-me"
+								};
+	
+	NSDictionary *local		= @{
+								@"title"	:	@"Local",
+								@"flags"	:	@{
+													@"pinned"	: @(YES),
+													@"markdown"	: @(YES)
+												}
+								};
+	
+	NSDictionary *remote	= @{
+								@"title"	:	@"Remote",
+								@"flags"	:	@{
+													@"pinned"	: @(NO),
+													@"markdown"	: @(NO)
+												},
+								@"added"	:	@(42)
+								};
+	
+	// Both edits land, and the local title wins
+	NSDictionary *expected	= @{
+								@"title"	:	@"Local",
+								@"flags"	:	@{
+													@"pinned"	: @(YES),
+													@"markdown"	: @(NO)
+												},
+								@"added"	:	@(42)
+								};
+	
+	NSDictionary *localDiff		= [self.jsonMember diff:ghost otherValue:local];
+	NSDictionary *remoteDiff	= [self.jsonMember diff:ghost otherValue:remote];
+	
+	NSError *error = nil;
+	NSDictionary *transformed	= [self.jsonMember transformChange:localDiff otherChange:remoteDiff oldValue:ghost object:nil error:&error];
+	
+	XCTAssertNil(error, @"Error transforming diff");
+	XCTAssertEqualObjects(transformed[@"o"], @"O", @"Concurrent Object Diffs should remain structural");
+	XCTAssertNil(transformed[@"v"][@"legacy"], @"Removals performed by both sides should be dropped");
+	
+	NSDictionary *rebased	= [self.jsonMember applyDiff:ghost otherValue:remoteDiff[@"v"] error:&error];
+	NSDictionary *output	= [self.jsonMember applyDiff:rebased otherValue:transformed[@"v"] error:&error];
+	
+	XCTAssertEqualObjects(output, expected, @"Error applying transformed Object Diff");
+	XCTAssertNil(error, @"Error applying diff");
+}
+
+- (void)testValueTransformerIsUsedForDictionaries {
+	[NSValueTransformer setValueTransformer:[SPMemberJSONTestsTransformer new] forName:SPMemberJSONTestsTransformerName];
+	
+	SPMemberJSON *member	= [[SPMemberJSON alloc] initFromDictionary:@{
+																		@"name"					: @"settings",
+																		@"valueTransformerName"	: SPMemberJSONTestsTransformerName
+																		}];
+	NSDictionary *value		= @{ @"flags" : @{ @"pinned" : @(YES) } };
+	NSDictionary *other		= @{ @"flags" : @{ @"pinned" : @(NO) } };
+	
+	NSMutableDictionary *memberData = [NSMutableDictionary dictionary];
+	[member setValue:value forKey:@"settings" inDictionary:memberData];
+	
+	XCTAssertTrue([memberData[@"settings"] isKindOfClass:[NSString class]], @"Values should go through the Value Transformer");
+	XCTAssertEqualObjects([member getValueFromDictionary:memberData key:@"settings" object:nil], value, @"Error reversing the Value Transformer");
+	
+	NSDictionary *diff = [member diff:value otherValue:other];
+	
+	XCTAssertEqualObjects(diff[@"o"], @"r", @"Transformed values should be sent as replacements");
+	XCTAssertEqualObjects([member getValueFromDictionary:diff key:@"v" object:nil], other, @"Error reversing the Value Transformer");
+}
+
+- (void)testDiffFallsBackToReplaceWhenTooLarge {
+	NSMutableDictionary *local	= [NSMutableDictionary dictionary];
+	NSMutableDictionary *remote	= [NSMutableDictionary dictionary];
+	
+	for (NSInteger i = 0; i < 1000; ++i) {
+		NSString *key	= [NSString stringWithFormat:@"key-%ld", (long)i];
+		local[key]		= @(i);
+		remote[key]		= @(i + 1);
+	}
+	
+	NSDictionary *diff = [self.jsonMember diff:local otherValue:remote];
+	
+	XCTAssertEqualObjects(diff[@"o"], @"r", @"Large diffs should be sent as replacements");
+	XCTAssertEqualObjects(diff[@"v"], remote, @"JSON Dictionaries should be replaced natively");
+}
+
 @end
@@ -0,0 +1,85 @@
+//
+//  SPMemberTextBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "SPMemberText.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSUInteger const SPMemberTextBenchmarksEdits             = 8;
+static NSUInteger const SPMemberTextBenchmarksBytesPerRun       = 512 * 1024;
+static NSUInteger const SPMemberTextBenchmarksMinOperations     = 4;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberTextBenchmarks
+#pragma mark ====================================================================================
+
+@interface SPMemberTextBenchmarks : SPBenchmarkTestCase
+@property (nonatomic, strong) SPMemberText *member;
+@end
+
+@implementation SPMemberTextBenchmarks
+
+- (void)setUp {
+    [super setUp];
+    self.member = [[SPMemberText alloc] initFromDictionary:@{ @"name" : @"content", @"type" : @"text" }];
+}
+
+- (void)testSmallText {
+    [self benchmarkTextOfLength:256];
+}
+
+- (void)testMediumText {
+    [self benchmarkTextOfLength:4 * 1024];
+}
+
+- (void)testLargeText {
+    [self benchmarkTextOfLength:64 * 1024];
+}
+
+
+#pragma mark - Helpers
+
+// Both the local and remote edits are applied over the same base: that's the rebase scenario
+- (void)benchmarkTextOfLength:(NSUInteger)length {
+    SPMemberText *member    = self.member;
+    NSString *base          = [self randomTextOfLength:length];
+    NSString *localText     = [self text:base withRandomEdits:SPMemberTextBenchmarksEdits];
+    NSString *remoteText    = [self text:base withRandomEdits:SPMemberTextBenchmarksEdits];
+    
+    NSString *localDelta    = [member diff:base otherValue:localText][OP_VALUE];
+    NSString *remoteDelta   = [member diff:base otherValue:remoteText][OP_VALUE];
+    NSUInteger operations   = MAX(SPMemberTextBenchmarksBytesPerRun / length, SPMemberTextBenchmarksMinOperations);
+    
+    XCTAssertEqualObjects([member applyDiff:base otherValue:localDelta error:nil], localText, @"Inconsistency detected");
+    
+    [self benchmark:[NSString stringWithFormat:@"text.%lu.diff", (unsigned long)length] operations:operations block:^{
+        for (NSUInteger i = 0; i < operations; ++i) {
+            [member diff:base otherValue:localText];
+        }
+    }];
+    
+    [self benchmark:[NSString stringWithFormat:@"text.%lu.apply", (unsigned long)length] operations:operations block:^{
+        for (NSUInteger i = 0; i < operations; ++i) {
+            [member applyDiff:base otherValue:localDelta error:nil];
+        }
+    }];
+    
+    [self benchmark:[NSString stringWithFormat:@"text.%lu.transform", (unsigned long)length] operations:operations block:^{
+        for (NSUInteger i = 0; i < operations; ++i) {
+            [member transform:localDelta otherValue:remoteDelta oldValue:base error:nil];
+        }
+    }];
+}
+
+@end
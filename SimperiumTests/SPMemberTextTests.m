@@ -0,0 +1,143 @@
+//
+//  SPMemberTextTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPMemberText.h"
+#import "SPMemberList.h"
+#import "DiffMatchPatch.h"
+#import "DiffMatchPatch+Simperium.h"
+#import "SPDiffBudget.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSInteger const SPMemberTextTestsThreadCount     = 8;
+static NSInteger const SPMemberTextTestsIterations      = 200;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMemberTextTests
+#pragma mark ====================================================================================
+
+@interface SPMemberTextTests : XCTestCase
+@property (nonatomic, strong) SPMemberText *textMember;
+@property (nonatomic, strong) SPMemberList *listMember;
+@end
+
+@implementation SPMemberTextTests
+
+- (void)setUp {
+    self.textMember = [[SPMemberText alloc] initFromDictionary:@{ @"name" : @"content", @"type" : @"text" }];
+    self.listMember = [[SPMemberList alloc] initFromDictionary:@{ @"name" : @"tags", @"type" : @"list" }];
+}
+
+- (void)testThreadLocalInstanceIsStablePerThread {
+    DiffMatchPatch *mainInstance            = [DiffMatchPatch sp_threadLocalInstance];
+    __block DiffMatchPatch *otherInstance   = nil;
+    
+    XCTAssertTrue(mainInstance == [DiffMatchPatch sp_threadLocalInstance], @"The same thread should get the same instance");
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Thread Expectation"];
+    NSThread *thread = [[NSThread alloc] initWithBlock:^{
+        otherInstance = [DiffMatchPatch sp_threadLocalInstance];
+        [expectation fulfill];
+    }];
+    
+    [thread start];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    XCTAssertNotNil(otherInstance, @"Missing instance");
+    XCTAssertFalse(mainInstance == otherInstance, @"Threads should not share DiffMatchPatch instances");
+}
+
+- (void)testDiffingFromMultipleThreadsConcurrently {
+    dispatch_queue_t queue      = dispatch_queue_create("com.simperium.SPMemberTextTests", DISPATCH_QUEUE_CONCURRENT);
+    NSMutableArray *failures    = [NSMutableArray array];
+    
+    dispatch_apply(SPMemberTextTestsThreadCount, queue, ^(size_t thread) {
+        for (NSInteger i = 0; i < SPMemberTextTestsIterations; ++i) {
+            NSString *base      = [NSString stringWithFormat:@"Thread %zu, iteration %ld: the quick brown fox jumps over the lazy dog", thread, (long)i];
+            NSString *edited    = [base stringByReplacingOccurrencesOfString:@"lazy" withString:[NSString stringWithFormat:@"sleepy #%ld", (long)i]];
+            
+            NSDictionary *diff  = [self.textMember diff:base otherValue:edited];
+            NSString *output    = [self.textMember applyDiff:base otherValue:diff[@"v"] error:nil];
+            
+            NSArray *tags       = @[ @(thread), @(i), @"fox" ];
+            NSArray *newTags    = @[ @(thread), @"dog", @(i) ];
+            
+            NSDictionary *listDiff  = [self.listMember diff:tags otherValue:newTags];
+            NSArray *listOutput     = [self.listMember applyDiff:tags otherValue:listDiff[@"v"] error:nil];
+            
+            if (![output isEqualToString:edited] || ![listOutput isEqualToArray:newTags]) {
+                @synchronized(failures) {
+                    [failures addObject:@(thread)];
+                }
+            }
+        }
+    });
+    
+    XCTAssertEqual(failures.count, 0, @"Concurrent diffs shouldn't interfere with each other");
+}
+
+- (void)testLargeDocumentsEscalateWithinBudget {
+    NSMutableString *base   = [NSMutableString string];
+    NSMutableString *edited = [NSMutableString string];
+    
+    for (NSInteger i = 0; i < 20000; ++i) {
+        [base appendFormat:@"Line %ld: the quick brown fox jumps over the lazy dog\n", (long)i];
+        [edited appendFormat:(i % 7 == 0) ? @"Line %ld: the sleepy dog ignores the fox\n" : @"Line %ld: the quick brown fox jumps over the lazy dog\n", (long)i];
+    }
+    
+    SPMemberText *member    = [[SPMemberText alloc] initFromDictionary:@{ @"name" : @"content", @"type" : @"text", @"diffBudget" : @(0.05) }];
+    SPDiffBudget *budget    = [SPDiffBudget budgetWithTimeInterval:10];
+    __block NSDictionary *diff = nil;
+    
+    [budget performBlock:^{
+        diff = [member diff:base otherValue:edited];
+    }];
+    
+    NSString *output = [member applyDiff:base otherValue:diff[@"v"] error:nil];
+    
+    XCTAssertEqualObjects(output, edited, @"Escalated diffs should still roundtrip");
+    XCTAssertEqual(budget.escalationCount, 1, @"The diff should have been escalated");
+    XCTAssertNil([SPDiffBudget currentBudget], @"The budget should only be current within its block");
+}
+
+- (void)testExhaustedBatchStillGrantsMinimumMemberBudget {
+    SPDiffBudget *budget = [SPDiffBudget budgetWithTimeInterval:0];
+    __block NSTimeInterval memberBudget = 0;
+    __block NSTimeInterval smallBudget  = 0;
+    
+    [budget performBlock:^{
+        memberBudget    = [SPDiffBudget timeIntervalForMemberBudget:1];
+        smallBudget     = [SPDiffBudget timeIntervalForMemberBudget:0.001];
+    }];
+    
+    XCTAssertEqual(memberBudget, SPDiffBudgetMinimumMemberTimeInterval, @"Members should get the minimum budget");
+    XCTAssertEqual(smallBudget, 0.001, @"The floor shouldn't exceed the member's own budget");
+    XCTAssertEqual([SPDiffBudget timeIntervalForMemberBudget:1], 1, @"Outside a batch, the member budget applies");
+}
+
+- (void)testLineGranularityKeepsLinesWhole {
+    DiffMatchPatch *dmp                     = [DiffMatchPatch sp_threadLocalInstance];
+    DiffMatchPatchGranularity granularity   = DiffMatchPatchGranularityCharacters;
+    
+    NSMutableArray *diffs = [dmp sp_diffsFromText:@"alpha\nbravo\ncharlie"
+                                           toText:@"alpha\nbrave\ncharlie"
+                                      granularity:DiffMatchPatchGranularityLines
+                                           budget:1
+                                  usedGranularity:&granularity];
+    
+    XCTAssertEqual(granularity, DiffMatchPatchGranularityLines, @"Lines shouldn't get any finer");
+    XCTAssertEqualObjects([dmp diff_toDelta:diffs], @"=6\t-6\t+brave%0A\t=7", @"Unexpected line diff");
+}
+
+@end
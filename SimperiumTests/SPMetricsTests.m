@@ -0,0 +1,126 @@
+//
+//  SPMetricsTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPMetrics.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSInteger const SPMetricsTestsSamples            = 10000;
+static NSInteger const SPMetricsTestsThreads            = 4;
+static NSInteger const SPMetricsTestsIterations         = 100000;
+static double const SPMetricsTestsPrecision             = 1.0 / 16.0;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPMetricsTests
+#pragma mark ====================================================================================
+
+@interface SPMetricsTests : XCTestCase
+
+@end
+
+@implementation SPMetricsTests
+
+- (void)testHistogramPercentilesAreWithinPrecision {
+    SPMetricsHistogram *histogram = [SPMetricsHistogram new];
+    
+    // 1ms ... 10s
+    for (NSInteger i = 1; i <= SPMetricsTestsSamples; ++i) {
+        [histogram recordMicroseconds:i * 1000];
+    }
+    
+    XCTAssertTrue(histogram.count == SPMetricsTestsSamples, @"Inconsistency detected");
+    
+    for (NSNumber *percentile in @[ @50, @90, @99, @99.9, @100 ]) {
+        NSTimeInterval expected = ceil(percentile.doubleValue / 100.0 * SPMetricsTestsSamples) / 1000.0;
+        NSTimeInterval value    = [histogram valueAtPercentile:percentile.doubleValue];
+    
+        XCTAssertTrue(value >= expected, @"Percentile %@ below the recorded value", percentile);
+        XCTAssertTrue(value <= expected * (1 + SPMetricsTestsPrecision), @"Percentile %@ out of precision", percentile);
+    }
+}
+
+- (void)testHistogramRecordsSmallValuesExactly {
+    SPMetricsHistogram *histogram = [SPMetricsHistogram new];
+    
+    for (uint64_t i = 0; i < 32; ++i) {
+        [histogram recordMicroseconds:i];
+    }
+    
+    XCTAssertEqual([histogram valueAtPercentile:50], 15 / 1e6, @"Inconsistency detected");
+    XCTAssertEqual([histogram valueAtPercentile:100], 31 / 1e6, @"Inconsistency detected");
+}
+
+- (void)testEmptyHistogramSnapshot {
+    SPMetricsHistogram *histogram = [SPMetricsHistogram new];
+    
+    XCTAssertEqualObjects([histogram snapshot], @{ @"count" : @0 }, @"Inconsistency detected");
+    XCTAssertTrue([histogram valueAtPercentile:99] == 0, @"Inconsistency detected");
+}
+
+- (void)testRegistryReturnsTheSameMetricForTheSameName {
+    SPMetrics *metrics = [SPMetrics new];
+    
+    XCTAssertTrue([metrics counterNamed:SPMetricsChangesSent] == [metrics counterNamed:SPMetricsChangesSent], @"Inconsistency detected");
+    XCTAssertTrue([metrics gaugeNamed:SPMetricsPendingChanges] == [metrics gaugeNamed:SPMetricsPendingChanges], @"Inconsistency detected");
+    XCTAssertTrue([metrics histogramNamed:SPMetricsIndexTime] == [metrics histogramNamed:SPMetricsIndexTime], @"Inconsistency detected");
+    XCTAssertTrue([metrics counterNamed:SPMetricsChangesSent] != [metrics counterNamed:SPMetricsChangesAcknowledged], @"Inconsistency detected");
+}
+
+- (void)testSnapshotContainsEveryMetric {
+    SPMetrics *metrics = [SPMetrics new];
+    
+    [[metrics counterNamed:SPMetricsChangesSent] add:3];
+    [[metrics counterNamed:SPMetricsChangesAcknowledged] increment];
+    [metrics gaugeNamed:SPMetricsPendingChanges].value = 7;
+    [[metrics histogramNamed:SPMetricsChangeAckLatency] recordTimeInterval:0.002];
+    
+    NSDictionary *snapshot  = [metrics snapshot];
+    NSDictionary *latency   = snapshot[SPMetricsSnapshotHistograms][SPMetricsChangeAckLatency];
+    
+    XCTAssertEqualObjects(snapshot[SPMetricsSnapshotCounters][SPMetricsChangesSent], @3, @"Inconsistency detected");
+    XCTAssertEqualObjects(snapshot[SPMetricsSnapshotCounters][SPMetricsChangesAcknowledged], @1, @"Inconsistency detected");
+    XCTAssertEqualObjects(snapshot[SPMetricsSnapshotGauges][SPMetricsPendingChanges], @7, @"Inconsistency detected");
+    XCTAssertEqualObjects(latency[@"count"], @1, @"Inconsistency detected");
+    XCTAssertEqualWithAccuracy([latency[@"max"] doubleValue], 2.0, 0.01, @"Inconsistency detected");
+    XCTAssertTrue([NSPropertyListSerialization propertyList:snapshot isValidForFormat:NSPropertyListBinaryFormat_v1_0], @"Snapshot should be exportable");
+}
+
+- (void)testConcurrentRecordingDoesNotLoseSamples {
+    SPMetrics *metrics              = [SPMetrics new];
+    SPMetricsCounter *counter       = [metrics counterNamed:SPMetricsChangesSent];
+    SPMetricsHistogram *histogram   = [metrics histogramNamed:SPMetricsRemoteChangeApplyTime];
+    
+    dispatch_apply(SPMetricsTestsThreads, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        for (NSInteger i = 0; i < SPMetricsTestsIterations; ++i) {
+            [counter increment];
+            [histogram recordMicroseconds:i];
+        }
+    });
+    
+    XCTAssertTrue(counter.value == SPMetricsTestsThreads * SPMetricsTestsIterations, @"Inconsistency detected");
+    XCTAssertTrue(histogram.count == SPMetricsTestsThreads * SPMetricsTestsIterations, @"Inconsistency detected");
+}
+
+- (void)testRecordingPerformance {
+    SPMetricsHistogram *histogram = [SPMetricsHistogram new];
+    
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < SPMetricsTestsIterations; ++i) {
+            CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+            [histogram recordTimeIntervalSinceTime:start];
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,108 @@
+//
+//  SPPersistenceBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "SPPersistentMutableDictionary.h"
+#import "SPPersistentMutableSet.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPPersistenceBenchmarksLabel        = @"SPPersistenceBenchmarks";
+static NSUInteger const SPPersistenceBenchmarksWrites       = 100;
+static NSUInteger const SPPersistenceBenchmarksSaves        = 10;
+static NSUInteger const SPPersistenceBenchmarksSmallSet     = 1000;
+static NSUInteger const SPPersistenceBenchmarksLargeSet     = 20000;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPPersistenceBenchmarks
+#pragma mark ====================================================================================
+
+@interface SPPersistenceBenchmarks : SPBenchmarkTestCase
+
+@end
+
+@implementation SPPersistenceBenchmarks
+
+// Mimics the Change Processor: a batch of pending changes gets upserted, and then saved
+- (void)testDictionarySave {
+    NSString *label                         = [SPPersistenceBenchmarksLabel stringByAppendingString:NSStringFromSelector(_cmd)];
+    SPPersistentMutableDictionary *storage  = [SPPersistentMutableDictionary loadDictionaryWithLabel:label];
+    NSMutableArray *keys                    = [NSMutableArray arrayWithCapacity:SPPersistenceBenchmarksWrites];
+    NSMutableArray *changes                 = [NSMutableArray arrayWithCapacity:SPPersistenceBenchmarksWrites];
+    
+    for (NSUInteger i = 0; i < SPPersistenceBenchmarksWrites; ++i) {
+        [keys addObject:[self randomStringOfLength:24]];
+        [changes addObject:@{
+            @"id"   : keys.lastObject,
+            @"o"    : @"M",
+            @"v"    : @{ @"content" : @{ @"o" : @"d", @"v" : [self randomTextOfLength:256] } },
+            @"ccid" : [self randomStringOfLength:24],
+            @"sv"   : @([self randomNumberBelow:1000])
+        }];
+    }
+    
+    [self benchmark:@"persistence.dictionary.save" operations:SPPersistenceBenchmarksWrites block:^{
+        for (NSUInteger i = 0; i < SPPersistenceBenchmarksWrites; ++i) {
+            [storage setObject:changes[i] forKey:keys[i]];
+        }
+        [storage save];
+    }];
+    
+    XCTAssertTrue(storage.count == SPPersistenceBenchmarksWrites, @"Inconsistency detected");
+    
+    [storage removeAllObjects];
+    [storage save];
+}
+
+- (void)testSmallSetSave {
+    [self benchmarkSetSaveWithCount:SPPersistenceBenchmarksSmallSet];
+}
+
+- (void)testLargeSetSave {
+    [self benchmarkSetSaveWithCount:SPPersistenceBenchmarksLargeSet];
+}
+
+
+#pragma mark - Helpers
+
+// Sets get rewritten as a whole: the cost depends on the set size, rather than on the number of dirty entries
+- (void)benchmarkSetSaveWithCount:(NSUInteger)count {
+    NSString *label                 = [NSString stringWithFormat:@"%@%lu", SPPersistenceBenchmarksLabel, (unsigned long)count];
+    SPPersistentMutableSet *set     = [SPPersistentMutableSet loadSetWithLabel:label];
+    NSMutableArray *keys            = [NSMutableArray arrayWithCapacity:count];
+    
+    for (NSUInteger i = 0; i < count; ++i) {
+        [keys addObject:[self randomStringOfLength:24]];
+    }
+    
+    [set removeAllObjects];
+    [set addObjectsFromArray:keys];
+    
+    NSString *name = [NSString stringWithFormat:@"persistence.set.%lu.save", (unsigned long)count];
+    
+    [self benchmark:name operations:SPPersistenceBenchmarksSaves block:^{
+        for (NSUInteger i = 0; i < SPPersistenceBenchmarksSaves; ++i) {
+            // Dirty the set: unchanged sets don't hit the disk
+            [set removeObject:keys[i]];
+            [set addObject:keys[i]];
+            [set saveAndWait:YES];
+        }
+    }];
+    
+    XCTAssertTrue(set.count == count, @"Inconsistency detected");
+    
+    [set removeAllObjects];
+    [set saveAndWait:YES];
+}
+
+@end
@@ -0,0 +1,191 @@
+//
+//  SPProcessorBenchmarks.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SPBenchmarkTestCase.h"
+#import "MockStorage.h"
+#import "SPBucket+Internals.h"
+#import "SPChangeProcessor.h"
+#import "SPIndexProcessor.h"
+#import "SPDiffer.h"
+#import "SPSchema.h"
+#import "SPObject.h"
+#import "SPGhost.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPProcessorBenchmarksBucket         = @"Note";
+static NSString * const SPProcessorBenchmarksLabel          = @"SPProcessorBenchmarks";
+static NSString * const SPProcessorBenchmarksClientID       = @"Benchmark-Local";
+static NSString * const SPProcessorBenchmarksRemoteClientID = @"Benchmark-Remote";
+static NSString * const SPProcessorBenchmarksStartVersion   = @"1";
+static NSString * const SPProcessorBenchmarksEndVersion     = @"2";
+static NSUInteger const SPProcessorBenchmarksObjectCount    = 500;
+static NSUInteger const SPProcessorBenchmarksContentLength  = 2048;
+static NSUInteger const SPProcessorBenchmarksEdits          = 4;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPProcessorBenchmarks
+#pragma mark ====================================================================================
+
+@interface SPProcessorBenchmarks : SPBenchmarkTestCase
+@property (nonatomic, strong) MockStorage           *storage;
+@property (nonatomic, strong) SPBucket              *bucket;
+@property (nonatomic, strong) NSArray               *objects;
+@property (nonatomic, strong) NSDictionary          *baseData;
+@property (nonatomic, strong) NSMutableDictionary   *remoteData;
+@end
+
+@implementation SPProcessorBenchmarks
+
+- (void)setUp {
+    [super setUp];
+    
+    NSDictionary *definition = @{
+        @"members" : @[
+            @{ @"name" : @"content",    @"type" : @"text" },
+            @{ @"name" : @"pinned",     @"type" : @"bool" },
+            @{ @"name" : @"modified",   @"type" : @"double" },
+            @{ @"name" : @"tags",       @"type" : @"json" }
+        ]
+    };
+    
+    // Note: The bucket only keeps a weak reference to its storage
+    SPSchema *schema    = [[SPSchema alloc] initWithBucketName:SPProcessorBenchmarksBucket data:definition];
+    self.storage        = [MockStorage new];
+    self.bucket         = [[SPBucket alloc] initWithSchema:schema
+                                                   storage:self.storage
+                                          networkInterface:nil
+                                      relationshipResolver:nil
+                                                     label:SPProcessorBenchmarksLabel
+                                                remoteName:SPProcessorBenchmarksBucket
+                                                  clientID:SPProcessorBenchmarksClientID];
+    
+    [self.bucket.changeProcessor reset];
+    
+    NSMutableArray *objects     = [NSMutableArray arrayWithCapacity:SPProcessorBenchmarksObjectCount];
+    NSMutableDictionary *base   = [NSMutableDictionary dictionaryWithCapacity:SPProcessorBenchmarksObjectCount];
+    NSMutableDictionary *remote = [NSMutableDictionary dictionaryWithCapacity:SPProcessorBenchmarksObjectCount];
+    
+    for (NSUInteger i = 0; i < SPProcessorBenchmarksObjectCount; ++i) {
+        NSString *key           = [self randomStringOfLength:24];
+        NSString *content       = [self randomTextOfLength:SPProcessorBenchmarksContentLength];
+        NSArray *tags           = @[ [self randomStringOfLength:8], [self randomStringOfLength:8] ];
+        
+        base[key]               = @{ @"content" : content, @"pinned" : @NO, @"modified" : @(i), @"tags" : tags };
+        remote[key]             = @{ @"content" : [self text:content withRandomEdits:SPProcessorBenchmarksEdits], @"pinned" : @YES, @"modified" : @(i + 1), @"tags" : tags };
+        
+        SPObject *object        = [[SPObject alloc] initWithDictionary:[base[key] mutableCopy]];
+        object.simperiumKey     = key;
+        object.bucket           = self.bucket;
+        
+        [self.storage insertObject:object bucketName:SPProcessorBenchmarksBucket];
+        [objects addObject:object];
+    }
+    
+    self.objects    = objects;
+    self.baseData   = base;
+    self.remoteData = remote;
+}
+
+- (void)tearDown {
+    [self.bucket.changeProcessor reset];
+    [super tearDown];
+}
+
+- (void)testProcessRemoteChanges {
+    SPBucket *bucket        = self.bucket;
+    NSMutableArray *changes = [NSMutableArray arrayWithCapacity:self.objects.count];
+    
+    for (SPObject *object in self.objects) {
+        SPObject *remote    = [[SPObject alloc] initWithDictionary:[self.remoteData[object.simperiumKey] mutableCopy]];
+        NSDictionary *diff  = [bucket.differ diffFromDictionary:self.baseData[object.simperiumKey] toObject:remote];
+        
+        [changes addObject:@{
+            CH_CLIENT_ID        : SPProcessorBenchmarksRemoteClientID,
+            CH_CHANGE_VERSION   : [self randomStringOfLength:24],
+            CH_START_VERSION    : SPProcessorBenchmarksStartVersion,
+            CH_END_VERSION      : SPProcessorBenchmarksEndVersion,
+            CH_KEY              : object.simperiumKey,
+            CH_OPERATION        : CH_MODIFY,
+            CH_VALUE            : diff
+        }];
+    }
+    
+    __block NSUInteger errorCount = 0;
+    
+    [self benchmark:@"processor.remoteChanges" operations:changes.count prepare:^{
+        [self resetObjectsWithLocalData:self.baseData];
+    } block:^{
+        dispatch_sync(bucket.processorQueue, ^{
+            [bucket.changeProcessor processRemoteChanges:changes bucket:bucket successHandler:^(NSString *simperiumKey, NSString *version) {
+                // No-Op
+            } errorHandler:^(NSString *simperiumKey, NSString *version, NSError *error) {
+                ++errorCount;
+            }];
+        });
+    }];
+    
+    XCTAssertTrue(errorCount == 0, @"Inconsistency detected");
+}
+
+- (void)testProcessVersions {
+    [self benchmarkVersionsNamed:@"processor.versions" localData:self.baseData];
+}
+
+- (void)testProcessVersionsWithLocalChanges {
+    NSMutableDictionary *localData = [NSMutableDictionary dictionaryWithCapacity:self.baseData.count];
+    
+    for (NSString *key in self.baseData) {
+        NSMutableDictionary *data   = [self.baseData[key] mutableCopy];
+        data[@"content"]            = [self text:data[@"content"] withRandomEdits:SPProcessorBenchmarksEdits];
+        localData[key]              = data;
+    }
+    
+    [self benchmarkVersionsNamed:@"processor.versions.rebase" localData:localData];
+}
+
+
+#pragma mark - Helpers
+
+- (void)benchmarkVersionsNamed:(NSString *)name localData:(NSDictionary *)localData {
+    SPBucket *bucket            = self.bucket;
+    NSMutableArray *versions    = [NSMutableArray arrayWithCapacity:self.objects.count];
+    
+    for (SPObject *object in self.objects) {
+        [versions addObject:@[ object.simperiumKey, SPProcessorBenchmarksEndVersion, self.remoteData[object.simperiumKey] ]];
+    }
+    
+    [self benchmark:name operations:versions.count prepare:^{
+        [self resetObjectsWithLocalData:localData];
+    } block:^{
+        dispatch_sync(bucket.processorQueue, ^{
+            [bucket.indexProcessor processVersions:versions bucket:bucket changeHandler:^(NSString *key) {
+                // No-Op
+            }];
+        });
+    }];
+}
+
+// Every object goes back to the Start Version: ghosts hold the base data, while the members hold the local data
+- (void)resetObjectsWithLocalData:(NSDictionary *)localData {
+    for (SPObject *object in self.objects) {
+        NSString *key   = object.simperiumKey;
+        SPGhost *ghost  = [[SPGhost alloc] initWithKey:key memberData:self.baseData[key]];
+        ghost.version   = SPProcessorBenchmarksStartVersion;
+        object.ghost    = ghost;
+        
+        [object loadMemberData:localData[key]];
+    }
+}
+
+@end
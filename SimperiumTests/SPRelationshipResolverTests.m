@@ -32,10 +32,12 @@ static NSString *SPLegacyPathKey                    = @"SPPathKey";
 static NSString *SPLegacyPathBucket                 = @"SPPathBucket";
 static NSString *SPLegacyPathAttribute              = @"SPPathAttribute";
 static NSString *SPLegacyPendingsKey                = @"SPPendingReferences";
+static NSString *SPPendingsKey                      = @"SPRelationshipsPendingsNewKey";
 
 static NSInteger SPTestStressIterations             = 1000;
 static NSInteger SPTestIterations                   = 100;
 static NSInteger SPTestSubIterations                = 10;
+static NSInteger SPTestPerformanceIterations        = 50000;
 static NSTimeInterval const SPExpectationTimeout    = 60.0;
 
 
@@ -266,6 +268,47 @@ static NSTimeInterval const SPExpectationTimeout    = 60.0;
     XCTAssertTrue([self.resolver countPendingRelationships] == 0, @"Inconsistency detected");
 }
 
+- (void)testResolvePendingRelationshipsForMultipleKeys {
+    NSMutableArray *sourceObjects   = [NSMutableArray array];
+    NSMutableArray *targetObjects   = [NSMutableArray array];
+    NSMutableSet *targetKeys        = [NSMutableSet set];
+    
+    for (NSInteger i = 1; i <= SPTestIterations; ++i) {
+        SPObject *target    = [SPObject new];
+        target.simperiumKey = [NSString sp_makeUUID];
+        
+        SPObject *source    = [SPObject new];
+        source.simperiumKey = [NSString sp_makeUUID];
+        
+        SPRelationship *relationship = [SPRelationship relationshipFromObjectWithKey:source.simperiumKey
+                                                                           attribute:SPTestSourceAttribute
+                                                                        sourceBucket:SPTestSourceBucket
+                                                                     toObjectWithKey:target.simperiumKey
+                                                                        targetBucket:SPTestTargetBucket];
+        [self.resolver addPendingRelationship:relationship];
+        
+        [self.storage insertObject:source bucketName:SPTestSourceBucket];
+        [self.storage insertObject:target bucketName:SPTestTargetBucket];
+        
+        [sourceObjects addObject:source];
+        [targetObjects addObject:target];
+        [targetKeys addObject:target.simperiumKey];
+    }
+    
+    // Resolve every Target in a single pass
+    [self.resolver resolvePendingRelationshipsForKeys:targetKeys bucketName:SPTestTargetBucket storage:self.storage];
+    [self waitUntilResolverFinishes];
+    
+    // Verify
+    for (NSInteger i = 0; i < sourceObjects.count; ++i) {
+        SPObject *source = sourceObjects[i];
+        SPObject *target = targetObjects[i];
+        XCTAssert([source simperiumValueForKey:SPTestSourceAttribute] == target, @"Inconsistency detected");
+    }
+    
+    XCTAssertTrue([self.resolver countPendingRelationships] == 0, @"Inconsistency detected");
+}
+
 - (void)testStressRelationshipResolver {
     NSMutableArray *sourceObjects = [NSMutableArray array];
     NSMutableArray *targetObjects = [NSMutableArray array];
@@ -368,9 +411,153 @@ static NSTimeInterval const SPExpectationTimeout    = 60.0;
     }];
 }
 
+- (void)testJournaledRelationshipsSurviveReload {
+    NSURL *journalURL = [self temporaryJournalURL];
+    [self.resolver loadPendingRelationships:self.storage journalURL:journalURL];
+    
+    NSMutableArray *sourceObjects = [NSMutableArray array];
+    NSMutableArray *relationships = [NSMutableArray array];
+    
+    for (NSInteger i = 1; i <= SPTestIterations; ++i) {
+        SPObject *source    = [SPObject new];
+        source.simperiumKey = [NSString sp_makeUUID];
+        
+        SPRelationship *pending = [SPRelationship relationshipFromObjectWithKey:source.simperiumKey
+                                                                      attribute:SPTestSourceAttribute
+                                                                   sourceBucket:SPTestSourceBucket
+                                                                toObjectWithKey:[NSString sp_makeUUID]
+                                                                   targetBucket:SPTestTargetBucket];
+        [self.resolver addPendingRelationship:pending];
+        [self.resolver saveWithStorage:self.storage];
+        
+        [sourceObjects addObject:source];
+        [relationships addObject:pending];
+    }
+    
+    // The metadata should remain untouched
+    XCTAssertNil(self.storage.metadata[SPPendingsKey], @"Relationships should have been journaled");
+    
+    // Resolve the first half: their removal should get journaled as well
+    NSInteger resolvedCount = SPTestIterations / 2;
+    for (NSInteger i = 0; i < resolvedCount; ++i) {
+        SPRelationship *relationship    = relationships[i];
+        SPObject *target                = [SPObject new];
+        target.simperiumKey             = relationship.targetKey;
+        
+        [self.storage insertObject:sourceObjects[i] bucketName:SPTestSourceBucket];
+        [self.storage insertObject:target bucketName:SPTestTargetBucket];
+        [self.resolver resolvePendingRelationshipsForKey:target.simperiumKey bucketName:SPTestTargetBucket storage:self.storage];
+    }
+    
+    [self waitUntilResolverFinishes];
+    [self waitUntilResolverSynchronizes];
+    
+    XCTAssertTrue([self.resolver countPendingRelationships] == SPTestIterations - resolvedCount, @"Inconsistency detected");
+    
+    // ""Simulate"" App Relaunch
+    self.resolver = [SPRelationshipResolver new];
+    [self.resolver loadPendingRelationships:[MockStorage new] journalURL:journalURL];
+    
+    XCTAssertTrue([self.resolver countPendingRelationships] == SPTestIterations - resolvedCount, @"Inconsistency detected");
+    
+    for (NSInteger i = 0; i < relationships.count; ++i) {
+        SPRelationship *relationship    = relationships[i];
+        NSInteger expected              = (i < resolvedCount) ? 0 : 1;
+        NSInteger count                 = [self.resolver countPendingRelationshipsWithSourceKey:relationship.sourceKey andTargetKey:relationship.targetKey];
+        XCTAssertTrue(count == expected, @"Inconsistency detected");
+    }
+    
+    [[NSFileManager defaultManager] removeItemAtURL:journalURL error:nil];
+}
+
+- (void)testJournalMigratesMetadataRelationships {
+    for (NSInteger i = 1; i <= SPTestIterations; ++i) {
+        SPRelationship *pending = [SPRelationship relationshipFromObjectWithKey:[NSString sp_makeUUID]
+                                                                      attribute:SPTestSourceAttribute
+                                                                   sourceBucket:SPTestSourceBucket
+                                                                toObjectWithKey:[NSString sp_makeUUID]
+                                                                   targetBucket:SPTestTargetBucket];
+        [self.resolver addPendingRelationship:pending];
+    }
+    
+    [self.resolver saveWithStorage:self.storage];
+    XCTAssertNotNil(self.storage.metadata[SPPendingsKey], @"Relationships should have been stored in the metadata");
+    
+    // Relaunch with a journal: metadata relationships should get migrated
+    NSURL *journalURL = [self temporaryJournalURL];
+    
+    self.resolver = [SPRelationshipResolver new];
+    [self.resolver loadPendingRelationships:self.storage journalURL:journalURL];
+    XCTAssertNotNil(self.storage.metadata[SPPendingsKey], @"Relationships should remain until the journal hits the disk");
+    
+    [self waitUntilResolverSynchronizes];
+    
+    XCTAssertNil(self.storage.metadata[SPPendingsKey], @"Relationships should have been migrated");
+    XCTAssertTrue([self.resolver countPendingRelationships] == SPTestIterations, @"Inconsistency detected");
+    
+    // Relaunch once more: the journal alone should do
+    self.resolver = [SPRelationshipResolver new];
+    [self.resolver loadPendingRelationships:self.storage journalURL:journalURL];
+    
+    XCTAssertTrue([self.resolver countPendingRelationships] == SPTestIterations, @"Inconsistency detected");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:journalURL error:nil];
+}
+
+- (void)testPendingRelationshipsPerformance {
+    NSMutableArray *relationships = [NSMutableArray array];
+    
+    for (NSInteger i = 1; i <= SPTestPerformanceIterations; ++i) {
+        SPRelationship *pending = [SPRelationship relationshipFromObjectWithKey:[NSString sp_makeUUID]
+                                                                      attribute:SPTestSourceAttribute
+                                                                   sourceBucket:SPTestSourceBucket
+                                                                toObjectWithKey:[NSString sp_makeUUID]
+                                                                   targetBucket:SPTestTargetBucket];
+        [relationships addObject:pending];
+    }
+    
+    [self measureBlock:^{
+        NSURL *journalURL                   = [self temporaryJournalURL];
+        SPRelationshipResolver *resolver    = [SPRelationshipResolver new];
+        [resolver loadPendingRelationships:self.storage journalURL:journalURL];
+        
+        // Saved one by one, just like SPMemberEntity does
+        for (SPRelationship *relationship in relationships) {
+            [resolver addPendingRelationship:relationship];
+            [resolver saveWithStorage:self.storage];
+        }
+        
+        for (SPRelationship *relationship in relationships) {
+            [resolver countPendingRelationshipsWithSourceKey:relationship.sourceKey andTargetKey:relationship.targetKey];
+            [resolver resolvePendingRelationshipsForKey:relationship.targetKey bucketName:SPTestTargetBucket storage:self.storage];
+        }
+        
+        XCTAssertTrue([resolver countPendingRelationships] == SPTestPerformanceIterations, @"Inconsistency detected");
+        
+        [[NSFileManager defaultManager] removeItemAtURL:journalURL error:nil];
+    }];
+}
+
 
 #pragma mark - Helpers
 
+- (NSURL *)temporaryJournalURL {
+    NSString *folder = [NSString stringWithFormat:@"SPRelationshipResolverTests-%@", [[NSUUID UUID] UUIDString]];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:folder] isDirectory:YES];
+}
+
+- (void)waitUntilResolverSynchronizes {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Journal Expectation"];
+    
+    [self.resolver synchronizeWithCompletion:^{
+        [expectation fulfill];
+    }];
+    
+    [self waitForExpectationsWithTimeout:SPExpectationTimeout handler:^(NSError *error) {
+        XCTAssertNil(error, @"Expectations Timeout");
+    }];
+}
+
 - (void)waitUntilResolverFinishes {
     XCTestExpectation *expectation = [self expectationWithDescription:@"Resolver Expectation"];
     
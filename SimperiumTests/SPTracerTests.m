@@ -0,0 +1,102 @@
+//
+//  SPTracerTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPTracer.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPTracerTestsBucket     = @"notes";
+static NSString * const SPTracerTestsKey        = @"1234";
+static NSInteger const SPTracerTestsIterations  = 1000000;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPTracerTests
+#pragma mark ====================================================================================
+
+@interface SPTracerTests : XCTestCase
+@property (nonatomic, strong) NSURL *traceFileURL;
+@end
+
+@implementation SPTracerTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *filename  = [NSString stringWithFormat:@"SPTracerTests-%@.json", [[NSUUID UUID] UUIDString]];
+    self.traceFileURL   = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:filename]];
+}
+
+- (void)tearDown {
+    [[SPTracer sharedInstance] stopTracing];
+    [[NSFileManager defaultManager] removeItemAtURL:self.traceFileURL error:nil];
+    [super tearDown];
+}
+
+- (void)traceNestedSpans {
+    SPTraceScope("outer", SPTracerTestsBucket, nil);
+    
+    for (NSInteger i = 0; i < 2; ++i) {
+        SPTraceScope("inner", SPTracerTestsBucket, SPTracerTestsKey);
+        if (i == 0) {
+            continue;
+        }
+    }
+}
+
+- (void)testSpansAreWrittenAsChromeTraceEvents {
+    [[SPTracer sharedInstance] startTracingToURL:self.traceFileURL];
+    [self traceNestedSpans];
+    [[SPTracer sharedInstance] stopTracing];
+    
+    NSData *data    = [NSData dataWithContentsOfURL:self.traceFileURL];
+    NSArray *events = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    NSArray *phases = [events valueForKey:@"ph"];
+    NSArray *names  = [events valueForKey:@"name"];
+    
+    XCTAssertEqualObjects(phases, (@[ @"B", @"B", @"E", @"B", @"E", @"E" ]), @"Inconsistency detected");
+    XCTAssertEqualObjects(names, (@[ @"outer", @"inner", @"inner", @"inner", @"inner", @"outer" ]), @"Inconsistency detected");
+    
+    NSDictionary *inner = events[1];
+    XCTAssertEqualObjects(inner[@"args"][@"bucket"], SPTracerTestsBucket, @"Inconsistency detected");
+    XCTAssertEqualObjects(inner[@"args"][@"key"], SPTracerTestsKey, @"Inconsistency detected");
+    
+    // Timestamps should never go backwards, within a thread
+    double lastTimestamp = 0;
+    for (NSDictionary *event in events) {
+        XCTAssertTrue([event[@"ts"] doubleValue] >= lastTimestamp, @"Inconsistency detected");
+        lastTimestamp = [event[@"ts"] doubleValue];
+    }
+}
+
+- (void)testNothingGetsRecordedWhileDisabled {
+    [[SPTracer sharedInstance] startTracingToURL:self.traceFileURL];
+    [[SPTracer sharedInstance] stopTracing];
+    
+    [self traceNestedSpans];
+    [[SPTracer sharedInstance] flush];
+    
+    NSData *data    = [NSData dataWithContentsOfURL:self.traceFileURL];
+    NSArray *events = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    
+    XCTAssertTrue([events isKindOfClass:[NSArray class]] && events.count == 0, @"Inconsistency detected");
+}
+
+- (void)testDisabledTracingPerformance {
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < SPTracerTestsIterations; ++i) {
+            SPTraceScope("disabled", SPTracerTestsBucket, SPTracerTestsKey);
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,132 @@
+//
+//  SPWebSocketRecorderTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "XCTestCase+Simperium.h"
+#import "SPWebSocketRecorder.h"
+#import "SPWebSocketReplayer.h"
+#import "MockSimperium.h"
+#import "MockWebSocketInterface.h"
+#import "JSONKit+Simperium.h"
+#import "Config.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPWebSocketRecorderTestsMultiline       = @"0:c:[{\"v\": {\"captainsLog\": \"line\\nbreak\"}}]\nh:1";
+static NSString * const SPWebSocketRecorderTestsUnicode         = @"0:e:1234.1\n{\"data\": {\"captainsLog\": \"Bitácora 🚀\"}}";
+static int const SPWebSocketRecorderTestsRecordedChannel        = 7;
+static NSTimeInterval const SPWebSocketRecorderTestsTimeout     = 5;
+
+
+#pragma mark ====================================================================================
+#pragma mark SPWebSocketRecorderTests
+#pragma mark ====================================================================================
+
+@interface SPWebSocketRecorderTests : XCTestCase
+@property (nonatomic, strong) NSURL *recordingURL;
+@end
+
+@implementation SPWebSocketRecorderTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *filename  = [NSString stringWithFormat:@"SPWebSocketRecorderTests-%@.spws", [[NSUUID UUID] UUIDString]];
+    self.recordingURL   = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:filename]];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.recordingURL error:nil];
+    [super tearDown];
+}
+
+- (void)testRecordingRoundTrip {
+    SPWebSocketRecorder *recorder = [SPWebSocketRecorder recorderWithURL:self.recordingURL];
+    [recorder recordMessage:@"0:init:{\"name\": \"config\"}" direction:SPWebSocketDirectionOutbound];
+    [recorder recordMessage:SPWebSocketRecorderTestsMultiline direction:SPWebSocketDirectionInbound];
+    [recorder recordMessage:SPWebSocketRecorderTestsUnicode direction:SPWebSocketDirectionInbound];
+    [recorder close];
+    
+    // Length prefixes should survive embedded newlines and multibyte characters
+    SPWebSocketReplayer *replayer = [SPWebSocketReplayer replayerWithURL:self.recordingURL];
+    XCTAssertNotNil(replayer, @"Inconsistency detected");
+    XCTAssertTrue(replayer.inboundCount == 2, @"Inconsistency detected");
+    XCTAssertTrue(replayer.outboundCount == 1, @"Inconsistency detected");
+    XCTAssertTrue(replayer.duration >= 0, @"Inconsistency detected");
+}
+
+- (void)testCredentialsAreRedacted {
+    NSDictionary *payload           = @{ @"name" : @"config", @"token" : @"secret-token", @"username" : @"someone@example.com" };
+    NSString *initMessage           = [NSString stringWithFormat:@"0:init:%@", [payload sp_JSONString]];
+    
+    SPWebSocketRecorder *recorder   = [SPWebSocketRecorder recorderWithURL:self.recordingURL];
+    [recorder recordMessage:initMessage direction:SPWebSocketDirectionOutbound];
+    [recorder recordMessage:@"0:auth:someone@example.com" direction:SPWebSocketDirectionInbound];
+    [recorder close];
+    
+    NSString *recording = [NSString stringWithContentsOfURL:self.recordingURL encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertFalse([recording containsString:@"secret-token"], @"Tokens should never hit the disk");
+    XCTAssertFalse([recording containsString:@"someone@example.com"], @"Emails should never hit the disk");
+    XCTAssertTrue([recording containsString:@"config"], @"Bucket names are needed to map channels on replay");
+}
+
+- (void)testMalformedRecordingIsRejected {
+    SPWebSocketRecorder *recorder = [SPWebSocketRecorder recorderWithURL:self.recordingURL];
+    [recorder recordMessage:SPWebSocketRecorderTestsUnicode direction:SPWebSocketDirectionInbound];
+    [recorder close];
+    
+    // Chop off the trailing bytes: the payload no longer matches its length prefix
+    NSData *data = [NSData dataWithContentsOfURL:self.recordingURL];
+    [[data subdataWithRange:NSMakeRange(0, data.length - 2)] writeToURL:self.recordingURL atomically:YES];
+    
+    XCTAssertNil([SPWebSocketReplayer replayerWithURL:self.recordingURL], @"Inconsistency detected");
+}
+
+- (void)testReplayMapsRecordedChannels {
+    MockSimperium *s                = [MockSimperium mockSimperium];
+    SPBucket *bucket                = [s bucketForName:NSStringFromClass([Config class])];
+    MockWebSocketChannel *channel   = [s.mockWebSocketInterface mockChannelForBucket:bucket];
+    
+    // The recorded session had the very same bucket, on a different channel number
+    NSDictionary *payload           = @{ @"name" : channel.remoteName };
+    NSString *initMessage           = [NSString stringWithFormat:@"%d:init:%@", SPWebSocketRecorderTestsRecordedChannel, [payload sp_JSONString]];
+    NSString *indexMessage          = [NSString stringWithFormat:@"%d:index", SPWebSocketRecorderTestsRecordedChannel];
+    
+    SPWebSocketRecorder *recorder   = [SPWebSocketRecorder recorderWithURL:self.recordingURL];
+    [recorder recordMessage:initMessage direction:SPWebSocketDirectionOutbound];
+    [recorder recordMessage:indexMessage direction:SPWebSocketDirectionInbound];
+    [recorder close];
+    
+    SPWebSocketReplayer *replayer   = [SPWebSocketReplayer replayerWithURL:self.recordingURL];
+    __block NSUInteger replayed     = 0;
+    
+    [replayer replayIntoSimperium:s timing:SPWebSocketReplayTimingImmediate completion:^(NSUInteger messageCount, NSTimeInterval elapsed) {
+        replayed = messageCount;
+    }];
+    
+    NSDate *timeoutDate = [NSDate dateWithTimeIntervalSinceNow:SPWebSocketRecorderTestsTimeout];
+    while (replayed == 0 && [timeoutDate timeIntervalSinceNow] > 0) {
+        [self waitFor:0.1];
+    }
+    
+    // The index state request should have been answered on the local channel
+    NSString *expectedPrefix    = [NSString stringWithFormat:@"%d:index:", channel.number];
+    BOOL responseSent           = NO;
+    
+    for (NSString *sent in s.mockWebSocketInterface.mockSentMessages) {
+        responseSent |= [sent hasPrefix:expectedPrefix];
+    }
+    
+    XCTAssertTrue(replayed == 1, @"Inconsistency detected");
+    XCTAssertTrue(responseSent, @"Inconsistency detected");
+}
+
+@end
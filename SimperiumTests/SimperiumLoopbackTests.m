@@ -0,0 +1,206 @@
+//
+//  SimperiumLoopbackTests.m
+//  Simperium
+//
+//  Created by Simperium on 10/19/26.
+//  Copyright (c) 2026 Simperium. All rights reserved.
+//
+
+#import "SimperiumTests.h"
+#import "SPLoopbackServer.h"
+#import "NSString+Simperium.h"
+#import "Config.h"
+#import "Farm.h"
+#import "SPBucket.h"
+
+
+
+#pragma mark ====================================================================================
+#pragma mark Constants
+#pragma mark ====================================================================================
+
+static NSString * const SPLoopbackTestsToken                = @"loopback-token";
+static NSUInteger const SPLoopbackTestsFarmCount            = 4;
+static NSUInteger const SPLoopbackTestsObjectCount          = 200;
+static NSUInteger const SPLoopbackTestsIndexObjectCount     = 120;
+static NSUInteger const SPLoopbackTestsIndexPageSize        = 25;
+static NSTimeInterval const SPLoopbackTestsLatency          = 0.02;
+static NSUInteger const SPLoopbackTestsBandwidth            = 1024 * 1024;
+static double const SPLoopbackTestsErrorRate                = 0.2;
+static NSTimeInterval const SPLoopbackTestsTimeout          = 60;
+static NSTimeInterval const SPLoopbackTestsPollInterval     = 0.01;
+
+
+#pragma mark ====================================================================================
+#pragma mark SimperiumLoopbackTests
+#pragma mark ====================================================================================
+
+// Drives Farms through an in-process SPLoopbackServer, rather than through the Simperium backend. Every scenario
+// logs its sync throughput (changes delivered per second, across all of the farms) and its convergence time.
+//
+@interface SimperiumLoopbackTests : SimperiumTests
+@property (nonatomic, strong) SPLoopbackServer *server;
+@end
+
+@implementation SimperiumLoopbackTests
+
+- (void)authorize {
+    self.server             = [SPLoopbackServer new];
+    self.server.latency     = SPLoopbackTestsLatency;
+    self.server.bandwidth   = SPLoopbackTestsBandwidth;
+    [self.server start];
+    
+    self.token = SPLoopbackTestsToken;
+}
+
+- (void)tearDown {
+    [super tearDown];
+    [self.server stop];
+}
+
+- (void)testSyncThroughput {
+    NSArray *farms  = [self startLoopbackFarms:SPLoopbackTestsFarmCount];
+    Farm *leader    = farms.firstObject;
+    
+    // Leader inserts, followers receive
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self insertConfigs:SPLoopbackTestsObjectCount farm:leader];
+    [self expectAdditions:(int)SPLoopbackTestsObjectCount deletions:0 changes:0 fromLeader:leader expectAcks:YES];
+    
+    [self waitForConvergenceNamed:@"insertions" farms:farms changes:SPLoopbackTestsObjectCount * (farms.count - 1) startTime:startTime];
+    
+    // Every farm edits its own share of the objects, concurrently
+    startTime = CFAbsoluteTimeGetCurrent();
+    [self resetExpectations:farms];
+    
+    for (NSUInteger i = 0; i < farms.count; ++i) {
+        Farm *farm          = farms[i];
+        NSUInteger edits    = [self editConfigsWithStride:farms.count offset:i farm:farm];
+        farm.expectedAcknowledgments += (int)edits;
+        
+        for (Farm *follower in farms) {
+            if (follower != farm) {
+                follower.expectedChanges += (int)edits;
+            }
+        }
+    }
+    
+    [self waitForConvergenceNamed:@"edits" farms:farms changes:SPLoopbackTestsObjectCount * (farms.count - 1) startTime:startTime];
+    [self ensureFarmsEqual:farms entityName:[Config entityName]];
+}
+
+- (void)testConvergenceWithInjectedErrors {
+    self.server.changeErrorRate = SPLoopbackTestsErrorRate;
+    
+    NSArray *farms  = [self startLoopbackFarms:SPLoopbackTestsFarmCount];
+    Farm *leader    = farms.firstObject;
+    
+    // Rejected changes get retried by the client: everything should get through, eventually
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self insertConfigs:SPLoopbackTestsObjectCount farm:leader];
+    [self expectAdditions:(int)SPLoopbackTestsObjectCount deletions:0 changes:0 fromLeader:leader expectAcks:YES];
+    
+    [self waitForConvergenceNamed:@"insertions.errors" farms:farms changes:SPLoopbackTestsObjectCount * (farms.count - 1) startTime:startTime];
+    [self ensureFarmsEqual:farms entityName:[Config entityName]];
+    
+    XCTAssertTrue([self.server.stats[SPLoopbackStatsErrorsInjected] unsignedIntegerValue] > 0, @"Inconsistency detected");
+}
+
+- (void)testIndexPaging {
+    self.server.indexPageSize = SPLoopbackTestsIndexPageSize;
+    
+    Farm *leader = [[self startLoopbackFarms:1] firstObject];
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self insertConfigs:SPLoopbackTestsIndexObjectCount farm:leader];
+    leader.expectedAcknowledgments = (int)SPLoopbackTestsIndexObjectCount;
+    
+    [self waitForConvergenceNamed:@"acknowledgements" farms:@[ leader ] changes:SPLoopbackTestsIndexObjectCount startTime:startTime];
+    
+    // A late joiner gets everything through the index, a page at a time
+    NSUInteger indexPages   = [self.server.stats[SPLoopbackStatsIndexPages] unsignedIntegerValue];
+    startTime               = CFAbsoluteTimeGetCurrent();
+    
+    Farm *follower                      = [self createFarm:@"loopback follower"];
+    follower.expectedIndexCompletions   = 1;
+    follower.expectedAdditions          = (int)SPLoopbackTestsIndexObjectCount;
+    [follower start];
+    
+    [self waitForConvergenceNamed:@"index" farms:@[ follower ] changes:SPLoopbackTestsIndexObjectCount startTime:startTime];
+    [self ensureFarmsEqual:self.farms entityName:[Config entityName]];
+    
+    NSUInteger followerPages = [self.server.stats[SPLoopbackStatsIndexPages] unsignedIntegerValue] - indexPages;
+    XCTAssertTrue(followerPages > SPLoopbackTestsIndexObjectCount / SPLoopbackTestsIndexPageSize, @"Inconsistency detected");
+}
+
+
+#pragma mark - Helpers
+
+- (NSArray *)startLoopbackFarms:(NSUInteger)count {
+    NSMutableArray *farms = [NSMutableArray arrayWithCapacity:count];
+    
+    for (NSUInteger i = 0; i < count; ++i) {
+        NSString *label                 = [NSString stringWithFormat:@"loopback %@", [NSString sp_makeUUID]];
+        Farm *farm                      = [self createFarm:label];
+        farm.expectedIndexCompletions   = 1;
+        [farm start];
+        [farms addObject:farm];
+    }
+    
+    [self waitForConvergenceNamed:@"connection" farms:farms changes:0 startTime:CFAbsoluteTimeGetCurrent()];
+    
+    return farms;
+}
+
+- (void)insertConfigs:(NSUInteger)count farm:(Farm *)farm {
+    SPBucket *bucket = [farm.simperium bucketForName:[Config entityName]];
+    
+    for (NSUInteger i = 0; i < count; ++i) {
+        Config *config      = [bucket insertNewObject];
+        config.warpSpeed    = @(i);
+        config.captainsLog  = [NSString stringWithFormat:@"Captain's log, entry %lu", (unsigned long)i];
+    }
+    
+    [farm.simperium save];
+}
+
+// Keys are sorted, so that every farm picks the very same share
+- (NSUInteger)editConfigsWithStride:(NSUInteger)stride offset:(NSUInteger)offset farm:(Farm *)farm {
+    SPBucket *bucket        = [farm.simperium bucketForName:[Config entityName]];
+    NSSortDescriptor *sort  = [NSSortDescriptor sortDescriptorWithKey:@"simperiumKey" ascending:YES];
+    NSArray *configs        = [[bucket allObjects] sortedArrayUsingDescriptors:@[ sort ]];
+    NSUInteger edits        = 0;
+    
+    for (NSUInteger i = offset; i < configs.count; i += stride) {
+        Config *config      = configs[i];
+        config.captainsLog  = [config.captainsLog stringByAppendingFormat:@", edited by %@", farm.simperium.label];
+        ++edits;
+    }
+    
+    [farm.simperium save];
+    
+    return edits;
+}
+
+- (void)waitForConvergenceNamed:(NSString *)name farms:(NSArray *)farms changes:(NSUInteger)changes startTime:(CFAbsoluteTime)startTime {
+    NSDate *timeoutDate = [NSDate dateWithTimeIntervalSinceNow:SPLoopbackTestsTimeout];
+    
+    while (![self farmsDone:farms] && [timeoutDate timeIntervalSinceNow] > 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:SPLoopbackTestsPollInterval]];
+    }
+    
+    BOOL converged = [self farmsDone:farms];
+    if (!converged) {
+        for (Farm *farm in farms) {
+            [farm logUnfulfilledExpectations];
+        }
+    }
+    
+    XCTAssertTrue(converged, @"Timed out while waiting for %@", name);
+    
+    NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - startTime;
+    NSLog(@"<> Loopback %@ (%@): %lu farms, %lu changes, %.0f changes/sec, converged in %.3fs, server %@",
+          self.name, name, (unsigned long)farms.count, (unsigned long)changes, changes / MAX(elapsed, DBL_EPSILON), elapsed, self.server.stats);
+}
+
+@end
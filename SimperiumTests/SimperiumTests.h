@@ -20,6 +20,7 @@
 @property (nonatomic, copy)   NSString			*token;
 @property (nonatomic, assign) BOOL				done;
 
+- (void)authorize;
 - (void)waitFor:(NSTimeInterval)seconds;
 - (BOOL)farmsDone:(NSArray *)farmArray;
 - (BOOL)waitForCompletion:(NSTimeInterval)timeoutSecs farmArray:(NSArray *)farmArray;
@@ -112,7 +112,10 @@
 
 - (void)setUp {
     [super setUp];
-	
+    [self authorize];
+}
+
+- (void)authorize {
 	// prepare the URL Request
     NSURL *tokenURL = [NSURL URLWithString:[NSString stringWithFormat:@"%@/1/%@/authorize/", SERVER, APP_ID]];
 	NSMutableURLRequest* request = [[NSMutableURLRequest alloc] initWithURL:tokenURL];